@@ -55,8 +55,6 @@
 #include <vtkImageData.h>
 #include <vtkDoubleArray.h>
 #include <vtkTable.h>
-#include <vtkPlane.h>
-#include <vtkCubeSource.h>
 
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkAlgorithmOutput.h>
@@ -78,13 +76,22 @@
 #include <vtkTransform.h>
 #include <vtkMatrix4x4.h>
 #include <vtkMath.h> // cross, dot vector operations
+#include <vtkTriangleFilter.h>
+#include <vtkCellArray.h>
+#include <vtkSMPTools.h>
+#include <vtkCollection.h>
 
 // SlicerRtCommon includes
 #include <vtkSlicerRtCommon.h>
-#include <vtkCollisionDetectionFilter.h>
 
 // STD includes
 #include <algorithm>
+#include <array>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <vector>
 
 namespace
 {
@@ -92,19 +99,441 @@ namespace
 const char* MLCX_BOUNDARYANDPOSITION = "MLCX_BoundaryAndPosition";
 const char* MLCY_BOUNDARYANDPOSITION = "MLCY_BoundaryAndPosition";
 
+typedef std::vector< std::array< double, 3 > > PolygonType;
+
+/// Clip polygon by the half space sign * (point[axis] - value) <= 0 (Sutherland-Hodgman)
+void ClipPolygon(const PolygonType& polygon, int axis, double value, double sign, PolygonType& clippedPolygon)
+{
+  clippedPolygon.clear();
+  size_t nofPoints = polygon.size();
+  for (size_t i = 0; i < nofPoints; ++i)
+  {
+    const std::array< double, 3 >& current = polygon[i];
+    const std::array< double, 3 >& next = polygon[(i + 1) % nofPoints];
+    double currentDistance = sign * (current[axis] - value);
+    double nextDistance = sign * (next[axis] - value);
+    if (currentDistance <= 0.)
+    {
+      clippedPolygon.push_back(current);
+    }
+    if ((currentDistance < 0. && nextDistance > 0.) || (currentDistance > 0. && nextDistance < 0.))
+    {
+      double t = currentDistance / (currentDistance - nextDistance);
+      std::array< double, 3 > intersection;
+      for (int k = 0; k < 3; ++k)
+      {
+        intersection[k] = current[k] + t * (next[k] - current[k]);
+      }
+      clippedPolygon.push_back(intersection);
+    }
+  }
+}
+
+/// Extend leaf axis extent by the part of a polygon within a leaf pair strip.
+/// Polygon is in IEC BEAM LIMITING DEVICE coordinate system.
+/// @param polygon - polygon to clip, it is modified
+/// @param leafAxis - axis of leaf movement (0 = MLCX, 1 = MLCY)
+/// @param stripBegin - leaf pair boundary begin
+/// @param stripEnd - leaf pair boundary end
+/// @param slabHalfThickness - polygon is also clipped by |z| <= slabHalfThickness if positive
+/// @param extent - leaf axis extent (min, max) to extend
+/// @return true if part of the polygon is within the strip, false otherwise
+bool ExtendExtentByPolygonInStrip(PolygonType& polygon, int leafAxis, double stripBegin, double stripEnd,
+  double slabHalfThickness, double extent[2])
+{
+  PolygonType clippedPolygon;
+  int stripAxis = 1 - leafAxis;
+  ClipPolygon( polygon, stripAxis, stripBegin, -1., clippedPolygon);
+  ClipPolygon( clippedPolygon, stripAxis, stripEnd, 1., polygon);
+  if (slabHalfThickness > 0.)
+  {
+    ClipPolygon( polygon, 2, -1. * slabHalfThickness, -1., clippedPolygon);
+    ClipPolygon( clippedPolygon, 2, slabHalfThickness, 1., polygon);
+  }
+  for (const std::array< double, 3 >& point : polygon)
+  {
+    extent[0] = std::min( extent[0], point[leafAxis]);
+    extent[1] = std::max( extent[1], point[leafAxis]);
+  }
+  return !polygon.empty();
+}
+
+/// Assign every target triangle to the leaf pairs whose strip its projection on the strip axis overlaps
+/// @param leafPairTriangles - output triangle ids for each leaf pair
+void AssignTrianglesToLeafPairs(const std::vector<double>& pointCoordinates, const std::vector<vtkIdType>& trianglePointIds,
+  const std::vector<double>& leafPairBoundaries, int leafAxis, std::vector< std::vector<vtkIdType> >& leafPairTriangles)
+{
+  vtkIdType nofLeafPairs = static_cast<vtkIdType>(leafPairBoundaries.size()) - 1;
+  leafPairTriangles.assign(nofLeafPairs, std::vector<vtkIdType>());
+  bool ascendingBoundaries = std::is_sorted( leafPairBoundaries.begin(), leafPairBoundaries.end());
+
+  vtkIdType nofTriangles = static_cast<vtkIdType>(trianglePointIds.size() / 3);
+  for (vtkIdType triangleId = 0; triangleId < nofTriangles; ++triangleId)
+  {
+    double stripMin = std::numeric_limits<double>::max();
+    double stripMax = std::numeric_limits<double>::lowest();
+    for (vtkIdType vertex = 0; vertex < 3; ++vertex)
+    {
+      vtkIdType pointId = trianglePointIds[3 * triangleId + vertex];
+      stripMin = std::min( stripMin, pointCoordinates[3 * pointId + 1 - leafAxis]);
+      stripMax = std::max( stripMax, pointCoordinates[3 * pointId + 1 - leafAxis]);
+    }
+
+    vtkIdType firstLeafPair = 0;
+    vtkIdType lastLeafPair = nofLeafPairs - 1;
+    if (ascendingBoundaries)
+    {
+      firstLeafPair = std::max<vtkIdType>( 0, std::lower_bound( leafPairBoundaries.begin(), leafPairBoundaries.end(), stripMin)
+        - leafPairBoundaries.begin() - 1);
+      lastLeafPair = std::min<vtkIdType>( nofLeafPairs - 1, std::upper_bound( leafPairBoundaries.begin(), leafPairBoundaries.end(), stripMax)
+        - leafPairBoundaries.begin() - 1);
+    }
+    for (vtkIdType leafPair = firstLeafPair; leafPair <= lastLeafPair; ++leafPair)
+    {
+      leafPairTriangles[leafPair].push_back(triangleId);
+    }
+  }
+}
+
+/// Leaf axis extent of the target triangles within the strip of each leaf pair.
+/// Every leaf pair only processes the triangles overlapping its strip, leaf pairs are independent.
+class LeafPairTargetExtentFunctor
+{
+public:
+  LeafPairTargetExtentFunctor(const std::vector<double>& pointCoordinates, const std::vector<vtkIdType>& trianglePointIds,
+    const std::vector< std::vector<vtkIdType> >& leafPairTriangles, const std::vector<double>& leafPairBoundaries,
+    const std::vector<vtkIdType>& leafPairs, int leafAxis, double slabHalfThickness,
+    std::vector<double>& side1, std::vector<double>& side2, std::vector<char>& extentFound)
+    : PointCoordinates(pointCoordinates)
+    , TrianglePointIds(trianglePointIds)
+    , LeafPairTriangles(leafPairTriangles)
+    , LeafPairBoundaries(leafPairBoundaries)
+    , LeafPairs(leafPairs)
+    , LeafAxis(leafAxis)
+    , SlabHalfThickness(slabHalfThickness)
+    , Side1(side1)
+    , Side2(side2)
+    , ExtentFound(extentFound)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    PolygonType triangle;
+    for (vtkIdType index = begin; index < end; ++index)
+    {
+      vtkIdType leafPair = this->LeafPairs[index];
+      double extent[2] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest() };
+      bool found = false;
+      for (vtkIdType triangleId : this->LeafPairTriangles[leafPair])
+      {
+        triangle.resize(3);
+        for (int vertex = 0; vertex < 3; ++vertex)
+        {
+          const double* point = &this->PointCoordinates[3 * this->TrianglePointIds[3 * triangleId + vertex]];
+          triangle[vertex] = { point[0], point[1], point[2] };
+        }
+        found |= ExtendExtentByPolygonInStrip( triangle, this->LeafAxis, this->LeafPairBoundaries[leafPair],
+          this->LeafPairBoundaries[leafPair + 1], this->SlabHalfThickness, extent);
+      }
+      this->ExtentFound[leafPair] = found;
+      if (found)
+      {
+        this->Side1[leafPair] = extent[0];
+        this->Side2[leafPair] = extent[1];
+      }
+    }
+  }
+
+private:
+  const std::vector<double>& PointCoordinates;
+  const std::vector<vtkIdType>& TrianglePointIds;
+  const std::vector< std::vector<vtkIdType> >& LeafPairTriangles;
+  const std::vector<double>& LeafPairBoundaries;
+  const std::vector<vtkIdType>& LeafPairs;
+  int LeafAxis;
+  double SlabHalfThickness;
+  std::vector<double>& Side1;
+  std::vector<double>& Side2;
+  std::vector<char>& ExtentFound;
+};
+
+/// Leaf positions conformed to the target for a sequence of control points.
+/// Every control point rotates the target points into its own beam frame and fits
+/// all leaf pairs, control points are independent.
+class ControlPointLeafPositionsFunctor
+{
+public:
+  ControlPointLeafPositionsFunctor(const std::vector<double>& pointCoordinates, const std::vector<vtkIdType>& trianglePointIds,
+    const std::vector< std::array<double, 9> >& rotations, const std::vector<double>& leafPairBoundaries,
+    int leafAxis, double slabHalfThickness, double margin, double* leafPositions)
+    : PointCoordinates(pointCoordinates)
+    , TrianglePointIds(trianglePointIds)
+    , Rotations(rotations)
+    , LeafPairBoundaries(leafPairBoundaries)
+    , LeafAxis(leafAxis)
+    , SlabHalfThickness(slabHalfThickness)
+    , Margin(margin)
+    , LeafPositions(leafPositions)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType nofLeafPairs = static_cast<vtkIdType>(this->LeafPairBoundaries.size()) - 1;
+    size_t nofPoints = this->PointCoordinates.size() / 3;
+    std::vector<double> controlPointCoordinates(3 * nofPoints);
+    std::vector< std::vector<vtkIdType> > leafPairTriangles;
+    std::vector<vtkIdType> leafPairs(nofLeafPairs);
+    for (vtkIdType leafPair = 0; leafPair < nofLeafPairs; ++leafPair)
+    {
+      leafPairs[leafPair] = leafPair;
+    }
+    std::vector<double> side1(nofLeafPairs), side2(nofLeafPairs);
+    std::vector<char> extentFound(nofLeafPairs);
+
+    for (vtkIdType controlPoint = begin; controlPoint < end; ++controlPoint)
+    {
+      const std::array<double, 9>& rotation = this->Rotations[controlPoint];
+      for (size_t i = 0; i < nofPoints; ++i)
+      {
+        const double* point = &this->PointCoordinates[3 * i];
+        for (int row = 0; row < 3; ++row)
+        {
+          controlPointCoordinates[3 * i + row] = rotation[3 * row] * point[0]
+            + rotation[3 * row + 1] * point[1] + rotation[3 * row + 2] * point[2];
+        }
+      }
+
+      AssignTrianglesToLeafPairs( controlPointCoordinates, this->TrianglePointIds, this->LeafPairBoundaries,
+        this->LeafAxis, leafPairTriangles);
+      LeafPairTargetExtentFunctor extentFunctor( controlPointCoordinates, this->TrianglePointIds, leafPairTriangles,
+        this->LeafPairBoundaries, leafPairs, this->LeafAxis, this->SlabHalfThickness, side1, side2, extentFound);
+      extentFunctor( 0, nofLeafPairs);
+
+      // Leaf pairs without target are closed
+      double* positions = this->LeafPositions + 2 * controlPoint * nofLeafPairs;
+      for (vtkIdType leafPair = 0; leafPair < nofLeafPairs; ++leafPair)
+      {
+        positions[2 * leafPair] = extentFound[leafPair] ? side1[leafPair] - this->Margin : 0.;
+        positions[2 * leafPair + 1] = extentFound[leafPair] ? side2[leafPair] + this->Margin : 0.;
+      }
+    }
+  }
+
+private:
+  const std::vector<double>& PointCoordinates;
+  const std::vector<vtkIdType>& TrianglePointIds;
+  const std::vector< std::array<double, 9> >& Rotations;
+  const std::vector<double>& LeafPairBoundaries;
+  int LeafAxis;
+  double SlabHalfThickness;
+  double Margin;
+  double* LeafPositions;
+};
+
 } // namespace
 
+//----------------------------------------------------------------------------
+class vtkSlicerMLCPositionLogic::vtkInternal
+{
+public:
+  /// Beam's eye view of a target for one beam.
+  /// The cache is valid as long as the signature (target modified time, beam geometry and beam to world transform) does not change.
+  struct TargetProjectionCache
+  {
+    std::string Signature;
+    /// Target points in IEC BEAM LIMITING DEVICE coordinate system (x, y, z)
+    std::vector<double> PointCoordinates;
+    /// Point ids of the target triangles
+    std::vector<vtkIdType> TrianglePointIds;
+    /// Convex hull of the target projected on the isocenter plane (x, y),
+    /// index 0 for divergent and 1 for parallel projection
+    std::vector<double> ConvexHulls[2];
+    bool ConvexHullValid[2] = { false, false };
+  };
+
+  /// Assemble a string from the target and the beam geometry the projection depends on
+  static std::string GetTargetProjectionSignature(vtkMRMLRTBeamNode* beamNode, vtkPolyData* targetPoly);
+
+  /// Get target projection cache of a beam. If the signature changed, the cache is reset
+  /// and the target is transformed into the beam frame and triangulated.
+  /// @return valid pointer if successfull, nullptr otherwise
+  TargetProjectionCache* GetTargetProjection(vtkMRMLRTBeamNode* beamNode, vtkPolyData* targetPoly);
+
+  /// Get convex hull of the cached target projected on the isocenter plane, calculate it if not cached yet
+  /// @param sourceToIsocenterDistance - SAD, used for divergent projection only
+  /// @return x and y coordinates of the counterclockwise hull points
+  static const std::vector<double>& GetTargetConvexHull(TargetProjectionCache& cache,
+    bool parallelBeam, double sourceToIsocenterDistance);
+
+public:
+  /// Target projection cache for each beam node (by node ID)
+  std::map<std::string, TargetProjectionCache> TargetProjectionCaches;
+};
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerMLCPositionLogic::vtkInternal::GetTargetProjectionSignature(vtkMRMLRTBeamNode* beamNode, vtkPolyData* targetPoly)
+{
+  double isocenter[3] = {};
+  beamNode->GetPlanIsocenterPosition(isocenter);
+  std::stringstream ss;
+  ss << targetPoly << ";" << targetPoly->GetMTime() << ";"
+    << std::setprecision(12) << beamNode->GetGantryAngle() << ";"
+    << beamNode->GetCollimatorAngle() << ";"
+    << beamNode->GetCouchAngle() << ";"
+    << beamNode->GetSAD() << ";"
+    << isocenter[0] << ";" << isocenter[1] << ";" << isocenter[2];
+
+  // The target is transformed into the beam frame by the beam to world transform, which may be changed
+  // (e.g. by a transform above the beam transform) without changing the beam parameters
+  vtkMRMLTransformNode* beamTransformNode = beamNode->GetParentTransformNode();
+  if (beamTransformNode)
+  {
+    vtkNew<vtkMatrix4x4> beamToWorldMatrix;
+    beamTransformNode->GetMatrixTransformToWorld(beamToWorldMatrix);
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        ss << ";" << beamToWorldMatrix->GetElement( i, j);
+      }
+    }
+  }
+  return ss.str();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerMLCPositionLogic::vtkInternal::TargetProjectionCache* vtkSlicerMLCPositionLogic::vtkInternal::GetTargetProjection(
+  vtkMRMLRTBeamNode* beamNode, vtkPolyData* targetPoly)
+{
+  if (!beamNode || !targetPoly)
+  {
+    return nullptr;
+  }
+
+  std::string signature = GetTargetProjectionSignature( beamNode, targetPoly);
+  TargetProjectionCache& cache = this->TargetProjectionCaches[beamNode->GetID() ? beamNode->GetID() : ""];
+  if (cache.Signature == signature)
+  {
+    return &cache;
+  }
+  cache = TargetProjectionCache();
+
+  // transform target poly data into beam frame
+  vtkMRMLTransformNode* beamTransformNode = beamNode->GetParentTransformNode();
+  vtkNew<vtkMatrix4x4> beamInverseMatrix;
+  vtkNew<vtkTransform> beamInverseTransform;
+  if (beamTransformNode)
+  {
+    beamTransformNode->GetMatrixTransformToWorld(beamInverseMatrix);
+    beamInverseMatrix->Invert();
+    beamInverseTransform->SetMatrix(beamInverseMatrix);
+  }
+
+  vtkNew<vtkTransformPolyDataFilter> beamInverseTransformFilter;
+  beamInverseTransformFilter->SetTransform(beamInverseTransform);
+  beamInverseTransformFilter->SetInputData(targetPoly);
+
+  // Target surface as triangles, its points are copied so that leaf pairs can be processed concurrently
+  vtkNew<vtkTriangleFilter> triangleFilter;
+  triangleFilter->SetInputConnection(beamInverseTransformFilter->GetOutputPort());
+  triangleFilter->PassVertsOff();
+  triangleFilter->PassLinesOff();
+  triangleFilter->Update();
+  vtkPolyData* targetTriangles = triangleFilter->GetOutput();
+  if (!targetTriangles)
+  {
+    return nullptr;
+  }
+
+  cache.PointCoordinates.resize(3 * targetTriangles->GetNumberOfPoints());
+  for (vtkIdType pointId = 0; pointId < targetTriangles->GetNumberOfPoints(); ++pointId)
+  {
+    targetTriangles->GetPoint( pointId, &cache.PointCoordinates[3 * pointId]);
+  }
+
+  vtkCellArray* polys = targetTriangles->GetPolys();
+  vtkNew<vtkIdList> cellPointIds;
+  polys->InitTraversal();
+  while (polys->GetNextCell(cellPointIds))
+  {
+    if (cellPointIds->GetNumberOfIds() == 3)
+    {
+      for (vtkIdType vertex = 0; vertex < 3; ++vertex)
+      {
+        cache.TrianglePointIds.push_back(cellPointIds->GetId(vertex));
+      }
+    }
+  }
+
+  cache.Signature = signature;
+  return &cache;
+}
+
+//----------------------------------------------------------------------------
+const std::vector<double>& vtkSlicerMLCPositionLogic::vtkInternal::GetTargetConvexHull(
+  TargetProjectionCache& cache, bool parallelBeam, double sourceToIsocenterDistance)
+{
+  int mode = parallelBeam ? 1 : 0;
+  std::vector<double>& hull = cache.ConvexHulls[mode];
+  if (cache.ConvexHullValid[mode])
+  {
+    return hull;
+  }
+
+  // external points for MLC opening calculation, projected on the isocenter plane
+  vtkNew<vtkPointsProjectedHull> points;
+  size_t nofPoints = cache.PointCoordinates.size() / 3;
+  for (size_t i = 0; i < nofPoints; i++)
+  {
+    const double* beamFramePoint = &cache.PointCoordinates[3 * i]; // target region point in beam frame coordinates
+    if (parallelBeam)
+    {
+      // projection on XY plane of BEAM LIMITING DEVICE frame
+      points->InsertNextPoint(beamFramePoint[0], beamFramePoint[1], 0.0);
+    }
+    else
+    {
+      // intersection of the ray from the source (0, 0, -SAD) through the point with the isocenter plane
+      double sourceToPointDistance = sourceToIsocenterDistance + beamFramePoint[2];
+      if (sourceToPointDistance > 0.)
+      {
+        double scale = sourceToIsocenterDistance / sourceToPointDistance;
+        points->InsertNextPoint(beamFramePoint[0] * scale, beamFramePoint[1] * scale, 0.0);
+      }
+    }
+  }
+
+  // get x and y coordinates of convex hull on the isocenter IEC BEAM LIMITING DEVICE coordinate system plane
+  hull.clear();
+  int zSize = points->GetSizeCCWHullZ(); // number of points
+  if (zSize > 0)
+  {
+    hull.resize(2 * zSize);
+    points->GetCCWHullZ(hull.data(), zSize); // get points of convex hull on the plane
+  }
+  cache.ConvexHullValid[mode] = true;
+  return hull;
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerMLCPositionLogic);
 
 //----------------------------------------------------------------------------
 vtkSlicerMLCPositionLogic::vtkSlicerMLCPositionLogic()
 {
+  this->Internal = new vtkInternal();
 }
 
 //----------------------------------------------------------------------------
 vtkSlicerMLCPositionLogic::~vtkSlicerMLCPositionLogic()
 {
+  if (this->Internal)
+  {
+    delete this->Internal;
+    this->Internal = nullptr;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -162,20 +591,20 @@ vtkMRMLMarkupsCurveNode* vtkSlicerMLCPositionLogic::CalculatePositionConvexHullC
     return nullptr;
   }
 
-  vtkMRMLTransformNode* beamTransformNode = beamNode->GetParentTransformNode();
-  vtkNew<vtkMatrix4x4> beamInverseMatrix;
-  vtkNew<vtkTransform> beamInverseTransform;
-  if (beamTransformNode)
+  if (!beamNode->GetParentTransformNode())
   {
-    beamTransformNode->GetMatrixTransformToWorld(beamInverseMatrix);
-    beamInverseMatrix->Invert();
-    beamInverseTransform->SetMatrix(beamInverseMatrix);
+    vtkErrorMacro("CalculatePositionConvexHullCurve: Beam transform node is invalid");
+    return nullptr;
   }
-  else
+
+  vtkInternal::TargetProjectionCache* targetProjection = this->Internal->GetTargetProjection( beamNode, targetPoly);
+  if (!targetProjection)
   {
-    vtkErrorMacro("CalculatePositionConvexHullCurve: Beam transform node is invalid");
+    vtkErrorMacro("CalculatePositionConvexHullCurve: Target projection is invalid");
     return nullptr;
   }
+  const std::vector<double>& xyCoordinates = vtkInternal::GetTargetConvexHull( *targetProjection,
+    parallelBeam, beamNode->GetSAD());
 
   // Create markups node (subject hierarchy node is created automatically)
   vtkNew<vtkMRMLMarkupsClosedCurveNode> curveNode;
@@ -184,61 +613,10 @@ vtkMRMLMarkupsCurveNode* vtkSlicerMLCPositionLogic::CalculatePositionConvexHullC
 
   this->GetMRMLScene()->AddNode(curveNode);
 
-  // transform target poly data into beam frame
-  vtkNew<vtkTransformPolyDataFilter> beamInverseTransformFilter;
-  beamInverseTransformFilter->SetTransform(beamInverseTransform);
-  beamInverseTransformFilter->SetInputData(targetPoly);
-  beamInverseTransformFilter->Update();
-
-  vtkPolyData* targetPolyBeamFrame = beamInverseTransformFilter->GetOutput();
-
-  // external points for MLC opening calculation, projected on the isocenter plane
-  vtkNew<vtkPointsProjectedHull> points; 
-
-  if (parallelBeam)
-  {
-    for (vtkIdType i = 0; i < targetPolyBeamFrame->GetNumberOfPoints(); i++)
-    {
-      double projectedPoint[4] = {}; // projected point in isocenter plane coordinates
-
-      targetPolyBeamFrame->GetPoint(i, projectedPoint);
-
-      // projection on XY plane of BEAM LIMITING DEVICE frame
-      points->InsertPoint(i, projectedPoint[0], projectedPoint[1], 0.0);
-    }
-  }
-  else
-  {
-    vtkNew<vtkPlane> projectionPlane;
-    projectionPlane->SetOrigin(0., 0., 0.);
-    projectionPlane->SetNormal(0., 0., 1.);
-    for (vtkIdType i = 0; i < targetPolyBeamFrame->GetNumberOfPoints(); i++)
-    {
-      double beamFramePoint[4] = {}; // target region point in beam frame coordinates
-      double t = 0.0001;
-      double projectedPoint[3]; // target region point projected on plane
-
-      targetPolyBeamFrame->GetPoint(i, beamFramePoint);
-      
-      double sourcePoint[3] = { 0., 0., -1. * beamNode->GetSAD() };
-      double targetPoint[3] = { beamFramePoint[0], beamFramePoint[1], projectedPoint[2] };
-
-      if (projectionPlane->IntersectWithLine(sourcePoint, targetPoint, t, projectedPoint))
-      {
-        // projection on XY plane of BEAM LIMITING DEVICE coordinate system
-        points->InsertPoint(i, projectedPoint[0], projectedPoint[1], 0.0);
-      }
-    }
-  }
-
-  // get x and y coordinates of convex hull on the isocenter IEC BEAM LIMITING DEVICE coordinate system plane
-  int zSize = points->GetSizeCCWHullZ(); // number of points
+  size_t zSize = xyCoordinates.size() / 2; // number of convex hull points
   if (zSize >= 3)
   {
-    double* xyCoordinates = new double[zSize * 2]; // x and y coordinates buffer
-    points->GetCCWHullZ(xyCoordinates, zSize); // get points of convex hull on the plane
-
-    for (int i = 0; i < zSize; i++)
+    for (size_t i = 0; i < zSize; i++)
     {
       double xval = xyCoordinates[2 * i]; // x coordinate
       double yval = xyCoordinates[2 * i + 1]; // y coordinate
@@ -247,7 +625,6 @@ vtkMRMLMarkupsCurveNode* vtkSlicerMLCPositionLogic::CalculatePositionConvexHullC
       curveNode->AddControlPoint(point); // add point to the closed curve
     }
 
-    delete [] xyCoordinates;
     return curveNode.GetPointer();
   }
   else
@@ -499,8 +876,18 @@ bool vtkSlicerMLCPositionLogic::CalculateMultiLeafCollimatorPosition( vtkMRMLTab
 }
 
 //---------------------------------------------------------------------------
-void vtkSlicerMLCPositionLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* vtkNotUsed(node))
+void vtkSlicerMLCPositionLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
+{
+  if (vtkMRMLRTBeamNode::SafeDownCast(node) && node->GetID())
+  {
+    this->Internal->TargetProjectionCaches.erase(node->GetID());
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerMLCPositionLogic::OnMRMLSceneEndClose()
 {
+  this->Internal->TargetProjectionCaches.clear();
 }
 
 //---------------------------------------------------------------------------
@@ -629,8 +1016,7 @@ bool vtkSlicerMLCPositionLogic::FindLeafPairPositions(
   size_t leafPairIndex, 
   double& side1, double& side2, 
   int vtkNotUsed(strategy), 
-  double maxPositionDistance, 
-  double positionStep)
+  double maxPositionDistance)
 {
   if (!mlcTableNode)
   {
@@ -640,7 +1026,7 @@ bool vtkSlicerMLCPositionLogic::FindLeafPairPositions(
 
   const char* mlcName = mlcTableNode->GetName();
   bool typeMLCY = !strncmp("MLCY", mlcName, strlen("MLCY"));
-  bool typeMLCX = !strncmp("MLCX", mlcName, strlen("MLCX"));
+  int leafAxis = typeMLCY ? 1 : 0; // leaves of MLCX move along X-axis, leaves of MLCY along Y-axis
 
   vtkTable* mlcTable = mlcTableNode->GetTable();
 
@@ -648,96 +1034,29 @@ bool vtkSlicerMLCPositionLogic::FindLeafPairPositions(
   double leafEnd = mlcTable->GetValue(leafPairIndex + 1, 0).ToDouble();
 
   vtkPolyData* curvePoly = curveNode->GetCurveWorld();
-  if (!curvePoly)
+  if (!curvePoly || !curvePoly->GetPoints())
   {
     vtkErrorMacro("FindLeafPairPositions: Curve polydata is invalid");
     return false;
   }
 
-  // Build locator
-  vtkNew<vtkCellLocator> cellLocator;
-//  vtkNew<vtkModifiedBSPTree> cellLocator;
-  cellLocator->SetDataSet(curvePoly);
-  cellLocator->BuildLocator();
-
-  // intersection with side1
-  bool side1Flag = false;
-  double pStart[3] = { };
-  double pEnd[3] = { };
-
-  if (typeMLCX)
+  // Leaf pair positions are the extent of the closed curve polygon within the leaf pair strip
+  PolygonType polygon(curvePoly->GetNumberOfPoints());
+  for (vtkIdType i = 0; i < curvePoly->GetNumberOfPoints(); ++i)
   {
-   pStart[1] = leafStart;
-   pEnd[1] = leafEnd;
-  }
-  else if (typeMLCY)
-  {
-   pStart[0] = leafStart;
-   pEnd[0] = leafEnd;
+    curvePoly->GetPoint( i, polygon[i].data());
   }
 
-  int subId = -1;
-  double t = 0., xyz[3] = {}, pcoords[3] = {};
-  for (double c = -1. * maxPositionDistance; c <= maxPositionDistance; c += positionStep)
+  double extent[2] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest() };
+  if (!ExtendExtentByPolygonInStrip( polygon, leafAxis, leafStart, leafEnd, 0., extent)
+    || extent[1] < -1. * maxPositionDistance || extent[0] > maxPositionDistance)
   {
-    if (typeMLCX)
-    {
-      pStart[0] = c;
-      pEnd[0] = c;
-    }
-    else if (typeMLCY)
-    {
-      pStart[1] = c;
-      pEnd[1] = c;
-    }
-
-    if (cellLocator->IntersectWithLine(pStart, pEnd, 0.0001, t, xyz, pcoords, subId))
-    {
-      side1Flag = true;
-      // xyz values
-      if (typeMLCX)
-      {
-        side1 = xyz[0];
-      }
-      else if (typeMLCY)
-      {
-        side1 = xyz[1];
-      }
-      break;
-    }
+    return false;
   }
 
-  // intersection with side2
-  bool side2Flag = false;
-  for (double c = maxPositionDistance; c >= -1. * maxPositionDistance; c -= positionStep)
-  {
-    if (typeMLCX)
-    {
-      pStart[0] = c;
-      pEnd[0] = c;
-    }
-    else if (typeMLCY)
-    {
-      pStart[1] = c;
-      pEnd[1] = c;
-    }
-
-    if (cellLocator->IntersectWithLine(pStart, pEnd, 0.0001, t, xyz, pcoords, subId))
-    {
-      side2Flag = true;
-      // xyz values
-      if (typeMLCX)
-      {
-        side2 = xyz[0];
-      }
-      else if (typeMLCY)
-      {
-        side2 = xyz[1];
-      }
-      break;
-    }
-  }
-  return (side1Flag && side2Flag);
+  side1 = std::max( extent[0], -1. * maxPositionDistance);
+  side2 = std::min( extent[1], maxPositionDistance);
+  return true;
 }
 
 //---------------------------------------------------------------------------
@@ -877,7 +1196,7 @@ void vtkSlicerMLCPositionLogic::SetParentForMultiLeafCollimatorCurve(vtkMRMLRTBe
 
 //---------------------------------------------------------------------------
 bool vtkSlicerMLCPositionLogic::CalculateMultiLeafCollimatorPosition(vtkMRMLRTBeamNode* beamNode, 
-  vtkMRMLTableNode* mlcTableNode, vtkPolyData* targetPoly)
+  vtkMRMLTableNode* mlcTableNode, vtkPolyData* targetPoly, double margin)
 {
   if (!beamNode)
   {
@@ -897,29 +1216,17 @@ bool vtkSlicerMLCPositionLogic::CalculateMultiLeafCollimatorPosition(vtkMRMLRTBe
     return false;
   }
 
-  vtkMRMLTransformNode* beamTransformNode = beamNode->GetParentTransformNode();
-  vtkNew<vtkMatrix4x4> beamInverseMatrix;
-  vtkNew<vtkTransform> beamInverseTransform;
-  if (beamTransformNode)
-  {
-    beamTransformNode->GetMatrixTransformToWorld(beamInverseMatrix);
-    beamInverseMatrix->Invert();
-    beamInverseTransform->SetMatrix(beamInverseMatrix);
-  }
-
   double isocenterToMLCDistance = beamNode->GetSAD() - beamNode->GetSourceToMultiLeafCollimatorDistance();
 
-  // transform target poly data into beam frame
-  vtkNew<vtkTransformPolyDataFilter> beamInverseTransformFilter;
-  beamInverseTransformFilter->SetTransform(beamInverseTransform);
-  beamInverseTransformFilter->SetInputData(targetPoly);
-  beamInverseTransformFilter->Update();
-  vtkPolyData* targetPolyData = vtkPolyData::SafeDownCast(beamInverseTransformFilter->GetOutput());
-  if (!targetPolyData)
+  // Target in beam frame as triangles, reused from the previous call if neither target nor beam geometry changed
+  vtkInternal::TargetProjectionCache* targetProjection = this->Internal->GetTargetProjection( beamNode, targetPoly);
+  if (!targetProjection)
   {
     vtkErrorMacro("CalculateMultiLeafCollimatorPosition: Transformed target polydata is invalid");
     return false;
   }
+  const std::vector<double>& pointCoordinates = targetProjection->PointCoordinates;
+  const std::vector<vtkIdType>& trianglePointIds = targetProjection->TrianglePointIds;
 
   const char* mlcName = mlcTableNode->GetName();
   bool typeMLCX = !strncmp("MLCX", mlcName, strlen("MLCX")); // MLCX by default
@@ -929,206 +1236,196 @@ bool vtkSlicerMLCPositionLogic::CalculateMultiLeafCollimatorPosition(vtkMRMLRTBe
   {
     typeMLCX = false;
   }
+  int leafAxis = typeMLCX ? 0 : 1;
 
-  // each leaf is represented as a perpendicular parallelepiped
-  vtkNew<vtkCubeSource> leaf1; // leaf on side 1
-  vtkNew<vtkCubeSource> leaf2; // leaf on side 2
-
-  for (vtkIdType leafPair = 0; leafPair < nofLeafPairs; leafPair++)
-  { // leaf pair for cycle begins
-
-    vtkTable* table = mlcTableNode->GetTable();
-    double InitialPos1 = table->GetValue(leafPair, 1).ToDouble();
-    double InitialPos2 = table->GetValue(leafPair, 2).ToDouble();
-
-    if (vtkSlicerRtCommon::AreEqualWithTolerance(InitialPos1, InitialPos2))
-    {
-      continue;
-    }
-
-    double boundBegin = table->GetValue(leafPair, 0).ToDouble();
-    double boundEnd = table->GetValue(leafPair + 1, 0).ToDouble();
-
-    double mlcLeafLength = 200.; // meaningful leaf side of MLC leaf in mm
-
-    // generate leaf on side "1" and "2" for MLCX or MLCY
-    if (typeMLCX) // MLCX
-    {
-      leaf1->SetBounds(-1. * mlcLeafLength, 0., boundBegin, boundEnd, 
-        -1. * isocenterToMLCDistance, isocenterToMLCDistance);
-      leaf2->SetBounds(0., mlcLeafLength, boundBegin, boundEnd, 
-        -1. * isocenterToMLCDistance, isocenterToMLCDistance);
-    }
-    else // MLCY
-    {
-      leaf1->SetBounds(boundBegin, boundEnd, -1. * mlcLeafLength, 0.0, 
-        -1. * isocenterToMLCDistance, isocenterToMLCDistance);
-      leaf2->SetBounds(boundBegin, boundEnd, 0.0, mlcLeafLength, 
-        -1. * isocenterToMLCDistance, isocenterToMLCDistance);
-    }
+  vtkTable* table = mlcTableNode->GetTable();
+  std::vector<double> leafPairBoundaries(nofLeafPairs + 1);
+  for (vtkIdType row = 0; row <= nofLeafPairs; ++row)
+  {
+    leafPairBoundaries[row] = table->GetValue(row, 0).ToDouble();
+  }
 
-    leaf1->Update();
-    leaf2->Update();
+  // Project every target triangle onto the leaf pair axis and assign it to the leaf pairs whose strip it overlaps
+  std::vector< std::vector<vtkIdType> > leafPairTriangles;
+  AssignTrianglesToLeafPairs( pointCoordinates, trianglePointIds, leafPairBoundaries, leafAxis, leafPairTriangles);
 
-    vtkPolyData* leaf2PolyData = vtkPolyData::SafeDownCast(leaf2->GetOutput(0));
-    vtkPolyData* leaf1PolyData = vtkPolyData::SafeDownCast(leaf1->GetOutput(0));
-    if (!leaf1PolyData || !leaf2PolyData)
+  // Leaf pairs without opening after the first pass are skipped
+  std::vector<vtkIdType> leafPairs;
+  std::vector<double> side1(nofLeafPairs, 0.), side2(nofLeafPairs, 0.);
+  std::vector<char> extentFound(nofLeafPairs, 0);
+  for (vtkIdType leafPair = 0; leafPair < nofLeafPairs; leafPair++)
+  {
+    double initialPos1 = table->GetValue(leafPair, 1).ToDouble();
+    double initialPos2 = table->GetValue(leafPair, 2).ToDouble();
+    if (!vtkSlicerRtCommon::AreEqualWithTolerance(initialPos1, initialPos2))
     {
-      vtkErrorMacro("CalculateMultiLeafCollimatorPosition: leaf on side 1 or 2 is invalid, leaf pair index is " << leafPair);
-      return false;
+      leafPairs.push_back(leafPair);
     }
+  }
 
-    double side1 = 0.0;
-    // find a collition between moving leaf and stationaty target on side "1"
-    if (FindLeafAndTargetCollision(beamNode, leaf1PolyData, targetPolyData,
-      side1, InitialPos1 - 1., 1, typeMLCX))
-    {
-      table->SetValue(leafPair, 1, side1);
-    }
-    else
-    {
-      vtkWarningMacro("CalculateMultiLeafCollimatorPosition: Side 1 collision hasn't been found");
-    }
+  // Leaves are parallelepipeds between the isocenter plane +/- isocenter to MLC distance,
+  // so leaf positions are the extent of the target part within that slab and the leaf pair strip
+  LeafPairTargetExtentFunctor extentFunctor( pointCoordinates, trianglePointIds, leafPairTriangles,
+    leafPairBoundaries, leafPairs, leafAxis, fabs(isocenterToMLCDistance), side1, side2, extentFound);
+  vtkSMPTools::For( 0, static_cast<vtkIdType>(leafPairs.size()), extentFunctor);
 
-    double side2 = 0.0;
-    // find a collition between moving leaf and stationaty target on side "2"
-    if (FindLeafAndTargetCollision(beamNode, leaf2PolyData, targetPolyData,
-      side2, InitialPos2 + 1., 2, typeMLCX))
+  for (vtkIdType leafPair : leafPairs)
+  {
+    if (extentFound[leafPair])
     {
-      table->SetValue(leafPair, 2, side2);
+      table->SetValue(leafPair, 1, side1[leafPair] - margin);
+      table->SetValue(leafPair, 2, side2[leafPair] + margin);
     }
     else
     {
-      vtkWarningMacro("CalculateMultiLeafCollimatorPosition: Side 2 collision hasn't been found");
+      vtkWarningMacro("CalculateMultiLeafCollimatorPosition: Target hasn't been found within leaf pair " << leafPair);
     }
-  } // leafPair for cycle ends
+  }
   return true;
 }
 
 //---------------------------------------------------------------------------
-bool vtkSlicerMLCPositionLogic::FindLeafAndTargetCollision(vtkMRMLRTBeamNode* vtkNotUsed(beamNode), 
-  vtkPolyData* leafPolyData, vtkPolyData* targetPolyData,
-  double& sidePos, double initialPosition, int sideType, bool mlcType, 
-  double maxPositionDistance, double positionStep)
+bool vtkSlicerMLCPositionLogic::CalculateMultiLeafCollimatorPositionSequence(vtkMRMLRTBeamNode* beamNode,
+  vtkMRMLTableNode* mlcTableNode, vtkPolyData* targetPoly, vtkDoubleArray* gantryAngles,
+  vtkDoubleArray* collimatorAngles, vtkDoubleArray* leafPositions, double margin)
 {
-  int contactMode = 1; // move leaf until first contact
-  vtkNew<vtkMatrix4x4> targetMatrix; // fixed target matrix
-  targetMatrix->Identity();
-  vtkNew<vtkTransform> leafTransform; // moving leaf transform
-  leafTransform->Identity();
-  vtkNew<vtkCollisionDetectionFilter> collide;
-  collide->SetInputData(0, leafPolyData); // moving leaf polydata
-  collide->SetTransform(0, leafTransform);
-  collide->SetInputData(1, targetPolyData); // stationary target polydata
-  collide->SetMatrix(1, targetMatrix);
-  collide->SetBoxTolerance(0.0);
-  collide->SetCellTolerance(0.0);
-  collide->SetNumberOfCellsPerNode(2);
-  if (contactMode == 0)
-  {
-    collide->SetCollisionModeToAllContacts();
-  }
-  else if (contactMode == 1)
-  {
-    collide->SetCollisionModeToFirstContact();
+  if (!beamNode || !targetPoly)
+  {
+    vtkErrorMacro("CalculateMultiLeafCollimatorPositionSequence: invalid beam node or target");
+    return false;
   }
-  else
+  if (!gantryAngles || !leafPositions)
   {
-    collide->SetCollisionModeToHalfContacts();
+    vtkErrorMacro("CalculateMultiLeafCollimatorPositionSequence: invalid gantry angles or leaf positions array");
+    return false;
+  }
+  vtkIdType nofControlPoints = gantryAngles->GetNumberOfTuples();
+  if (collimatorAngles && collimatorAngles->GetNumberOfTuples() != nofControlPoints)
+  {
+    vtkErrorMacro("CalculateMultiLeafCollimatorPositionSequence: number of collimator angles ("
+      << collimatorAngles->GetNumberOfTuples() << ") differs from number of gantry angles (" << nofControlPoints << ")");
+    return false;
   }
-  collide->GenerateScalarsOn();
 
-  // Move the leaf in IEC BEAM LIMITING DEVICE coordinate system plane to initial position
-  if (sideType == 1) // leaf situated on side "1"
+  int nofLeafPairs = 0;
+  if (mlcTableNode && mlcTableNode->GetTable())
   {
-    if (mlcType) // MLCX
-    {
-      leafTransform->Translate(initialPosition, 0.0, 0.0);
-    }
-    else // MLCY
-    {
-      leafTransform->Translate(0., initialPosition, 0.0);
-    }
+    nofLeafPairs = mlcTableNode->GetNumberOfRows() - 1;
   }
-  else // leaf situated on side "2"
+  if (nofLeafPairs <= 0)
   {
-    if (mlcType) // MLCX
-    {
-      leafTransform->Translate(initialPosition, 0.0, 0.0);
-    }
-    else // MLCY
-    {
-      leafTransform->Translate(0., initialPosition, 0.0);
-    }
+    vtkErrorMacro("CalculateMultiLeafCollimatorPositionSequence: invalid number of MLC leaf pairs, current value is "
+      << nofLeafPairs << ", is must be more than zero!");
+    return false;
   }
 
-  // find a collition between leaf and target by moving leaf polydata with small steps
-  int numSteps = fabs(initialPosition) + fabs(maxPositionDistance) / fabs(positionStep);
-  bool res = false;
-  double p[3] = {};
-  for (int i = 0; i < numSteps; ++i)
+  // Target in the frame of the beam at its current geometry, the control point frames differ only by rotations
+  vtkInternal::TargetProjectionCache* targetProjection = this->Internal->GetTargetProjection( beamNode, targetPoly);
+  if (!targetProjection)
   {
-    if (sideType == 1) // leaf situated on side "1"
-    {
-      if (mlcType) // MLCX
-      {
-        leafTransform->Translate(positionStep, 0.0, 0.0);
-      }
-      else // MLCY
-      {
-        leafTransform->Translate(0.0, positionStep, 0.0);
-      }
-    }
-    else // leaf situated on side "2"
+    vtkErrorMacro("CalculateMultiLeafCollimatorPositionSequence: Transformed target polydata is invalid");
+    return false;
+  }
+
+  const char* mlcName = mlcTableNode->GetName();
+  bool typeMLCX = !strncmp("MLCX", mlcName, strlen("MLCX")); // MLCX by default
+  bool typeMLCY = !strncmp("MLCY", mlcName, strlen("MLCY"));
+  // if MLCX then typeMLCX = true, if MLCY then typeMLCX = false
+  if (typeMLCY && !typeMLCX)
+  {
+    typeMLCX = false;
+  }
+  int leafAxis = typeMLCX ? 0 : 1;
+
+  vtkTable* table = mlcTableNode->GetTable();
+  std::vector<double> leafPairBoundaries(nofLeafPairs + 1);
+  for (vtkIdType row = 0; row <= nofLeafPairs; ++row)
+  {
+    leafPairBoundaries[row] = table->GetValue(row, 0).ToDouble();
+  }
+
+  // Gantry rotates around the Y axis of IEC FIXED REFERENCE and collimator around the Z axis of IEC GANTRY,
+  // so the rotation from the current beam frame into the frame of a control point is
+  // Rz(-collimator) * Ry(currentGantry - gantry) * Rz(currentCollimator)
+  std::vector< std::array<double, 9> > rotations(nofControlPoints);
+  vtkNew<vtkTransform> rotationTransform;
+  for (vtkIdType controlPoint = 0; controlPoint < nofControlPoints; ++controlPoint)
+  {
+    double gantryAngle = gantryAngles->GetValue(controlPoint);
+    double collimatorAngle = collimatorAngles ? collimatorAngles->GetValue(controlPoint) : beamNode->GetCollimatorAngle();
+    rotationTransform->Identity();
+    rotationTransform->RotateZ(-1. * collimatorAngle);
+    rotationTransform->RotateY(beamNode->GetGantryAngle() - gantryAngle);
+    rotationTransform->RotateZ(beamNode->GetCollimatorAngle());
+    vtkMatrix4x4* rotationMatrix = rotationTransform->GetMatrix();
+    for (int row = 0; row < 3; ++row)
     {
-      if (mlcType) // MLCX
-      {
-        leafTransform->Translate(-1. * positionStep, 0.0, 0.0);
-      }
-      else // MLCY
+      for (int column = 0; column < 3; ++column)
       {
-        leafTransform->Translate(0.0, -1. * positionStep, 0.0);
+        rotations[controlPoint][3 * row + column] = rotationMatrix->GetElement(row, column);
       }
     }
-    
-    leafTransform->Update();
-    collide->Update();
-
-    // Check if collision (first contact) is found, get a coordinate of the contact
-    // and break the cycle
-    // If there is no collision, then process to the next leaf step 
-    if (collide->GetNumberOfContacts() > 0)
-    {
-      vtkPolyData* contacts = collide->GetContactsOutput();
-      vtkIdType nofCells = contacts->GetNumberOfCells();
+  }
 
-      for (vtkIdType i = 0; i < nofCells; ++i)
-      {
-        vtkCell* cell = contacts->GetCell(i);
-        if (cell)
-        {
-          vtkPoints* points = cell->GetPoints();
-          if (points)
-          {
-            for (vtkIdType j = 0; j < points->GetNumberOfPoints(); ++j)
-            {
-              points->GetPoint(j, p);
-              if (mlcType) // MLCX
-              {
-                sidePos = p[0];
-              }
-              else // MLCY
-              {
-                sidePos = p[1];
-              }
-            }
-          }
-        }
-      }
-      res = true;
-      break;
-    }
+  leafPositions->SetNumberOfComponents(2);
+  leafPositions->SetNumberOfTuples(nofControlPoints * nofLeafPairs);
+  leafPositions->SetComponentName(0, "1");
+  leafPositions->SetComponentName(1, "2");
+
+  double isocenterToMLCDistance = beamNode->GetSAD() - beamNode->GetSourceToMultiLeafCollimatorDistance();
+  ControlPointLeafPositionsFunctor positionsFunctor( targetProjection->PointCoordinates, targetProjection->TrianglePointIds,
+    rotations, leafPairBoundaries, leafAxis, fabs(isocenterToMLCDistance), margin, leafPositions->GetPointer(0));
+  vtkSMPTools::For( 0, nofControlPoints, positionsFunctor);
+  leafPositions->Modified();
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerMLCPositionLogic::CreateMultiLeafCollimatorTableNodesFromPositionSequence(
+  vtkMRMLTableNode* mlcTableNode, vtkDoubleArray* leafPositions, vtkCollection* mlcTableNodes)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene)
+  {
+    vtkErrorMacro("CreateMultiLeafCollimatorTableNodesFromPositionSequence: Invalid MRML scene");
+    return false;
+  }
+  if (!mlcTableNode || !mlcTableNode->GetTable() || !leafPositions || !mlcTableNodes)
+  {
+    vtkErrorMacro("CreateMultiLeafCollimatorTableNodesFromPositionSequence: Invalid input or output");
+    return false;
   }
 
-  return res;
+  vtkIdType nofLeafPairs = mlcTableNode->GetNumberOfRows() - 1;
+  if (nofLeafPairs <= 0 || leafPositions->GetNumberOfComponents() != 2
+    || leafPositions->GetNumberOfTuples() % nofLeafPairs)
+  {
+    vtkErrorMacro("CreateMultiLeafCollimatorTableNodesFromPositionSequence: Leaf positions don't match MLC table "
+      << mlcTableNode->GetName());
+    return false;
+  }
+  vtkIdType nofControlPoints = leafPositions->GetNumberOfTuples() / nofLeafPairs;
+
+  // All tables are added in a single batch so that observers are notified only once
+  scene->StartState(vtkMRMLScene::BatchProcessState);
+  for (vtkIdType controlPoint = 0; controlPoint < nofControlPoints; ++controlPoint)
+  {
+    vtkNew<vtkMRMLTableNode> tableNode;
+    tableNode->CopyContent(mlcTableNode);
+    // Name starts with the MLC type ("MLCX" or "MLCY") of the boundary table
+    std::string tableName = std::string(mlcTableNode->GetName()) + "_" + std::to_string(controlPoint);
+    tableNode->SetName(tableName.c_str());
+
+    vtkTable* table = tableNode->GetTable();
+    for (vtkIdType leafPair = 0; leafPair < nofLeafPairs; ++leafPair)
+    {
+      double* positions = leafPositions->GetTuple2(controlPoint * nofLeafPairs + leafPair);
+      table->SetValue(leafPair, 1, positions[0]);
+      table->SetValue(leafPair, 2, positions[1]);
+    }
+    scene->AddNode(tableNode);
+    mlcTableNodes->AddItem(tableNode);
+  }
+  scene->EndState(vtkMRMLScene::BatchProcessState);
+  return true;
 }
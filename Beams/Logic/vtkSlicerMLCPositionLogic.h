@@ -35,6 +35,8 @@ class vtkMRMLRTBeamNode;
 class vtkMRMLTableNode;
 class vtkTable;
 class vtkAlgorithmOutput;
+class vtkCollection;
+class vtkDoubleArray;
 
 /// \ingroup SlicerRt_QtModules_Beams
 class VTK_SLICER_BEAMS_LOGIC_EXPORT vtkSlicerMLCPositionLogic : public vtkMRMLAbstractLogic
@@ -75,7 +77,8 @@ public:
   bool UpdateMultiLeafCollimatorTableNodeBoundaryData( vtkMRMLTableNode* mlcTable, 
     bool mlcType, unsigned int nofLeafPairs, double leafPairSize, double isocenterOffset = 0.0);
 
-  /// Calculate convex hull curve on isocenter plane for MLC position computation
+  /// Calculate convex hull curve on isocenter plane for MLC position computation.
+  /// The target projection is cached per beam until the target or the beam geometry changes.
   /// @param beamNode - beam node
   /// @param targetPoly - poly data of the target region
   /// @param parallelBeam - flag if beam is parallel
@@ -92,13 +95,41 @@ public:
   bool CalculateMultiLeafCollimatorPosition( vtkMRMLTableNode* mlcTableNode, 
     vtkMRMLMarkupsCurveNode* curveNode);
 
-  /// Calculate MLC table position using target polydata (second pass)
+  /// Calculate MLC table position using target polydata (second pass).
+  /// Leaf positions are the extent of the target within the strip of each leaf pair,
+  /// calculated analytically from the target triangles, leaf pairs are processed in parallel.
   /// @param beamNode - beam node
   /// @param mlcTableNode - table node with MLC boundary data and positions after first pass
   /// @param targetPoly - poly data of the target region
+  /// @param margin - margin in mm added to the target extent on both sides
   /// @return true if position calculation is successfull, false otherwise
   bool CalculateMultiLeafCollimatorPosition( vtkMRMLRTBeamNode* beamNode, 
-    vtkMRMLTableNode* mlcTableNode, vtkPolyData* targetPoly);
+    vtkMRMLTableNode* mlcTableNode, vtkPolyData* targetPoly, double margin = 0.);
+
+  /// Calculate MLC positions conformed to the target for a sequence of control points, e.g. of a conformal arc.
+  /// Leaf positions are calculated as in the second pass for every control point, control points are
+  /// processed in parallel and no MRML node is modified.
+  /// @param beamNode - beam node, its current geometry is the reference the control point angles are applied to
+  /// @param mlcTableNode - table node with MLC boundary data
+  /// @param targetPoly - poly data of the target region
+  /// @param gantryAngles - gantry angle of each control point in degrees
+  /// @param collimatorAngles - collimator angle of each control point in degrees,
+  ///   the collimator angle of the beam is used for every control point if nullptr
+  /// @param leafPositions - output leaf positions (side "1", side "2") of every leaf pair of every control point,
+  ///   tuple index is controlPoint * nofLeafPairs + leafPair. Leaf pairs outside the target are closed at zero.
+  /// @param margin - margin in mm added to the target extent on both sides
+  /// @return true if position calculation is successfull, false otherwise
+  bool CalculateMultiLeafCollimatorPositionSequence( vtkMRMLRTBeamNode* beamNode,
+    vtkMRMLTableNode* mlcTableNode, vtkPolyData* targetPoly, vtkDoubleArray* gantryAngles,
+    vtkDoubleArray* collimatorAngles, vtkDoubleArray* leafPositions, double margin = 0.);
+
+  /// Create MLC table nodes of a control point sequence in a single scene batch
+  /// @param mlcTableNode - table node with MLC boundary data
+  /// @param leafPositions - leaf positions calculated by \sa CalculateMultiLeafCollimatorPositionSequence
+  /// @param mlcTableNodes - output collection of the created table nodes, one for each control point
+  /// @return true if the table nodes are created, false otherwise
+  bool CreateMultiLeafCollimatorTableNodesFromPositionSequence( vtkMRMLTableNode* mlcTableNode,
+    vtkDoubleArray* leafPositions, vtkCollection* mlcTableNodes);
 
   /// Calculate MLC position opening area, for statistic purposes.
   /// @return positive area value is successfull, negative value otherwise 
@@ -128,10 +159,16 @@ protected:
   /// node is being removed.
   virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node);
 
+  /// Clear target projection cache when the scene is closed
+  virtual void OnMRMLSceneEndClose();
+
 private:
   vtkSlicerMLCPositionLogic(const vtkSlicerMLCPositionLogic&); // Not implemented
   void operator=(const vtkSlicerMLCPositionLogic&); // Not implemented
 
+  class vtkInternal;
+  vtkInternal* Internal;
+
   /// Calculate closed convex hull curve boundary
   /// @param curveBound (xmin, xmax, ymin, ymax)
   /// @return true if successfull, false otherwise
@@ -147,7 +184,8 @@ private:
   void FindLeafPairRangeIndexes( vtkMRMLRTBeamNode* beamNode, vtkMRMLTableNode* mlcTableNode, 
     int& leafPairIndexFirst, int& leafPairIndexLast);
 
-  /// Find leaf pair position using convex hull curve data (first pass, fast and coarse)
+  /// Find leaf pair position using convex hull curve data (first pass, fast and coarse).
+  /// Positions are the extent of the curve polygon clipped by the leaf pair strip.
   /// @param convexHullCurveNode - convex hull curve
   /// @param mlcTableNode is used only to get leaf pair boundary data
   /// @param leafPairIndex - index of a leaf pair (starts from 0)
@@ -155,29 +193,11 @@ private:
   /// @param side2 - leaf pair position on side 1
   /// @param strategy - position strategy (1 = out-of-field; 2 = in-field; 3 = cross-boundary; only out-of-field implemented)
   /// @param maxPositionDistance - maximum position of the leaf pair
-  /// @param positionStep - position step of leaf pair
   /// @return true if successfull, false otherwise
   bool FindLeafPairPositions( vtkMRMLMarkupsCurveNode* convexHullCurveNode,
     vtkMRMLTableNode* mlcTableNode, size_t leafPairIndex, 
     double& side1, double& side2, int strategy = 1, 
-    double maxPositionDistance = 100., double positionStep = 0.01);
-
-  /// Find leaf pair position using collision filter between leaf 
-  /// rectangle projection and target polydata (second pass, slow and more precise)
-  /// @param beamNode - beam node with observed mlc table
-  /// @param leafPoly - leaf polydata
-  /// @param targetPoly - target polydata
-  /// @param sidePos - final leaf position on current side 
-  /// @param initialPosition - initial leaf position on current side 
-  /// @param sideType - leaf side (1 = side 1; 2 = side 2)
-  /// @param mlcType - type of MLC (true = MLCX, false = MLCY)
-  /// @param maxPositionDistance - maximum position of the leaf pair
-  /// @param positionStep - position step of leaf pair
-  /// @return true if successfull, false otherwise
-  bool FindLeafAndTargetCollision( vtkMRMLRTBeamNode* beamNode, 
-    vtkPolyData* leafPoly, vtkPolyData* targetPoly, double& sidePos, 
-    double initialPosition, int sideType = 1, bool mlcType = true, 
-    double maxPositionDistance = 100., double positionStep = 0.01);
+    double maxPositionDistance = 100.);
 };
 
 #endif
@@ -37,6 +37,7 @@
 
 // VTK includes
 #include <vtkCommand.h>
+#include <vtkDataArray.h>
 #include <vtkObjectFactory.h>
 #include <vtkSmartPointer.h>
 #include <vtkIntArray.h>
@@ -49,11 +50,21 @@
 //------------------------------------------------------------------------------
 const char* vtkMRMLRTBeamNode::NEW_BEAM_NODE_NAME_PREFIX = "NewBeam_";
 const char* vtkMRMLRTBeamNode::BEAM_TRANSFORM_NODE_NAME_POSTFIX = "_BeamTransform";
+const char* vtkMRMLRTBeamNode::CONTROL_POINT_GANTRY_ANGLE_COLUMN_NAME = "GantryAngle";
+const char* vtkMRMLRTBeamNode::CONTROL_POINT_COLLIMATOR_ANGLE_COLUMN_NAME = "CollimatorAngle";
+const char* vtkMRMLRTBeamNode::CONTROL_POINT_COUCH_ANGLE_COLUMN_NAME = "CouchAngle";
+const char* vtkMRMLRTBeamNode::CONTROL_POINT_X1_JAW_COLUMN_NAME = "X1Jaw";
+const char* vtkMRMLRTBeamNode::CONTROL_POINT_X2_JAW_COLUMN_NAME = "X2Jaw";
+const char* vtkMRMLRTBeamNode::CONTROL_POINT_Y1_JAW_COLUMN_NAME = "Y1Jaw";
+const char* vtkMRMLRTBeamNode::CONTROL_POINT_Y2_JAW_COLUMN_NAME = "Y2Jaw";
+const char* vtkMRMLRTBeamNode::CONTROL_POINT_CUMULATIVE_METERSET_WEIGHT_COLUMN_NAME = "CumulativeMetersetWeight";
+const char* vtkMRMLRTBeamNode::CONTROL_POINT_LEAF_POSITION_COLUMN_NAME_PREFIX = "Leaf";
 
 //------------------------------------------------------------------------------
 static const char* MLC_BOUNDARY_POSITION_REFERENCE_ROLE = "MLCBoundaryAndPositionRef";
 static const char* DRR_REFERENCE_ROLE = "DRRRef";
 static const char* CONTOUR_BEV_REFERENCE_ROLE = "contourBEVRef";
+static const char* CONTROL_POINT_TABLE_REFERENCE_ROLE = "controlPointTableRef";
 
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLRTBeamNode);
@@ -74,6 +85,8 @@ vtkMRMLRTBeamNode::vtkMRMLRTBeamNode()
   this->CollimatorAngle = 0.0;
   this->CouchAngle = 0.0;
 
+  this->CurrentControlPointIndex = -1;
+
   this->SAD = 2000.0;
 
   this->SourceToJawsDistanceX = 500.;
@@ -110,6 +123,7 @@ void vtkMRMLRTBeamNode::WriteXML(ostream& of, int nIndent)
   vtkMRMLWriteXMLFloatMacro(GantryAngle, GantryAngle);
   vtkMRMLWriteXMLFloatMacro(CollimatorAngle, CollimatorAngle);
   vtkMRMLWriteXMLFloatMacro(CouchAngle, CouchAngle);
+  vtkMRMLWriteXMLIntMacro(CurrentControlPointIndex, CurrentControlPointIndex);
   vtkMRMLWriteXMLEndMacro();
 }
 
@@ -134,6 +148,7 @@ void vtkMRMLRTBeamNode::ReadXMLAttributes(const char** atts)
   vtkMRMLReadXMLFloatMacro(GantryAngle, GantryAngle);
   vtkMRMLReadXMLFloatMacro(CollimatorAngle, CollimatorAngle);
   vtkMRMLReadXMLFloatMacro(CouchAngle, CouchAngle);
+  vtkMRMLReadXMLIntMacro(CurrentControlPointIndex, CurrentControlPointIndex);
   vtkMRMLReadXMLEndMacro();
 }
 
@@ -180,6 +195,7 @@ void vtkMRMLRTBeamNode::Copy(vtkMRMLNode *anode)
   vtkMRMLCopyFloatMacro(GantryAngle);
   vtkMRMLCopyFloatMacro(CollimatorAngle);
   vtkMRMLCopyFloatMacro(CouchAngle);
+  vtkMRMLCopyIntMacro(CurrentControlPointIndex);
   vtkMRMLCopyEndMacro();
 
   this->EndModify(disabledModify);
@@ -213,6 +229,7 @@ void vtkMRMLRTBeamNode::CopyContent(vtkMRMLNode *anode, bool deepCopy/*=true*/)
   vtkMRMLCopyFloatMacro(GantryAngle);
   vtkMRMLCopyFloatMacro(CollimatorAngle);
   vtkMRMLCopyFloatMacro(CouchAngle);
+  vtkMRMLCopyIntMacro(CurrentControlPointIndex);
   vtkMRMLCopyEndMacro();
 }
 
@@ -256,6 +273,7 @@ void vtkMRMLRTBeamNode::PrintSelf(ostream& os, vtkIndent indent)
   vtkMRMLPrintFloatMacro(GantryAngle);
   vtkMRMLPrintFloatMacro(CollimatorAngle);
   vtkMRMLPrintFloatMacro(CouchAngle);
+  vtkMRMLPrintIntMacro(CurrentControlPointIndex);
   vtkMRMLPrintEndMacro();
 }
 
@@ -339,6 +357,135 @@ void vtkMRMLRTBeamNode::SetAndObserveMultiLeafCollimatorTableNode(vtkMRMLTableNo
   this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
 }
 
+//----------------------------------------------------------------------------
+vtkMRMLTableNode* vtkMRMLRTBeamNode::GetControlPointTableNode()
+{
+  return vtkMRMLTableNode::SafeDownCast( this->GetNodeReference(CONTROL_POINT_TABLE_REFERENCE_ROLE) );
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLRTBeamNode::SetAndObserveControlPointTableNode(vtkMRMLTableNode* node)
+{
+  if (node && this->Scene != node->GetScene())
+  {
+    vtkErrorMacro("Cannot set reference: the referenced and referencing node are not in the same scene");
+    return;
+  }
+
+  this->SetNodeReferenceID(CONTROL_POINT_TABLE_REFERENCE_ROLE, (node ? node->GetID() : nullptr));
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLRTBeamNode::GetNumberOfControlPoints()
+{
+  vtkMRMLTableNode* controlPointTableNode = this->GetControlPointTableNode();
+  if (!controlPointTableNode || !controlPointTableNode->GetTable())
+  {
+    return 0;
+  }
+  return static_cast<int>(controlPointTableNode->GetTable()->GetNumberOfRows());
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLRTBeamNode::SetCurrentControlPointIndex(int controlPointIndex)
+{
+  vtkMRMLTableNode* controlPointTableNode = this->GetControlPointTableNode();
+  vtkTable* controlPointTable = (controlPointTableNode ? controlPointTableNode->GetTable() : nullptr);
+  if (!controlPointTable)
+  {
+    vtkErrorMacro("SetCurrentControlPointIndex: Beam " << (this->Name ? this->Name : "") << " has no control point table");
+    return false;
+  }
+  if (controlPointIndex < 0 || controlPointIndex >= controlPointTable->GetNumberOfRows())
+  {
+    vtkErrorMacro("SetCurrentControlPointIndex: Invalid control point index " << controlPointIndex
+      << ", number of control points is " << controlPointTable->GetNumberOfRows());
+    return false;
+  }
+
+  // Only the value of the requested row is read from each column
+  auto getControlPointValue = [controlPointTable, controlPointIndex](const char* columnName, double& value)
+  {
+    vtkDataArray* column = vtkDataArray::SafeDownCast(controlPointTable->GetColumnByName(columnName));
+    if (!column)
+    {
+      return false;
+    }
+    value = column->GetComponent(controlPointIndex, 0);
+    return true;
+  };
+
+  MRMLNodeModifyBlocker blocker(this);
+
+  double value = 0.0;
+  if (getControlPointValue(CONTROL_POINT_GANTRY_ANGLE_COLUMN_NAME, value))
+  {
+    this->SetGantryAngle(value);
+  }
+  if (getControlPointValue(CONTROL_POINT_COLLIMATOR_ANGLE_COLUMN_NAME, value))
+  {
+    this->SetCollimatorAngle(value);
+  }
+  if (getControlPointValue(CONTROL_POINT_COUCH_ANGLE_COLUMN_NAME, value))
+  {
+    this->SetCouchAngle(value);
+  }
+  if (getControlPointValue(CONTROL_POINT_X1_JAW_COLUMN_NAME, value))
+  {
+    this->SetX1Jaw(value);
+  }
+  if (getControlPointValue(CONTROL_POINT_X2_JAW_COLUMN_NAME, value))
+  {
+    this->SetX2Jaw(value);
+  }
+  if (getControlPointValue(CONTROL_POINT_Y1_JAW_COLUMN_NAME, value))
+  {
+    this->SetY1Jaw(value);
+  }
+  if (getControlPointValue(CONTROL_POINT_Y2_JAW_COLUMN_NAME, value))
+  {
+    this->SetY2Jaw(value);
+  }
+
+  // Copy leaf positions into the MLC table that the beam model is generated from
+  vtkMRMLTableNode* mlcTableNode = this->GetMultiLeafCollimatorTableNode();
+  vtkTable* mlcTable = (mlcTableNode ? mlcTableNode->GetTable() : nullptr);
+  if (mlcTable && mlcTable->GetNumberOfColumns() == 3 && mlcTable->GetNumberOfRows() > 1)
+  {
+    vtkDataArray* positions1 = vtkDataArray::SafeDownCast(mlcTable->GetColumn(1));
+    vtkDataArray* positions2 = vtkDataArray::SafeDownCast(mlcTable->GetColumn(2));
+    vtkIdType numberOfLeafPairs = mlcTable->GetNumberOfRows() - 1;
+    bool mlcModified = false;
+    for (vtkIdType leafPairIndex = 0; positions1 && positions2 && leafPairIndex < numberOfLeafPairs; ++leafPairIndex)
+    {
+      std::string leafPairIndexString = std::to_string(leafPairIndex);
+      std::string columnName1 = std::string(CONTROL_POINT_LEAF_POSITION_COLUMN_NAME_PREFIX) + "1_" + leafPairIndexString;
+      std::string columnName2 = std::string(CONTROL_POINT_LEAF_POSITION_COLUMN_NAME_PREFIX) + "2_" + leafPairIndexString;
+      if (getControlPointValue(columnName1.c_str(), value))
+      {
+        positions1->SetComponent(leafPairIndex, 0, value);
+        mlcModified = true;
+      }
+      if (getControlPointValue(columnName2.c_str(), value))
+      {
+        positions2->SetComponent(leafPairIndex, 0, value);
+        mlcModified = true;
+      }
+    }
+    if (mlcModified)
+    {
+      positions1->Modified();
+      positions2->Modified();
+      mlcTableNode->Modified();
+      this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
+    }
+  }
+
+  this->CurrentControlPointIndex = controlPointIndex;
+  this->Modified();
+  return true;
+}
+
 //----------------------------------------------------------------------------
 vtkMRMLScalarVolumeNode* vtkMRMLRTBeamNode::GetDRRVolumeNode()
 {
@@ -43,6 +43,19 @@ public:
   static const char* NEW_BEAM_NODE_NAME_PREFIX;
   static const char* BEAM_TRANSFORM_NODE_NAME_POSTFIX;
 
+  /// Column names of the control point table (\sa GetControlPointTableNode)
+  static const char* CONTROL_POINT_GANTRY_ANGLE_COLUMN_NAME;
+  static const char* CONTROL_POINT_COLLIMATOR_ANGLE_COLUMN_NAME;
+  static const char* CONTROL_POINT_COUCH_ANGLE_COLUMN_NAME;
+  static const char* CONTROL_POINT_X1_JAW_COLUMN_NAME;
+  static const char* CONTROL_POINT_X2_JAW_COLUMN_NAME;
+  static const char* CONTROL_POINT_Y1_JAW_COLUMN_NAME;
+  static const char* CONTROL_POINT_Y2_JAW_COLUMN_NAME;
+  static const char* CONTROL_POINT_CUMULATIVE_METERSET_WEIGHT_COLUMN_NAME;
+  /// Prefix of the leaf position columns of the control point table. Column name is
+  /// the prefix followed by the side ("1" or "2"), an underscore, and the leaf pair index
+  static const char* CONTROL_POINT_LEAF_POSITION_COLUMN_NAME_PREFIX;
+
   enum
   {
     /// Fired if beam geometry (beam model) needs to be updated
@@ -113,6 +126,23 @@ public:
   /// Triggers \sa BeamGeometryModified event and re-generation of beam model
   void SetAndObserveMultiLeafCollimatorTableNode(vtkMRMLTableNode* node);
 
+  /// Get control point table node. Dynamic beams can store the parameters of all their control points
+  /// in a single table (one row per control point, one column per parameter, see the CONTROL_POINT_*
+  /// column names) instead of a sequence of beam nodes. \sa SetCurrentControlPointIndex
+  vtkMRMLTableNode* GetControlPointTableNode();
+  /// Set and observe control point table node
+  void SetAndObserveControlPointTableNode(vtkMRMLTableNode* node);
+
+  /// Get number of control points in the control point table, 0 if there is no table
+  int GetNumberOfControlPoints();
+  /// Set beam parameters (angles, jaw positions, MLC leaf positions) from the given row of the
+  /// control point table. Parameters without column in the table are left unchanged.
+  /// Triggers \sa BeamTransformModified and \sa BeamGeometryModified events
+  /// \return Success flag
+  bool SetCurrentControlPointIndex(int controlPointIndex);
+  /// Get index of the control point the beam parameters were last set from, -1 if none
+  vtkGetMacro(CurrentControlPointIndex, int);
+
   /// Get DRR volume node
   vtkMRMLScalarVolumeNode* GetDRRVolumeNode();
   /// Set and observe DRR volume node
@@ -248,6 +278,9 @@ protected:
   /// Couch angle
   double CouchAngle;
 
+  /// Index of the control point the beam parameters were last set from
+  int CurrentControlPointIndex;
+
 protected:
   /// Visible multi-leaf collimator points
   typedef std::vector< std::pair< double, double > > MLCVisiblePointVector;
@@ -43,10 +43,22 @@
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkNew.h>
 #include <vtkTable.h>
 #include <vtkCellArray.h>
 #include <vtkAppendPolyData.h>
 
+// STD includes
+#include <algorithm>
+#include <sstream>
+
+//------------------------------------------------------------------------------
+const char* vtkMRMLRTIonBeamNode::SCAN_SPOT_POSITION_X_COLUMN_NAME = "X";
+const char* vtkMRMLRTIonBeamNode::SCAN_SPOT_POSITION_Y_COLUMN_NAME = "Y";
+const char* vtkMRMLRTIonBeamNode::SCAN_SPOT_METERSET_WEIGHT_COLUMN_NAME = "Weight";
+const char* vtkMRMLRTIonBeamNode::SCAN_SPOT_ENERGY_LAYER_COLUMN_NAME = "EnergyLayer";
+
 //------------------------------------------------------------------------------
 namespace
 {
@@ -54,6 +66,37 @@ namespace
 const char* const SCANSPOT_REFERENCE_ROLE = "ScanSpotRef";
 double FWHM_TO_SIGMA = 1. / (2. * sqrt(2. * log(2.)));
 
+/// Get column of the scan spot table with the given array type.
+/// Column is created if missing, or converted if it has a different type (e.g. in tables read from file).
+template<class ArrayType> ArrayType* GetOrCreateScanSpotColumn(vtkTable* table, const char* columnName)
+{
+  vtkAbstractArray* existingColumn = table->GetColumnByName(columnName);
+  ArrayType* column = ArrayType::SafeDownCast(existingColumn);
+  if (column)
+  {
+    return column;
+  }
+
+  vtkNew<ArrayType> newColumn;
+  vtkDataArray* existingDataColumn = vtkDataArray::SafeDownCast(existingColumn);
+  if (existingDataColumn)
+  {
+    newColumn->DeepCopy(existingDataColumn);
+  }
+  else
+  {
+    newColumn->SetNumberOfTuples(table->GetNumberOfRows());
+    newColumn->Fill(0);
+  }
+  newColumn->SetName(columnName);
+  if (existingColumn)
+  {
+    table->RemoveColumnByName(columnName);
+  }
+  table->AddColumn(newColumn);
+  return newColumn;
+}
+
 } // namespace
 
 //------------------------------------------------------------------------------
@@ -99,6 +142,17 @@ void vtkMRMLRTIonBeamNode::WriteXML(ostream& of, int nIndent)
   vtkMRMLWriteXMLFloatMacro( IsocenterToRangeShifterDistance, IsocenterToRangeShifterDistance);
   vtkMRMLWriteXMLVectorMacro( ScanningSpotSize, ScanningSpotSize, float, 2);
   vtkMRMLWriteXMLEndMacro();
+
+  // Energy layers as space separated (energy, number of spots, tune ID) triplets.
+  // Tune ID is prefixed so that empty IDs are preserved.
+  of << " ScanSpotEnergyLayers=\"";
+  for (size_t layerIndex = 0; layerIndex < this->ScanSpotEnergyLayers.size(); ++layerIndex)
+  {
+    const ScanSpotEnergyLayer& layer = this->ScanSpotEnergyLayers[layerIndex];
+    of << (layerIndex > 0 ? " " : "") << layer.NominalBeamEnergy << " " << layer.NumberOfScanSpots
+      << " T" << vtkMRMLNode::URLEncodeString(layer.ScanSpotTuneId.c_str());
+  }
+  of << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -115,6 +169,26 @@ void vtkMRMLRTIonBeamNode::ReadXMLAttributes(const char** atts)
   vtkMRMLReadXMLFloatMacro( IsocenterToRangeShifterDistance, IsocenterToRangeShifterDistance);
   vtkMRMLReadXMLVectorMacro( ScanningSpotSize, ScanningSpotSize, float, 2);
   vtkMRMLReadXMLEndMacro();
+
+  for (const char** attribute = atts; attribute && *attribute; attribute += 2)
+  {
+    if (strcmp(attribute[0], "ScanSpotEnergyLayers") || !attribute[1])
+    {
+      continue;
+    }
+    this->ScanSpotEnergyLayers.clear();
+    std::istringstream layersStream(attribute[1]);
+    ScanSpotEnergyLayer layer;
+    std::string tuneIdToken;
+    vtkIdType firstScanSpotIndex = 0;
+    while (layersStream >> layer.NominalBeamEnergy >> layer.NumberOfScanSpots >> tuneIdToken)
+    {
+      layer.ScanSpotTuneId = vtkMRMLNode::URLDecodeString(tuneIdToken.substr(1).c_str());
+      layer.FirstScanSpotIndex = firstScanSpotIndex;
+      firstScanSpotIndex += layer.NumberOfScanSpots;
+      this->ScanSpotEnergyLayers.push_back(layer);
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -166,6 +240,7 @@ void vtkMRMLRTIonBeamNode::Copy(vtkMRMLNode *anode)
   vtkMRMLCopyFloatMacro(CollimatorAngle);
   vtkMRMLCopyFloatMacro(CouchAngle);
   vtkMRMLCopyEndMacro();
+  this->ScanSpotEnergyLayers = node->ScanSpotEnergyLayers;
 
   this->EndModify(disabledModify);
   
@@ -203,6 +278,7 @@ void vtkMRMLRTIonBeamNode::CopyContent(vtkMRMLNode *anode, bool deepCopy/*=true*
   vtkMRMLCopyFloatMacro(CollimatorAngle);
   vtkMRMLCopyFloatMacro(CouchAngle);
   vtkMRMLCopyEndMacro();
+  this->ScanSpotEnergyLayers = node->ScanSpotEnergyLayers;
 }
 
 //----------------------------------------------------------------------------
@@ -225,6 +301,7 @@ void vtkMRMLRTIonBeamNode::PrintSelf(ostream& os, vtkIndent indent)
   vtkMRMLPrintFloatMacro(IsocenterToRangeShifterDistance);
   vtkMRMLPrintVectorMacro( ScanningSpotSize, float, 2);
   vtkMRMLPrintEndMacro();
+  os << indent << "NumberOfScanSpotEnergyLayers: " << this->ScanSpotEnergyLayers.size() << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -247,6 +324,117 @@ vtkMRMLTableNode* vtkMRMLRTIonBeamNode::GetScanSpotTableNode()
   return vtkMRMLTableNode::SafeDownCast( this->GetNodeReference(SCANSPOT_REFERENCE_ROLE) );
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLRTIonBeamNode::AddScanSpotEnergyLayer(double nominalBeamEnergy, const std::string& scanSpotTuneId,
+  vtkIdType numberOfScanSpots, const float* positionMap, const float* metersetWeights)
+{
+  vtkMRMLTableNode* scanSpotTableNode = this->GetScanSpotTableNode();
+  if (!scanSpotTableNode || !scanSpotTableNode->GetTable())
+  {
+    vtkErrorMacro("AddScanSpotEnergyLayer: No scan spot table node is set for beam " << (this->Name ? this->Name : ""));
+    return false;
+  }
+  if (numberOfScanSpots < 0 || (numberOfScanSpots > 0 && (!positionMap || !metersetWeights)))
+  {
+    vtkErrorMacro("AddScanSpotEnergyLayer: Invalid scan spot data");
+    return false;
+  }
+
+  vtkTable* table = scanSpotTableNode->GetTable();
+  vtkFloatArray* positionsX = GetOrCreateScanSpotColumn<vtkFloatArray>(table, SCAN_SPOT_POSITION_X_COLUMN_NAME);
+  vtkFloatArray* positionsY = GetOrCreateScanSpotColumn<vtkFloatArray>(table, SCAN_SPOT_POSITION_Y_COLUMN_NAME);
+  vtkFloatArray* weights = GetOrCreateScanSpotColumn<vtkFloatArray>(table, SCAN_SPOT_METERSET_WEIGHT_COLUMN_NAME);
+  vtkIntArray* layerIndices = GetOrCreateScanSpotColumn<vtkIntArray>(table, SCAN_SPOT_ENERGY_LAYER_COLUMN_NAME);
+
+  ScanSpotEnergyLayer layer;
+  layer.NominalBeamEnergy = nominalBeamEnergy;
+  layer.ScanSpotTuneId = scanSpotTuneId;
+  layer.FirstScanSpotIndex = table->GetNumberOfRows();
+  layer.NumberOfScanSpots = numberOfScanSpots;
+  int layerIndex = static_cast<int>(this->ScanSpotEnergyLayers.size());
+
+  // Grow all columns at once, then copy the spots directly into the column buffers
+  table->SetNumberOfRows(layer.FirstScanSpotIndex + numberOfScanSpots);
+  float* positionsXBuffer = positionsX->GetPointer(layer.FirstScanSpotIndex);
+  float* positionsYBuffer = positionsY->GetPointer(layer.FirstScanSpotIndex);
+  float* weightsBuffer = weights->GetPointer(layer.FirstScanSpotIndex);
+  int* layerIndicesBuffer = layerIndices->GetPointer(layer.FirstScanSpotIndex);
+  for (vtkIdType spotIndex = 0; spotIndex < numberOfScanSpots; ++spotIndex)
+  {
+    positionsXBuffer[spotIndex] = positionMap[2 * spotIndex];
+    positionsYBuffer[spotIndex] = positionMap[2 * spotIndex + 1];
+    weightsBuffer[spotIndex] = metersetWeights[spotIndex];
+    layerIndicesBuffer[spotIndex] = layerIndex;
+  }
+  positionsX->Modified();
+  positionsY->Modified();
+  weights->Modified();
+  layerIndices->Modified();
+  table->Modified();
+  scanSpotTableNode->Modified();
+
+  this->ScanSpotEnergyLayers.push_back(layer);
+  this->Modified();
+  this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLRTIonBeamNode::RemoveAllScanSpots()
+{
+  vtkMRMLTableNode* scanSpotTableNode = this->GetScanSpotTableNode();
+  if (scanSpotTableNode && scanSpotTableNode->GetTable())
+  {
+    scanSpotTableNode->GetTable()->SetNumberOfRows(0);
+    scanSpotTableNode->Modified();
+  }
+  this->ScanSpotEnergyLayers.clear();
+  this->Modified();
+  this->InvokeCustomModifiedEvent(vtkMRMLRTBeamNode::BeamGeometryModified);
+}
+
+//----------------------------------------------------------------------------
+const vtkMRMLRTIonBeamNode::ScanSpotEnergyLayer* vtkMRMLRTIonBeamNode::GetScanSpotEnergyLayer(int layerIndex)
+{
+  if (layerIndex < 0 || layerIndex >= static_cast<int>(this->ScanSpotEnergyLayers.size()))
+  {
+    return nullptr;
+  }
+  return &this->ScanSpotEnergyLayers[layerIndex];
+}
+
+//----------------------------------------------------------------------------
+vtkFloatArray* vtkMRMLRTIonBeamNode::GetScanSpotPositionsX()
+{
+  vtkMRMLTableNode* scanSpotTableNode = this->GetScanSpotTableNode();
+  return (scanSpotTableNode && scanSpotTableNode->GetTable()) ?
+    vtkFloatArray::SafeDownCast(scanSpotTableNode->GetTable()->GetColumnByName(SCAN_SPOT_POSITION_X_COLUMN_NAME)) : nullptr;
+}
+
+//----------------------------------------------------------------------------
+vtkFloatArray* vtkMRMLRTIonBeamNode::GetScanSpotPositionsY()
+{
+  vtkMRMLTableNode* scanSpotTableNode = this->GetScanSpotTableNode();
+  return (scanSpotTableNode && scanSpotTableNode->GetTable()) ?
+    vtkFloatArray::SafeDownCast(scanSpotTableNode->GetTable()->GetColumnByName(SCAN_SPOT_POSITION_Y_COLUMN_NAME)) : nullptr;
+}
+
+//----------------------------------------------------------------------------
+vtkFloatArray* vtkMRMLRTIonBeamNode::GetScanSpotMetersetWeights()
+{
+  vtkMRMLTableNode* scanSpotTableNode = this->GetScanSpotTableNode();
+  return (scanSpotTableNode && scanSpotTableNode->GetTable()) ?
+    vtkFloatArray::SafeDownCast(scanSpotTableNode->GetTable()->GetColumnByName(SCAN_SPOT_METERSET_WEIGHT_COLUMN_NAME)) : nullptr;
+}
+
+//----------------------------------------------------------------------------
+vtkIntArray* vtkMRMLRTIonBeamNode::GetScanSpotEnergyLayerIndices()
+{
+  vtkMRMLTableNode* scanSpotTableNode = this->GetScanSpotTableNode();
+  return (scanSpotTableNode && scanSpotTableNode->GetTable()) ?
+    vtkIntArray::SafeDownCast(scanSpotTableNode->GetTable()->GetColumnByName(SCAN_SPOT_ENERGY_LAYER_COLUMN_NAME)) : nullptr;
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLRTIonBeamNode::CreateDefaultDisplayNodes()
 {
@@ -363,6 +551,10 @@ void vtkMRMLRTIonBeamNode::CreateBeamPolyData(vtkPolyData* beamModelPolyData/*=n
 
   // Scan spot position map & meterset weights
   vtkMRMLTableNode* scanSpotTableNode = this->GetScanSpotTableNode();
+  if (scanSpotTableNode && scanSpotTableNode->GetNumberOfRows() == 0)
+  {
+    scanSpotTableNode = nullptr; // no spots, draw beam from jaws and MLC
+  }
   if (scanSpotTableNode)
   {
     vtkDebugMacro("CreateBeamPolyData: Valid scan spot parameters table node");
@@ -411,16 +603,31 @@ void vtkMRMLRTIonBeamNode::CreateBeamPolyData(vtkPolyData* beamModelPolyData/*=n
   // Scanning spot beam
   if (scanSpotTableNode)
   {
-    std::vector<double> positionX, positionY;
-    vtkIdType rows = scanSpotTableNode->GetNumberOfRows();
-    positionX.resize(rows);
-    positionY.resize(rows);
-    // copy scan scot map data for processing
-    for (vtkIdType row = 0; row < rows; row++)
+    // Border of the scan spot map
+    double rangeX[2] = { 0.0, 0.0 };
+    double rangeY[2] = { 0.0, 0.0 };
+    vtkTable* table = scanSpotTableNode->GetTable();
+    vtkDataArray* positionsX = vtkDataArray::SafeDownCast(table->GetColumnByName(SCAN_SPOT_POSITION_X_COLUMN_NAME));
+    vtkDataArray* positionsY = vtkDataArray::SafeDownCast(table->GetColumnByName(SCAN_SPOT_POSITION_Y_COLUMN_NAME));
+    if (positionsX && positionsY)
     {
-      vtkTable* table = scanSpotTableNode->GetTable();
-      positionX[row] = table->GetValue( row, 0).ToDouble();
-      positionY[row] = table->GetValue( row, 1).ToDouble();
+      positionsX->GetRange(rangeX, 0);
+      positionsY->GetRange(rangeY, 0);
+    }
+    else
+    {
+      // Non-numeric columns (e.g. table read from file without schema)
+      rangeX[0] = rangeY[0] = VTK_DOUBLE_MAX;
+      rangeX[1] = rangeY[1] = -VTK_DOUBLE_MAX;
+      for (vtkIdType row = 0; row < table->GetNumberOfRows(); row++)
+      {
+        double x = table->GetValue( row, 0).ToDouble();
+        double y = table->GetValue( row, 1).ToDouble();
+        rangeX[0] = std::min(rangeX[0], x);
+        rangeX[1] = std::max(rangeX[1], x);
+        rangeY[0] = std::min(rangeY[0], y);
+        rangeY[1] = std::max(rangeY[1], y);
+      }
     }
     double beamTopCap = std::min( this->VSADx, this->VSADy);
     double beamBottomCap = -beamTopCap;
@@ -434,10 +641,10 @@ void vtkMRMLRTIonBeamNode::CreateBeamPolyData(vtkPolyData* beamModelPolyData/*=n
     double sigmaX = this->ScanningSpotSize[0] * FWHM_TO_SIGMA;
     double sigmaY = this->ScanningSpotSize[1] * FWHM_TO_SIGMA;
 
-    double borderMinX = *std::min_element( positionX.begin(), positionX.end());
-    double borderMaxX = *std::max_element( positionX.begin(), positionX.end());
-    double borderMinY = *std::min_element( positionY.begin(), positionY.end());
-    double borderMaxY = *std::max_element( positionY.begin(), positionY.end());
+    double borderMinX = rangeX[0];
+    double borderMaxX = rangeX[1];
+    double borderMinY = rangeY[0];
+    double borderMaxY = rangeY[1];
 
     double sigmaX1 = M1x * sigmaX;
     double sigmaY1 = M1y * sigmaY;
@@ -28,9 +28,36 @@
 // MRML includes
 #include "vtkMRMLRTBeamNode.h"
 
+// STD includes
+#include <string>
+#include <vector>
+
+class vtkFloatArray;
+class vtkIntArray;
+
 /// \ingroup SlicerRt_QtModules_Beams
 class VTK_SLICER_BEAMS_MODULE_MRML_EXPORT vtkMRMLRTIonBeamNode : public vtkMRMLRTBeamNode
 {
+public:
+  /// Column names of the scan spot table (\sa GetScanSpotTableNode)
+  static const char* SCAN_SPOT_POSITION_X_COLUMN_NAME;
+  static const char* SCAN_SPOT_POSITION_Y_COLUMN_NAME;
+  static const char* SCAN_SPOT_METERSET_WEIGHT_COLUMN_NAME;
+  static const char* SCAN_SPOT_ENERGY_LAYER_COLUMN_NAME;
+
+  /// Energy layer of the scan spot map. The spots of a layer are stored contiguously
+  /// in the scan spot table, starting at row \sa FirstScanSpotIndex
+  struct ScanSpotEnergyLayer
+  {
+    /// Nominal beam energy of the layer (MeV/u)
+    double NominalBeamEnergy{ 0.0 };
+    /// Scan spot tune ID (optional, empty if not specified)
+    std::string ScanSpotTuneId;
+    /// Index of the first scan spot of the layer in the scan spot table
+    vtkIdType FirstScanSpotIndex{ 0 };
+    /// Number of scan spots in the layer
+    vtkIdType NumberOfScanSpots{ 0 };
+  };
 
 public:
   static vtkMRMLRTIonBeamNode *New();
@@ -121,6 +148,32 @@ public:
   /// Get scan spot position map & meterset weights table node
   vtkMRMLTableNode* GetScanSpotTableNode();
 
+  /// Append an energy layer to the scan spot map. The spots are copied in bulk into the columns of the
+  /// scan spot table, which must be set before (\sa SetAndObserveScanSpotTableNode). Missing columns are created.
+  /// Triggers \sa BeamGeometryModified event and re-generation of beam model
+  /// \param positionMap Scan spot positions as (x,y) pairs, 2 * numberOfScanSpots values
+  /// \param metersetWeights Scan spot meterset weights, numberOfScanSpots values
+  /// \return Success flag
+  bool AddScanSpotEnergyLayer(double nominalBeamEnergy, const std::string& scanSpotTuneId,
+    vtkIdType numberOfScanSpots, const float* positionMap, const float* metersetWeights);
+  /// Remove all energy layers and scan spots. Triggers \sa BeamGeometryModified event
+  void RemoveAllScanSpots();
+
+  /// Get number of energy layers added by \sa AddScanSpotEnergyLayer
+  int GetNumberOfScanSpotEnergyLayers() { return static_cast<int>(this->ScanSpotEnergyLayers.size()); };
+  /// Get energy layer of the scan spot map
+  /// \return Energy layer, nullptr if the index is out of range
+  const ScanSpotEnergyLayer* GetScanSpotEnergyLayer(int layerIndex);
+
+  /// Get contiguous array of scan spot X positions of all energy layers, nullptr if not available
+  vtkFloatArray* GetScanSpotPositionsX();
+  /// Get contiguous array of scan spot Y positions of all energy layers, nullptr if not available
+  vtkFloatArray* GetScanSpotPositionsY();
+  /// Get contiguous array of scan spot meterset weights of all energy layers, nullptr if not available
+  vtkFloatArray* GetScanSpotMetersetWeights();
+  /// Get contiguous array of scan spot energy layer indices, nullptr if not available
+  vtkIntArray* GetScanSpotEnergyLayerIndices();
+
 protected:
   /// Create beam model from beam parameters, supporting MLC leaves, jaws
   /// and scan spot map for modulated scan mode
@@ -153,6 +206,9 @@ protected:
   double IsocenterToRangeShifterDistance;
 
   float ScanningSpotSize[2];
+
+  /// Energy layers of the scan spot map. Scan spots themselves are stored in the scan spot table
+  std::vector<ScanSpotEnergyLayer> ScanSpotEnergyLayers;
 };
 
 #endif // __vtkMRMLRTIonBeamNode_h
@@ -0,0 +1,275 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Beams includes
+#include "vtkMRMLRTBeamNode.h"
+#include "vtkMRMLRTPlanNode.h"
+#include "vtkSlicerBeamsModuleLogic.h"
+#include "vtkSlicerMLCPositionLogic.h"
+
+// MRML includes
+#include <vtkMRMLMarkupsClosedCurveNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLTableNode.h>
+
+// VTK includes
+#include <vtkCubeSource.h>
+#include <vtkDoubleArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkTable.h>
+#include <vtkVector.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  // MLCX with 10 leaf pairs of 10 mm, boundaries at -50, -40, ..., 50 mm along Y
+  const unsigned int NUMBER_OF_LEAF_PAIRS = 10;
+  const double LEAF_PAIR_SIZE = 10.;
+  // Position of the leaves of a leaf pair that is not opened
+  const double CLOSED_LEAF_POSITION = -20.;
+
+  //-----------------------------------------------------------------------------
+  /// Set leaf positions of all leaf pairs of an MLC table
+  void SetLeafPositions(vtkMRMLTableNode* mlcTableNode, double side1, double side2)
+  {
+    vtkTable* table = mlcTableNode->GetTable();
+    for (unsigned int leafPair = 0; leafPair < NUMBER_OF_LEAF_PAIRS; ++leafPair)
+    {
+      table->SetValue(leafPair, 1, side1);
+      table->SetValue(leafPair, 2, side2);
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  /// Check leaf positions of the leaf pairs of an MLC table.
+  /// Leaf pairs from \a firstLeafPair to \a lastLeafPair are expected at (side1, side2), the others closed.
+  bool CheckLeafPositions(vtkMRMLTableNode* mlcTableNode, unsigned int firstLeafPair, unsigned int lastLeafPair,
+    double side1, double side2)
+  {
+    vtkTable* table = mlcTableNode->GetTable();
+    for (unsigned int leafPair = 0; leafPair < NUMBER_OF_LEAF_PAIRS; ++leafPair)
+    {
+      bool open = (leafPair >= firstLeafPair && leafPair <= lastLeafPair);
+      double expectedSide1 = open ? side1 : CLOSED_LEAF_POSITION;
+      double expectedSide2 = open ? side2 : CLOSED_LEAF_POSITION;
+      double position1 = table->GetValue(leafPair, 1).ToDouble();
+      double position2 = table->GetValue(leafPair, 2).ToDouble();
+      if (fabs(position1 - expectedSide1) > 1e-6 || fabs(position2 - expectedSide2) > 1e-6)
+      {
+        std::cerr << "Leaf pair " << leafPair << " is at (" << position1 << ", " << position2
+          << ") instead of (" << expectedSide1 << ", " << expectedSide2 << ")" << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  int TestFindLeafPairPositions()
+  {
+    vtkNew<vtkMRMLScene> scene;
+    vtkNew<vtkSlicerBeamsModuleLogic> beamsLogic;
+    beamsLogic->SetMRMLScene(scene);
+    vtkSlicerMLCPositionLogic* mlcLogic = beamsLogic->GetMLCPositionLogic();
+
+    vtkMRMLTableNode* mlcTableNode = mlcLogic->CreateMultiLeafCollimatorTableNodeBoundaryData(
+      true, NUMBER_OF_LEAF_PAIRS, LEAF_PAIR_SIZE);
+    if (!mlcTableNode)
+    {
+      std::cerr << __LINE__ << ": Failed to create MLC table" << std::endl;
+      return EXIT_FAILURE;
+    }
+    SetLeafPositions(mlcTableNode, CLOSED_LEAF_POSITION, CLOSED_LEAF_POSITION);
+
+    // First pass: axis-aligned square x = [-15, 25], y = [-15, 15] on the isocenter plane.
+    // It is within the strips of leaf pairs 3 to 6 (y = [-20, 20]), the leaves of those are at the
+    // extent of the square along X, the other leaf pairs are not changed.
+    vtkNew<vtkMRMLMarkupsClosedCurveNode> curveNode;
+    curveNode->SetCurveTypeToLinear();
+    scene->AddNode(curveNode);
+    curveNode->AddControlPoint(vtkVector3d(-15., -15., 0.));
+    curveNode->AddControlPoint(vtkVector3d(25., -15., 0.));
+    curveNode->AddControlPoint(vtkVector3d(25., 15., 0.));
+    curveNode->AddControlPoint(vtkVector3d(-15., 15., 0.));
+    if (!mlcLogic->CalculateMultiLeafCollimatorPosition(mlcTableNode, curveNode))
+    {
+      std::cerr << __LINE__ << ": Failed to calculate MLC position from the square curve" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!CheckLeafPositions(mlcTableNode, 3, 6, -15., 25.))
+    {
+      std::cerr << __LINE__ << ": Leaf positions from the square curve are wrong" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Second pass: 30 mm cube target centered at the isocenter, which is within the strips of the
+    // same leaf pairs. Only the leaf pairs opened by the first pass are fitted to the target.
+    vtkNew<vtkMRMLRTBeamNode> beamNode;
+    scene->AddNode(beamNode);
+    vtkNew<vtkMRMLRTPlanNode> planNode;
+    scene->AddNode(planNode);
+    planNode->AddBeam(beamNode);
+
+    vtkNew<vtkCubeSource> cubeSource;
+    cubeSource->SetBounds(-15., 15., -15., 15., -15., 15.);
+    cubeSource->Update();
+    vtkPolyData* targetPoly = cubeSource->GetOutput();
+
+    if (!mlcLogic->CalculateMultiLeafCollimatorPosition(beamNode, mlcTableNode, targetPoly))
+    {
+      std::cerr << __LINE__ << ": Failed to calculate MLC position from the target" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!CheckLeafPositions(mlcTableNode, 3, 6, -15., 15.))
+    {
+      std::cerr << __LINE__ << ": Leaf positions fitted to the target without margin are wrong" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Margin is added on both sides
+    if (!mlcLogic->CalculateMultiLeafCollimatorPosition(beamNode, mlcTableNode, targetPoly, 5.))
+    {
+      std::cerr << __LINE__ << ": Failed to calculate MLC position from the target with margin" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!CheckLeafPositions(mlcTableNode, 3, 6, -20., 20.))
+    {
+      std::cerr << __LINE__ << ": Leaf positions fitted to the target with 5 mm margin are wrong" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+  }
+
+  //-----------------------------------------------------------------------------
+  int TestCalculateMultiLeafCollimatorPositionSequence()
+  {
+    vtkNew<vtkMRMLScene> scene;
+    vtkNew<vtkSlicerBeamsModuleLogic> beamsLogic;
+    beamsLogic->SetMRMLScene(scene);
+    vtkSlicerMLCPositionLogic* mlcLogic = beamsLogic->GetMLCPositionLogic();
+
+    vtkMRMLTableNode* mlcTableNode = mlcLogic->CreateMultiLeafCollimatorTableNodeBoundaryData(
+      true, NUMBER_OF_LEAF_PAIRS, LEAF_PAIR_SIZE);
+    if (!mlcTableNode)
+    {
+      std::cerr << __LINE__ << ": Failed to create MLC table" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkNew<vtkMRMLRTBeamNode> beamNode;
+    scene->AddNode(beamNode);
+    vtkNew<vtkMRMLRTPlanNode> planNode;
+    scene->AddNode(planNode);
+    planNode->AddBeam(beamNode);
+
+    // 30 mm cube target centered at the isocenter. Gantry rotates it around the Y axis of the beam frame,
+    // so its projection covers y = [-15, 15] (leaf pairs 3 to 6) and x = +/-15 * (|cos| + |sin|) of the gantry angle.
+    vtkNew<vtkCubeSource> cubeSource;
+    cubeSource->SetBounds(-15., 15., -15., 15., -15., 15.);
+    cubeSource->Update();
+    vtkPolyData* targetPoly = cubeSource->GetOutput();
+
+    const int numberOfControlPoints = 4;
+    const double controlPointGantryAngles[numberOfControlPoints] = { 0., 30., 90., 225. };
+    vtkNew<vtkDoubleArray> gantryAngles;
+    for (double gantryAngle : controlPointGantryAngles)
+    {
+      gantryAngles->InsertNextValue(gantryAngle);
+    }
+    vtkNew<vtkDoubleArray> leafPositions;
+    if (!mlcLogic->CalculateMultiLeafCollimatorPositionSequence(beamNode, mlcTableNode, targetPoly,
+      gantryAngles, nullptr, leafPositions))
+    {
+      std::cerr << __LINE__ << ": Failed to calculate MLC position sequence" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (leafPositions->GetNumberOfComponents() != 2
+      || leafPositions->GetNumberOfTuples() != numberOfControlPoints * NUMBER_OF_LEAF_PAIRS)
+    {
+      std::cerr << __LINE__ << ": Leaf positions array size is wrong" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Leaf positions of every control point must be the same as the ones found from the convex hull
+    // of the target for the beam rotated to the gantry angle of the control point
+    for (int controlPoint = 0; controlPoint < numberOfControlPoints; ++controlPoint)
+    {
+      double gantryAngle = controlPointGantryAngles[controlPoint];
+      beamNode->SetGantryAngle(gantryAngle);
+      beamsLogic->UpdateBeamTransform(beamNode);
+      vtkMRMLMarkupsCurveNode* curveNode = mlcLogic->CalculatePositionConvexHullCurve(beamNode, targetPoly);
+      SetLeafPositions(mlcTableNode, CLOSED_LEAF_POSITION, CLOSED_LEAF_POSITION);
+      if (!curveNode || !mlcLogic->CalculateMultiLeafCollimatorPosition(mlcTableNode, curveNode))
+      {
+        std::cerr << __LINE__ << ": Failed to calculate MLC position at gantry angle " << gantryAngle << std::endl;
+        return EXIT_FAILURE;
+      }
+      double gantryAngleRadians = vtkMath::RadiansFromDegrees(gantryAngle);
+      double halfWidth = 15. * (fabs(cos(gantryAngleRadians)) + fabs(sin(gantryAngleRadians)));
+      if (!CheckLeafPositions(mlcTableNode, 3, 6, -1. * halfWidth, halfWidth))
+      {
+        std::cerr << __LINE__ << ": Leaf positions from the convex hull are wrong at gantry angle " << gantryAngle << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      vtkTable* table = mlcTableNode->GetTable();
+      for (unsigned int leafPair = 0; leafPair < NUMBER_OF_LEAF_PAIRS; ++leafPair)
+      {
+        // Leaf pairs outside the target are closed at zero in the sequence
+        double expectedPositions[2] = { 0., 0. };
+        if (leafPair >= 3 && leafPair <= 6)
+        {
+          expectedPositions[0] = table->GetValue(leafPair, 1).ToDouble();
+          expectedPositions[1] = table->GetValue(leafPair, 2).ToDouble();
+        }
+        double* positions = leafPositions->GetTuple2(controlPoint * NUMBER_OF_LEAF_PAIRS + leafPair);
+        if (fabs(positions[0] - expectedPositions[0]) > 1e-6 || fabs(positions[1] - expectedPositions[1]) > 1e-6)
+        {
+          std::cerr << __LINE__ << ": Leaf pair " << leafPair << " of control point " << controlPoint
+            << " is at (" << positions[0] << ", " << positions[1] << ") instead of ("
+            << expectedPositions[0] << ", " << expectedPositions[1] << ")" << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+
+    return EXIT_SUCCESS;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerMLCPositionLogicTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  if (TestFindLeafPairPositions() != EXIT_SUCCESS)
+  {
+    std::cerr << "FindLeafPairPositions test failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (TestCalculateMultiLeafCollimatorPositionSequence() != EXIT_SUCCESS)
+  {
+    std::cerr << "CalculateMultiLeafCollimatorPositionSequence test failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "MLC position logic test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -907,7 +907,8 @@ void qMRMLBeamParametersTabWidget::calculateMLCPositionClicked()
 
       vtkMRMLTableNode* mlcTableNode = vtkMRMLTableNode::SafeDownCast(mlcTable);
       if (mlcTableNode && d->MLCPositionLogic->CalculateMultiLeafCollimatorPosition( mlcTableNode, convexHullCurve)
-        && d->MLCPositionLogic->CalculateMultiLeafCollimatorPosition( d->BeamNode, mlcTableNode, targetPoly))
+        && d->MLCPositionLogic->CalculateMultiLeafCollimatorPosition( d->BeamNode, mlcTableNode, targetPoly,
+          d->SliderWidget_MLCTargetMargin->value()))
       {
         d->BeamNode->SetAndObserveMultiLeafCollimatorTableNode(mlcTableNode);
         d->MLCPositionLogic->SetParentForMultiLeafCollimatorTableNode(d->BeamNode);
@@ -0,0 +1,823 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DicomRtImportExport includes
+#include "vtkPlanarContourToBinaryLabelmapConversionRule.h"
+#include "vtkPlanarContourToClosedSurfaceConversionRule.h"
+#include "vtkSegmentConversionCache.h"
+
+// SegmentationCore includes
+#include <vtkCalculateOversamplingFactor.h>
+#include <vtkClosedSurfaceToBinaryLabelmapConversionRule.h>
+#include <vtkOrientedImageData.h>
+#include <vtkOrientedImageDataResample.h>
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+#include <vtkSegment.h>
+#endif
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkVariant.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+/// Contour lines closer than this in slice coordinate are considered to be on the same plane
+const double CONTOUR_PLANE_TOLERANCE = 0.1;
+
+/// Slices between contour planes further apart than this factor times the typical contour plane spacing
+/// are not filled (the structure is considered to have a gap there)
+const double CONTOUR_PLANE_GAP_FACTOR = 1.5;
+
+//----------------------------------------------------------------------------
+/// Fill the polygons of a contour plane into a slice buffer using scanlines and the even-odd rule.
+/// Voxel centers on row J are inside if they are between an odd and the next even crossing of the row
+/// with the polygon edges. Edges are treated as half-open in J so that vertices are counted once.
+template<class T>
+void FillContourPlane(const vtkPlanarContourToBinaryLabelmapConversionRule::ContourPlane& plane,
+  const int extent[6], T value, T* sliceBuffer)
+{
+  int dimensionI = extent[1] - extent[0] + 1;
+  int dimensionJ = extent[3] - extent[2] + 1;
+  std::vector<std::vector<double> > rowCrossings(dimensionJ);
+
+  for (const std::vector<double>& polygon : plane.Polygons)
+  {
+    size_t numberOfPoints = polygon.size() / 2;
+    for (size_t pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      size_t nextPointIndex = (pointIndex + 1) % numberOfPoints;
+      double i0 = polygon[2 * pointIndex];
+      double j0 = polygon[2 * pointIndex + 1];
+      double i1 = polygon[2 * nextPointIndex];
+      double j1 = polygon[2 * nextPointIndex + 1];
+      if (j0 == j1)
+      {
+        // Horizontal edges do not cross any row
+        continue;
+      }
+
+      int firstRow = std::max(static_cast<int>(std::ceil(std::min(j0, j1))), extent[2]);
+      int lastRow = std::min(static_cast<int>(std::ceil(std::max(j0, j1))) - 1, extent[3]);
+      double slope = (i1 - i0) / (j1 - j0);
+      for (int row = firstRow; row <= lastRow; ++row)
+      {
+        rowCrossings[row - extent[2]].push_back(i0 + (row - j0) * slope);
+      }
+    }
+  }
+
+  for (int rowIndex = 0; rowIndex < dimensionJ; ++rowIndex)
+  {
+    std::vector<double>& crossings = rowCrossings[rowIndex];
+    std::sort(crossings.begin(), crossings.end());
+    T* rowBuffer = sliceBuffer + static_cast<size_t>(rowIndex) * dimensionI;
+    for (size_t crossingIndex = 0; crossingIndex + 1 < crossings.size(); crossingIndex += 2)
+    {
+      int firstColumn = std::max(static_cast<int>(std::ceil(crossings[crossingIndex])), extent[0]);
+      int lastColumn = std::min(static_cast<int>(std::ceil(crossings[crossingIndex + 1])) - 1, extent[1]);
+      for (int column = firstColumn; column <= lastColumn; ++column)
+      {
+        rowBuffer[column - extent[0]] = value;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+/// Compute approximate Euclidean distance (in voxels) from each voxel to the nearest voxel
+/// that is inside (or outside) the mask, using a two-pass chamfer distance transform.
+void ComputeChamferDistance(const std::vector<unsigned char>& mask, int dimensionI, int dimensionJ,
+  bool distanceToInside, std::vector<float>& distance)
+{
+  const float diagonal = static_cast<float>(vtkMath::Sqrt(2.0));
+  const float maximumDistance = static_cast<float>(dimensionI + dimensionJ);
+  distance.resize(mask.size());
+  for (size_t index = 0; index < mask.size(); ++index)
+  {
+    distance[index] = ((mask[index] != 0) == distanceToInside) ? 0.0f : maximumDistance;
+  }
+
+  // Forward pass
+  for (int j = 0; j < dimensionJ; ++j)
+  {
+    for (int i = 0; i < dimensionI; ++i)
+    {
+      size_t index = static_cast<size_t>(j) * dimensionI + i;
+      float value = distance[index];
+      if (i > 0)
+      {
+        value = std::min(value, distance[index - 1] + 1.0f);
+      }
+      if (j > 0)
+      {
+        value = std::min(value, distance[index - dimensionI] + 1.0f);
+        if (i > 0)
+        {
+          value = std::min(value, distance[index - dimensionI - 1] + diagonal);
+        }
+        if (i < dimensionI - 1)
+        {
+          value = std::min(value, distance[index - dimensionI + 1] + diagonal);
+        }
+      }
+      distance[index] = value;
+    }
+  }
+
+  // Backward pass
+  for (int j = dimensionJ - 1; j >= 0; --j)
+  {
+    for (int i = dimensionI - 1; i >= 0; --i)
+    {
+      size_t index = static_cast<size_t>(j) * dimensionI + i;
+      float value = distance[index];
+      if (i < dimensionI - 1)
+      {
+        value = std::min(value, distance[index + 1] + 1.0f);
+      }
+      if (j < dimensionJ - 1)
+      {
+        value = std::min(value, distance[index + dimensionI] + 1.0f);
+        if (i < dimensionI - 1)
+        {
+          value = std::min(value, distance[index + dimensionI + 1] + diagonal);
+        }
+        if (i > 0)
+        {
+          value = std::min(value, distance[index + dimensionI - 1] + diagonal);
+        }
+      }
+      distance[index] = value;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+/// Compute signed distance map of a mask (negative inside, positive outside, boundary at zero)
+void ComputeSignedDistanceMap(const std::vector<unsigned char>& mask, int dimensionI, int dimensionJ, std::vector<float>& signedDistance)
+{
+  std::vector<float> distanceToInside;
+  std::vector<float> distanceToOutside;
+  ComputeChamferDistance(mask, dimensionI, dimensionJ, true, distanceToInside);
+  ComputeChamferDistance(mask, dimensionI, dimensionJ, false, distanceToOutside);
+  signedDistance.resize(mask.size());
+  for (size_t index = 0; index < mask.size(); ++index)
+  {
+    signedDistance[index] = (mask[index] != 0) ? 0.5f - distanceToOutside[index] : distanceToInside[index] - 0.5f;
+  }
+}
+
+//----------------------------------------------------------------------------
+/// Rasterizes the labelmap slices. Each slice is filled from its nearest contour plane,
+/// or interpolated between its two neighboring contour planes. Slices only write their
+/// own part of the labelmap, so they can be processed concurrently.
+template<class T>
+class SliceRasterizationFunctor
+{
+public:
+  SliceRasterizationFunctor(const std::vector<vtkPlanarContourToBinaryLabelmapConversionRule::ContourPlane>& planes,
+    const int extent[6], double contourPlaneSpacing, bool subSliceInterpolation, T labelValue, T* labelmapBuffer)
+    : Planes(planes)
+    , ContourPlaneSpacing(contourPlaneSpacing)
+    , SubSliceInterpolation(subSliceInterpolation)
+    , LabelValue(labelValue)
+    , LabelmapBuffer(labelmapBuffer)
+  {
+    std::copy(extent, extent + 6, this->Extent);
+  }
+
+  void operator()(vtkIdType beginSlice, vtkIdType endSlice)
+  {
+    int dimensionI = this->Extent[1] - this->Extent[0] + 1;
+    int dimensionJ = this->Extent[3] - this->Extent[2] + 1;
+    size_t sliceSize = static_cast<size_t>(dimensionI) * dimensionJ;
+    const double epsilon = 1e-6;
+    const double halfThickness = 0.5 * this->ContourPlaneSpacing;
+
+    for (vtkIdType sliceIndex = beginSlice; sliceIndex < endSlice; ++sliceIndex)
+    {
+      double k = this->Extent[4] + sliceIndex;
+      T* sliceBuffer = this->LabelmapBuffer + sliceIndex * sliceSize;
+
+      // Find the contour planes below and above the slice
+      std::vector<vtkPlanarContourToBinaryLabelmapConversionRule::ContourPlane>::const_iterator planeAboveIt =
+        std::lower_bound(this->Planes.begin(), this->Planes.end(), k,
+          [](const vtkPlanarContourToBinaryLabelmapConversionRule::ContourPlane& plane, double sliceK) { return plane.K < sliceK; });
+      const vtkPlanarContourToBinaryLabelmapConversionRule::ContourPlane* planeAbove =
+        (planeAboveIt != this->Planes.end() ? &(*planeAboveIt) : nullptr);
+      const vtkPlanarContourToBinaryLabelmapConversionRule::ContourPlane* planeBelow =
+        (planeAboveIt != this->Planes.begin() ? &(*(planeAboveIt - 1)) : nullptr);
+      if (planeAbove && std::abs(planeAbove->K - k) < epsilon)
+      {
+        // Slice is on a contour plane
+        planeBelow = planeAbove;
+      }
+
+      bool betweenAdjacentPlanes = planeBelow && planeAbove && planeBelow != planeAbove
+        && (planeAbove->K - planeBelow->K) <= CONTOUR_PLANE_GAP_FACTOR * this->ContourPlaneSpacing + epsilon;
+
+      if (this->SubSliceInterpolation && betweenAdjacentPlanes)
+      {
+        // Interpolate the signed distance maps of the two planes
+        std::vector<unsigned char> maskBelow(sliceSize, 0);
+        std::vector<unsigned char> maskAbove(sliceSize, 0);
+        FillContourPlane<unsigned char>(*planeBelow, this->Extent, 1, maskBelow.data());
+        FillContourPlane<unsigned char>(*planeAbove, this->Extent, 1, maskAbove.data());
+        std::vector<float> distanceBelow;
+        std::vector<float> distanceAbove;
+        ComputeSignedDistanceMap(maskBelow, dimensionI, dimensionJ, distanceBelow);
+        ComputeSignedDistanceMap(maskAbove, dimensionI, dimensionJ, distanceAbove);
+        float weightAbove = static_cast<float>((k - planeBelow->K) / (planeAbove->K - planeBelow->K));
+        for (size_t index = 0; index < sliceSize; ++index)
+        {
+          if ((1.0f - weightAbove) * distanceBelow[index] + weightAbove * distanceAbove[index] < 0.0f)
+          {
+            sliceBuffer[index] = this->LabelValue;
+          }
+        }
+        continue;
+      }
+
+      // Use the nearest plane (the lower one in case of a tie)
+      const vtkPlanarContourToBinaryLabelmapConversionRule::ContourPlane* nearestPlane = planeBelow;
+      if (!nearestPlane || (planeAbove && (planeAbove->K - k) < (k - planeBelow->K)))
+      {
+        nearestPlane = planeAbove;
+      }
+      if (!nearestPlane)
+      {
+        continue;
+      }
+      // Each contour plane represents a slab of one contour plane spacing thickness
+      if (betweenAdjacentPlanes || std::abs(nearestPlane->K - k) < halfThickness - epsilon)
+      {
+        FillContourPlane(*nearestPlane, this->Extent, this->LabelValue, sliceBuffer);
+      }
+    }
+  }
+
+private:
+  const std::vector<vtkPlanarContourToBinaryLabelmapConversionRule::ContourPlane>& Planes;
+  int Extent[6];
+  double ContourPlaneSpacing;
+  bool SubSliceInterpolation;
+  T LabelValue;
+  T* LabelmapBuffer;
+};
+
+//----------------------------------------------------------------------------
+/// Clear the labelmap and rasterize its slices in parallel
+template<class T>
+void RasterizeSlices(const std::vector<vtkPlanarContourToBinaryLabelmapConversionRule::ContourPlane>& planes,
+  const int extent[6], double contourPlaneSpacing, bool subSliceInterpolation, int labelValue, vtkImageData* labelmap)
+{
+  T* labelmapBuffer = static_cast<T*>(labelmap->GetScalarPointer());
+  size_t numberOfVoxels = static_cast<size_t>(extent[1] - extent[0] + 1) * (extent[3] - extent[2] + 1) * (extent[5] - extent[4] + 1);
+  std::fill(labelmapBuffer, labelmapBuffer + numberOfVoxels, static_cast<T>(0));
+
+  SliceRasterizationFunctor<T> rasterizationFunctor(planes, extent, contourPlaneSpacing, subSliceInterpolation,
+    static_cast<T>(labelValue), labelmapBuffer);
+  vtkSMPTools::For(0, extent[5] - extent[4] + 1, rasterizationFunctor);
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+vtkSegmentationConverterRuleNewMacro(vtkPlanarContourToBinaryLabelmapConversionRule);
+
+//----------------------------------------------------------------------------
+vtkPlanarContourToBinaryLabelmapConversionRule::vtkPlanarContourToBinaryLabelmapConversionRule()
+{
+  this->ConversionParameters->SetParameter(vtkSegmentationConverter::GetReferenceImageGeometryParameterName(), "",
+    "Image geometry description string determining the geometry of the labelmap that is created in course of conversion.\n"
+    "If the slices of the geometry are not parallel to the contours, then the contours are rasterized in an aligned geometry and resampled.");
+  this->ConversionParameters->SetParameter(vtkClosedSurfaceToBinaryLabelmapConversionRule::GetOversamplingFactorParameterName(), "1",
+    "Determines the oversampling of the reference image geometry. Value of 1 means no oversampling.\n"
+    "Automatic oversampling (A) requires closed surface, so it is treated as 1 by this rule.");
+  this->ConversionParameters->SetParameter(vtkClosedSurfaceToBinaryLabelmapConversionRule::GetCropToReferenceImageGeometryParameterName(), "0",
+    "Crop the labelmap to the extent of reference geometry. 0 (default) = created labelmap will contain the entire structure.\n"
+    "1 = created labelmap extent will be within reference image extent.");
+  this->ConversionParameters->SetParameter(vtkPlanarContourToClosedSurfaceConversionRule::GetDefaultSliceThicknessParameterName(), "0.0",
+    "Default thickness for contours if slice spacing cannot be calculated.");
+  this->ConversionParameters->SetParameter(this->GetSubSliceInterpolationParameterName(), "0",
+    "Interpolate labelmap slices that lie between two contour planes.\n"
+    "0 (default) = slices are filled from the nearest contour plane.\n"
+    "1 = slices are interpolated from the signed distance maps of the two neighboring contour planes.");
+}
+
+//----------------------------------------------------------------------------
+vtkPlanarContourToBinaryLabelmapConversionRule::~vtkPlanarContourToBinaryLabelmapConversionRule() = default;
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlanarContourToBinaryLabelmapConversionRule::GetConversionCost(
+  vtkDataObject* vtkNotUsed(sourceRepresentation)/*=nullptr*/,
+  vtkDataObject* vtkNotUsed(targetRepresentation)/*=nullptr*/)
+{
+  // Rough input-independent guess (ms)
+  // Cheaper than the planar contour to closed surface to binary labelmap path
+  return 300;
+}
+
+//----------------------------------------------------------------------------
+vtkDataObject* vtkPlanarContourToBinaryLabelmapConversionRule::ConstructRepresentationObjectByRepresentation(std::string representationName)
+{
+  if (!representationName.compare(this->GetSourceRepresentationName()))
+  {
+    return (vtkDataObject*)vtkPolyData::New();
+  }
+  else if (!representationName.compare(this->GetTargetRepresentationName()))
+  {
+    return (vtkDataObject*)vtkOrientedImageData::New();
+  }
+  else
+  {
+    return nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkDataObject* vtkPlanarContourToBinaryLabelmapConversionRule::ConstructRepresentationObjectByClass(std::string className)
+{
+  if (!className.compare("vtkPolyData"))
+  {
+    return (vtkDataObject*)vtkPolyData::New();
+  }
+  else if (!className.compare("vtkOrientedImageData"))
+  {
+    return (vtkDataObject*)vtkOrientedImageData::New();
+  }
+  else
+  {
+    return nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+bool vtkPlanarContourToBinaryLabelmapConversionRule::Convert(vtkSegment* segment)
+{
+  this->CreateTargetRepresentation(segment);
+
+  // Use the persistent cache if the segment was loaded from an RT structure set
+  std::string conversionDescription = std::string(this->GetName()) + "|Label value=" + vtkVariant(segment->GetLabelValue()).ToString();
+  std::vector<std::string> parameterNames =
+    {
+    vtkSegmentationConverter::GetReferenceImageGeometryParameterName(),
+    vtkClosedSurfaceToBinaryLabelmapConversionRule::GetOversamplingFactorParameterName(),
+    vtkClosedSurfaceToBinaryLabelmapConversionRule::GetCropToReferenceImageGeometryParameterName(),
+    vtkPlanarContourToClosedSurfaceConversionRule::GetDefaultSliceThicknessParameterName(),
+    this->GetSubSliceInterpolationParameterName()
+    };
+  for (const std::string& parameterName : parameterNames)
+  {
+    conversionDescription += "|" + parameterName + "=" + this->GetConversionParameter(parameterName);
+  }
+  std::string cacheKey = vtkSegmentConversionCache::GetCacheKey(segment, this->GetSourceRepresentationName(), conversionDescription);
+  vtkOrientedImageData* binaryLabelmap = vtkOrientedImageData::SafeDownCast(segment->GetRepresentation(this->GetTargetRepresentationName()));
+  if (!cacheKey.empty() && vtkSegmentConversionCache::ReadOrientedImageData(cacheKey, binaryLabelmap))
+  {
+    return true;
+  }
+
+  if (!this->ConvertUncached(segment))
+  {
+    return false;
+  }
+  if (!cacheKey.empty())
+  {
+    vtkSegmentConversionCache::WriteOrientedImageData(cacheKey, binaryLabelmap);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlanarContourToBinaryLabelmapConversionRule::ConvertUncached(vtkSegment* segment)
+{
+#else
+bool vtkPlanarContourToBinaryLabelmapConversionRule::Convert(vtkDataObject* sourceRepresentation, vtkDataObject* targetRepresentation)
+{
+#endif
+  // Check validity of source and target representation objects
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  vtkPolyData* planarContoursPolyData = vtkPolyData::SafeDownCast(segment->GetRepresentation(this->GetSourceRepresentationName()));
+#else
+  vtkPolyData* planarContoursPolyData = vtkPolyData::SafeDownCast(sourceRepresentation);
+#endif
+  if (!planarContoursPolyData)
+  {
+    vtkErrorMacro("Convert: Source representation is not a poly data!");
+    return false;
+  }
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  vtkOrientedImageData* binaryLabelmap = vtkOrientedImageData::SafeDownCast(segment->GetRepresentation(this->GetTargetRepresentationName()));
+  int labelValue = segment->GetLabelValue();
+#else
+  vtkOrientedImageData* binaryLabelmap = vtkOrientedImageData::SafeDownCast(targetRepresentation);
+  int labelValue = 1;
+#endif
+  if (!binaryLabelmap)
+  {
+    vtkErrorMacro("Convert: Target representation is not an oriented image data!");
+    return false;
+  }
+  if (labelValue <= 0)
+  {
+    vtkErrorMacro("Convert: Invalid label value " << labelValue);
+    return false;
+  }
+
+  if (planarContoursPolyData->GetNumberOfPoints() == 0 || planarContoursPolyData->GetNumberOfLines() == 0)
+  {
+    // Empty contours result in empty labelmap
+    binaryLabelmap->SetExtent(0, -1, 0, -1, 0, -1);
+    binaryLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    return true;
+  }
+
+  // Get reference geometry and apply oversampling
+  vtkNew<vtkOrientedImageData> referenceGeometry;
+  std::string geometryString = this->GetConversionParameter(vtkSegmentationConverter::GetReferenceImageGeometryParameterName());
+  bool referenceGeometryValid = !geometryString.empty()
+    && vtkSegmentationConverter::DeserializeImageGeometry(geometryString, referenceGeometry, false);
+  if (referenceGeometryValid)
+  {
+    bool oversamplingFactorValid = false;
+    double oversamplingFactor = vtkVariant(this->GetConversionParameter(
+      vtkClosedSurfaceToBinaryLabelmapConversionRule::GetOversamplingFactorParameterName())).ToDouble(&oversamplingFactorValid);
+    if (oversamplingFactorValid && oversamplingFactor > 0.0 && oversamplingFactor != 1.0)
+    {
+      vtkCalculateOversamplingFactor::ApplyOversamplingOnImageGeometry(referenceGeometry, oversamplingFactor);
+    }
+  }
+  bool cropToReferenceGeometry = referenceGeometryValid
+    && vtkVariant(this->GetConversionParameter(vtkClosedSurfaceToBinaryLabelmapConversionRule::GetCropToReferenceImageGeometryParameterName())).ToInt() != 0;
+
+  // Rasterize directly into the reference geometry if its slices are parallel to the contours
+  double contourNormal[3] = { 0.0, 0.0, 1.0 };
+  this->CalculateContourNormal(planarContoursPolyData, contourNormal);
+  bool slicesParallelToContours = false;
+  vtkNew<vtkMatrix4x4> referenceImageToWorldMatrix;
+  if (referenceGeometryValid)
+  {
+    referenceGeometry->GetImageToWorldMatrix(referenceImageToWorldMatrix);
+    double sliceNormal[3] = { 0.0, 0.0, 0.0 };
+    for (int i = 0; i < 3; ++i)
+    {
+      sliceNormal[i] = referenceImageToWorldMatrix->GetElement(i, 2);
+    }
+    vtkMath::Normalize(sliceNormal);
+    slicesParallelToContours = (std::abs(vtkMath::Dot(sliceNormal, contourNormal)) > 1.0 - 1e-6);
+  }
+  if (slicesParallelToContours)
+  {
+    binaryLabelmap->SetGeometryFromImageToWorldMatrix(referenceImageToWorldMatrix);
+    return this->RasterizeContours(planarContoursPolyData, binaryLabelmap, labelValue,
+      cropToReferenceGeometry ? referenceGeometry->GetExtent() : nullptr);
+  }
+
+  // Rasterize into a geometry aligned with the contours
+  vtkSmartPointer<vtkOrientedImageData> alignedLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  if (referenceGeometryValid)
+  {
+    double* referenceSpacing = referenceGeometry->GetSpacing();
+    double minimumSpacing = std::min(std::min(referenceSpacing[0], referenceSpacing[1]), referenceSpacing[2]);
+    this->CalculateContourAlignedGeometry(planarContoursPolyData, contourNormal, minimumSpacing, minimumSpacing, alignedLabelmap);
+  }
+  else
+  {
+    // Common when converting without a reference volume, so it is not reported as a warning on every conversion
+    vtkDebugMacro("Convert: No reference image geometry is specified, labelmap is created with 1mm in-plane spacing aligned with the contours");
+    this->CalculateContourAlignedGeometry(planarContoursPolyData, contourNormal, 1.0, 0.0, alignedLabelmap);
+  }
+  if (!this->RasterizeContours(planarContoursPolyData, alignedLabelmap, labelValue))
+  {
+    return false;
+  }
+  if (!referenceGeometryValid)
+  {
+    binaryLabelmap->DeepCopy(alignedLabelmap);
+    return true;
+  }
+
+  // Resample into the reference geometry, restricted to the region of the aligned labelmap
+  int alignedExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  alignedLabelmap->GetExtent(alignedExtent);
+  vtkNew<vtkMatrix4x4> alignedImageToWorldMatrix;
+  alignedLabelmap->GetImageToWorldMatrix(alignedImageToWorldMatrix);
+  vtkNew<vtkMatrix4x4> worldToReferenceImageMatrix;
+  referenceGeometry->GetWorldToImageMatrix(worldToReferenceImageMatrix);
+  vtkNew<vtkMatrix4x4> alignedToReferenceImageMatrix;
+  vtkMatrix4x4::Multiply4x4(worldToReferenceImageMatrix, alignedImageToWorldMatrix, alignedToReferenceImageMatrix);
+  int referenceExtent[6] = { VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN };
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    double cornerPoint[4] = {
+      static_cast<double>(alignedExtent[(corner & 1) ? 1 : 0]),
+      static_cast<double>(alignedExtent[(corner & 2) ? 3 : 2]),
+      static_cast<double>(alignedExtent[(corner & 4) ? 5 : 4]),
+      1.0 };
+    alignedToReferenceImageMatrix->MultiplyPoint(cornerPoint, cornerPoint);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      referenceExtent[2 * axis] = std::min(referenceExtent[2 * axis], static_cast<int>(std::floor(cornerPoint[axis])));
+      referenceExtent[2 * axis + 1] = std::max(referenceExtent[2 * axis + 1], static_cast<int>(std::ceil(cornerPoint[axis])));
+    }
+  }
+  if (cropToReferenceGeometry)
+  {
+    int* cropExtent = referenceGeometry->GetExtent();
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      referenceExtent[2 * axis] = std::max(referenceExtent[2 * axis], cropExtent[2 * axis]);
+      referenceExtent[2 * axis + 1] = std::min(referenceExtent[2 * axis + 1], cropExtent[2 * axis + 1]);
+    }
+  }
+  referenceGeometry->SetExtent(referenceExtent);
+  if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(alignedLabelmap, referenceGeometry, binaryLabelmap))
+  {
+    vtkErrorMacro("Convert: Failed to resample labelmap to reference image geometry");
+    return false;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlanarContourToBinaryLabelmapConversionRule::RasterizeContours(vtkPolyData* planarContoursPolyData,
+  vtkOrientedImageData* binaryLabelmap, int labelValue, const int* cropExtent/*=nullptr*/)
+{
+  if (!planarContoursPolyData || !binaryLabelmap)
+  {
+    vtkErrorMacro("RasterizeContours: Invalid input!");
+    return false;
+  }
+
+  vtkNew<vtkMatrix4x4> worldToImageMatrix;
+  binaryLabelmap->GetWorldToImageMatrix(worldToImageMatrix);
+  std::vector<ContourPlane> planes;
+  double contourPlaneSpacing = this->GetContourPlanes(planarContoursPolyData, worldToImageMatrix, planes);
+  if (contourPlaneSpacing <= 0.0)
+  {
+    // Single contour plane, use default slice thickness
+    double defaultSliceThickness = vtkVariant(this->GetConversionParameter(
+      vtkPlanarContourToClosedSurfaceConversionRule::GetDefaultSliceThicknessParameterName())).ToDouble();
+    double sliceSpacing = binaryLabelmap->GetSpacing()[2];
+    contourPlaneSpacing = (defaultSliceThickness > 0.0 && sliceSpacing > 0.0) ? defaultSliceThickness / sliceSpacing : 1.0;
+  }
+
+  // Extent covered by the contours
+  int extent[6] = { 0, -1, 0, -1, 0, -1 };
+  if (!planes.empty())
+  {
+    double bounds[4] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+    for (const ContourPlane& plane : planes)
+    {
+      for (const std::vector<double>& polygon : plane.Polygons)
+      {
+        for (size_t coordinateIndex = 0; coordinateIndex + 1 < polygon.size(); coordinateIndex += 2)
+        {
+          bounds[0] = std::min(bounds[0], polygon[coordinateIndex]);
+          bounds[1] = std::max(bounds[1], polygon[coordinateIndex]);
+          bounds[2] = std::min(bounds[2], polygon[coordinateIndex + 1]);
+          bounds[3] = std::max(bounds[3], polygon[coordinateIndex + 1]);
+        }
+      }
+    }
+    extent[0] = static_cast<int>(std::floor(bounds[0]));
+    extent[1] = static_cast<int>(std::ceil(bounds[1]));
+    extent[2] = static_cast<int>(std::floor(bounds[2]));
+    extent[3] = static_cast<int>(std::ceil(bounds[3]));
+    extent[4] = static_cast<int>(std::ceil(planes.front().K - 0.5 * contourPlaneSpacing));
+    extent[5] = static_cast<int>(std::floor(planes.back().K + 0.5 * contourPlaneSpacing));
+  }
+  if (cropExtent)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      extent[2 * axis] = std::max(extent[2 * axis], cropExtent[2 * axis]);
+      extent[2 * axis + 1] = std::min(extent[2 * axis + 1], cropExtent[2 * axis + 1]);
+    }
+  }
+  if (extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5])
+  {
+    binaryLabelmap->SetExtent(0, -1, 0, -1, 0, -1);
+    binaryLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    return true;
+  }
+
+  // Use the smallest scalar type that can hold the label value
+  bool subSliceInterpolation = vtkVariant(this->GetConversionParameter(this->GetSubSliceInterpolationParameterName())).ToInt() != 0;
+  binaryLabelmap->SetExtent(extent);
+  if (labelValue <= VTK_UNSIGNED_CHAR_MAX)
+  {
+    binaryLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    RasterizeSlices<unsigned char>(planes, extent, contourPlaneSpacing, subSliceInterpolation, labelValue, binaryLabelmap);
+  }
+  else if (labelValue <= VTK_UNSIGNED_SHORT_MAX)
+  {
+    binaryLabelmap->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+    RasterizeSlices<unsigned short>(planes, extent, contourPlaneSpacing, subSliceInterpolation, labelValue, binaryLabelmap);
+  }
+  else
+  {
+    binaryLabelmap->AllocateScalars(VTK_UNSIGNED_INT, 1);
+    RasterizeSlices<unsigned int>(planes, extent, contourPlaneSpacing, subSliceInterpolation, labelValue, binaryLabelmap);
+  }
+
+  binaryLabelmap->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlanarContourToBinaryLabelmapConversionRule::CalculateContourNormal(vtkPolyData* planarContoursPolyData, double normal[3])
+{
+  normal[0] = 0.0;
+  normal[1] = 0.0;
+  normal[2] = 0.0;
+  if (!planarContoursPolyData)
+  {
+    vtkErrorMacro("CalculateContourNormal: Invalid vtkPolyData!");
+    normal[2] = 1.0;
+    return;
+  }
+
+  vtkCellArray* lines = planarContoursPolyData->GetLines();
+  vtkNew<vtkIdList> linePointIds;
+  lines->InitTraversal();
+  while (lines->GetNextCell(linePointIds))
+  {
+    vtkIdType numberOfPoints = linePointIds->GetNumberOfIds();
+    if (numberOfPoints < 3)
+    {
+      continue;
+    }
+
+    // Newell's method
+    double lineNormal[3] = { 0.0, 0.0, 0.0 };
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      double currentPoint[3] = { 0.0, 0.0, 0.0 };
+      double nextPoint[3] = { 0.0, 0.0, 0.0 };
+      planarContoursPolyData->GetPoint(linePointIds->GetId(pointIndex), currentPoint);
+      planarContoursPolyData->GetPoint(linePointIds->GetId((pointIndex + 1) % numberOfPoints), nextPoint);
+      lineNormal[0] += (currentPoint[1] - nextPoint[1]) * (currentPoint[2] + nextPoint[2]);
+      lineNormal[1] += (currentPoint[2] - nextPoint[2]) * (currentPoint[0] + nextPoint[0]);
+      lineNormal[2] += (currentPoint[0] - nextPoint[0]) * (currentPoint[1] + nextPoint[1]);
+    }
+
+    // Contours may have different orientations, so only the direction of the normal matters
+    if (vtkMath::Dot(lineNormal, normal) < 0.0)
+    {
+      vtkMath::MultiplyScalar(lineNormal, -1.0);
+    }
+    vtkMath::Add(normal, lineNormal, normal);
+  }
+
+  if (vtkMath::Normalize(normal) == 0.0)
+  {
+    normal[0] = 0.0;
+    normal[1] = 0.0;
+    normal[2] = 1.0;
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkPlanarContourToBinaryLabelmapConversionRule::GetContourPlanes(vtkPolyData* planarContoursPolyData,
+  vtkMatrix4x4* worldToIjkMatrix, std::vector<ContourPlane>& planes)
+{
+  planes.clear();
+  if (!planarContoursPolyData || !worldToIjkMatrix)
+  {
+    vtkErrorMacro("GetContourPlanes: Invalid input!");
+    return 0.0;
+  }
+
+  // Transform lines into IJK coordinate system
+  std::vector<ContourPlane> linePlanes;
+  vtkCellArray* lines = planarContoursPolyData->GetLines();
+  vtkNew<vtkIdList> linePointIds;
+  lines->InitTraversal();
+  while (lines->GetNextCell(linePointIds))
+  {
+    vtkIdType numberOfPoints = linePointIds->GetNumberOfIds();
+    if (numberOfPoints < 2)
+    {
+      continue;
+    }
+    ContourPlane linePlane;
+    linePlane.K = 0.0;
+    linePlane.Polygons.resize(1);
+    std::vector<double>& polygon = linePlane.Polygons[0];
+    polygon.reserve(2 * numberOfPoints);
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      double point[4] = { 0.0, 0.0, 0.0, 1.0 };
+      planarContoursPolyData->GetPoint(linePointIds->GetId(pointIndex), point);
+      worldToIjkMatrix->MultiplyPoint(point, point);
+      polygon.push_back(point[0]);
+      polygon.push_back(point[1]);
+      linePlane.K += point[2];
+    }
+    linePlane.K /= numberOfPoints;
+    linePlanes.push_back(linePlane);
+  }
+  std::sort(linePlanes.begin(), linePlanes.end(),
+    [](const ContourPlane& plane1, const ContourPlane& plane2) { return plane1.K < plane2.K; });
+
+  // Merge lines on the same plane
+  for (ContourPlane& linePlane : linePlanes)
+  {
+    if (!planes.empty() && linePlane.K - planes.back().K < CONTOUR_PLANE_TOLERANCE)
+    {
+      planes.back().Polygons.push_back(std::move(linePlane.Polygons[0]));
+    }
+    else
+    {
+      planes.push_back(std::move(linePlane));
+    }
+  }
+
+  // Use the median of the distances between adjacent planes, so that gaps in the structure do not affect it
+  if (planes.size() < 2)
+  {
+    return 0.0;
+  }
+  std::vector<double> planeDistances;
+  for (size_t planeIndex = 1; planeIndex < planes.size(); ++planeIndex)
+  {
+    planeDistances.push_back(planes[planeIndex].K - planes[planeIndex - 1].K);
+  }
+  std::nth_element(planeDistances.begin(), planeDistances.begin() + planeDistances.size() / 2, planeDistances.end());
+  return planeDistances[planeDistances.size() / 2];
+}
+
+//----------------------------------------------------------------------------
+void vtkPlanarContourToBinaryLabelmapConversionRule::CalculateContourAlignedGeometry(vtkPolyData* planarContoursPolyData,
+  double normal[3], double inPlaneSpacing, double sliceSpacing, vtkOrientedImageData* geometryImage)
+{
+  if (!planarContoursPolyData || !geometryImage)
+  {
+    vtkErrorMacro("CalculateContourAlignedGeometry: Invalid input!");
+    return;
+  }
+
+  // In-plane axes perpendicular to the normal
+  double firstAxis[3] = { 0.0, 0.0, 0.0 };
+  double secondAxis[3] = { 0.0, 0.0, 0.0 };
+  vtkMath::Perpendiculars(normal, firstAxis, secondAxis, 0.0);
+
+  // Find the contour planes with unit spacing to get the plane positions and spacing in mm
+  vtkNew<vtkMatrix4x4> imageToWorldMatrix;
+  for (int row = 0; row < 3; ++row)
+  {
+    imageToWorldMatrix->SetElement(row, 0, firstAxis[row]);
+    imageToWorldMatrix->SetElement(row, 1, secondAxis[row]);
+    imageToWorldMatrix->SetElement(row, 2, normal[row]);
+  }
+  vtkNew<vtkMatrix4x4> worldToImageMatrix;
+  vtkMatrix4x4::Invert(imageToWorldMatrix, worldToImageMatrix);
+  std::vector<ContourPlane> planes;
+  double contourPlaneSpacing = this->GetContourPlanes(planarContoursPolyData, worldToImageMatrix, planes);
+  if (sliceSpacing <= 0.0)
+  {
+    double defaultSliceThickness = vtkVariant(this->GetConversionParameter(
+      vtkPlanarContourToClosedSurfaceConversionRule::GetDefaultSliceThicknessParameterName())).ToDouble();
+    sliceSpacing = (contourPlaneSpacing > 0.0 ? contourPlaneSpacing : (defaultSliceThickness > 0.0 ? defaultSliceThickness : inPlaneSpacing));
+  }
+
+  // Place the first contour plane on a slice
+  double firstPlanePosition = (planes.empty() ? 0.0 : planes.front().K);
+  for (int row = 0; row < 3; ++row)
+  {
+    imageToWorldMatrix->SetElement(row, 0, firstAxis[row] * inPlaneSpacing);
+    imageToWorldMatrix->SetElement(row, 1, secondAxis[row] * inPlaneSpacing);
+    imageToWorldMatrix->SetElement(row, 2, normal[row] * sliceSpacing);
+    imageToWorldMatrix->SetElement(row, 3, normal[row] * firstPlanePosition);
+  }
+  geometryImage->SetGeometryFromImageToWorldMatrix(imageToWorldMatrix);
+}
@@ -0,0 +1,137 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkPlanarContourToBinaryLabelmapConversionRule_h
+#define __vtkPlanarContourToBinaryLabelmapConversionRule_h
+
+// Slicer include
+#include <vtkSlicerVersionConfigureMinimal.h>
+
+// SegmentationCore includes
+#include "vtkSegmentationConverterRule.h"
+#include "vtkSegmentationConverter.h"
+
+#include "vtkSlicerDicomRtImportExportConversionRulesExport.h"
+
+// STD includes
+#include <vector>
+
+class vtkMatrix4x4;
+class vtkOrientedImageData;
+class vtkPolyData;
+
+/// \ingroup DicomRtImportImportExportConversionRules
+/// \brief Convert planar contour representation (vtkPolyData type) directly to binary
+///   labelmap representation (vtkOrientedImageData type), without creating a closed surface first.
+///   Each labelmap slice is scanline filled from the contours of the nearest contour plane using
+///   the even-odd rule, so holes and keyholes need no special handling. Slices between two contour
+///   planes can optionally be interpolated from the signed distance maps of the two planes.
+///   Slices are rasterized in parallel.
+class VTK_SLICER_DICOMRTIMPORTEXPORT_CONVERSIONRULES_EXPORT vtkPlanarContourToBinaryLabelmapConversionRule
+  : public vtkSegmentationConverterRule
+{
+public:
+  static vtkPlanarContourToBinaryLabelmapConversionRule* New();
+  vtkTypeMacro(vtkPlanarContourToBinaryLabelmapConversionRule, vtkSegmentationConverterRule);
+  vtkSegmentationConverterRule* CreateRuleInstance() override;
+
+  static const std::string GetSubSliceInterpolationParameterName() { return "Sub-slice interpolation"; };
+
+  /// Contours of one contour plane in the IJK coordinate system of the rasterized image
+  struct ContourPlane
+  {
+    /// Slice coordinate of the plane
+    double K;
+    /// Polygons of the plane as (I,J) coordinate pairs. Polygons are implicitly closed.
+    std::vector<std::vector<double> > Polygons;
+  };
+
+  /// Constructs representation object from representation name for the supported representation classes
+  /// (typically source and target representation VTK classes, subclasses of vtkDataObject)
+  /// Note: Need to take ownership of the created object! For example using vtkSmartPointer<vtkDataObject>::Take
+  vtkDataObject* ConstructRepresentationObjectByRepresentation(std::string representationName) override;
+
+  /// Constructs representation object from class name for the supported representation classes
+  /// (typically source and target representation VTK classes, subclasses of vtkDataObject)
+  /// Note: Need to take ownership of the created object! For example using vtkSmartPointer<vtkDataObject>::Take
+  vtkDataObject* ConstructRepresentationObjectByClass(std::string className) override;
+
+  /// Update the target representation based on the source representation
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  bool Convert(vtkSegment* segment) override;
+#else
+  bool Convert(vtkDataObject* sourceRepresentation, vtkDataObject* targetRepresentation) override;
+#endif
+
+  /// Get the cost of the conversion.
+  unsigned int GetConversionCost(vtkDataObject* sourceRepresentation = nullptr, vtkDataObject* targetRepresentation = nullptr) override;
+
+  /// Human-readable name of the converter rule
+  const char* GetName() override { return "Planar contour to binary labelmap"; };
+
+  /// Human-readable name of the source representation
+  const char* GetSourceRepresentationName() override { return vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(); };
+
+  /// Human-readable name of the target representation
+  const char* GetTargetRepresentationName() override { return vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(); };
+
+protected:
+  vtkPlanarContourToBinaryLabelmapConversionRule();
+  ~vtkPlanarContourToBinaryLabelmapConversionRule() override;
+
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  /// Perform the conversion without consulting the persistent conversion cache
+  bool ConvertUncached(vtkSegment* segment);
+#endif
+
+  /// Rasterize planar contours into a binary labelmap.
+  /// The geometry of the labelmap (origin, spacing, directions) must be set, and its slices must be
+  /// parallel to the contour planes. The extent is set to the region covered by the contours.
+  /// \param planarContoursPolyData Polydata containing the planar contours
+  /// \param binaryLabelmap Output labelmap
+  /// \param labelValue Value of the voxels inside the contours. The scalar type of the labelmap is the
+  ///   smallest unsigned integer type that can hold this value.
+  /// \param cropExtent If specified, the labelmap extent is cropped to this extent
+  bool RasterizeContours(vtkPolyData* planarContoursPolyData, vtkOrientedImageData* binaryLabelmap, int labelValue, const int* cropExtent = nullptr);
+
+  /// Calculate the normal of the contour planes using Newell's method
+  /// \param planarContoursPolyData Polydata containing the planar contours
+  /// \param normal Output unit normal vector
+  void CalculateContourNormal(vtkPolyData* planarContoursPolyData, double normal[3]);
+
+  /// Group the contour lines into planes in the IJK coordinate system defined by the given transform.
+  /// \param planarContoursPolyData Polydata containing the planar contours
+  /// \param worldToIjkMatrix Transform from world (contour) coordinates to IJK coordinates
+  /// \param planes Output planes, sorted by slice coordinate
+  /// \return Spacing between adjacent contour planes in slice coordinates, 0 if there is only one plane
+  double GetContourPlanes(vtkPolyData* planarContoursPolyData, vtkMatrix4x4* worldToIjkMatrix, std::vector<ContourPlane>& planes);
+
+  /// Set up a geometry with slices parallel to the contour planes.
+  /// Used if no reference geometry is specified, or if its slices are not parallel to the contours.
+  /// \param planarContoursPolyData Polydata containing the planar contours
+  /// \param normal Normal of the contour planes
+  /// \param inPlaneSpacing Spacing within the contour planes
+  /// \param sliceSpacing Spacing between slices. If zero then the spacing between the contour planes is used.
+  /// \param geometryImage Output geometry
+  void CalculateContourAlignedGeometry(vtkPolyData* planarContoursPolyData, double normal[3],
+    double inPlaneSpacing, double sliceSpacing, vtkOrientedImageData* geometryImage);
+
+private:
+  vtkPlanarContourToBinaryLabelmapConversionRule(const vtkPlanarContourToBinaryLabelmapConversionRule&) = delete;
+  void operator=(const vtkPlanarContourToBinaryLabelmapConversionRule&) = delete;
+};
+
+#endif // __vtkPlanarContourToBinaryLabelmapConversionRule_h
@@ -19,24 +19,24 @@
 ==============================================================================*/
 
 #include "vtkPlanarContourToClosedSurfaceConversionRule.h"
+#include "vtkSegmentConversionCache.h"
 
 // VTK includes
-#include <vtkCleanPolyData.h>
 #include <vtkExtractCells.h>
-#include <vtkImageAccumulate.h>
 #include <vtkImageData.h>
-#include <vtkImageDilateErode3D.h>
-#include <vtkImageStencil.h>
 #include <vtkLine.h>
 #include <vtkMarchingSquares.h>
 #include <vtkPlane.h>
-#include <vtkPolyDataToImageStencil.h>
+#include <vtkPointData.h>
+#include <vtkPointLocator.h>
 #include <vtkPolygon.h>
 #include <vtkPriorityQueue.h>
+#include <vtkSMPTools.h>
 #include <vtkStripper.h>
 #include <vtkTextureMapToPlane.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
+#include <vtkUnsignedCharArray.h>
 #include <vtkUnstructuredGrid.h>
 
 // vtkAddon includes
@@ -44,6 +44,9 @@
 
 // STD includes
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 
 // SegmentationCore includes
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
@@ -64,6 +67,232 @@ enum CappingDirection
 };
 static const CappingDirection CappingDirections[] = { CAPPING_BELOW, CAPPING_ABOVE };
 
+//----------------------------------------------------------------------------
+/// Flat 2D grid index over the points of a set of contour lines lying on the same plane.
+/// Coordinates of all lines are stored contiguously and bucketed into a uniform XY grid,
+/// so one index serves all closest point queries against the lines of a plane without
+/// allocating a locator for each line. The index is not modified by queries, so it can
+/// be queried from multiple threads.
+class vtkPlanarContourToClosedSurfaceConversionRule::ContourPointIndex
+{
+public:
+  /// Add the points of a line to the index. Build() must be called after all lines are added.
+  /// \param inputROIPoints Polydata containing all of the points
+  /// \param lineId Identifier of the line, returned by queries and used for filtering them
+  /// \param linePointIds Point IDs of the line. Positions within this list are returned by queries
+  void AddLine(vtkPolyData* inputROIPoints, vtkIdType lineId, vtkIdList* linePointIds)
+  {
+    vtkIdType numberOfPoints = linePointIds->GetNumberOfIds();
+    for (vtkIdType position = 0; position < numberOfPoints; ++position)
+    {
+      IndexedPoint indexedPoint;
+      inputROIPoints->GetPoint(linePointIds->GetId(position), indexedPoint.Point);
+      indexedPoint.LineId = lineId;
+      indexedPoint.Position = position;
+      this->Points.push_back(indexedPoint);
+    }
+  }
+
+  /// Sort the added points into the grid cells
+  void Build()
+  {
+    this->Dimensions[0] = 0;
+    this->Dimensions[1] = 0;
+    this->CellOffsets.clear();
+    vtkIdType numberOfPoints = static_cast<vtkIdType>(this->Points.size());
+    if (numberOfPoints == 0)
+    {
+      return;
+    }
+
+    double bounds[4] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+    for (const IndexedPoint& indexedPoint : this->Points)
+    {
+      bounds[0] = std::min(bounds[0], indexedPoint.Point[0]);
+      bounds[1] = std::max(bounds[1], indexedPoint.Point[0]);
+      bounds[2] = std::min(bounds[2], indexedPoint.Point[1]);
+      bounds[3] = std::max(bounds[3], indexedPoint.Point[1]);
+    }
+    this->Origin[0] = bounds[0];
+    this->Origin[1] = bounds[2];
+
+    // Aim for a few points per cell. Contours are often thin or axis aligned, so fall back
+    // to the longer side of the bounding box if the area is zero.
+    const double pointsPerCell = 4.0;
+    double width = bounds[1] - bounds[0];
+    double height = bounds[3] - bounds[2];
+    this->CellSize = std::sqrt(width * height * pointsPerCell / numberOfPoints);
+    if (this->CellSize <= 0.0)
+    {
+      this->CellSize = std::max(width, height) * pointsPerCell / numberOfPoints;
+    }
+    if (this->CellSize <= 0.0)
+    {
+      this->CellSize = 1.0;
+    }
+    this->Dimensions[0] = std::min(static_cast<vtkIdType>(width / this->CellSize) + 1, numberOfPoints);
+    this->Dimensions[1] = std::min(static_cast<vtkIdType>(height / this->CellSize) + 1, numberOfPoints);
+
+    // Counting sort of the points by grid cell
+    std::vector<vtkIdType> pointCells(numberOfPoints);
+    this->CellOffsets.assign(this->Dimensions[0] * this->Dimensions[1] + 1, 0);
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      vtkIdType cellIndex[2] = { 0, 0 };
+      this->GetCellIndex(this->Points[pointIndex].Point, cellIndex);
+      pointCells[pointIndex] = cellIndex[1] * this->Dimensions[0] + cellIndex[0];
+      ++this->CellOffsets[pointCells[pointIndex] + 1];
+    }
+    for (size_t cell = 1; cell < this->CellOffsets.size(); ++cell)
+    {
+      this->CellOffsets[cell] += this->CellOffsets[cell - 1];
+    }
+    std::vector<IndexedPoint> sortedPoints(numberOfPoints);
+    std::vector<vtkIdType> cellInsertPositions(this->CellOffsets.begin(), this->CellOffsets.end() - 1);
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      sortedPoints[cellInsertPositions[pointCells[pointIndex]]++] = this->Points[pointIndex];
+    }
+    this->Points.swap(sortedPoints);
+  }
+
+  /// Find the indexed point closest to the given point.
+  /// Ties are resolved in favor of the lowest line ID, then the lowest position in the line,
+  /// to give the same result as an exhaustive search over the lines in ascending order.
+  /// \param originalPoint The point that is being compared
+  /// \param lineIds If specified, only points on these lines are considered
+  /// \param closestLineId ID of the line containing the closest point
+  /// \param closestPosition Position of the closest point in the point ID list of its line
+  /// \return False if there are no indexed points on the requested lines
+  bool FindClosestPoint(const double originalPoint[3], const std::vector<vtkIdType>* lineIds,
+    vtkIdType& closestLineId, vtkIdType& closestPosition) const
+  {
+    if (this->CellOffsets.empty())
+    {
+      return false;
+    }
+
+    vtkIdType centerCellIndex[2] = { 0, 0 };
+    this->GetCellIndex(originalPoint, centerCellIndex);
+    vtkIdType maximumRing = std::max(
+      std::max(centerCellIndex[0], this->Dimensions[0] - 1 - centerCellIndex[0]),
+      std::max(centerCellIndex[1], this->Dimensions[1] - 1 - centerCellIndex[1]));
+
+    bool found = false;
+    double minimumDistanceSquared = VTK_DOUBLE_MAX;
+    for (vtkIdType ring = 0; ring <= maximumRing; ++ring)
+    {
+      // Points in this ring and beyond are at least (ring-1) cells away in the XY plane
+      if (found && ring > 0)
+      {
+        double ringDistance = (ring - 1) * this->CellSize;
+        if (minimumDistanceSquared < ringDistance * ringDistance)
+        {
+          break;
+        }
+      }
+
+      vtkIdType minimumRow = std::max<vtkIdType>(centerCellIndex[1] - ring, 0);
+      vtkIdType maximumRow = std::min<vtkIdType>(centerCellIndex[1] + ring, this->Dimensions[1] - 1);
+      for (vtkIdType row = minimumRow; row <= maximumRow; ++row)
+      {
+        bool fullRow = (std::abs(row - centerCellIndex[1]) == ring);
+        vtkIdType columnStep = (fullRow || ring == 0) ? 1 : 2 * ring;
+        for (vtkIdType column = centerCellIndex[0] - ring; column <= centerCellIndex[0] + ring; column += columnStep)
+        {
+          if (column < 0 || column >= this->Dimensions[0])
+          {
+            continue;
+          }
+          vtkIdType cell = row * this->Dimensions[0] + column;
+          for (vtkIdType pointIndex = this->CellOffsets[cell]; pointIndex < this->CellOffsets[cell + 1]; ++pointIndex)
+          {
+            const IndexedPoint& indexedPoint = this->Points[pointIndex];
+            if (lineIds && std::find(lineIds->begin(), lineIds->end(), indexedPoint.LineId) == lineIds->end())
+            {
+              continue;
+            }
+            double distanceSquared = vtkMath::Distance2BetweenPoints(originalPoint, indexedPoint.Point);
+            if (!found || distanceSquared < minimumDistanceSquared
+              || (distanceSquared == minimumDistanceSquared
+                && (indexedPoint.LineId < closestLineId
+                  || (indexedPoint.LineId == closestLineId && indexedPoint.Position < closestPosition))))
+            {
+              found = true;
+              minimumDistanceSquared = distanceSquared;
+              closestLineId = indexedPoint.LineId;
+              closestPosition = indexedPoint.Position;
+            }
+          }
+        }
+      }
+    }
+    return found;
+  }
+
+private:
+  struct IndexedPoint
+  {
+    double Point[3];
+    vtkIdType LineId;
+    vtkIdType Position;
+  };
+
+  void GetCellIndex(const double point[3], vtkIdType cellIndex[2]) const
+  {
+    for (int axis = 0; axis < 2; ++axis)
+    {
+      double cellCoordinate = std::floor((point[axis] - this->Origin[axis]) / this->CellSize);
+      cellCoordinate = std::max(0.0, std::min(cellCoordinate, static_cast<double>(this->Dimensions[axis] - 1)));
+      cellIndex[axis] = static_cast<vtkIdType>(cellCoordinate);
+    }
+  }
+
+  /// Points sorted by grid cell after Build()
+  std::vector<IndexedPoint> Points;
+  /// Index of the first point of each cell in Points, followed by the total number of points
+  std::vector<vtkIdType> CellOffsets;
+  double Origin[2]{ 0.0, 0.0 };
+  double CellSize{ 1.0 };
+  vtkIdType Dimensions[2]{ 0, 0 };
+};
+
+//----------------------------------------------------------------------------
+/// Triangulates the divided line pairs collected for adjacent contour planes.
+/// Once overlaps and branching are resolved the pairs are independent, so they can be
+/// processed concurrently. Each pair writes into its own cell array, which are merged
+/// in order afterwards so that the output does not depend on the number of threads.
+class vtkPlanarContourToClosedSurfaceConversionRule::TriangulationFunctor
+{
+public:
+  TriangulationFunctor(vtkPlanarContourToClosedSurfaceConversionRule* rule, vtkPolyData* inputROIPoints,
+    const std::vector<std::pair<vtkSmartPointer<vtkIdList>, vtkSmartPointer<vtkIdList> > >& linePairs,
+    std::vector<vtkSmartPointer<vtkCellArray> >& linePairPolygons)
+    : Rule(rule)
+    , InputROIPoints(inputROIPoints)
+    , LinePairs(linePairs)
+    , LinePairPolygons(linePairPolygons)
+  {
+  }
+
+  void operator()(vtkIdType beginPair, vtkIdType endPair)
+  {
+    for (vtkIdType pairIndex = beginPair; pairIndex < endPair; ++pairIndex)
+    {
+      vtkSmartPointer<vtkCellArray> polygons = vtkSmartPointer<vtkCellArray>::New();
+      this->Rule->TriangulateBetweenContours(this->InputROIPoints,
+        this->LinePairs[pairIndex].first, this->LinePairs[pairIndex].second, polygons);
+      this->LinePairPolygons[pairIndex] = polygons;
+    }
+  }
+
+private:
+  vtkPlanarContourToClosedSurfaceConversionRule* Rule;
+  vtkPolyData* InputROIPoints;
+  const std::vector<std::pair<vtkSmartPointer<vtkIdList>, vtkSmartPointer<vtkIdList> > >& LinePairs;
+  std::vector<vtkSmartPointer<vtkCellArray> >& LinePairPolygons;
+};
+
 //----------------------------------------------------------------------------
 vtkSegmentationConverterRuleNewMacro(vtkPlanarContourToClosedSurfaceConversionRule);
 
@@ -135,6 +364,32 @@ vtkDataObject* vtkPlanarContourToClosedSurfaceConversionRule::ConstructRepresent
 bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkSegment* segment)
 {
   this->CreateTargetRepresentation(segment);
+
+  // Use the persistent cache if the segment was loaded from an RT structure set
+  std::string conversionDescription = std::string(this->GetName())
+    + "|" + this->GetDefaultSliceThicknessParameterName() + "=" + this->GetConversionParameter(this->GetDefaultSliceThicknessParameterName())
+    + "|" + this->GetEndCappingParameterName() + "=" + this->GetConversionParameter(this->GetEndCappingParameterName());
+  std::string cacheKey = vtkSegmentConversionCache::GetCacheKey(segment, this->GetSourceRepresentationName(), conversionDescription);
+  vtkPolyData* closedSurfacePolyData = vtkPolyData::SafeDownCast(segment->GetRepresentation(this->GetTargetRepresentationName()));
+  if (!cacheKey.empty() && vtkSegmentConversionCache::ReadPolyData(cacheKey, closedSurfacePolyData))
+  {
+    return true;
+  }
+
+  if (!this->ConvertUncached(segment))
+  {
+    return false;
+  }
+  if (!cacheKey.empty())
+  {
+    vtkSegmentConversionCache::WritePolyData(cacheKey, closedSurfacePolyData);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlanarContourToClosedSurfaceConversionRule::ConvertUncached(vtkSegment* segment)
+{
 #else
 bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourceRepresentation, vtkDataObject* targetRepresentation)
 {
@@ -160,6 +415,12 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
     vtkErrorMacro("Convert: Target representation is not a poly data!");
     return false;
   }
+  if (planarContoursPolyData->GetNumberOfPoints() == 0)
+  {
+    // Nothing to convert (e.g. contours of the segment are not loaded yet)
+    closedSurfacePolyData->Initialize();
+    return true;
+  }
 
   // Copy the contours so that we can make modifications without affecting the original
   vtkSmartPointer<vtkPolyData> inputContoursCopy = vtkSmartPointer<vtkPolyData>::New();
@@ -193,20 +454,6 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
 
   double spacing = this->GetSpacingBetweenLines(inputContoursCopy);
 
-  std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators(numberOfLines);
-  std::vector<vtkSmartPointer<vtkIdList> > linePointIdLists(numberOfLines);
-  for (int lineIndex = 0; lineIndex < numberOfLines; ++lineIndex)
-  {
-    vtkSmartPointer<vtkLine> currentLine = vtkSmartPointer<vtkLine>::New();
-    currentLine->DeepCopy(inputContoursCopy->GetCell(lineIndex));
-    linePointIdLists[lineIndex] = currentLine->GetPointIds();
-    vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
-    linePolyData->SetPoints(currentLine->GetPoints());
-    pointLocators[lineIndex] = vtkSmartPointer<vtkPointLocator>::New();
-    pointLocators[lineIndex]->SetDataSet(linePolyData);
-    pointLocators[lineIndex]->BuildLocator();
-  }
-
   // Vector of booleans to determine which lines are triangulated from above and from below.
   std::vector< bool > lineTriganulatedToAbove(numberOfLines);
   std::vector< bool > lineTriganulatedToBelow(numberOfLines);
@@ -216,15 +463,23 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
     lineTriganulatedToBelow[i] = false;
   }
 
+  // Divided line pairs between adjacent planes that need to be triangulated.
+  // Overlap detection and branching is done sequentially, then the pairs are triangulated in parallel.
+  std::vector<std::pair<vtkSmartPointer<vtkIdList>, vtkSmartPointer<vtkIdList> > > linePairsToTriangulate;
+
   // Get two consecutive planes.
   vtkIdType firstLineOnPlane1Index = 0; // pointer to first line on plane 1.
   int numberOfLinesInPlane1 = this->GetNumberOfLinesOnPlane(inputContoursCopy, 0, spacing);
+  ContourPointIndex plane1PointIndex;
+  this->BuildPlanePointIndex(inputContoursCopy, firstLineOnPlane1Index, numberOfLinesInPlane1, plane1PointIndex);
 
   // Loop through all of the contours in the polydata
   while (firstLineOnPlane1Index + numberOfLinesInPlane1 < numberOfLines)
   {
     vtkIdType firstLineOnPlane2Index = firstLineOnPlane1Index + numberOfLinesInPlane1; // pointer to first line on plane 2
     int numberOfLinesInPlane2 = this->GetNumberOfLinesOnPlane(inputContoursCopy, firstLineOnPlane2Index, spacing); // number of lines on plane 2
+    ContourPointIndex plane2PointIndex;
+    this->BuildPlanePointIndex(inputContoursCopy, firstLineOnPlane2Index, numberOfLinesInPlane2, plane2PointIndex);
 
     // initialize overlaps lists. - list of list
     // Each internal list represents a line from the plane and will store the pointers to the overlap lines
@@ -261,17 +516,6 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
       vtkSmartPointer<vtkLine> line1 = vtkSmartPointer<vtkLine>::New();
       line1->DeepCopy(inputContoursCopy->GetCell(line1Index));
 
-      std::vector<vtkSmartPointer<vtkPointLocator> > overlap1PointLocators(plane1Overlaps[line1Index - firstLineOnPlane1Index].size());
-      std::vector<vtkSmartPointer<vtkIdList> > overlap1PointIds(plane1Overlaps[line1Index - firstLineOnPlane1Index].size());
-
-      // Loop through all of the lines in the second plane that overlap with the current line in the first plane
-      for (size_t overlapIndex = 0; overlapIndex < plane1Overlaps[line1Index - firstLineOnPlane1Index].size(); ++overlapIndex) // lines on plane 2 that overlap with line 1
-      {
-        vtkIdType j = plane1Overlaps[line1Index - firstLineOnPlane1Index][overlapIndex];
-        overlap1PointLocators[overlapIndex] = pointLocators[j];
-        overlap1PointIds[overlapIndex] = linePointIdLists[j];
-      }
-
       // Loop through all of the lines in the second plane that overlap with the current line in the first plane
       for (size_t overlapIndex = 0; overlapIndex < plane1Overlaps[line1Index - firstLineOnPlane1Index].size(); ++overlapIndex) // lines on plane 2 that overlap with line 1
       {
@@ -280,25 +524,15 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
         vtkSmartPointer<vtkLine> line2 = vtkSmartPointer<vtkLine>::New();
         line2->DeepCopy(inputContoursCopy->GetCell(line2Index));
 
-        std::vector<vtkSmartPointer<vtkPointLocator> > overlap2PointLocators(plane2Overlaps[line2Index - firstLineOnPlane2Index].size());
-        std::vector<vtkSmartPointer<vtkIdList> > overlap2PointIds(plane2Overlaps[line2Index - firstLineOnPlane2Index].size());
-
-        for (size_t i = 0; i < plane2Overlaps[line2Index - firstLineOnPlane2Index].size(); ++i)
-        {
-          int j = plane2Overlaps[line2Index - firstLineOnPlane2Index][i];
-          overlap2PointLocators[i] = pointLocators[j];
-          overlap2PointIds[i] = linePointIdLists[j];
-        }
-
         // Get the portion of line 1 that is close to line 2,
         vtkSmartPointer<vtkLine> dividedLine1 = vtkSmartPointer<vtkLine>::New();
-        this->Branch(inputContoursCopy, line1, line2Index, plane1Overlaps[line1Index - firstLineOnPlane1Index], overlap1PointLocators, overlap1PointIds, dividedLine1);
+        this->Branch(inputContoursCopy, line1, line2Index, plane1Overlaps[line1Index - firstLineOnPlane1Index], &plane2PointIndex, dividedLine1);
         vtkSmartPointer<vtkIdList> dividedPointsInLine1 = dividedLine1->GetPointIds();
         int numberOfdividedPointsInLine1 = dividedLine1->GetNumberOfPoints();
 
         // Get the portion of line 2 that is close to line 1.
         vtkSmartPointer<vtkLine> dividedLine2 = vtkSmartPointer<vtkLine>::New();
-        this->Branch(inputContoursCopy, line2, line1Index, plane2Overlaps[line2Index - firstLineOnPlane2Index], overlap2PointLocators, overlap2PointIds, dividedLine2);
+        this->Branch(inputContoursCopy, line2, line1Index, plane2Overlaps[line2Index - firstLineOnPlane2Index], &plane1PointIndex, dividedLine2);
         vtkSmartPointer<vtkIdList> dividedPointsInLine2 = dividedLine2->GetPointIds();
         int numberOfdividedPointsInLine2 = dividedLine2->GetNumberOfPoints();
 
@@ -306,7 +540,7 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
         {
           lineTriganulatedToAbove[line1Index] = true;
           lineTriganulatedToBelow[line2Index] = true;
-          this->TriangulateBetweenContours(inputContoursCopy, dividedPointsInLine1, dividedPointsInLine2, outputPolygons);
+          linePairsToTriangulate.push_back(std::make_pair(dividedPointsInLine1, dividedPointsInLine2));
         }
 
       }
@@ -315,6 +549,23 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
     // Advance the points
     firstLineOnPlane1Index = firstLineOnPlane2Index;
     numberOfLinesInPlane1 = numberOfLinesInPlane2;
+    plane1PointIndex = std::move(plane2PointIndex);
+  }
+
+  // Triangulate between the line pairs
+  std::vector<vtkSmartPointer<vtkCellArray> > linePairPolygons(linePairsToTriangulate.size());
+  TriangulationFunctor triangulationFunctor(this, inputContoursCopy, linePairsToTriangulate, linePairPolygons);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(linePairsToTriangulate.size()), triangulationFunctor);
+
+  // Merge the triangles in the original order
+  vtkSmartPointer<vtkIdList> trianglePointIds = vtkSmartPointer<vtkIdList>::New();
+  for (vtkSmartPointer<vtkCellArray>& polygons : linePairPolygons)
+  {
+    polygons->InitTraversal();
+    while (polygons->GetNextCell(trianglePointIds))
+    {
+      outputPolygons->InsertNextCell(trianglePointIds);
+    }
   }
 
   // Triangulate all contours which are exposed.
@@ -371,6 +622,12 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateBetweenContours(v
   int numberOfPointsInLine2 = pointsInLine2->GetNumberOfIds();
 
   // Pre-calculate and store the closest points.
+  ContourPointIndex line1SpatialIndex;
+  line1SpatialIndex.AddLine(inputROIPoints, 0, pointsInLine1);
+  line1SpatialIndex.Build();
+  ContourPointIndex line2SpatialIndex;
+  line2SpatialIndex.AddLine(inputROIPoints, 0, pointsInLine2);
+  line2SpatialIndex.Build();
 
   // Closest point from line 1 to line 2
   std::vector< int > closestPointFromLine1ToLine2Ids(numberOfPointsInLine1);
@@ -378,7 +635,7 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateBetweenContours(v
   {
     double line1Point[3] = { 0,0,0 };
     inputROIPoints->GetPoint(pointsInLine1->GetId(line1PointIndex), line1Point);
-    closestPointFromLine1ToLine2Ids[line1PointIndex] = this->GetClosestPoint(inputROIPoints, line1Point, pointsInLine2);
+    closestPointFromLine1ToLine2Ids[line1PointIndex] = this->GetClosestPoint(&line2SpatialIndex, line1Point);
   }
 
   // Closest from line 2 to line 1
@@ -387,7 +644,7 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateBetweenContours(v
   {
     double line2Point[3] = { 0,0,0 };
     inputROIPoints->GetPoint(pointsInLine2->GetId(line2PointIndex), line2Point);
-    closestPointFromLine2ToLine1Ids[line2PointIndex] = this->GetClosestPoint(inputROIPoints, line2Point, pointsInLine1);
+    closestPointFromLine2ToLine1Ids[line2PointIndex] = this->GetClosestPoint(&line1SpatialIndex, line2Point);
   }
 
   // Orient loops.
@@ -564,42 +821,39 @@ vtkIdType vtkPlanarContourToClosedSurfaceConversionRule::GetEndLoop(vtkIdType st
 }
 
 //----------------------------------------------------------------------------
-vtkIdType vtkPlanarContourToClosedSurfaceConversionRule::GetClosestPoint(vtkPolyData* inputROIPoints, double* originalPoint, vtkIdList* linePointIds)
+vtkIdType vtkPlanarContourToClosedSurfaceConversionRule::GetClosestPoint(ContourPointIndex* linePointIndex, double* originalPoint)
 {
-  if (!inputROIPoints)
+  if (!linePointIndex)
   {
-    vtkErrorMacro("inputROIPoints: Invalid vtkPolyData!");
+    vtkErrorMacro("GetClosestPoint: Invalid point index!");
     return 0;
   }
 
-  if (!linePointIds)
+  vtkIdType closestLineId = 0;
+  vtkIdType closestPointIndex = 0;
+  if (!linePointIndex->FindClosestPoint(originalPoint, nullptr, closestLineId, closestPointIndex))
   {
-    vtkErrorMacro("GetClosestPoint: Invalid vtkIdList!");
     return 0;
   }
+  return closestPointIndex;
+}
 
-  double pointOnLine[3] = { 0,0,0 }; // point from the given line
-  inputROIPoints->GetPoint(linePointIds->GetId(0), pointOnLine);
-
-  double minimumDistance = vtkMath::Distance2BetweenPoints(originalPoint, pointOnLine); // minimum distance from the point to the line
-  double closestPointIndex = 0;
-
-  int numberOfPoints = linePointIds->GetNumberOfIds();
-
-  // Loop through all of the points in the current line
-  for (int currentPointIndex = 1; currentPointIndex < numberOfPoints; ++currentPointIndex)
+//----------------------------------------------------------------------------
+void vtkPlanarContourToClosedSurfaceConversionRule::BuildPlanePointIndex(vtkPolyData* inputROIPoints, vtkIdType firstLineId, int numberOfLines, ContourPointIndex& planePointIndex)
+{
+  if (!inputROIPoints)
   {
-    inputROIPoints->GetPoint(linePointIds->GetId(currentPointIndex), pointOnLine);
-
-    double distanceBetweenPoints = vtkMath::Distance2BetweenPoints(originalPoint, pointOnLine);
-    if (distanceBetweenPoints < minimumDistance)
-    {
-      minimumDistance = distanceBetweenPoints;
-      closestPointIndex = currentPointIndex;
-    }
+    vtkErrorMacro("BuildPlanePointIndex: Invalid vtkPolyData!");
+    return;
   }
 
-  return closestPointIndex;
+  vtkSmartPointer<vtkIdList> linePointIds = vtkSmartPointer<vtkIdList>::New();
+  for (vtkIdType lineId = firstLineId; lineId < firstLineId + numberOfLines; ++lineId)
+  {
+    inputROIPoints->GetCellPoints(lineId, linePointIds);
+    planePointIndex.AddLine(inputROIPoints, lineId, linePointIds);
+  }
+  planePointIndex.Build();
 }
 
 //----------------------------------------------------------------------------
@@ -980,7 +1234,7 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::DoLinesOverlap(vtkLine* line
 
 // TODO: It may be possible to speed up this function by only calling the branch function once. -- need to look into this
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROIPoints, vtkLine* branchingLine, vtkIdType currentLineId, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists, vtkLine* outputLine)
+void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROIPoints, vtkLine* branchingLine, vtkIdType currentLineId, const std::vector< vtkIdType >& overlappingLineIds, ContourPointIndex* overlappingLinesPointIndex, vtkLine* outputLine)
 {
   if (!inputROIPoints)
   {
@@ -1015,7 +1269,7 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
     inputROIPoints->GetPoint(currentPointId, currentPoint);
 
     // See if the point's closest branch is the input branch.
-    if (this->GetClosestBranch(inputROIPoints, currentPoint, overlappingLineIds, pointLocators, lineIdLists) == currentLineId)
+    if (this->GetClosestBranch(inputROIPoints, currentPoint, overlappingLineIds, overlappingLinesPointIndex) == currentLineId)
     {
       outputLinePointIds->InsertNextId(currentPointId);
       prev = true;
@@ -1045,7 +1299,7 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
 }
 
 //----------------------------------------------------------------------------
-int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists)
+int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, const std::vector< vtkIdType >& overlappingLineIds, ContourPointIndex* overlappingLinesPointIndex)
 {
   if (!inputROIPoints)
   {
@@ -1058,22 +1312,18 @@ int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData*
     return overlappingLineIds[0];
   }
 
-  double minimumDistanceSquared = VTK_DOUBLE_MAX;
-  vtkIdType closestLineId = overlappingLineIds[0];
-
-  // Loop through all of the lines that overlap with the line the original point is on
-  for (size_t currentOverlapIndex = 0; currentOverlapIndex < overlappingLineIds.size(); ++currentOverlapIndex)
+  if (!overlappingLinesPointIndex)
   {
-    vtkIdType closestPointId = pointLocators[currentOverlapIndex]->FindClosestPoint(originalPoint);
-    double currentPoint[3] = { 0,0,0 };
-    inputROIPoints->GetPoint(lineIdLists[currentOverlapIndex]->GetId(closestPointId), currentPoint);
+    vtkErrorMacro("GetClosestBranch: Invalid point index!");
+    return overlappingLineIds[0];
+  }
 
-    double currentDistanceToLineSquared = vtkMath::Distance2BetweenPoints(currentPoint, originalPoint);
-    if (currentDistanceToLineSquared < minimumDistanceSquared)
-    {
-      minimumDistanceSquared = currentDistanceToLineSquared;
-      closestLineId = overlappingLineIds[currentOverlapIndex];
-    }
+  // Find the closest point on any of the lines that overlap with the line the original point is on
+  vtkIdType closestLineId = overlappingLineIds[0];
+  vtkIdType closestPointIndex = 0;
+  if (!overlappingLinesPointIndex->FindClosestPoint(originalPoint, &overlappingLineIds, closestLineId, closestPointIndex))
+  {
+    return overlappingLineIds[0];
   }
 
   return closestLineId;
@@ -1130,8 +1380,8 @@ void vtkPlanarContourToClosedSurfaceConversionRule::EndCapping(vtkPolyData* inpu
 
         int numberOfCells = externalLines->GetNumberOfCells();
         std::vector<vtkIdType> overlapLineIds(numberOfCells);
-        std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators(numberOfCells);
         std::vector<vtkSmartPointer<vtkIdList> >  idLists(numberOfCells);
+        ContourPointIndex externalLinesPointIndex;
 
         // Loop through all of the external lines that were created
         for (int currentLineId = 0; currentLineId < numberOfCells; ++currentLineId)
@@ -1142,28 +1392,23 @@ void vtkPlanarContourToClosedSurfaceConversionRule::EndCapping(vtkPolyData* inpu
           externalLines->GetNextCell(lineIdList);
           idLists[currentLineId] = lineIdList;
 
+          // The cell map (Cells) is kept up to date by InsertNextCell, rebuilding it with BuildCells for each new line is not needed
           vtkIdType newLineId = inputROIPoints->InsertNextCell(VTK_LINE, lineIdList);
-          inputROIPoints->BuildCells();
 
           vtkSmartPointer<vtkLine> newLine = vtkSmartPointer<vtkLine>::New();
           newLine->DeepCopy(inputROIPoints->GetCell(newLineId));
 
           this->TriangulateContourInterior(newLine, outputPolygons, direction == CAPPING_ABOVE);
 
-          vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
-          linePolyData->SetPoints(newLine->GetPoints());
-
-          vtkSmartPointer<vtkPointLocator> pointLocator = vtkSmartPointer<vtkPointLocator>::New();
-          pointLocator->SetDataSet(linePolyData);
-          pointLocator->BuildLocator();
-          pointLocators[currentLineId] = pointLocator;
+          externalLinesPointIndex.AddLine(inputROIPoints, currentLineId, lineIdList);
         }
+        externalLinesPointIndex.Build();
 
         // Loop through all of the external lines that were created
         for (int currentLineId = 0; currentLineId < numberOfCells; ++currentLineId)
         {
           vtkSmartPointer<vtkLine> dividedLine = vtkSmartPointer<vtkLine>::New();
-          this->Branch(inputROIPoints, currentLine, currentLineId, overlapLineIds, pointLocators, idLists, dividedLine);
+          this->Branch(inputROIPoints, currentLine, currentLineId, overlapLineIds, &externalLinesPointIndex, dividedLine);
           if (direction == CAPPING_ABOVE)
           {
             this->TriangulateBetweenContours(inputROIPoints, dividedLine->GetPointIds(), idLists[currentLineId], outputPolygons);
@@ -1347,23 +1592,16 @@ void vtkPlanarContourToClosedSurfaceConversionRule::CreateSmoothEndCapContour(vt
     vtkErrorMacro("CreateEndCapContour: invalid vtkCellArray");
   }
 
-  vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
-  lines->Initialize();
-  lines->InsertNextCell(inputLine);
-
-  vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
-  linePolyData->Initialize();
-  linePolyData->SetPoints(inputROIPoints->GetPoints());
-  linePolyData->SetLines(lines);
-
-  // Remove unused points
-  vtkNew<vtkCleanPolyData> cleanFilter;
-  cleanFilter->SetInputData(linePolyData);
-  cleanFilter->Update();
-  linePolyData->ShallowCopy(cleanFilter->GetOutput());
-
+  // Only the points of the line are needed, so the rasterization grid is computed from them directly
+  // instead of cleaning the point set shared by all contours of the structure
+  vtkPoints* linePoints = inputLine->GetPoints();
+  if (!linePoints)
+  {
+    vtkErrorMacro("CreateEndCapContour: invalid vtkLine");
+    return;
+  }
   double bounds[6] = { 0, 0, 0, 0, 0, 0 };
-  linePolyData->GetBounds(bounds);
+  linePoints->GetBounds(bounds);
 
   // Calculate the spacing using alternative dimensions
   double alternativeSpacing[2] = { 0, 0 };
@@ -1392,71 +1630,31 @@ void vtkPlanarContourToClosedSurfaceConversionRule::CreateSmoothEndCapContour(vt
   double origin[3] = { bounds[0], bounds[2], bounds[4] };
   int extent[6] = { 0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, dimensions[2] - 1 };
 
-  vtkSmartPointer<vtkImageData> blankImage = vtkSmartPointer<vtkImageData>::New();
-  blankImage->SetSpacing(spacing);
-  blankImage->SetExtent(extent);
-  blankImage->SetOrigin(origin);
-  blankImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  // Fill the inside of the contour in the mask. The masks are local so that the rule can be used concurrently.
+  size_t maskSize = static_cast<size_t>(dimensions[0]) * static_cast<size_t>(dimensions[1]);
+  std::vector<unsigned char> mask(maskSize, 0);
+  std::vector<unsigned char> erodedMask(maskSize);
+  int foregroundExtent[4] = { 0, -1, 0, -1 };
+  int totalNumberOfPixels = this->RasterizeEndCapContour(linePoints, origin, spacing, dimensions, mask.data(), foregroundExtent);
+  int numberOfPixels = totalNumberOfPixels;
+  int pixelDifference = VTK_INT_MAX;
 
-  void* blankImagePtr = blankImage->GetScalarPointerForExtent(blankImage->GetExtent());
-  if (!blankImagePtr)
+  // Loop while the number of pixels in the image is still greater than half the original number,
+  // and while the number of pixels is still changing
+  while (numberOfPixels > totalNumberOfPixels / 2 && pixelDifference > 0)
   {
-    vtkErrorMacro("CreateExternalLine: Failed to allocate memory for output labelmap image!");
-    return;
-  }
-  else
-  {
-    blankImage->GetExtent(extent);
-    memset(blankImagePtr, 0, ((extent[1] - extent[0] + 1)*(extent[3] - extent[2] + 1)*(extent[5] - extent[4] + 1) * blankImage->GetScalarSize() * blankImage->GetNumberOfScalarComponents()));
+    pixelDifference = numberOfPixels - this->ErodeEndCapMask(mask.data(), erodedMask.data(), dimensions, foregroundExtent);
+    numberOfPixels -= pixelDifference;
   }
 
-  // Convert the polydata to an image stencil
-  vtkSmartPointer<vtkPolyDataToImageStencil> polyDataToImageStencil = vtkSmartPointer<vtkPolyDataToImageStencil>::New();
-  polyDataToImageStencil->SetInputData(linePolyData);
-  polyDataToImageStencil->SetOutputSpacing(spacing);
-  polyDataToImageStencil->SetOutputOrigin(origin);
-  polyDataToImageStencil->SetOutputWholeExtent(extent);
-
-  // Convert the stencil to a binary image
-  vtkSmartPointer<vtkImageStencil> stencil = vtkSmartPointer<vtkImageStencil>::New();
-  stencil->SetInputData(blankImage);
-  stencil->SetStencilConnection(polyDataToImageStencil->GetOutputPort());
-  stencil->ReverseStencilOn();
-  stencil->SetBackgroundValue(1);
-  stencil->Update();
-
+  // Wrap the mask in an image for contour extraction without copying (the mask outlives the pipeline below)
+  vtkNew<vtkUnsignedCharArray> newContourScalars;
+  newContourScalars->SetArray(mask.data(), static_cast<vtkIdType>(maskSize), 1);
   vtkSmartPointer<vtkImageData> newContourImage = vtkSmartPointer<vtkImageData>::New();
-  newContourImage = stencil->GetOutput();
-
-  // Calculate the number of non-zero pixels in the image
-  vtkSmartPointer<vtkImageAccumulate> imageAccumulate = vtkSmartPointer<vtkImageAccumulate>::New();
-  imageAccumulate->SetInputData(newContourImage);
-  imageAccumulate->IgnoreZeroOn();
-  imageAccumulate->Update();
-
-  int totalNumberOfVoxels = imageAccumulate->GetVoxelCount();
-  int numberOfVoxels = totalNumberOfVoxels;
-  int voxelDifference = VTK_INT_MAX;
-
-  // Loop while the number of voxels in the image is still greater than half the original number,
-  // and while the number of voxels is still changing
-  while (numberOfVoxels > totalNumberOfVoxels / 2 && voxelDifference > 0)
-  {
-
-    // Erode the image using a kernel of size 5, 5, 1
-    vtkSmartPointer<vtkImageDilateErode3D> imageDilateErode3D = vtkSmartPointer<vtkImageDilateErode3D>::New();
-    imageDilateErode3D->SetErodeValue(1);
-    imageDilateErode3D->SetKernelSize(5, 5, 1);
-    imageDilateErode3D->SetInputData(newContourImage);
-    imageDilateErode3D->Update();
-    newContourImage = imageDilateErode3D->GetOutput();
-
-    // Calculate the number of voxels in the new image
-    imageAccumulate->SetInputData(newContourImage);
-    imageAccumulate->Update();
-    voxelDifference = numberOfVoxels - imageAccumulate->GetVoxelCount();
-    numberOfVoxels -= voxelDifference;
-  }
+  newContourImage->SetSpacing(spacing);
+  newContourImage->SetExtent(extent);
+  newContourImage->SetOrigin(origin);
+  newContourImage->GetPointData()->SetScalars(newContourScalars);
 
   // Create contours from the image
   vtkSmartPointer<vtkMarchingSquares> marchingSquares = vtkSmartPointer<vtkMarchingSquares>::New();
@@ -1560,6 +1758,131 @@ void vtkPlanarContourToClosedSurfaceConversionRule::CreateSmoothEndCapContour(vt
   }
 }
 
+//----------------------------------------------------------------------------
+int vtkPlanarContourToClosedSurfaceConversionRule::RasterizeEndCapContour(vtkPoints* contourPoints,
+  const double origin[3], const double spacing[3], const int dimensions[3], unsigned char* mask, int foregroundExtent[4])
+{
+  foregroundExtent[0] = dimensions[0];
+  foregroundExtent[1] = -1;
+  foregroundExtent[2] = dimensions[1];
+  foregroundExtent[3] = -1;
+
+  // Contour points in continuous pixel coordinates
+  vtkIdType numberOfPoints = contourPoints->GetNumberOfPoints();
+  std::vector<double> pointsI(numberOfPoints);
+  std::vector<double> pointsJ(numberOfPoints);
+  for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    double point[3] = { 0.0, 0.0, 0.0 };
+    contourPoints->GetPoint(pointIndex, point);
+    pointsI[pointIndex] = (point[0] - origin[0]) / spacing[0];
+    pointsJ[pointIndex] = (point[1] - origin[1]) / spacing[1];
+  }
+
+  // Fill pixels whose centers are inside the contour row by row using the even-odd rule
+  int numberOfFilledPixels = 0;
+  std::vector<double> crossings;
+  for (int j = 0; j < dimensions[1]; ++j)
+  {
+    crossings.clear();
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      vtkIdType nextPointIndex = (pointIndex + 1) % numberOfPoints;
+      double j0 = pointsJ[pointIndex];
+      double j1 = pointsJ[nextPointIndex];
+      if ((j0 <= j && j < j1) || (j1 <= j && j < j0))
+      {
+        crossings.push_back(pointsI[pointIndex] + (j - j0) * (pointsI[nextPointIndex] - pointsI[pointIndex]) / (j1 - j0));
+      }
+    }
+    std::sort(crossings.begin(), crossings.end());
+    for (size_t crossingIndex = 0; crossingIndex + 1 < crossings.size(); crossingIndex += 2)
+    {
+      int firstI = std::max(0, static_cast<int>(std::ceil(crossings[crossingIndex])));
+      int lastI = std::min(dimensions[0] - 1, static_cast<int>(std::floor(crossings[crossingIndex + 1])));
+      if (firstI > lastI)
+      {
+        continue;
+      }
+      memset(mask + static_cast<size_t>(j) * dimensions[0] + firstI, 1, lastI - firstI + 1);
+      numberOfFilledPixels += lastI - firstI + 1;
+      foregroundExtent[0] = std::min(foregroundExtent[0], firstI);
+      foregroundExtent[1] = std::max(foregroundExtent[1], lastI);
+      foregroundExtent[2] = std::min(foregroundExtent[2], j);
+      foregroundExtent[3] = std::max(foregroundExtent[3], j);
+    }
+  }
+  return numberOfFilledPixels;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlanarContourToClosedSurfaceConversionRule::ErodeEndCapMask(unsigned char* mask, unsigned char* erodedMask, const int dimensions[3], int foregroundExtent[4])
+{
+  // Elliptical 5x5 kernel, the same as the one of vtkImageDilateErode3D with kernel size 5,5,1
+  static const int KernelRadius = 2;
+  static const double KernelRadiusSquared = 2.5 * 2.5;
+
+  if (foregroundExtent[0] > foregroundExtent[1] || foregroundExtent[2] > foregroundExtent[3])
+  {
+    return 0;
+  }
+
+  // Only the pixels within the foreground extent can be set, so erosion is restricted to that region
+  // (which shrinks with each erosion). Neighbors outside the image are ignored.
+  int numberOfRemainingPixels = 0;
+  int newForegroundExtent[4] = { dimensions[0], -1, dimensions[1], -1 };
+  for (int j = foregroundExtent[2]; j <= foregroundExtent[3]; ++j)
+  {
+    for (int i = foregroundExtent[0]; i <= foregroundExtent[1]; ++i)
+    {
+      size_t pixelIndex = static_cast<size_t>(j) * dimensions[0] + i;
+      unsigned char value = mask[pixelIndex];
+      for (int offsetJ = -KernelRadius; value && offsetJ <= KernelRadius; ++offsetJ)
+      {
+        int neighborJ = j + offsetJ;
+        if (neighborJ < 0 || neighborJ >= dimensions[1])
+        {
+          continue;
+        }
+        for (int offsetI = -KernelRadius; offsetI <= KernelRadius; ++offsetI)
+        {
+          int neighborI = i + offsetI;
+          if (neighborI < 0 || neighborI >= dimensions[0] || offsetI * offsetI + offsetJ * offsetJ > KernelRadiusSquared)
+          {
+            continue;
+          }
+          if (!mask[static_cast<size_t>(neighborJ) * dimensions[0] + neighborI])
+          {
+            value = 0;
+            break;
+          }
+        }
+      }
+      erodedMask[pixelIndex] = value;
+      if (value)
+      {
+        ++numberOfRemainingPixels;
+        newForegroundExtent[0] = std::min(newForegroundExtent[0], i);
+        newForegroundExtent[1] = std::max(newForegroundExtent[1], i);
+        newForegroundExtent[2] = std::min(newForegroundExtent[2], j);
+        newForegroundExtent[3] = std::max(newForegroundExtent[3], j);
+      }
+    }
+  }
+
+  // Copy the eroded region back to the mask
+  for (int j = foregroundExtent[2]; j <= foregroundExtent[3]; ++j)
+  {
+    size_t rowStart = static_cast<size_t>(j) * dimensions[0] + foregroundExtent[0];
+    memcpy(mask + rowStart, erodedMask + rowStart, foregroundExtent[1] - foregroundExtent[0] + 1);
+  }
+  for (int i = 0; i < 4; ++i)
+  {
+    foregroundExtent[i] = newForegroundExtent[i];
+  }
+  return numberOfRemainingPixels;
+}
+
 //----------------------------------------------------------------------------
 void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateContourInterior(vtkLine* inputLine, vtkCellArray* outputPolys, bool normalsUp)
 {
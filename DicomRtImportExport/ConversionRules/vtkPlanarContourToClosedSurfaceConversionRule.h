@@ -30,8 +30,8 @@
 
 #include "vtkSlicerDicomRtImportExportConversionRulesExport.h"
 
-// VTK includes
-#include "vtkPointLocator.h"
+// STD includes
+#include <vector>
 
 class vtkPolyData;
 class vtkIdList;
@@ -98,7 +98,19 @@ protected:
   vtkPlanarContourToClosedSurfaceConversionRule();
   ~vtkPlanarContourToClosedSurfaceConversionRule() override;
 
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  /// Perform the conversion without consulting the persistent conversion cache
+  bool ConvertUncached(vtkSegment* segment);
+#endif
+
+  /// Triangulates divided line pairs of adjacent planes in parallel (using vtkSMPTools)
+  class TriangulationFunctor;
+
+  /// Flat 2D grid index serving closest point queries against the lines of one plane
+  class ContourPointIndex;
+
   /// Construct a surface triangulation between two lines using a dynamic programming algorithm.
+  /// Does not modify the rule or the input points, so it may be called concurrently for different line pairs.
   /// \param inputROIPoints Polydata containing all of the points and contours
   /// \param pointsInLine1 List of points that are contained in the line to be triangulated
   /// \param pointsInLine2 List of points that are contained in the line to be triangulated
@@ -113,11 +125,17 @@ protected:
   vtkIdType GetEndLoop(vtkIdType startLoopIndex, int numberOfPoints, bool loopClosed);
 
   /// Find the point on the given line that is closest to the given point.
-  /// \param inputROIPoints Polydata containing all of the points and contours
+  /// \param linePointIndex Point index containing the line that is being compared to the point
   /// \param originalPoint The point that is being compared to the line
-  /// \param linePointIds The line that is being compared to the point
   /// \return The index of the point in the line that is closet to the specified point
-  vtkIdType GetClosestPoint(vtkPolyData* inputROIPoints, double* originalPoint, vtkIdList* linePointIds);
+  vtkIdType GetClosestPoint(ContourPointIndex* linePointIndex, double* originalPoint);
+
+  /// Build the point index of the lines on a plane. Lines are identified by their ID in the input polydata.
+  /// \param inputROIPoints Polydata containing all of the points and contours
+  /// \param firstLineId The ID of the first line on the plane
+  /// \param numberOfLines The number of lines on the plane
+  /// \param planePointIndex The output point index
+  void BuildPlanePointIndex(vtkPolyData* inputROIPoints, vtkIdType firstLineId, int numberOfLines, ContourPointIndex& planePointIndex);
 
   /// Sort the contours based on Z value.
   /// \param inputROIPoints Polydata containing all of the points and contours
@@ -160,18 +178,16 @@ protected:
   /// \param branchingLine The orignal line that is being divided
   /// \param currentLineId The ID of the current line in the input polydata that is being compared
   /// \param overlappingLineIds List of line IDs for lines that overlap with the current line
-  /// \param pointLocators List of point locators for lines in the overlap list
-  /// \param lineIdLists List of vtkIdLists for all of the lines in the overlap list
+  /// \param overlappingLinesPointIndex Point index containing the lines in the overlap list
   /// \param outputLine The output branched line
-  void Branch(vtkPolyData* inputROIPoints, vtkLine* branchingLine, vtkIdType currentLineId, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists, vtkLine* outputLine);
+  void Branch(vtkPolyData* inputROIPoints, vtkLine* branchingLine, vtkIdType currentLineId, const std::vector< vtkIdType >& overlappingLineIds, ContourPointIndex* overlappingLinesPointIndex, vtkLine* outputLine);
 
   /// Find the branch closest from the point on the trunk
   /// \param inputROIPoints Polydata containing all of the points and contours
   /// \param originalPoint The point that is being compared
   /// \param overlappingLineIds List of line IDs for lines that overlap with the current line
-  /// \param pointLocators List of point locators for lines in the overlap list
-  /// \param lineIdLists List of vtkIdLists for all of the lines in the overlap list
-  int GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists);
+  /// \param overlappingLinesPointIndex Point index containing the lines in the overlap list
+  int GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, const std::vector< vtkIdType >& overlappingLineIds, ContourPointIndex* overlappingLinesPointIndex);
 
   /// Seal the exterior contours of the mesh.
   /// \param inputROIPoints Polydata containing all of the points and contours
@@ -211,6 +227,25 @@ protected:
   /// \param The size of the spacing between the contours. Contours created by this function will be offset by 1/2 of this amount
   void CreateStraightEndCapContour(vtkPolyData* inputROIPoints, vtkLine* inputLine, vtkCellArray* outputLines, double lineSpacing);
 
+  /// Fill the inside of a contour in a 2D mask used for smooth end capping.
+  /// \param contourPoints Points of the contour, in order
+  /// \param origin Origin of the mask grid
+  /// \param spacing Spacing of the mask grid
+  /// \param dimensions Dimensions of the mask grid
+  /// \param mask Mask that is filled with 1 inside the contour. Must be initialized to 0.
+  /// \param foregroundExtent Output extent (i min, i max, j min, j max) of the filled pixels
+  /// \return Number of filled pixels
+  int RasterizeEndCapContour(vtkPoints* contourPoints, const double origin[3], const double spacing[3],
+    const int dimensions[3], unsigned char* mask, int foregroundExtent[4]);
+
+  /// Erode the end cap mask with a 5x5 elliptical kernel.
+  /// \param mask Mask to erode in place
+  /// \param erodedMask Scratch buffer of the same size as the mask
+  /// \param dimensions Dimensions of the mask grid
+  /// \param foregroundExtent Extent of the set pixels. Only this region is processed, and it is updated after erosion.
+  /// \return Number of pixels remaining set
+  int ErodeEndCapMask(unsigned char* mask, unsigned char* erodedMask, const int dimensions[3], int foregroundExtent[4]);
+
   /// Triangulate the interior of a contour on the xy plane.
   /// \param Contour that is being triangulated
   /// \param Cell array that the polygons are added to
@@ -28,10 +28,14 @@
 #include <vtkCell.h>
 #include <vtkIdList.h>
 #include <vtkPlane.h>
-#include <vtkCleanPolyData.h>
-#include <vtkPolyDataNormals.h>
-#include <vtkRibbonFilter.h>
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
 #include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
 
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
 // SegmentationCore includes
@@ -83,6 +87,99 @@ namespace
     outputMessage = outputStringStream.str();
     return majorityValue;
   }
+
+  /// Builds the ribbons of a range of contour lines into preallocated output arrays.
+  /// Each line of m distinct consecutive points produces 2m points (one on each side of the
+  /// contour plane, offset along the contour normal) and 2(m-1) triangles. The output offsets
+  /// of each line are computed in advance, so lines are processed independently.
+  struct RibbonFunctor
+  {
+    vtkPoints* InputPoints;
+    const std::vector<vtkIdType>* LineOffsets;
+    const std::vector<vtkIdType>* LinePointIds;
+    const std::vector<vtkIdType>* OutputPointOffsets;
+    const std::vector<vtkIdType>* OutputTriangleOffsets;
+    double Normal[3];
+    double HalfWidth;
+    float* OutputPoints;
+    float* OutputNormals;
+    vtkIdType* OutputTriangles;
+
+    void operator()(vtkIdType beginLine, vtkIdType endLine) const
+    {
+      for (vtkIdType lineIndex = beginLine; lineIndex < endLine; ++lineIndex)
+      {
+        vtkIdType firstPointId = (*this->OutputPointOffsets)[lineIndex];
+        vtkIdType numberOfRibbonPoints = ((*this->OutputPointOffsets)[lineIndex + 1] - firstPointId) / 2;
+        if (numberOfRibbonPoints < 2)
+        {
+          continue;
+        }
+
+        // Distinct consecutive points of the line (coincident points would produce degenerate directions)
+        std::vector<vtkVector3d> linePoints;
+        linePoints.reserve(numberOfRibbonPoints);
+        for (vtkIdType idIndex = (*this->LineOffsets)[lineIndex]; idIndex < (*this->LineOffsets)[lineIndex + 1]; ++idIndex)
+        {
+          double point[3] = { 0.0, 0.0, 0.0 };
+          this->InputPoints->GetPoint((*this->LinePointIds)[idIndex], point);
+          if (linePoints.empty() || point[0] != linePoints.back()[0]
+            || point[1] != linePoints.back()[1] || point[2] != linePoints.back()[2])
+          {
+            linePoints.push_back(vtkVector3d(point[0], point[1], point[2]));
+          }
+        }
+
+        vtkVector3d normal(this->Normal[0], this->Normal[1], this->Normal[2]);
+        float* outputPoints = this->OutputPoints + 3 * firstPointId;
+        float* outputNormals = this->OutputNormals + 3 * firstPointId;
+        for (vtkIdType pointIndex = 0; pointIndex < numberOfRibbonPoints; ++pointIndex)
+        {
+          // Average direction of the adjacent segments
+          const vtkVector3d& point = linePoints[pointIndex];
+          vtkVector3d previousDirection = (pointIndex > 0 ? point - linePoints[pointIndex - 1] : linePoints[1] - point);
+          vtkVector3d nextDirection = (pointIndex < numberOfRibbonPoints - 1 ? linePoints[pointIndex + 1] - point : previousDirection);
+          previousDirection.Normalize();
+          nextDirection.Normalize();
+          vtkVector3d direction(previousDirection[0] + nextDirection[0],
+            previousDirection[1] + nextDirection[1], previousDirection[2] + nextDirection[2]);
+          if (direction.Normalize() == 0.0)
+          {
+            direction = previousDirection;
+          }
+
+          // Ribbon surface normal lies in the contour plane, the ribbon extends along the contour normal
+          vtkVector3d surfaceNormal(direction.Cross(normal));
+          surfaceNormal.Normalize();
+          vtkVector3d offset(surfaceNormal.Cross(direction));
+          offset.Normalize();
+          for (int i = 0; i < 3; ++i)
+          {
+            outputPoints[6 * pointIndex + i] = static_cast<float>(point[i] - this->HalfWidth * offset[i]);
+            outputPoints[6 * pointIndex + 3 + i] = static_cast<float>(point[i] + this->HalfWidth * offset[i]);
+            outputNormals[6 * pointIndex + i] = static_cast<float>(surfaceNormal[i]);
+            outputNormals[6 * pointIndex + 3 + i] = static_cast<float>(surfaceNormal[i]);
+          }
+        }
+
+        // Two triangles per segment, in legacy cell array layout (number of points followed by the point IDs)
+        vtkIdType* outputTriangles = this->OutputTriangles + 4 * (*this->OutputTriangleOffsets)[lineIndex];
+        for (vtkIdType segmentIndex = 0; segmentIndex < numberOfRibbonPoints - 1; ++segmentIndex)
+        {
+          vtkIdType lowerPointId = firstPointId + 2 * segmentIndex;
+          vtkIdType* triangles = outputTriangles + 8 * segmentIndex;
+          triangles[0] = 3;
+          triangles[1] = lowerPointId;
+          triangles[2] = lowerPointId + 2;
+          triangles[3] = lowerPointId + 1;
+          triangles[4] = 3;
+          triangles[5] = lowerPointId + 1;
+          triangles[6] = lowerPointId + 2;
+          triangles[7] = lowerPointId + 3;
+        }
+      }
+    }
+  };
 }
 
 //----------------------------------------------------------------------------
@@ -173,25 +270,87 @@ bool vtkPlanarContourToRibbonModelConversionRule::Convert(vtkDataObject* sourceR
   vtkSmartPointer<vtkPlane> contoursPlane = vtkSmartPointer<vtkPlane>::New();
   double sliceThickness = this->ComputeContourPlaneSpacing(planarContourPolyData, contoursPlane);
 
-  // Remove coincident points (if there are multiple contour points at the same position then the ribbon filter fails)
-  vtkSmartPointer<vtkCleanPolyData> cleaner = vtkSmartPointer<vtkCleanPolyData>::New();
-  cleaner->SetInputData(planarContourPolyData);
-
-  // Convert to ribbon using vtkRibbonFilter
-  vtkSmartPointer<vtkRibbonFilter> ribbonFilter = vtkSmartPointer<vtkRibbonFilter>::New();
-  ribbonFilter->SetInputConnection(cleaner->GetOutputPort());
-  ribbonFilter->SetDefaultNormal(contoursPlane->GetNormal());
-  ribbonFilter->UseDefaultNormalOn();
-  ribbonFilter->SetWidth(sliceThickness / 2.0);
-  ribbonFilter->SetAngle(90.0);
-  ribbonFilter->Update();
-
-  vtkSmartPointer<vtkPolyDataNormals> normalFilter = vtkSmartPointer<vtkPolyDataNormals>::New();
-  normalFilter->SetInputConnection(ribbonFilter->GetOutputPort());
-  normalFilter->ConsistencyOn();
-  normalFilter->Update();
-
-  ribbonModelPolyData->DeepCopy(normalFilter->GetOutput());
+  // Gather the point IDs of the contour lines and count the distinct consecutive points of each line,
+  // so that the output can be allocated at once and the lines converted independently
+  vtkPoints* inputPoints = planarContourPolyData->GetPoints();
+  vtkCellArray* lines = planarContourPolyData->GetLines();
+  if (!lines || lines->GetNumberOfCells() < 1)
+  {
+    vtkErrorMacro("Convert: Planar contour does not contain contour lines");
+    return false;
+  }
+  vtkIdType numberOfLines = lines->GetNumberOfCells();
+  std::vector<vtkIdType> lineOffsets(1, 0);
+  std::vector<vtkIdType> linePointIds;
+  std::vector<vtkIdType> outputPointOffsets(1, 0);
+  std::vector<vtkIdType> outputTriangleOffsets(1, 0);
+  lineOffsets.reserve(numberOfLines + 1);
+  linePointIds.reserve(lines->GetNumberOfConnectivityEntries());
+  outputPointOffsets.reserve(numberOfLines + 1);
+  outputTriangleOffsets.reserve(numberOfLines + 1);
+  vtkIdType numberOfLinePoints = 0;
+  const vtkIdType* lineCellPointIds = nullptr;
+  for (lines->InitTraversal(); lines->GetNextCell(numberOfLinePoints, lineCellPointIds); )
+  {
+    vtkIdType numberOfDistinctPoints = 0;
+    double previousPoint[3] = { 0.0, 0.0, 0.0 };
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfLinePoints; ++pointIndex)
+    {
+      double point[3] = { 0.0, 0.0, 0.0 };
+      inputPoints->GetPoint(lineCellPointIds[pointIndex], point);
+      if (pointIndex == 0 || point[0] != previousPoint[0] || point[1] != previousPoint[1] || point[2] != previousPoint[2])
+      {
+        ++numberOfDistinctPoints;
+      }
+      previousPoint[0] = point[0];
+      previousPoint[1] = point[1];
+      previousPoint[2] = point[2];
+      linePointIds.push_back(lineCellPointIds[pointIndex]);
+    }
+    // Lines that collapse into a single point have no ribbon
+    if (numberOfDistinctPoints < 2)
+    {
+      numberOfDistinctPoints = 0;
+    }
+    lineOffsets.push_back(static_cast<vtkIdType>(linePointIds.size()));
+    outputPointOffsets.push_back(outputPointOffsets.back() + 2 * numberOfDistinctPoints);
+    outputTriangleOffsets.push_back(outputTriangleOffsets.back() + (numberOfDistinctPoints > 0 ? 2 * (numberOfDistinctPoints - 1) : 0));
+  }
+
+  // Preallocate output
+  vtkIdType numberOfOutputPoints = outputPointOffsets.back();
+  vtkIdType numberOfOutputTriangles = outputTriangleOffsets.back();
+  vtkNew<vtkPoints> outputPoints;
+  outputPoints->SetDataTypeToFloat();
+  outputPoints->SetNumberOfPoints(numberOfOutputPoints);
+  vtkNew<vtkFloatArray> outputNormals;
+  outputNormals->SetName("Normals");
+  outputNormals->SetNumberOfComponents(3);
+  outputNormals->SetNumberOfTuples(numberOfOutputPoints);
+  vtkNew<vtkIdTypeArray> outputTriangles;
+  outputTriangles->SetNumberOfValues(4 * numberOfOutputTriangles);
+
+  // Build the ribbons of the contour lines in parallel
+  RibbonFunctor ribbonFunctor;
+  ribbonFunctor.InputPoints = inputPoints;
+  ribbonFunctor.LineOffsets = &lineOffsets;
+  ribbonFunctor.LinePointIds = &linePointIds;
+  ribbonFunctor.OutputPointOffsets = &outputPointOffsets;
+  ribbonFunctor.OutputTriangleOffsets = &outputTriangleOffsets;
+  contoursPlane->GetNormal(ribbonFunctor.Normal);
+  ribbonFunctor.HalfWidth = sliceThickness / 2.0;
+  ribbonFunctor.OutputPoints = vtkFloatArray::SafeDownCast(outputPoints->GetData())->GetPointer(0);
+  ribbonFunctor.OutputNormals = outputNormals->GetPointer(0);
+  ribbonFunctor.OutputTriangles = outputTriangles->GetPointer(0);
+  vtkSMPTools::For(0, numberOfLines, ribbonFunctor);
+
+  vtkNew<vtkCellArray> outputPolys;
+  outputPolys->SetCells(numberOfOutputTriangles, outputTriangles);
+
+  ribbonModelPolyData->Initialize();
+  ribbonModelPolyData->SetPoints(outputPoints);
+  ribbonModelPolyData->SetPolys(outputPolys);
+  ribbonModelPolyData->GetPointData()->SetNormals(outputNormals);
 
   return true;
 }
@@ -41,7 +41,8 @@ class vtkPlane;
 /// \ingroup DicomRtImportImportExportConversionRules
 /// \brief Convert planar contour representation (vtkPolyData type) to ribbon
 ///   model representation (also vtkPolyData) by thickening the contours along
-///   a normal vector orthogonal to the planes
+///   a normal vector orthogonal to the planes. The ribbons of the contour lines are
+///   built in parallel directly into the preallocated output.
 class VTK_SLICER_DICOMRTIMPORTEXPORT_CONVERSIONRULES_EXPORT vtkPlanarContourToRibbonModelConversionRule
   : public vtkSegmentationConverterRule
 {
@@ -0,0 +1,407 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DicomRtImportExport includes
+#include "vtkSegmentConversionCache.h"
+
+// SlicerRt includes
+#include "vtkSlicerRtCommon.h"
+
+// SegmentationCore includes
+#include <vtkOrientedImageData.h>
+#include <vtkSegment.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdList.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkXMLImageDataReader.h>
+#include <vtkXMLImageDataWriter.h>
+#include <vtkXMLPolyDataReader.h>
+#include <vtkXMLPolyDataWriter.h>
+#include <vtksys/Directory.hxx>
+#include <vtksys/MD5.h>
+#include <vtksys/SystemInformation.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  /// Needs to be changed when the conversion algorithms change, to invalidate the existing cache entries
+  const char* CONVERSION_CACHE_VERSION = "SlicerRT conversion cache v2";
+
+  /// Name of the field data array storing the directions of cached oriented image data
+  const char* DIRECTIONS_ARRAY_NAME = "ImageDirections";
+
+  /// The cache is pruned when the first entry is written to it, then after this many written entries
+  const unsigned int PRUNE_INTERVAL = 100;
+
+  /// The cache is pruned to this fraction of the maximum size, so that it is not pruned again right away
+  const double PRUNED_SIZE_FRACTION = 0.9;
+
+  std::mutex CacheSettingsMutex;
+  std::string CacheDirectory;
+  unsigned long long MaximumCacheSize = 2ULL * 1024 * 1024 * 1024;
+
+  std::atomic<unsigned int> NumberOfWrittenEntries(0);
+  std::atomic<unsigned int> NumberOfTemporaryFiles(0);
+
+  /// Add a data buffer to an MD5 digest. The buffer may be larger than what a single append call accepts.
+  void AppendToDigest(vtksysMD5* md5, const void* data, size_t length)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const size_t maximumChunkLength = 1 << 30;
+    while (length > 0)
+    {
+      size_t chunkLength = std::min(length, maximumChunkLength);
+      vtksysMD5_Append(md5, bytes, static_cast<int>(chunkLength));
+      bytes += chunkLength;
+      length -= chunkLength;
+    }
+  }
+
+  void AppendToDigest(vtksysMD5* md5, const std::string& text)
+  {
+    // Include terminating character so that consecutive strings cannot be confused
+    AppendToDigest(md5, text.c_str(), text.size() + 1);
+  }
+
+  void AppendCellsToDigest(vtksysMD5* md5, vtkCellArray* cells)
+  {
+    vtkIdType numberOfCells = (cells ? cells->GetNumberOfCells() : 0);
+    AppendToDigest(md5, &numberOfCells, sizeof(vtkIdType));
+    if (numberOfCells == 0)
+    {
+      return;
+    }
+    vtkNew<vtkIdList> cellPointIds;
+    cells->InitTraversal();
+    while (cells->GetNextCell(cellPointIds))
+    {
+      vtkIdType numberOfCellPoints = cellPointIds->GetNumberOfIds();
+      AppendToDigest(md5, &numberOfCellPoints, sizeof(vtkIdType));
+      AppendToDigest(md5, cellPointIds->GetPointer(0), numberOfCellPoints * sizeof(vtkIdType));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentConversionCache::SetCacheDirectory(const std::string& cacheDirectory)
+{
+  std::lock_guard<std::mutex> lock(CacheSettingsMutex);
+  CacheDirectory = cacheDirectory;
+  // Entries left in the directory by earlier sessions are pruned when the first entry is written
+  NumberOfWrittenEntries = 0;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSegmentConversionCache::GetCacheDirectory()
+{
+  std::lock_guard<std::mutex> lock(CacheSettingsMutex);
+  return CacheDirectory;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentConversionCache::SetMaximumCacheSize(unsigned long long maximumCacheSize)
+{
+  std::lock_guard<std::mutex> lock(CacheSettingsMutex);
+  MaximumCacheSize = maximumCacheSize;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkSegmentConversionCache::GetMaximumCacheSize()
+{
+  std::lock_guard<std::mutex> lock(CacheSettingsMutex);
+  return MaximumCacheSize;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentConversionCache::PruneCache()
+{
+  std::string cacheDirectory = GetCacheDirectory();
+  vtksys::Directory directory;
+  if (cacheDirectory.empty() || !directory.Load(cacheDirectory))
+  {
+    return;
+  }
+
+  // Reading an entry updates its modification time, so the oldest files are the least recently used ones
+  struct CacheFile
+  {
+    std::string Path;
+    unsigned long long Size;
+    long ModifiedTime;
+  };
+  std::vector<CacheFile> cacheFiles;
+  unsigned long long totalSize = 0;
+  for (unsigned long fileIndex = 0; fileIndex < directory.GetNumberOfFiles(); ++fileIndex)
+  {
+    std::string fileName(directory.GetFile(fileIndex));
+    std::string extension = vtksys::SystemTools::GetFilenameLastExtension(fileName);
+    if (extension != ".vtp" && extension != ".vti")
+    {
+      continue; // Not a cache entry (temporary files of entries being written are skipped too)
+    }
+    CacheFile cacheFile;
+    cacheFile.Path = cacheDirectory + "/" + fileName;
+    cacheFile.Size = vtksys::SystemTools::FileLength(cacheFile.Path);
+    cacheFile.ModifiedTime = vtksys::SystemTools::ModifiedTime(cacheFile.Path);
+    totalSize += cacheFile.Size;
+    cacheFiles.push_back(cacheFile);
+  }
+
+  unsigned long long maximumCacheSize = GetMaximumCacheSize();
+  if (totalSize <= maximumCacheSize)
+  {
+    return;
+  }
+  unsigned long long prunedCacheSize = static_cast<unsigned long long>(maximumCacheSize * PRUNED_SIZE_FRACTION);
+  std::sort(cacheFiles.begin(), cacheFiles.end(),
+    [](const CacheFile& file1, const CacheFile& file2) { return file1.ModifiedTime < file2.ModifiedTime; });
+  for (const CacheFile& cacheFile : cacheFiles)
+  {
+    if (totalSize <= prunedCacheSize)
+    {
+      break;
+    }
+    // Removal fails if the file has been removed by another process in the meantime, which is fine
+    vtksys::SystemTools::RemoveFile(cacheFile.Path);
+    totalSize -= cacheFile.Size;
+  }
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSegmentConversionCache::GetCacheKey(vtkSegment* segment, const std::string& sourceRepresentationName, const std::string& conversionDescription)
+{
+  if (!segment || GetCacheDirectory().empty())
+  {
+    return "";
+  }
+
+  // Only cache segments loaded from RT structure sets
+  std::string structureSetSopInstanceUid;
+  std::string roiNumber;
+  if ( !segment->GetTag(vtkSlicerRtCommon::DICOMRTIMPORT_STRUCTURE_SET_SOP_INSTANCE_UID_SEGMENT_TAG_NAME, structureSetSopInstanceUid)
+    || !segment->GetTag(vtkSlicerRtCommon::DICOMRTIMPORT_ROI_NUMBER_SEGMENT_TAG_NAME, roiNumber) )
+  {
+    return "";
+  }
+  vtkPolyData* sourcePolyData = vtkPolyData::SafeDownCast(segment->GetRepresentation(sourceRepresentationName));
+  if (!sourcePolyData || !sourcePolyData->GetPoints() || sourcePolyData->GetNumberOfPoints() == 0)
+  {
+    return ""; // Not worth caching
+  }
+
+  vtksysMD5* md5 = vtksysMD5_New();
+  vtksysMD5_Initialize(md5);
+  AppendToDigest(md5, CONVERSION_CACHE_VERSION);
+  AppendToDigest(md5, structureSetSopInstanceUid);
+  AppendToDigest(md5, roiNumber);
+  AppendToDigest(md5, conversionDescription);
+
+  // Source geometry
+  vtkDataArray* pointsArray = sourcePolyData->GetPoints()->GetData();
+  int pointsDataType = pointsArray->GetDataType();
+  AppendToDigest(md5, &pointsDataType, sizeof(int));
+  AppendToDigest(md5, pointsArray->GetVoidPointer(0),
+    static_cast<size_t>(pointsArray->GetNumberOfValues()) * pointsArray->GetDataTypeSize());
+  AppendCellsToDigest(md5, sourcePolyData->GetVerts());
+  AppendCellsToDigest(md5, sourcePolyData->GetLines());
+  AppendCellsToDigest(md5, sourcePolyData->GetPolys());
+
+  char digest[33] = { 0 };
+  vtksysMD5_FinalizeHex(md5, digest);
+  vtksysMD5_Delete(md5);
+  return std::string(digest, 32);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSegmentConversionCache::GetCacheFilePath(const std::string& cacheKey, const std::string& extension)
+{
+  std::string cacheDirectory = GetCacheDirectory();
+  if (cacheKey.empty() || cacheDirectory.empty())
+  {
+    return "";
+  }
+  return cacheDirectory + "/" + cacheKey + extension;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSegmentConversionCache::GetTemporaryFilePath(const std::string& filePath)
+{
+  // Entries may be written concurrently by other threads and by other application instances using the same database
+  static const int processId = vtksys::SystemInformation().GetProcessId();
+  std::stringstream temporaryFilePathStream;
+  temporaryFilePathStream << filePath << "." << processId << "." << std::this_thread::get_id()
+    << "." << NumberOfTemporaryFiles++ << ".tmp";
+  return temporaryFilePathStream.str();
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentConversionCache::OnEntryWritten()
+{
+  unsigned int numberOfWrittenEntries = ++NumberOfWrittenEntries;
+  if (numberOfWrittenEntries == 1 || numberOfWrittenEntries % PRUNE_INTERVAL == 0)
+  {
+    PruneCache();
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentConversionCache::ReadPolyData(const std::string& cacheKey, vtkPolyData* polyData)
+{
+  std::string filePath = GetCacheFilePath(cacheKey, ".vtp");
+  if (!polyData || filePath.empty() || !vtksys::SystemTools::FileExists(filePath, true))
+  {
+    return false;
+  }
+
+  vtkNew<vtkXMLPolyDataReader> reader;
+  reader->SetFileName(filePath.c_str());
+  reader->Update();
+  if (reader->GetErrorCode() != 0 || !reader->GetOutput())
+  {
+    // Corrupt entry, remove it so that it is replaced by the result of the conversion
+    vtksys::SystemTools::RemoveFile(filePath);
+    return false;
+  }
+  polyData->ShallowCopy(reader->GetOutput());
+
+  // Mark entry as recently used
+  vtksys::SystemTools::Touch(filePath, false);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentConversionCache::WritePolyData(const std::string& cacheKey, vtkPolyData* polyData)
+{
+  std::string filePath = GetCacheFilePath(cacheKey, ".vtp");
+  if (!polyData || filePath.empty())
+  {
+    return false;
+  }
+  vtksys::SystemTools::MakeDirectory(GetCacheDirectory());
+
+  // Write to a temporary file first so that concurrent readers never see a partially written entry
+  std::string temporaryFilePath = GetTemporaryFilePath(filePath);
+
+  vtkNew<vtkXMLPolyDataWriter> writer;
+  writer->SetFileName(temporaryFilePath.c_str());
+  writer->SetInputData(polyData);
+  writer->SetDataModeToAppended();
+  writer->EncodeAppendedDataOff();
+  writer->SetCompressorTypeToZLib();
+  if (!writer->Write() || !vtksys::SystemTools::RenameFile(temporaryFilePath, filePath))
+  {
+    vtksys::SystemTools::RemoveFile(temporaryFilePath);
+    return false;
+  }
+  OnEntryWritten();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentConversionCache::ReadOrientedImageData(const std::string& cacheKey, vtkOrientedImageData* imageData)
+{
+  std::string filePath = GetCacheFilePath(cacheKey, ".vti");
+  if (!imageData || filePath.empty() || !vtksys::SystemTools::FileExists(filePath, true))
+  {
+    return false;
+  }
+
+  vtkNew<vtkXMLImageDataReader> reader;
+  reader->SetFileName(filePath.c_str());
+  reader->Update();
+  vtkImageData* cachedImageData = reader->GetOutput();
+  vtkDoubleArray* directionsArray = (cachedImageData && cachedImageData->GetFieldData()
+    ? vtkDoubleArray::SafeDownCast(cachedImageData->GetFieldData()->GetArray(DIRECTIONS_ARRAY_NAME)) : nullptr);
+  if (reader->GetErrorCode() != 0 || !directionsArray || directionsArray->GetNumberOfValues() != 9)
+  {
+    // Corrupt entry, remove it so that it is replaced by the result of the conversion
+    vtksys::SystemTools::RemoveFile(filePath);
+    return false;
+  }
+
+  double directions[3][3] = { { 0.0 } };
+  for (int i = 0; i < 9; ++i)
+  {
+    directions[i / 3][i % 3] = directionsArray->GetValue(i);
+  }
+  cachedImageData->GetFieldData()->RemoveArray(DIRECTIONS_ARRAY_NAME);
+  imageData->ShallowCopy(cachedImageData);
+  imageData->SetDirections(directions);
+
+  // Mark entry as recently used
+  vtksys::SystemTools::Touch(filePath, false);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentConversionCache::WriteOrientedImageData(const std::string& cacheKey, vtkOrientedImageData* imageData)
+{
+  std::string filePath = GetCacheFilePath(cacheKey, ".vti");
+  if (!imageData || filePath.empty())
+  {
+    return false;
+  }
+  vtksys::SystemTools::MakeDirectory(GetCacheDirectory());
+
+  // Image data files do not store directions, so they are stored in a field data array
+  vtkNew<vtkImageData> imageDataToWrite;
+  imageDataToWrite->ShallowCopy(imageData);
+  double directions[3][3] = { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } };
+  imageData->GetDirections(directions);
+  vtkNew<vtkDoubleArray> directionsArray;
+  directionsArray->SetName(DIRECTIONS_ARRAY_NAME);
+  directionsArray->SetNumberOfValues(9);
+  for (int i = 0; i < 9; ++i)
+  {
+    directionsArray->SetValue(i, directions[i / 3][i % 3]);
+  }
+  vtkNew<vtkFieldData> fieldData;
+  fieldData->AddArray(directionsArray);
+  imageDataToWrite->SetFieldData(fieldData);
+
+  // Write to a temporary file first so that concurrent readers never see a partially written entry
+  std::string temporaryFilePath = GetTemporaryFilePath(filePath);
+
+  vtkNew<vtkXMLImageDataWriter> writer;
+  writer->SetFileName(temporaryFilePath.c_str());
+  writer->SetInputData(imageDataToWrite);
+  writer->SetDataModeToAppended();
+  writer->EncodeAppendedDataOff();
+  writer->SetCompressorTypeToZLib();
+  if (!writer->Write() || !vtksys::SystemTools::RenameFile(temporaryFilePath, filePath))
+  {
+    vtksys::SystemTools::RemoveFile(temporaryFilePath);
+    return false;
+  }
+  OnEntryWritten();
+  return true;
+}
@@ -0,0 +1,83 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSegmentConversionCache_h
+#define __vtkSegmentConversionCache_h
+
+#include "vtkSlicerDicomRtImportExportConversionRulesExport.h"
+
+// STD includes
+#include <string>
+
+class vtkOrientedImageData;
+class vtkPolyData;
+class vtkSegment;
+
+/// \ingroup DicomRtImportImportExportConversionRules
+/// \brief On-disk cache of converted representations of segments loaded from RT structure sets.
+///   Entries are addressed by a digest of the structure set SOP instance UID, the ROI number, the
+///   conversion rule with its parameters, and the source representation geometry itself, so modified
+///   contours never get a stale result. Poly data and labelmaps are stored as compressed binary VTK XML files.
+///   The total size of the cached files is limited, the least recently used entries are removed above the limit.
+///   The cache is disabled until a cache directory is set.
+class VTK_SLICER_DICOMRTIMPORTEXPORT_CONVERSIONRULES_EXPORT vtkSegmentConversionCache
+{
+public:
+  /// Set directory where the converted representations are stored. Empty string disables the cache.
+  static void SetCacheDirectory(const std::string& cacheDirectory);
+  /// Get directory where the converted representations are stored
+  static std::string GetCacheDirectory();
+
+  /// Set maximum total size of the cached files in bytes. 2 GB by default.
+  static void SetMaximumCacheSize(unsigned long long maximumCacheSize);
+  /// Get maximum total size of the cached files in bytes
+  static unsigned long long GetMaximumCacheSize();
+
+  /// Remove the least recently used entries if the total size of the cached files exceeds the maximum.
+  /// Called when the first entry is written to the cache directory, and then periodically as entries are written.
+  static void PruneCache();
+
+  /// Compute cache key for converting a segment.
+  /// \param segment Segment to convert. Only segments loaded from an RT structure set are cached.
+  /// \param sourceRepresentationName Name of the representation the conversion starts from
+  /// \param conversionDescription Name of the conversion rule and the values of all parameters affecting the result
+  /// \return Key of the cache entry, empty string if the conversion result is not to be cached
+  static std::string GetCacheKey(vtkSegment* segment, const std::string& sourceRepresentationName, const std::string& conversionDescription);
+
+  /// Read cached poly data representation
+  /// \return True if cached representation is found and read
+  static bool ReadPolyData(const std::string& cacheKey, vtkPolyData* polyData);
+  /// Store poly data representation in the cache
+  static bool WritePolyData(const std::string& cacheKey, vtkPolyData* polyData);
+
+  /// Read cached oriented image data representation
+  /// \return True if cached representation is found and read
+  static bool ReadOrientedImageData(const std::string& cacheKey, vtkOrientedImageData* imageData);
+  /// Store oriented image data representation in the cache
+  static bool WriteOrientedImageData(const std::string& cacheKey, vtkOrientedImageData* imageData);
+
+protected:
+  /// Get path of the file storing a cache entry
+  static std::string GetCacheFilePath(const std::string& cacheKey, const std::string& extension);
+
+  /// Get a path that is unique among threads and processes for writing a cache entry before renaming it to its final path
+  static std::string GetTemporaryFilePath(const std::string& filePath);
+
+  /// Count written entries and prune the cache on the first and then on every hundredth written entry
+  static void OnEntryWritten();
+};
+
+#endif // __vtkSegmentConversionCache_h
@@ -30,6 +30,7 @@
 #include "vtkRibbonModelToBinaryLabelmapConversionRule.h"
 #include "vtkPlanarContourToRibbonModelConversionRule.h"
 #include "vtkPlanarContourToClosedSurfaceConversionRule.h"
+#include "vtkPlanarContourToBinaryLabelmapConversionRule.h"
 #include "vtkClosedSurfaceToFractionalLabelmapConversionRule.h"
 #include "vtkFractionalLabelmapToClosedSurfaceConversionRule.h"
 
@@ -72,6 +73,8 @@
 #include <dcmtk/dcmdata/dcfilefo.h>
 #include <dcmtk/dcmdata/dcdeftag.h>
 #include <dcmtk/dcmdata/dcdatset.h>
+#include <dcmtk/dcmdata/dcmetinf.h>
+#include <dcmtk/dcmdata/dcsequen.h>
 #include <dcmtk/dcmdata/dcuid.h>
 #include <dcmtk/ofstd/ofcond.h>
 #include <dcmtk/ofstd/ofstring.h>
@@ -79,7 +82,6 @@
 #include <dcmtk/dcmrt/drtdose.h>
 #include <dcmtk/dcmrt/drtimage.h>
 #include <dcmtk/dcmrt/drtplan.h>
-#include <dcmtk/dcmrt/drtstrct.h>
 
 // MRML includes
 #include <vtkMRMLColorTableNode.h>
@@ -96,6 +98,7 @@
 #include <vtkMRMLTableNode.h>
 #include <vtkMRMLSequenceNode.h>
 #include <vtkMRMLLinearTransformNode.h>
+#include <vtkObserverManager.h>
 
 // Sequences inludes
 #include <vtkMRMLSequenceBrowserNode.h>
@@ -107,18 +110,21 @@
 // VTK includes
 #include <vtkCutter.h>
 #include <vtkGeneralTransform.h>
-#include <vtkImageCast.h>
 #include <vtkImageData.h>
 #include <vtkLookupTable.h>
 #include <vtkObjectFactory.h>
 #include <vtkPlane.h>
+#include <vtkPointData.h>
 #include <vtkPolyData.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartPointer.h>
 #include <vtkStringArray.h>
 #include <vtkStripper.h>
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkTable.h>
 #include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtksys/SystemTools.hxx>
 
 // ITK includes
 #include <itkImage.h>
@@ -130,6 +136,13 @@
 #include "vtkSlicerDICOMLoadable.h"
 #include "vtkSlicerDICOMExportable.h"
 
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerDicomRtImportExportModuleLogic);
 
@@ -139,6 +152,76 @@ namespace
   {
     return ptr ? ptr : "";
   }
+
+  /// Name of the examine cache file, stored in the DICOM database directory
+  const std::string EXAMINE_CACHE_FILENAME = "/SlicerRtExamineCache.txt";
+  /// First line of the examine cache file. Needs to be changed if the content of the cache entries changes.
+  const std::string EXAMINE_CACHE_HEADER = "SlicerRT DICOM examine cache v2";
+  /// Maximum number of examine results kept in the cache. The results added the longest time ago are removed above this.
+  const size_t EXAMINE_CACHE_MAXIMUM_SIZE = 50000;
+
+  /// Element values longer than this are not read from the file during examination.
+  /// They are loaded on demand if accessed, which is not the case for the examined attributes.
+  const Uint32 EXAMINE_MAX_READ_LENGTH = 4096;
+
+  /// Determine if objects of a SOP class are examined as loadable RT objects
+  bool IsSupportedRtSopClass(const OFString& sopClass)
+  {
+    /* Not yet supported
+    UID_RTTreatmentSummaryRecordStorage
+    UID_RTIonBeamsTreatmentRecordStorage
+    */
+    return ( sopClass == UID_RTDoseStorage || sopClass == UID_RTPlanStorage || sopClass == UID_RTIonPlanStorage
+      || sopClass == UID_RTStructureSetStorage || sopClass == UID_RTImageStorage );
+  }
+
+  /// Replace characters that are used as separators in the examine cache file
+  std::string SanitizeExamineCacheField(const std::string& field)
+  {
+    std::string sanitized(field);
+    for (char& c : sanitized)
+    {
+      if (c == '\t' || c == '\n' || c == '\r' || c == '\\')
+      {
+        c = ' ';
+      }
+    }
+    return sanitized;
+  }
+
+  /// Convert stored dose grid values to float and apply the dose grid scaling in one pass.
+  /// Voxel ranges are independent, so they are processed concurrently.
+  template <class T>
+  class DoseGridScalingFunctor
+  {
+  public:
+    DoseGridScalingFunctor(const T* storedValues, float* doseValues, double doseGridScaling)
+      : StoredValues(storedValues)
+      , DoseValues(doseValues)
+      , DoseGridScaling(doseGridScaling)
+    {
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+      for (vtkIdType index = begin; index < end; ++index)
+      {
+        this->DoseValues[index] = static_cast<float>(static_cast<float>(this->StoredValues[index]) * this->DoseGridScaling);
+      }
+    }
+
+  private:
+    const T* StoredValues;
+    float* DoseValues;
+    double DoseGridScaling;
+  };
+
+  template <class T>
+  void ApplyDoseGridScaling(const T* storedValues, float* doseValues, vtkIdType numberOfValues, double doseGridScaling)
+  {
+    DoseGridScalingFunctor<T> scalingFunctor(storedValues, doseValues, doseGridScaling);
+    vtkSMPTools::For(0, numberOfValues, scalingFunctor);
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -149,7 +232,8 @@ public:
   ~vtkInternal() = default;
 
   /// Examine RT Dose dataset and assemble name and referenced SOP instances
-  void ExamineRtDoseDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
+  /// \return False if the name is not final, i.e. the referenced plan is not in the DICOM database yet
+  bool ExamineRtDoseDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
 
   /// Examine RT Plan dataset and assemble name and referenced SOP instances
   void ExamineRtPlanDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
@@ -163,6 +247,50 @@ public:
   /// Examine RT Image dataset and assemble name and referenced SOP instances
   void ExamineRtImageDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
 
+  /// Result of examining a single file
+  struct ExamineResult
+  {
+    std::string FilePath;
+    unsigned long FileSize{0};
+    long ModifiedTime{0};
+    std::string SOPInstanceUID;
+    /// Name of the loadable. Empty if the file is not a loadable RT object
+    std::string Name;
+    std::vector<std::string> ReferencedSOPInstanceUIDs;
+  };
+
+  /// Examine result in the cache
+  struct ExamineCacheEntry
+  {
+    ExamineResult Result;
+    /// Number of results added to the cache before this one. Used for removing the oldest results.
+    unsigned long long AddedIndex{0};
+  };
+
+  /// Examine a file by parsing its metadata only. Bulk data (pixel data, contour data) is not read.
+  /// \return False if the result should not be cached
+  bool ExamineFile(const std::string& filePath, ExamineResult& result);
+
+  /// Get examine result from the cache. Results are only valid for the same file path, size and modification time.
+  /// \return True if a valid cached result is found
+  bool GetCachedExamineResult(const std::string& filePath, ExamineResult& result);
+
+  /// Add examine result to the cache. It is written to the cache file by \sa SaveExamineCache
+  void AddCachedExamineResult(const ExamineResult& result);
+
+  /// Add examine result to the in-memory cache and remove the oldest results if the cache is full
+  void AddExamineCacheEntry(const ExamineResult& result);
+
+  /// Make sure the examine cache of the current DICOM database is loaded
+  void LoadExamineCache();
+
+  /// Append the results added since the last save to the examine cache file in the DICOM database directory.
+  /// The whole file is only rewritten if it contains results that have been removed from the cache.
+  void SaveExamineCache();
+
+  /// Write one examine result as a line of the examine cache file
+  static void WriteExamineCacheLine(std::ostream& stream, const ExamineResult& result);
+
   /// Load RT Dose and related objects into the MRML scene
   /// \return Success flag
   bool LoadRtDose(vtkSlicerDicomRtReader* rtReader, vtkSlicerDICOMLoadable* loadable);
@@ -186,6 +314,11 @@ public:
     vtkMRMLLinearTransformNode* proxyTransformNode, 
     vtkMRMLTableNode* mlcTableNode, vtkMRMLTableNode* scanSpotTableNode);
 
+  /// Load dynamic beam as a single beam node with a control point table (called from \sa LoadExternalBeamPlan
+  /// if \sa CompactDynamicBeamLoading is on). The beam is set to the first control point.
+  vtkMRMLRTBeamNode* LoadDynamicBeamControlPoints(vtkSlicerDicomRtReader* rtReader, const char* seriesName,
+    vtkMRMLRTPlanNode* planNode, int beamIndex);
+
   /// Load brachytherapy plan (called from \sa LoadRtPlan)
   bool LoadBrachyPlan(vtkSlicerDicomRtReader* rtReader, const char* seriesName, vtkMRMLRTPlanNode* planNode);
 
@@ -226,6 +359,22 @@ public:
 
 public:
   vtkSlicerDicomRtImportExportModuleLogic* External;
+
+  /// Cached examine results of RT objects by file path. Files that are not loadable RT objects are not cached.
+  std::map<std::string, ExamineCacheEntry> ExamineCache;
+  /// Number of results added to the cache since it was loaded
+  unsigned long long NumberOfAddedExamineResults{0};
+  /// Results added since the cache file was last written
+  std::vector<ExamineResult> UnsavedExamineResults;
+  /// Path of the file the examine cache was loaded from. Empty if cache has not been loaded.
+  std::string ExamineCacheFilePath;
+  /// Set if the cache file contains results that are not in the cache anymore, or has not been created yet
+  bool ExamineCacheFileOutdated{false};
+
+  /// Contours of segments loaded in lazy mode that have not been added to the segmentation yet, by segment ID
+  std::map<vtkMRMLSegmentationNode*, std::map<std::string, vtkSmartPointer<vtkPolyData> > > DeferredSegmentContours;
+  /// Set while deferred contours are added to a segmentation
+  bool LoadingDeferredSegmentContours{false};
 };
 
 //----------------------------------------------------------------------------
@@ -238,11 +387,11 @@ vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::vtkInternal(vtkSlicerDicom
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtDoseDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs)
+bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtDoseDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs)
 {
   if (!dataset)
   {
-    return;
+    return true;
   }
 
   // Assemble name
@@ -290,9 +439,11 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtDoseDataset(
   //TODO: Uncomment this line when figured out the reason for the crash, see https://github.com/SlicerRt/SlicerRT/issues/135
   QString rtPlanLabelTag("300a,0002");
   QString rtPlanFileName = dicomDatabase->fileForInstance(referencedSOPInstanceUID.c_str());
+  bool nameFinal = referencedSOPInstanceUID.empty();
   if (!rtPlanFileName.isEmpty())
   {
    name += OFString(": ") + OFString(dicomDatabase->fileValue(rtPlanFileName,rtPlanLabelTag).toUtf8().constData());
+   nameFinal = true;
   }
 
   // Close and delete DICOM database
@@ -300,6 +451,8 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtDoseDataset(
   delete dicomDatabase;
   QSqlDatabase::removeDatabase(vtkSlicerDicomRtReader::DICOMREADER_DICOM_CONNECTION_NAME.c_str());
   QSqlDatabase::removeDatabase(QString(vtkSlicerDicomRtReader::DICOMREADER_DICOM_CONNECTION_NAME.c_str()) + "TagCache");
+
+  return nameFinal;
 }
 
 //-----------------------------------------------------------------------------
@@ -355,98 +508,32 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtStructureSet
     name += ": " + structLabel;
   }
 
-  // Get referenced image instance UIDs
-  OFString referencedSOPInstanceUID("");
-  DRTStructureSetIOD rtStructureSetObject;
-  if (rtStructureSetObject.read(*dataset).good())
+  // Get referenced image instance UIDs from the first referenced series of the first referenced frame of reference.
+  // The items are accessed directly in the dataset instead of reading the structure set IOD, because that would
+  // parse the whole ROI contour sequence, which is not even read during examination.
+  DcmItem* referencedFrameOfReferenceItem = nullptr;
+  DcmItem* referencedStudyItem = nullptr;
+  DcmItem* referencedSeriesItem = nullptr;
+  if ( dataset->findAndGetSequenceItem(DCM_ReferencedFrameOfReferenceSequence, referencedFrameOfReferenceItem, 0).bad()
+    || referencedFrameOfReferenceItem->findAndGetSequenceItem(DCM_RTReferencedStudySequence, referencedStudyItem, 0).bad()
+    || referencedStudyItem->findAndGetSequenceItem(DCM_RTReferencedSeriesSequence, referencedSeriesItem, 0).bad() )
   {
-    DRTROIContourSequence &rtROIContourSequenceObject = rtStructureSetObject.getROIContourSequence();
-    if (rtROIContourSequenceObject.gotoFirstItem().good())
-    {
-      do // For all ROIs
-      {
-        DRTROIContourSequence::Item &currentRoiObject = rtROIContourSequenceObject.getCurrentItem();
-        if (currentRoiObject.isValid())
-        {
-          DRTContourSequence &rtContourSequenceObject = currentRoiObject.getContourSequence();
-          if (rtContourSequenceObject.gotoFirstItem().good())
-          {
-            do // For all contours
-            {
-              DRTContourSequence::Item &contourItem = rtContourSequenceObject.getCurrentItem();
-              if (!contourItem.isValid())
-              {
-                DRTContourImageSequence &rtContourImageSequenceObject = contourItem.getContourImageSequence();
-                if (rtContourImageSequenceObject.gotoFirstItem().good())
-                {
-                  DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequenceObject.getCurrentItem();
-                  if (rtContourImageSequenceItem.isValid())
-                  {
-                    OFString referencedSOPInstanceUID("");
-                    if (rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID).good())
-                    {
-                      referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
-                    }
-                  }
-                }
-              }
-            } // For all contours
-            while (rtContourSequenceObject.gotoNextItem().good());
-          }
-        }
-      } // For all ROIs
-      while (rtROIContourSequenceObject.gotoNextItem().good());
-    } // End ROIContourSequence
-
-    // If the above tags do not store the referenced instance UIDs, then look at the other possible place
-    if (referencedSOPInstanceUIDs.empty())
+    return;
+  }
+  DcmSequenceOfItems* contourImageSequence = nullptr;
+  if (referencedSeriesItem->findAndGetSequence(DCM_ContourImageSequence, contourImageSequence).bad() || !contourImageSequence)
+  {
+    return;
+  }
+  for (unsigned long itemIndex=0; itemIndex<contourImageSequence->card(); ++itemIndex)
+  {
+    OFString referencedSOPInstanceUID("");
+    if ( contourImageSequence->getItem(itemIndex)->findAndGetOFString(DCM_ReferencedSOPInstanceUID, referencedSOPInstanceUID).good()
+      && !referencedSOPInstanceUID.empty() )
     {
-      DRTReferencedFrameOfReferenceSequence &rtReferencedFrameOfReferenceSequenceObject = rtStructureSetObject.getReferencedFrameOfReferenceSequence();
-      if (rtReferencedFrameOfReferenceSequenceObject.gotoFirstItem().good())
-      {
-        DRTReferencedFrameOfReferenceSequence::Item &currentReferencedFrameOfReferenceSequenceItem = rtReferencedFrameOfReferenceSequenceObject.getCurrentItem();
-        if (currentReferencedFrameOfReferenceSequenceItem.isValid())
-        {
-          DRTRTReferencedStudySequence &rtReferencedStudySequenceObject = currentReferencedFrameOfReferenceSequenceItem.getRTReferencedStudySequence();
-          if (rtReferencedStudySequenceObject.gotoFirstItem().good())
-          {
-            DRTRTReferencedStudySequence::Item &rtReferencedStudySequenceItem = rtReferencedStudySequenceObject.getCurrentItem();
-            if (rtReferencedStudySequenceItem.isValid())
-            {
-              DRTRTReferencedSeriesSequence &rtReferencedSeriesSequenceObject = rtReferencedStudySequenceItem.getRTReferencedSeriesSequence();
-              if (rtReferencedSeriesSequenceObject.gotoFirstItem().good())
-              {
-                if (rtReferencedSeriesSequenceObject.gotoFirstItem().good())
-                {
-                  DRTRTReferencedSeriesSequence::Item &rtReferencedSeriesSequenceItem = rtReferencedSeriesSequenceObject.getCurrentItem();
-                  if (rtReferencedSeriesSequenceItem.isValid())
-                  {
-                    DRTContourImageSequence &rtContourImageSequenceObject = rtReferencedSeriesSequenceItem.getContourImageSequence();
-                    if (rtContourImageSequenceObject.gotoFirstItem().good())
-                    {
-                      do
-                      {
-                        DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequenceObject.getCurrentItem();
-                        if (rtContourImageSequenceItem.isValid())
-                        {
-                          OFString referencedSOPInstanceUID("");
-                          if (rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID).good())
-                          {
-                            referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
-                          }
-                        }
-                      } // For all contours
-                      while (rtContourImageSequenceObject.gotoNextItem().good());
-                    }
-                  }
-                }
-              }
-            }
-          }
-        }
-      }
-    } // End DRTReferencedFrameOfReferenceSequence
-  } // End finding referenced instance UIDs
+      referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
+    }
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -483,6 +570,328 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtImageDataset
   }
 }
 
+//-----------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineFile(const std::string& filePath, ExamineResult& result)
+{
+  result = ExamineResult();
+  result.FilePath = filePath;
+  result.FileSize = vtksys::SystemTools::FileLength(filePath);
+  result.ModifiedTime = vtksys::SystemTools::ModifiedTime(filePath);
+
+  // Only RT objects are cached, so other objects (typically image slices) are rejected based on the
+  // file meta information, which is much faster than parsing the dataset
+  DcmMetaInfo metaInfo;
+  OFString mediaStorageSopClass;
+  if ( metaInfo.loadFile(filePath.c_str()).good()
+    && metaInfo.findAndGetOFString(DCM_MediaStorageSOPClassUID, mediaStorageSopClass).good()
+    && !mediaStorageSopClass.empty() && !IsSupportedRtSopClass(mediaStorageSopClass) )
+  {
+    return true; // Not an RT file
+  }
+
+  // Parse metadata only. Structure sets are examined based on the attributes preceding the ROI contour sequence,
+  // and the other objects based on the attributes preceding the pixel data. Large values are not read either.
+  DcmFileFormat fileformat;
+  OFCondition condition = fileformat.loadFileUntilTag(filePath.c_str(), EXS_Unknown, EGL_noChange,
+    EXAMINE_MAX_READ_LENGTH, ERM_autoDetect, DCM_ROIContourSequence);
+  if (!condition.good())
+  {
+    return true; // Failed to parse this file, skip it
+  }
+
+  // Check SOP Class UID for one of the supported RT objects
+  DcmDataset* dataset = fileformat.getDataset();
+  OFString sopClass;
+  if (!dataset->findAndGetOFString(DCM_SOPClassUID, sopClass).good() || sopClass.empty())
+  {
+    return true; // Failed to parse this file, skip it
+  }
+  if (!IsSupportedRtSopClass(sopClass))
+  {
+    return true; // Not an RT file
+  }
+  if (sopClass != UID_RTStructureSetStorage)
+  {
+    // Attributes needed for the other objects may follow the ROI contour sequence tag
+    fileformat.clear();
+    condition = fileformat.loadFileUntilTag(filePath.c_str(), EXS_Unknown, EGL_noChange,
+      EXAMINE_MAX_READ_LENGTH, ERM_autoDetect, DCM_PixelData);
+    if (!condition.good())
+    {
+      return true;
+    }
+    dataset = fileformat.getDataset();
+  }
+
+  OFString sopInstanceUID;
+  dataset->findAndGetOFString(DCM_SOPInstanceUID, sopInstanceUID);
+  result.SOPInstanceUID = sopInstanceUID.c_str();
+
+  // DICOM parsing is successful, now assemble name and get references
+  OFString name("");
+  OFString seriesNumber("");
+  std::vector<OFString> referencedSOPInstanceUIDs;
+  dataset->findAndGetOFString(DCM_SeriesNumber, seriesNumber);
+  if (!seriesNumber.empty())
+  {
+    name += seriesNumber + ": ";
+  }
+
+  bool cacheable = true;
+  // RTDose
+  if (sopClass == UID_RTDoseStorage)
+  {
+    cacheable = this->ExamineRtDoseDataset(dataset, name, referencedSOPInstanceUIDs);
+  }
+  // RTPlan
+  else if (sopClass == UID_RTPlanStorage)
+  {
+    this->ExamineRtPlanDataset(dataset, name, referencedSOPInstanceUIDs);
+  }
+  // RTIonPlan
+  else if (sopClass == UID_RTIonPlanStorage)
+  {
+    this->ExamineRtPlanDataset(dataset, name, referencedSOPInstanceUIDs);
+  }
+  // RTStructureSet
+  else if (sopClass == UID_RTStructureSetStorage)
+  {
+    this->ExamineRtStructureSetDataset(dataset, name, referencedSOPInstanceUIDs);
+  }
+  // RTImage
+  else if (sopClass == UID_RTImageStorage)
+  {
+    this->ExamineRtImageDataset(dataset, name, referencedSOPInstanceUIDs);
+  }
+
+  result.Name = name.c_str();
+  for (const OFString& referencedSOPInstanceUID : referencedSOPInstanceUIDs)
+  {
+    result.ReferencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID.c_str());
+  }
+  return cacheable;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::GetCachedExamineResult(const std::string& filePath, ExamineResult& result)
+{
+  std::map<std::string, ExamineCacheEntry>::iterator cacheIt = this->ExamineCache.find(filePath);
+  if (cacheIt == this->ExamineCache.end())
+  {
+    return false;
+  }
+
+  // Removed files do not match either, so existence of the files is only checked here and not when loading the cache
+  if ( cacheIt->second.Result.FileSize == vtksys::SystemTools::FileLength(filePath)
+    && cacheIt->second.Result.ModifiedTime == vtksys::SystemTools::ModifiedTime(filePath) )
+  {
+    result = cacheIt->second.Result;
+    return true;
+  }
+
+  // File has changed or has been removed since it was examined
+  this->ExamineCache.erase(cacheIt);
+  this->ExamineCacheFileOutdated = true;
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::AddCachedExamineResult(const ExamineResult& result)
+{
+  this->AddExamineCacheEntry(result);
+  this->UnsavedExamineResults.push_back(result);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::AddExamineCacheEntry(const ExamineResult& result)
+{
+  ExamineCacheEntry& entry = this->ExamineCache[result.FilePath];
+  if (!entry.Result.FilePath.empty())
+  {
+    // Replaced result remains in the cache file
+    this->ExamineCacheFileOutdated = true;
+  }
+  entry.Result = result;
+  entry.AddedIndex = this->NumberOfAddedExamineResults++;
+
+  if (this->ExamineCache.size() <= EXAMINE_CACHE_MAXIMUM_SIZE)
+  {
+    return;
+  }
+
+  // Remove the oldest tenth of the results, so that this is not needed again for every added result
+  size_t numberOfRemovedResults = this->ExamineCache.size() - EXAMINE_CACHE_MAXIMUM_SIZE * 9 / 10;
+  std::vector<unsigned long long> addedIndices;
+  addedIndices.reserve(this->ExamineCache.size());
+  for (const std::pair<const std::string, ExamineCacheEntry>& cacheItem : this->ExamineCache)
+  {
+    addedIndices.push_back(cacheItem.second.AddedIndex);
+  }
+  std::nth_element(addedIndices.begin(), addedIndices.begin() + (numberOfRemovedResults - 1), addedIndices.end());
+  unsigned long long lastRemovedAddedIndex = addedIndices[numberOfRemovedResults - 1];
+  for (std::map<std::string, ExamineCacheEntry>::iterator cacheIt = this->ExamineCache.begin(); cacheIt != this->ExamineCache.end(); )
+  {
+    if (cacheIt->second.AddedIndex <= lastRemovedAddedIndex)
+    {
+      cacheIt = this->ExamineCache.erase(cacheIt);
+    }
+    else
+    {
+      ++cacheIt;
+    }
+  }
+  this->ExamineCacheFileOutdated = true;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::WriteExamineCacheLine(std::ostream& stream, const ExamineResult& result)
+{
+  stream << SanitizeExamineCacheField(result.FilePath) << "\t" << result.FileSize << "\t" << result.ModifiedTime << "\t"
+    << SanitizeExamineCacheField(result.SOPInstanceUID) << "\t" << SanitizeExamineCacheField(result.Name) << "\t";
+  for (size_t uidIndex=0; uidIndex<result.ReferencedSOPInstanceUIDs.size(); ++uidIndex)
+  {
+    stream << (uidIndex > 0 ? "\\" : "") << SanitizeExamineCacheField(result.ReferencedSOPInstanceUIDs[uidIndex]);
+  }
+  stream << "\n";
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadExamineCache()
+{
+  // The cache is stored with the DICOM database, so that it is discarded together with it
+  QSettings settings;
+  QString databaseDirectory = settings.value("DatabaseDirectory").toString();
+  std::string cacheFilePath;
+  if (!databaseDirectory.isEmpty())
+  {
+    cacheFilePath = std::string(databaseDirectory.toUtf8().constData()) + EXAMINE_CACHE_FILENAME;
+  }
+  if (!this->ExamineCacheFilePath.empty() && cacheFilePath == this->ExamineCacheFilePath)
+  {
+    return; // Already loaded
+  }
+
+  this->ExamineCache.clear();
+  this->NumberOfAddedExamineResults = 0;
+  this->UnsavedExamineResults.clear();
+  this->ExamineCacheFilePath = cacheFilePath;
+  this->ExamineCacheFileOutdated = false;
+  if (cacheFilePath.empty())
+  {
+    return;
+  }
+
+  std::ifstream cacheFile(cacheFilePath.c_str());
+  std::string line;
+  if (!cacheFile.is_open() || !std::getline(cacheFile, line) || line != EXAMINE_CACHE_HEADER)
+  {
+    // No cache yet or cache of a different version
+    this->ExamineCacheFileOutdated = true;
+    return;
+  }
+  // One result per line, fields separated by tabs: file path, file size, modification time,
+  // SOP instance UID, loadable name, referenced SOP instance UIDs separated by backslashes.
+  // Results are appended to the file, so a later line replaces an earlier one with the same file path.
+  while (std::getline(cacheFile, line))
+  {
+    std::vector<std::string> fields;
+    std::stringstream lineStream(line);
+    std::string field;
+    while (std::getline(lineStream, field, '\t'))
+    {
+      fields.push_back(field);
+    }
+    if (fields.size() < 5 || fields[0].empty() || fields[4].empty())
+    {
+      // Invalid line (e.g. partially written when the application was terminated)
+      this->ExamineCacheFileOutdated = true;
+      continue;
+    }
+    ExamineResult result;
+    result.FilePath = fields[0];
+    result.FileSize = std::strtoul(fields[1].c_str(), nullptr, 10);
+    result.ModifiedTime = std::strtol(fields[2].c_str(), nullptr, 10);
+    result.SOPInstanceUID = fields[3];
+    result.Name = fields[4];
+    if (fields.size() > 5)
+    {
+      std::stringstream uidStream(fields[5]);
+      std::string uid;
+      while (std::getline(uidStream, uid, '\\'))
+      {
+        if (!uid.empty())
+        {
+          result.ReferencedSOPInstanceUIDs.push_back(uid);
+        }
+      }
+    }
+    this->AddExamineCacheEntry(result);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::SaveExamineCache()
+{
+  if (this->ExamineCacheFilePath.empty())
+  {
+    return;
+  }
+
+  if (!this->ExamineCacheFileOutdated)
+  {
+    // Append new results only
+    if (this->UnsavedExamineResults.empty())
+    {
+      return;
+    }
+    std::ofstream cacheFile(this->ExamineCacheFilePath.c_str(), std::ios::out | std::ios::app);
+    if (!cacheFile.is_open())
+    {
+      vtkWarningWithObjectMacro(this->External, "SaveExamineCache: Failed to write examine cache file " << this->ExamineCacheFilePath);
+      return;
+    }
+    for (const ExamineResult& result : this->UnsavedExamineResults)
+    {
+      WriteExamineCacheLine(cacheFile, result);
+    }
+    this->UnsavedExamineResults.clear();
+    return;
+  }
+
+  // Rewrite the whole file, in the order the results were added so that the oldest ones are removed first
+  // when the cache is full. Write to a temporary file first so that an interrupted write does not corrupt the cache.
+  std::vector<const ExamineCacheEntry*> entries;
+  entries.reserve(this->ExamineCache.size());
+  for (const std::pair<const std::string, ExamineCacheEntry>& cacheItem : this->ExamineCache)
+  {
+    entries.push_back(&cacheItem.second);
+  }
+  std::sort(entries.begin(), entries.end(),
+    [](const ExamineCacheEntry* entry1, const ExamineCacheEntry* entry2) { return entry1->AddedIndex < entry2->AddedIndex; });
+  std::string temporaryFilePath = this->ExamineCacheFilePath + ".tmp";
+  {
+    std::ofstream cacheFile(temporaryFilePath.c_str(), std::ios::out | std::ios::trunc);
+    if (!cacheFile.is_open())
+    {
+      vtkWarningWithObjectMacro(this->External, "SaveExamineCache: Failed to write examine cache file " << temporaryFilePath);
+      return;
+    }
+    cacheFile << EXAMINE_CACHE_HEADER << "\n";
+    for (const ExamineCacheEntry* entry : entries)
+    {
+      WriteExamineCacheLine(cacheFile, entry->Result);
+    }
+  }
+  if (!vtksys::SystemTools::RenameFile(temporaryFilePath, this->ExamineCacheFilePath))
+  {
+    vtkWarningWithObjectMacro(this->External, "SaveExamineCache: Failed to replace examine cache file " << this->ExamineCacheFilePath);
+    vtksys::SystemTools::RemoveFile(temporaryFilePath);
+    return;
+  }
+  this->UnsavedExamineResults.clear();
+  this->ExamineCacheFileOutdated = false;
+}
+
 //---------------------------------------------------------------------------
 bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtDose(vtkSlicerDicomRtReader* rtReader, vtkSlicerDICOMLoadable* loadable)
 {
@@ -528,21 +937,25 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtDose(vtkSlicerD
   }
   double doseGridScaling = vtkVariant(rtReader->GetDoseGridScaling()).ToDouble();
 
-  vtkSmartPointer<vtkImageData> floatVolumeData = vtkSmartPointer<vtkImageData>::New();
-
-  vtkSmartPointer<vtkImageCast> imageCast = vtkSmartPointer<vtkImageCast>::New();
-  imageCast->SetInputData(volumeNode->GetImageData());
-  imageCast->SetOutputScalarTypeToFloat();
-  imageCast->Update();
-  floatVolumeData->DeepCopy(imageCast->GetOutput());
-
-  float value = 0.0;
-  float* floatPtr = (float*)floatVolumeData->GetScalarPointer();
-  for (long i=0; i<floatVolumeData->GetNumberOfPoints(); ++i)
+  // Convert stored values to scaled float dose values in a single multi-threaded pass
+  // directly into the final buffer, without intermediate cast image
+  vtkImageData* storedVolumeData = volumeNode->GetImageData();
+  if (!storedVolumeData || !storedVolumeData->GetPointData()->GetScalars())
   {
-    value = (*floatPtr) * doseGridScaling;
-    (*floatPtr) = value;
-    ++floatPtr;
+    vtkErrorWithObjectMacro(this->External, "LoadRtDose: No pixel data found in dose volume " << volumeNode->GetName());
+    return false;
+  }
+  vtkSmartPointer<vtkImageData> floatVolumeData = vtkSmartPointer<vtkImageData>::New();
+  floatVolumeData->CopyStructure(storedVolumeData);
+  floatVolumeData->AllocateScalars(VTK_FLOAT, storedVolumeData->GetNumberOfScalarComponents());
+  vtkIdType numberOfValues = storedVolumeData->GetNumberOfPoints() * storedVolumeData->GetNumberOfScalarComponents();
+  float* doseValues = static_cast<float*>(floatVolumeData->GetScalarPointer());
+  switch (storedVolumeData->GetScalarType())
+  {
+    vtkTemplateMacro(ApplyDoseGridScaling(static_cast<const VTK_TT*>(storedVolumeData->GetScalarPointer()), doseValues, numberOfValues, doseGridScaling));
+    default:
+      vtkErrorWithObjectMacro(this->External, "LoadRtDose: Unsupported scalar type in dose volume " << volumeNode->GetName());
+      return false;
   }
 
   volumeNode->SetAndObserveImageData(floatVolumeData);
@@ -819,7 +1232,11 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadExternalBeamPlan(
     {
       ionBeamNode = vtkMRMLRTIonBeamNode::SafeDownCast(beamNode);
     }
-    else if (!singleBeam && this->LoadDynamicBeamSequence(rtReader, seriesName, 
+    else if (!singleBeam && this->External->CompactDynamicBeamLoading
+      && (beamNode = this->LoadDynamicBeamControlPoints(rtReader, seriesName, planNode, beamIndex)))
+    {
+    }
+    else if (!singleBeam && !this->External->CompactDynamicBeamLoading && this->LoadDynamicBeamSequence(rtReader, seriesName, 
       planNode, beamIndex, beamNode, beamTransformNode, mlcTableNode, scanSpotTableNode))
     {
     }
@@ -945,15 +1362,20 @@ vtkMRMLRTBeamNode* vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadSta
     vtkDebugWithObjectMacro(this->External, "LoadStaticBeam: MLC data unavailable");
   }
 
-  // Check Scan Spot parameters of modulated ion beam
+  // Check Scan Spot parameters of modulated ion beam.
+  // The spots are referenced in the reader and copied into the table columns once the table is observed.
   scanSpotTableNode = nullptr;
+  const float* scanSpotPositionMap = nullptr;
+  const float* scanSpotMetersetWeights = nullptr;
+  std::string scanSpotTuneId;
+  unsigned int numberOfScanSpots = 0;
   if (ionBeamNode)
   {
-    std::vector<float> positions, weights;
-    bool result = rtReader->GetBeamControlPointScanSpotParameters(dicomBeamNumber, 0, positions, weights);
-    if (result)
+    numberOfScanSpots = rtReader->GetBeamControlPointScanSpots(dicomBeamNumber, 0,
+      scanSpotPositionMap, scanSpotMetersetWeights, scanSpotTuneId);
+    if (numberOfScanSpots)
     {
-      scanSpotTableNode = CreateScanSpotTableNode("ScanSpot_PositionMap_MetersetWeights", positions, weights);
+      scanSpotTableNode = CreateScanSpotTableNode("ScanSpot_PositionMap_MetersetWeights", std::vector<float>(), std::vector<float>());
     }
     else
     {
@@ -981,6 +1403,8 @@ vtkMRMLRTBeamNode* vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadSta
     if (scanSpotTableNode)
     {
       ionBeamNode->SetAndObserveScanSpotTableNode(scanSpotTableNode);
+      ionBeamNode->AddScanSpotEnergyLayer(rtReader->GetBeamControlPointNominalBeamEnergy(dicomBeamNumber, 0),
+        scanSpotTuneId, numberOfScanSpots, scanSpotPositionMap, scanSpotMetersetWeights);
     }
   }
 
@@ -1026,6 +1450,162 @@ vtkMRMLRTBeamNode* vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadSta
   return beamNode;
 }
 
+//---------------------------------------------------------------------------
+vtkMRMLRTBeamNode* vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadDynamicBeamControlPoints(
+  vtkSlicerDicomRtReader* rtReader, const char* seriesName, vtkMRMLRTPlanNode* planNode, int beamIndex)
+{
+  vtkMRMLScene* scene = planNode->GetScene();
+  vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(scene);
+  if (!shNode)
+  {
+    vtkErrorWithObjectMacro(this->External, "LoadDynamicBeamControlPoints: Failed to access subject hierarchy node");
+    return nullptr;
+  }
+
+  // Create the beam with the parameters of the first control point, including MLC table, plan isocenter and subject hierarchy
+  vtkMRMLRTBeamNode* beamNode = this->LoadStaticBeam(rtReader, seriesName, planNode, beamIndex, nullptr, nullptr);
+  if (!beamNode)
+  {
+    return nullptr;
+  }
+
+  unsigned int dicomBeamNumber = rtReader->GetBeamNumberForIndex(beamIndex);
+  const char* beamName = rtReader->GetBeamName(dicomBeamNumber);
+  const char* treatmentDeliveryType = rtReader->GetBeamTreatmentDeliveryType(dicomBeamNumber);
+  unsigned int numberOfControlPoints = rtReader->GetBeamNumberOfControlPoints(dicomBeamNumber);
+
+  std::ostringstream nameStream;
+  nameStream << beamName;
+  if (treatmentDeliveryType)
+  {
+    nameStream << " [" << treatmentDeliveryType << "]";
+  }
+  std::string beamNodeName = nameStream.str();
+  beamNode->SetName(beamNodeName.c_str());
+
+  // Fill the control point parameters column by column into contiguous arrays
+  vtkNew<vtkMRMLTableNode> controlPointTableNode;
+  std::string controlPointTableNodeName = std::string(beamName) + "_ControlPoints";
+  controlPointTableNode->SetName(controlPointTableNodeName.c_str());
+  vtkTable* controlPointTable = controlPointTableNode->GetTable();
+
+  auto addColumn = [controlPointTable, numberOfControlPoints](const std::string& columnName)
+  {
+    vtkNew<vtkDoubleArray> column;
+    column->SetName(columnName.c_str());
+    column->SetNumberOfValues(numberOfControlPoints);
+    controlPointTable->AddColumn(column);
+    return column.GetPointer();
+  };
+  vtkDoubleArray* gantryAngles = addColumn(vtkMRMLRTBeamNode::CONTROL_POINT_GANTRY_ANGLE_COLUMN_NAME);
+  vtkDoubleArray* collimatorAngles = addColumn(vtkMRMLRTBeamNode::CONTROL_POINT_COLLIMATOR_ANGLE_COLUMN_NAME);
+  vtkDoubleArray* couchAngles = addColumn(vtkMRMLRTBeamNode::CONTROL_POINT_COUCH_ANGLE_COLUMN_NAME);
+  vtkDoubleArray* x1Jaws = addColumn(vtkMRMLRTBeamNode::CONTROL_POINT_X1_JAW_COLUMN_NAME);
+  vtkDoubleArray* x2Jaws = addColumn(vtkMRMLRTBeamNode::CONTROL_POINT_X2_JAW_COLUMN_NAME);
+  vtkDoubleArray* y1Jaws = addColumn(vtkMRMLRTBeamNode::CONTROL_POINT_Y1_JAW_COLUMN_NAME);
+  vtkDoubleArray* y2Jaws = addColumn(vtkMRMLRTBeamNode::CONTROL_POINT_Y2_JAW_COLUMN_NAME);
+  vtkDoubleArray* metersetWeights = addColumn(vtkMRMLRTBeamNode::CONTROL_POINT_CUMULATIVE_METERSET_WEIGHT_COLUMN_NAME);
+
+  // Leaf positions, one column per leaf. Boundaries are the same for all control points and are kept in the MLC table.
+  vtkMRMLTableNode* mlcTableNode = beamNode->GetMultiLeafCollimatorTableNode();
+  vtkIdType numberOfLeafPairs = (mlcTableNode ? mlcTableNode->GetNumberOfRows() - 1 : 0);
+  std::vector<vtkDoubleArray*> leafPositions1;
+  std::vector<vtkDoubleArray*> leafPositions2;
+  for (vtkIdType leafPairIndex = 0; leafPairIndex < numberOfLeafPairs; ++leafPairIndex)
+  {
+    leafPositions1.push_back(addColumn(std::string(vtkMRMLRTBeamNode::CONTROL_POINT_LEAF_POSITION_COLUMN_NAME_PREFIX) + "1_" + std::to_string(leafPairIndex)));
+  }
+  for (vtkIdType leafPairIndex = 0; leafPairIndex < numberOfLeafPairs; ++leafPairIndex)
+  {
+    leafPositions2.push_back(addColumn(std::string(vtkMRMLRTBeamNode::CONTROL_POINT_LEAF_POSITION_COLUMN_NAME_PREFIX) + "2_" + std::to_string(leafPairIndex)));
+  }
+
+  double jawPositions[2][2] = { { beamNode->GetX1Jaw(), beamNode->GetX2Jaw() }, { beamNode->GetY1Jaw(), beamNode->GetY2Jaw() } };
+  std::vector<double> boundaries, positions;
+  for (unsigned int controlPointIndex = 0; controlPointIndex < numberOfControlPoints; ++controlPointIndex)
+  {
+    gantryAngles->SetValue(controlPointIndex, rtReader->GetBeamControlPointGantryAngle(dicomBeamNumber, controlPointIndex));
+    collimatorAngles->SetValue(controlPointIndex, rtReader->GetBeamControlPointBeamLimitingDeviceAngle(dicomBeamNumber, controlPointIndex));
+    couchAngles->SetValue(controlPointIndex, rtReader->GetBeamControlPointPatientSupportAngle(dicomBeamNumber, controlPointIndex));
+    metersetWeights->SetValue(controlPointIndex, rtReader->GetBeamControlPointCumulativeMetersetWeight(dicomBeamNumber, controlPointIndex));
+
+    // Jaw and leaf positions are carried over from the previous control point if missing
+    rtReader->GetBeamControlPointJawPositions(dicomBeamNumber, controlPointIndex, jawPositions);
+    x1Jaws->SetValue(controlPointIndex, jawPositions[0][0]);
+    x2Jaws->SetValue(controlPointIndex, jawPositions[0][1]);
+    y1Jaws->SetValue(controlPointIndex, jawPositions[1][0]);
+    y2Jaws->SetValue(controlPointIndex, jawPositions[1][1]);
+
+    if (numberOfLeafPairs == 0)
+    {
+      continue;
+    }
+    boundaries.clear();
+    positions.clear();
+    bool leafPositionsValid = rtReader->GetBeamControlPointMultiLeafCollimatorPositions(dicomBeamNumber, controlPointIndex, boundaries, positions)
+      && positions.size() == static_cast<size_t>(2 * numberOfLeafPairs);
+    for (vtkIdType leafPairIndex = 0; leafPairIndex < numberOfLeafPairs; ++leafPairIndex)
+    {
+      if (leafPositionsValid)
+      {
+        leafPositions1[leafPairIndex]->SetValue(controlPointIndex, positions[leafPairIndex]);
+        leafPositions2[leafPairIndex]->SetValue(controlPointIndex, positions[leafPairIndex + numberOfLeafPairs]);
+      }
+      else
+      {
+        leafPositions1[leafPairIndex]->SetValue(controlPointIndex, (controlPointIndex > 0 ? leafPositions1[leafPairIndex]->GetValue(controlPointIndex - 1) : 0.0));
+        leafPositions2[leafPairIndex]->SetValue(controlPointIndex, (controlPointIndex > 0 ? leafPositions2[leafPairIndex]->GetValue(controlPointIndex - 1) : 0.0));
+      }
+    }
+  }
+
+  controlPointTableNode->SetUseColumnTitleAsColumnHeader(true);
+  scene->AddNode(controlPointTableNode);
+  beamNode->SetAndObserveControlPointTableNode(controlPointTableNode);
+  beamNode->SetCurrentControlPointIndex(0);
+
+  // Scan spots of all control points go into the single scan spot table of the ion beam,
+  // one energy layer per control point that delivers dose
+  vtkMRMLRTIonBeamNode* ionBeamNode = vtkMRMLRTIonBeamNode::SafeDownCast(beamNode);
+  if (ionBeamNode && ionBeamNode->GetScanSpotTableNode())
+  {
+    int wasModifying = ionBeamNode->StartModify();
+    ionBeamNode->RemoveAllScanSpots();
+    for (unsigned int controlPointIndex = 0; controlPointIndex < numberOfControlPoints; ++controlPointIndex)
+    {
+      const float* scanSpotPositionMap = nullptr;
+      const float* scanSpotMetersetWeights = nullptr;
+      std::string scanSpotTuneId;
+      unsigned int numberOfScanSpots = rtReader->GetBeamControlPointScanSpots(dicomBeamNumber, controlPointIndex,
+        scanSpotPositionMap, scanSpotMetersetWeights, scanSpotTuneId);
+      double totalWeight = 0.0;
+      for (unsigned int spotIndex = 0; spotIndex < numberOfScanSpots; ++spotIndex)
+      {
+        totalWeight += scanSpotMetersetWeights[spotIndex];
+      }
+      if (totalWeight <= 0.0)
+      {
+        // Control points closing an energy layer carry zero weights only
+        continue;
+      }
+      ionBeamNode->AddScanSpotEnergyLayer(rtReader->GetBeamControlPointNominalBeamEnergy(dicomBeamNumber, controlPointIndex),
+        scanSpotTuneId, numberOfScanSpots, scanSpotPositionMap, scanSpotMetersetWeights);
+    }
+    ionBeamNode->EndModify(wasModifying);
+  }
+
+  // Put control point table under the beam in subject hierarchy
+  vtkIdType beamShId = shNode->GetItemByDataNode(beamNode);
+  vtkIdType controlPointTableShId = shNode->GetItemByDataNode(controlPointTableNode);
+  if (beamShId != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID
+    && controlPointTableShId != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID)
+  {
+    shNode->SetItemParent(controlPointTableShId, beamShId);
+  }
+
+  return beamNode;
+}
+
 //---------------------------------------------------------------------------
 bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadDynamicBeamSequence(
   vtkSlicerDicomRtReader* rtReader, const char* seriesName, 
@@ -1451,6 +2031,8 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
 
   // Get referenced SOP instance UIDs
   const char* referencedSopInstanceUids = rtReader->GetRTStructureSetReferencedSOPInstanceUIDs();
+  std::string structureSetSopInstanceUid(rtReader->GetSOPInstanceUID() ? rtReader->GetSOPInstanceUID() : "");
+
   // Number of loaded points. Used to prevent unreasonably long loading times with the downside of a less nice initial representation
   long maximumNumberOfPoints = -1;
   long totalNumberOfPoints = 0;
@@ -1589,13 +2171,42 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
       vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
       segment->SetName(roiLabel);
       segment->SetColor(roiColor[0], roiColor[1], roiColor[2]);
-      segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(), roiPolyData);
+      if (this->External->LazyStructureSetLoading)
+      {
+        // Only register the ROI with empty contours, the actual contours are added when the segment is first shown
+        vtkSmartPointer<vtkPolyData> emptyContours = vtkSmartPointer<vtkPolyData>::New();
+        segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(), emptyContours);
+      }
+      else
+      {
+        segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(), roiPolyData);
+      }
+      if (!structureSetSopInstanceUid.empty())
+      {
+        // Identifies the structure set for the persistent conversion cache
+        segment->SetTag(vtkSlicerRtCommon::DICOMRTIMPORT_STRUCTURE_SET_SOP_INSTANCE_UID_SEGMENT_TAG_NAME, structureSetSopInstanceUid);
+      }
       segmentationNode->GetSegmentation()->AddSegment(segment);
 
       // Add DICOM ROI number as tag to the segment
       std::stringstream roiNumberStream;
       roiNumberStream << rtReader->GetRoiNumber(internalROIIndex);
       segment->SetTag(vtkSlicerRtCommon::DICOMRTIMPORT_ROI_NUMBER_SEGMENT_TAG_NAME, roiNumberStream.str());
+
+      if (this->External->LazyStructureSetLoading)
+      {
+        // Add bounds of the contours as tag, so that it is available while the contours are deferred
+        double roiBounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        roiPolyData->GetBounds(roiBounds);
+        std::stringstream roiBoundsStream;
+        roiBoundsStream << roiBounds[0] << " " << roiBounds[1] << " " << roiBounds[2] << " "
+          << roiBounds[3] << " " << roiBounds[4] << " " << roiBounds[5];
+        segment->SetTag(vtkSlicerRtCommon::DICOMRTIMPORT_ROI_BOUNDS_SEGMENT_TAG_NAME, roiBoundsStream.str());
+
+        std::string segmentID = segmentationNode->GetSegmentation()->GetSegmentIdBySegment(segment);
+        this->DeferredSegmentContours[segmentationNode][segmentID] = roiPolyData;
+        segmentationDisplayNode->SetSegmentVisibility(segmentID, false);
+      }
     }
   } // for all ROIs
 
@@ -1621,6 +2232,31 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
     vtkErrorWithObjectMacro(this->External, "LoadRtStructureSet: No display node was created for the segmentation node " << segmentationNode->GetName());
   }
 
+  // Add contours of deferred segments when they are shown, or when any new representation is requested
+  if (segmentationNode.GetPointer() && this->DeferredSegmentContours.count(segmentationNode))
+  {
+    // Create the representations used for display now, while it is fast because the deferred segments have no contours.
+    // Creating them later would load all deferred contours.
+    if (segmentationDisplayNode.GetPointer())
+    {
+      const char* displayRepresentationNames[2] = {
+        segmentationDisplayNode->GetPreferredDisplayRepresentationName2D(),
+        segmentationDisplayNode->GetPreferredDisplayRepresentationName3D() };
+      for (const char* displayRepresentationName : displayRepresentationNames)
+      {
+        if (displayRepresentationName && *displayRepresentationName)
+        {
+          segmentationNode->GetSegmentation()->CreateRepresentation(displayRepresentationName);
+        }
+      }
+    }
+
+    vtkSmartPointer<vtkIntArray> events = vtkSmartPointer<vtkIntArray>::New();
+    events->InsertNextValue(vtkMRMLDisplayableNode::DisplayModifiedEvent);
+    events->InsertNextValue(vtkSegmentation::ContainedRepresentationNamesModified);
+    this->External->GetMRMLNodesObserverManager()->AddObjectEvents(segmentationNode, events);
+  }
+
   // Insert series in subject hierarchy
   vtkSlicerDicomRtImportExportModuleLogic::InsertSeriesInSubjectHierarchy(rtReader, scene);
 
@@ -1833,33 +2469,41 @@ vtkMRMLTableNode* vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::CreateSc
   vtkTable* table = tableNode->GetTable();
   if (table)
   {
+    vtkIdType size = std::min<vtkIdType>(positions.size() / 2, weights.size());
+
     // Scan spot positions X
-    vtkNew<vtkDoubleArray> posX;
-    posX->SetName("X");
-    table->AddColumn(posX);
+    vtkNew<vtkFloatArray> posX;
+    posX->SetName(vtkMRMLRTIonBeamNode::SCAN_SPOT_POSITION_X_COLUMN_NAME);
+    posX->SetNumberOfValues(size);
 
     // Scan spot positions Y
-    vtkNew<vtkDoubleArray> posY;
-    posY->SetName("Y");
-    table->AddColumn(posY);
+    vtkNew<vtkFloatArray> posY;
+    posY->SetName(vtkMRMLRTIonBeamNode::SCAN_SPOT_POSITION_Y_COLUMN_NAME);
+    posY->SetNumberOfValues(size);
 
     // Scan spot meterset weights
-    vtkNew<vtkDoubleArray> msWeights;
-    msWeights->SetName("Weight");
-    table->AddColumn(msWeights);
-
-    vtkIdType size = positions.size() / 2;
-    table->SetNumberOfRows(size);
+    vtkNew<vtkFloatArray> msWeights;
+    msWeights->SetName(vtkMRMLRTIonBeamNode::SCAN_SPOT_METERSET_WEIGHT_COLUMN_NAME);
+    msWeights->SetNumberOfValues(size);
+
+    // Fill the column buffers directly instead of going through vtkVariant per cell
+    float* posXBuffer = posX->GetPointer(0);
+    float* posYBuffer = posY->GetPointer(0);
+    float* msWeightsBuffer = msWeights->GetPointer(0);
     for (vtkIdType row = 0; row < size; ++row)
     {
-      table->SetValue(row, 0, positions[2 * row]);
-      table->SetValue(row, 1, positions[2 * row + 1]);
-      table->SetValue(row, 2, weights[row]);
+      posXBuffer[row] = positions[2 * row];
+      posYBuffer[row] = positions[2 * row + 1];
+      msWeightsBuffer[row] = weights[row];
     }
+    table->AddColumn(posX);
+    table->AddColumn(posY);
+    table->AddColumn(msWeights);
+
     tableNode->SetUseColumnTitleAsColumnHeader(true);
-    tableNode->SetColumnDescription("X", "Scan spot positions X");
-    tableNode->SetColumnDescription("Y", "Scan spot positions Y");
-    tableNode->SetColumnDescription("Weight", "Scan spot meterset weights");
+    tableNode->SetColumnDescription(vtkMRMLRTIonBeamNode::SCAN_SPOT_POSITION_X_COLUMN_NAME, "Scan spot positions X");
+    tableNode->SetColumnDescription(vtkMRMLRTIonBeamNode::SCAN_SPOT_POSITION_Y_COLUMN_NAME, "Scan spot positions Y");
+    tableNode->SetColumnDescription(vtkMRMLRTIonBeamNode::SCAN_SPOT_METERSET_WEIGHT_COLUMN_NAME, "Scan spot meterset weights");
     return tableNode;
   }
   else
@@ -2189,6 +2833,9 @@ vtkSlicerDicomRtImportExportModuleLogic::vtkSlicerDicomRtImportExportModuleLogic
   this->Internal = new vtkInternal(this);
 
   this->BeamModelsInSeparateBranch = true;
+  this->LazyStructureSetLoading = false;
+  this->CompactDynamicBeamLoading = false;
+  this->ExportStructureBatchSize = 16;
 }
 
 //----------------------------------------------------------------------------
@@ -2212,9 +2859,172 @@ void vtkSlicerDicomRtImportExportModuleLogic::SetMRMLSceneInternal(vtkMRMLScene
 {
   vtkSmartPointer<vtkIntArray> events = vtkSmartPointer<vtkIntArray>::New();
   events->InsertNextValue(vtkMRMLScene::EndCloseEvent);
+  events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
+  events->InsertNextValue(vtkMRMLScene::StartSaveEvent);
   this->SetAndObserveMRMLSceneEvents(newScene, events.GetPointer());
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::ProcessMRMLSceneEvents(vtkObject* caller, unsigned long event, void* callData)
+{
+  if (event == vtkMRMLScene::StartSaveEvent)
+  {
+    // Segments with deferred contours would be saved empty, so load all contours before saving
+    std::vector<vtkMRMLSegmentationNode*> segmentationNodes;
+    for (const std::pair<vtkMRMLSegmentationNode* const, std::map<std::string, vtkSmartPointer<vtkPolyData> > >& deferredItem
+      : this->Internal->DeferredSegmentContours)
+    {
+      segmentationNodes.push_back(deferredItem.first);
+    }
+    for (vtkMRMLSegmentationNode* segmentationNode : segmentationNodes)
+    {
+      this->LoadDeferredSegmentContours(segmentationNode);
+    }
+  }
+
+  Superclass::ProcessMRMLSceneEvents(caller, event, callData);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
+{
+  vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(node);
+  if (segmentationNode && this->Internal->DeferredSegmentContours.erase(segmentationNode) > 0)
+  {
+    vtkUnObserveMRMLNodeMacro(segmentationNode);
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData)
+{
+  Superclass::ProcessMRMLNodesEvents(caller, event, callData);
+
+  vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(caller);
+  if (!segmentationNode || this->Internal->LoadingDeferredSegmentContours)
+  {
+    return;
+  }
+  if (event == vtkSegmentation::ContainedRepresentationNamesModified)
+  {
+    // A new representation is requested, which the deferred segments need to have too
+    this->LoadDeferredSegmentContours(segmentationNode);
+    return;
+  }
+  if (event != vtkMRMLDisplayableNode::DisplayModifiedEvent)
+  {
+    return;
+  }
+  std::map<vtkMRMLSegmentationNode*, std::map<std::string, vtkSmartPointer<vtkPolyData> > >::iterator deferredIt =
+    this->Internal->DeferredSegmentContours.find(segmentationNode);
+  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(segmentationNode->GetDisplayNode());
+  if (deferredIt == this->Internal->DeferredSegmentContours.end() || !displayNode)
+  {
+    return;
+  }
+
+  // Collect deferred segments that have been shown, as loading them modifies the segmentation
+  std::vector<std::string> shownSegmentIDs;
+  for (const std::pair<const std::string, vtkSmartPointer<vtkPolyData> >& deferredSegment : deferredIt->second)
+  {
+    if (displayNode->GetSegmentVisibility(deferredSegment.first))
+    {
+      shownSegmentIDs.push_back(deferredSegment.first);
+    }
+  }
+  for (const std::string& segmentID : shownSegmentIDs)
+  {
+    this->LoadDeferredSegmentContours(segmentationNode, segmentID.c_str());
+  }
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::LoadDeferredSegmentContours(vtkMRMLSegmentationNode* segmentationNode, const char* segmentID/*=nullptr*/)
+{
+  if (!segmentationNode)
+  {
+    vtkErrorMacro("LoadDeferredSegmentContours: Invalid segmentation node");
+    return false;
+  }
+  std::map<vtkMRMLSegmentationNode*, std::map<std::string, vtkSmartPointer<vtkPolyData> > >::iterator deferredIt =
+    this->Internal->DeferredSegmentContours.find(segmentationNode);
+  if (deferredIt == this->Internal->DeferredSegmentContours.end())
+  {
+    return true; // No deferred contours in segmentation
+  }
+
+  // Take the contours to load out of the deferred list first, so that nested calls do not load them again
+  std::map<std::string, vtkSmartPointer<vtkPolyData> > contoursToLoad;
+  if (segmentID)
+  {
+    std::map<std::string, vtkSmartPointer<vtkPolyData> >::iterator segmentIt = deferredIt->second.find(segmentID);
+    if (segmentIt == deferredIt->second.end())
+    {
+      return true; // Contours of segment are not deferred
+    }
+    contoursToLoad[segmentIt->first] = segmentIt->second;
+    deferredIt->second.erase(segmentIt);
+  }
+  else
+  {
+    contoursToLoad.swap(deferredIt->second);
+  }
+  if (deferredIt->second.empty())
+  {
+    this->Internal->DeferredSegmentContours.erase(deferredIt);
+    vtkUnObserveMRMLNodeMacro(segmentationNode);
+  }
+
+  vtkSegmentation* segmentation = segmentationNode->GetSegmentation();
+  std::string planarContourRepresentationName(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName());
+
+  // Representations that have been created for the segmentation need to be created for the loaded segments too
+  std::vector<std::string> containedRepresentationNames;
+  segmentation->GetContainedRepresentationNames(containedRepresentationNames);
+
+  bool success = true;
+  // Conversions may invoke the observed segmentation events, which must not load other deferred segments.
+  // The events blocked during the conversions are invoked when the blocker goes out of scope, so the flag
+  // is only restored after that.
+  bool wasLoadingDeferredSegmentContours = this->Internal->LoadingDeferredSegmentContours;
+  this->Internal->LoadingDeferredSegmentContours = true;
+  {
+    MRMLNodeModifyBlocker blocker(segmentationNode);
+    for (const std::pair<const std::string, vtkSmartPointer<vtkPolyData> >& contours : contoursToLoad)
+    {
+      vtkSegment* segment = segmentation->GetSegment(contours.first);
+      if (!segment)
+      {
+        continue; // Segment has been removed since loading
+      }
+      segment->AddRepresentation(planarContourRepresentationName, contours.second);
+      segment->RemoveAllRepresentations(planarContourRepresentationName);
+      for (const std::string& representationName : containedRepresentationNames)
+      {
+        if (representationName != planarContourRepresentationName && !segmentation->ConvertSingleSegment(contours.first, representationName))
+        {
+          vtkErrorMacro("LoadDeferredSegmentContours: Failed to convert segment " << contours.first << " to " << representationName);
+          success = false;
+        }
+      }
+    }
+  }
+  this->Internal->LoadingDeferredSegmentContours = wasLoadingDeferredSegmentContours;
+  return success;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::IsSegmentContoursDeferred(vtkMRMLSegmentationNode* segmentationNode, const char* segmentID)
+{
+  if (!segmentationNode || !segmentID)
+  {
+    return false;
+  }
+  std::map<vtkMRMLSegmentationNode*, std::map<std::string, vtkSmartPointer<vtkPolyData> > >::iterator deferredIt =
+    this->Internal->DeferredSegmentContours.find(segmentationNode);
+  return (deferredIt != this->Internal->DeferredSegmentContours.end() && deferredIt->second.count(segmentID) > 0);
+}
+
 //---------------------------------------------------------------------------
 void vtkSlicerDicomRtImportExportModuleLogic::OnMRMLSceneEndClose()
 {
@@ -2241,6 +3051,8 @@ void vtkSlicerDicomRtImportExportModuleLogic::RegisterNodes()
     vtkSmartPointer<vtkPlanarContourToRibbonModelConversionRule>::New() );
   vtkSegmentationConverterFactory::GetInstance()->RegisterConverterRule(
     vtkSmartPointer<vtkPlanarContourToClosedSurfaceConversionRule>::New() );
+  vtkSegmentationConverterFactory::GetInstance()->RegisterConverterRule(
+    vtkSmartPointer<vtkPlanarContourToBinaryLabelmapConversionRule>::New() );
 
 }
 
@@ -2253,82 +3065,41 @@ void vtkSlicerDicomRtImportExportModuleLogic::ExamineForLoad(vtkStringArray* fil
   }
   loadables->RemoveAllItems();
 
+  this->Internal->LoadExamineCache();
+
   for (int fileIndex=0; fileIndex<fileList->GetNumberOfValues(); ++fileIndex)
   {
-    // Load file in DCMTK
-    DcmFileFormat fileformat;
-    vtkStdString fileName = fileList->GetValue(fileIndex);
-    OFCondition result = fileformat.loadFile(fileName.c_str(), EXS_Unknown);
-    if (!result.good())
-    {
-      continue; // Failed to parse this file, skip it
-    }
-
-    // Check SOP Class UID for one of the supported RT objects
-    DcmDataset *dataset = fileformat.getDataset();
-    OFString sopClass;
-    if (!dataset->findAndGetOFString(DCM_SOPClassUID, sopClass).good() || sopClass.empty())
-    {
-      continue; // Failed to parse this file, skip it
-    }
-
-    // DICOM parsing is successful, now check if the object is loadable
-    OFString name("");
-    OFString seriesNumber("");
-    std::vector<OFString> referencedSOPInstanceUIDs;
-    dataset->findAndGetOFString(DCM_SeriesNumber, seriesNumber);
-    if (!seriesNumber.empty())
-    {
-      name += seriesNumber + ": ";
-    }
+    std::string fileName = fileList->GetValue(fileIndex);
 
-    // RTDose
-    if (sopClass == UID_RTDoseStorage)
-    {
-      this->Internal->ExamineRtDoseDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTPlan
-    else if (sopClass == UID_RTPlanStorage)
-    {
-      this->Internal->ExamineRtPlanDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTIonPlan
-    else if (sopClass == UID_RTIonPlanStorage)
-    {
-      this->Internal->ExamineRtPlanDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTStructureSet
-    else if (sopClass == UID_RTStructureSetStorage)
+    // Examine file only if it has not been examined since it was last modified
+    vtkInternal::ExamineResult result;
+    if (!this->Internal->GetCachedExamineResult(fileName, result))
     {
-      this->Internal->ExamineRtStructureSetDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTImage
-    else if (sopClass == UID_RTImageStorage)
-    {
-      this->Internal->ExamineRtImageDataset(dataset, name, referencedSOPInstanceUIDs);
+      // Only loadable RT objects are cached, other files are rejected quickly by ExamineFile
+      if (this->Internal->ExamineFile(fileName, result) && !result.Name.empty())
+      {
+        this->Internal->AddCachedExamineResult(result);
+      }
     }
-    /* Not yet supported
-    else if (sopClass == UID_RTTreatmentSummaryRecordStorage)
-    else if (sopClass == UID_RTIonBeamsTreatmentRecordStorage)
-    */
-    else
+    if (result.Name.empty())
     {
-      continue; // Not an RT file
+      continue; // Not a loadable RT object
     }
 
     // The file is a loadable RT object, create and set up loadable
     vtkNew<vtkSlicerDICOMLoadable> loadable;
-    loadable->SetName(name.c_str());
+    loadable->SetName(result.Name.c_str());
     loadable->AddFile(fileName.c_str());
     loadable->SetConfidence(1.0);
     loadable->SetSelected(true);
-    std::vector<OFString>::iterator uidIt;
-    for (uidIt = referencedSOPInstanceUIDs.begin(); uidIt != referencedSOPInstanceUIDs.end(); ++uidIt)
+    for (const std::string& referencedSOPInstanceUID : result.ReferencedSOPInstanceUIDs)
     {
-      loadable->AddReferencedInstanceUID(uidIt->c_str());
+      loadable->AddReferencedInstanceUID(referencedSOPInstanceUID.c_str());
     }
     loadables->AddItem(loadable);
   }
+
+  this->Internal->SaveExamineCache();
 }
 
 //---------------------------------------------------------------------------
@@ -2630,6 +3401,14 @@ std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkColle
   // Convert input segmentation to the format Plastimatch can use
   if (segmentationNode)
   {
+    // Make sure all contours are available in case the segmentation was loaded in lazy mode
+    if (!this->LoadDeferredSegmentContours(segmentationNode))
+    {
+      error = "Failed to load deferred contours of segmentation " + std::string(segmentationNode->GetName());
+      vtkErrorMacro("ExportDicomRTStudy: " + error);
+      return error;
+    }
+
     // If master representation is labelmap type, then export binary labelmap
     vtkSegmentation* segmentation = segmentationNode->GetSegmentation();
     if (segmentation->IsMasterRepresentationImageData())
@@ -2643,69 +3422,112 @@ std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkColle
         return error;
       }
 
-      // Export each segment in segmentation
+      // Get transform from segmentation to world (RAS)
+      vtkSmartPointer<vtkGeneralTransform> segmentationToWorldTransform;
+      if (segmentationNode->GetParentTransformNode())
+      {
+        segmentationToWorldTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+        segmentationNode->GetParentTransformNode()->GetTransformToWorld(segmentationToWorldTransform);
+      }
+
+      // Export segments in batches. The labelmaps of a batch are extracted from the segmentation on
+      // this thread, then transformed, resampled and converted to Plastimatch images concurrently.
+      // The structures are handed to the writer in segment order, and the intermediate images are
+      // released before the next batch so that only one batch is held in memory at a time.
       std::vector< std::string > segmentIDs;
       segmentationNode->GetSegmentation()->GetSegmentIDs(segmentIDs);
-      for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+      size_t batchSize = (this->ExportStructureBatchSize > 0 ? static_cast<size_t>(this->ExportStructureBatchSize) : segmentIDs.size());
+      for (size_t batchStart = 0; batchStart < segmentIDs.size(); batchStart += batchSize)
       {
-        std::string segmentID = *segmentIdIt;
-        vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(*segmentIdIt);
+        size_t numberOfBatchSegments = std::min(batchSize, segmentIDs.size() - batchStart);
+        std::vector< vtkSmartPointer<vtkOrientedImageData> > binaryLabelmapCopies(numberOfBatchSegments);
+        std::vector< vtkSmartPointer<vtkGeneralTransform> > segmentToWorldTransforms(numberOfBatchSegments);
+        for (size_t batchIndex = 0; batchIndex < numberOfBatchSegments; ++batchIndex)
+        {
+          std::string segmentID = segmentIDs[batchStart + batchIndex];
 
-        // Get binary labelmap representation
+          // Get binary labelmap representation
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
-        vtkNew<vtkOrientedImageData> binaryLabelmap;
-        segmentationNode->GetBinaryLabelmapRepresentation(segmentID, binaryLabelmap);
+          vtkNew<vtkOrientedImageData> binaryLabelmap;
+          segmentationNode->GetBinaryLabelmapRepresentation(segmentID, binaryLabelmap);
 #else
-        vtkOrientedImageData* binaryLabelmap = vtkOrientedImageData::SafeDownCast(
-          segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(segmentID);
+          vtkOrientedImageData* binaryLabelmap = vtkOrientedImageData::SafeDownCast(
+            segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
 #endif
-        if (!binaryLabelmap)
-        {
-          error = "Failed to get binary labelmap representation from segment " + segmentID;
-          vtkErrorMacro("ExportDicomRTStudy: " + error);
-          return error;
+          if (!binaryLabelmap)
+          {
+            error = "Failed to get binary labelmap representation from segment " + segmentID;
+            vtkErrorMacro("ExportDicomRTStudy: " + error);
+            return error;
+          }
+          // Temporarily copy labelmap image data as it will be probably resampled
+          binaryLabelmapCopies[batchIndex] = vtkSmartPointer<vtkOrientedImageData>::New();
+          binaryLabelmapCopies[batchIndex]->DeepCopy(binaryLabelmap);
+
+          // Each segment gets its own copy of the transform, as transforms are not safe to share between threads
+          if (segmentationToWorldTransform)
+          {
+            segmentToWorldTransforms[batchIndex] = vtkSmartPointer<vtkGeneralTransform>::New();
+            segmentToWorldTransforms[batchIndex]->DeepCopy(segmentationToWorldTransform);
+          }
         }
-        // Temporarily copy labelmap image data as it will be probably resampled
-        vtkSmartPointer<vtkOrientedImageData> binaryLabelmapCopy = vtkSmartPointer<vtkOrientedImageData>::New();
-        binaryLabelmapCopy->DeepCopy(binaryLabelmap);
 
-        // Apply parent transformation nodes if necessary
-        if (segmentationNode->GetParentTransformNode())
+        std::vector<Plm_image::Pointer> plmStructures(numberOfBatchSegments);
+        std::vector<std::string> segmentErrors(numberOfBatchSegments);
+        vtkSMPTools::For(0, static_cast<vtkIdType>(numberOfBatchSegments), [&](vtkIdType begin, vtkIdType end)
         {
-          if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, binaryLabelmapCopy))
+          for (vtkIdType batchIndex = begin; batchIndex < end; ++batchIndex)
           {
-            std::string errorMessage("Failed to apply parent transformation to exported segment");
-            vtkErrorMacro("ExportDicomRTStudy: " << errorMessage);
-            return errorMessage;
+            const std::string& segmentID = segmentIDs[batchStart + batchIndex];
+            vtkOrientedImageData* binaryLabelmapCopy = binaryLabelmapCopies[batchIndex];
+
+            // Apply parent transformation nodes if necessary
+            if (segmentToWorldTransforms[batchIndex])
+            {
+              vtkOrientedImageDataResample::TransformOrientedImage(binaryLabelmapCopy, segmentToWorldTransforms[batchIndex]);
+            }
+            // Make sure the labelmap dimensions match the reference dimensions
+            if ( !vtkOrientedImageDataResample::DoGeometriesMatch(imageOrientedImageData, binaryLabelmapCopy)
+              || !vtkOrientedImageDataResample::DoExtentsMatch(imageOrientedImageData, binaryLabelmapCopy) )
+            {
+              if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(binaryLabelmapCopy, imageOrientedImageData, binaryLabelmapCopy))
+              {
+                segmentErrors[batchIndex] = "Failed to resample segment " + segmentID + " to match anatomical image geometry";
+                continue;
+              }
+            }
+
+            // Convert mask to Plm image
+            plmStructures[batchIndex] = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(binaryLabelmapCopy);
+            if (!plmStructures[batchIndex])
+            {
+              segmentErrors[batchIndex] = "Failed to convert segment labelmap " + segmentID + " to Plastimatch image";
+              continue;
+            }
+            // The labelmap is not needed any more once it is converted
+            binaryLabelmapCopies[batchIndex] = nullptr;
           }
-        }
-        // Make sure the labelmap dimensions match the reference dimensions
-        if ( !vtkOrientedImageDataResample::DoGeometriesMatch(imageOrientedImageData, binaryLabelmapCopy)
-          || !vtkOrientedImageDataResample::DoExtentsMatch(imageOrientedImageData, binaryLabelmapCopy) )
+        });
+
+        for (size_t batchIndex = 0; batchIndex < numberOfBatchSegments; ++batchIndex)
         {
-          if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(binaryLabelmapCopy, imageOrientedImageData, binaryLabelmapCopy))
+          if (!segmentErrors[batchIndex].empty())
           {
-            error = "Failed to resample segment " + segmentID + " to match anatomical image geometry";
+            error = segmentErrors[batchIndex];
             vtkErrorMacro("ExportDicomRTStudy: " + error);
             return error;
           }
-        }
 
-        // Convert mask to Plm image
-        Plm_image::Pointer plmStructure = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(binaryLabelmapCopy);
-        if (!plmStructure)
-        {
-          error = "Failed to convert segment labelmap " + segmentID + " to Plastimatch image";
-          vtkErrorMacro("ExportDicomRTStudy: " + error);
-          return error;
-        }
+          // Get segment properties
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(segmentIDs[batchStart + batchIndex]);
+          std::string segmentName = segment->GetName();
+          double* segmentColor = segment->GetColor();
 
-        // Get segment properties
-        std::string segmentName = segment->GetName();
-        double* segmentColor = segment->GetColor();
-
-        rtWriter->AddStructure(plmStructure->itk_uchar(), segmentName.c_str(), segmentColor);
-      } // For each segment
+          rtWriter->AddStructure(plmStructures[batchIndex]->itk_uchar(), segmentName.c_str(), segmentColor);
+          plmStructures[batchIndex] = nullptr;
+        }
+      } // For each batch of segments
     }
     // If master representation is poly data type, then export from closed surface
     else if (segmentation->IsMasterRepresentationPolyData())
@@ -2726,99 +3548,124 @@ std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkColle
       {
         segmentationNode->GetParentTransformNode()->GetTransformToWorld(nodeToWorldTransform);
       }
-      // Initialize poly data transformer
-      vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyData = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-      transformPolyData->SetTransform(nodeToWorldTransform);
 
       // Initialize cutting plane with normal of the Z axis of the anatomical image
       vtkSmartPointer<vtkMatrix4x4> imageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
       imageOrientedImageData->GetImageToWorldMatrix(imageToWorldMatrix);
       double normal[3] = { imageToWorldMatrix->GetElement(0,2), imageToWorldMatrix->GetElement(1,2), imageToWorldMatrix->GetElement(2,2) };
-      vtkSmartPointer<vtkPlane> slicePlane = vtkSmartPointer<vtkPlane>::New();
-      slicePlane->SetNormal(normal);
+      int imageExtent[6] = {0,-1,0,-1,0,-1};
+      imageOrientedImageData->GetExtent(imageExtent);
 
-      // Export each segment in segmentation
+      // Planar contours of a segment, to be passed to the writer
+      struct SegmentContours
+      {
+        std::vector<int> SliceNumbers;
+        std::vector<std::string> SliceUIDs;
+        std::vector< vtkSmartPointer<vtkPolyData> > SliceContours;
+      };
+
+      // Export segments in batches. The contours of the segments in a batch are cut concurrently,
+      // each segment with its own pipeline, then handed to the writer in segment order and released
+      // before the next batch so that only one batch is held in memory at a time.
       std::vector< std::string > segmentIDs;
       segmentationNode->GetSegmentation()->GetSegmentIDs(segmentIDs);
-      for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+      size_t batchSize = (this->ExportStructureBatchSize > 0 ? static_cast<size_t>(this->ExportStructureBatchSize) : segmentIDs.size());
+      for (size_t batchStart = 0; batchStart < segmentIDs.size(); batchStart += batchSize)
       {
-        std::string segmentID = *segmentIdIt;
-        vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(*segmentIdIt);
-
-        // Get closed surface representation
-        vtkPolyData* closedSurfacePolyData = vtkPolyData::SafeDownCast(
-          segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName()) );
-        if (!closedSurfacePolyData)
+        size_t numberOfBatchSegments = std::min(batchSize, segmentIDs.size() - batchStart);
+        std::vector<vtkPolyData*> closedSurfaces(numberOfBatchSegments, nullptr);
+        std::vector< vtkSmartPointer<vtkGeneralTransform> > segmentToWorldTransforms(numberOfBatchSegments);
+        for (size_t batchIndex = 0; batchIndex < numberOfBatchSegments; ++batchIndex)
         {
-          error = "Failed to get closed surface representation from segment " + segmentID;
-          vtkErrorMacro("ExportDicomRTStudy: " + error);
-          return error;
-        }
+          std::string segmentID = segmentIDs[batchStart + batchIndex];
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(segmentID);
 
-        // Initialize cutter pipeline for segment
-        transformPolyData->SetInputData(closedSurfacePolyData);
-        vtkSmartPointer<vtkCutter> cutter = vtkSmartPointer<vtkCutter>::New();
-        cutter->SetInputConnection(transformPolyData->GetOutputPort());
-        cutter->SetGenerateCutScalars(0);
-        vtkSmartPointer<vtkStripper> stripper = vtkSmartPointer<vtkStripper>::New();
-        stripper->SetInputConnection(cutter->GetOutputPort());
-
-        // Get segment bounding box
-        double bounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
-        transformPolyData->Update();
-        transformPolyData->GetOutput()->GetBounds(bounds);
-
-        // Containers to be passed to the writer
-        std::vector<int> sliceNumbers;
-        std::vector<std::string> sliceUIDs;
-        std::vector<vtkPolyData*> sliceContours;
-
-        // Create planar contours from closed surface based on each of the anatomical image slices
-        int imageExtent[6] = {0,-1,0,-1,0,-1};
-        imageOrientedImageData->GetExtent(imageExtent);
-        for (int slice=imageExtent[4]; slice<imageExtent[5]; ++slice)
-        {
-          // Calculate slice origin
-          double origin[3] = { imageToWorldMatrix->GetElement(0,3) + slice*normal[0],
-                               imageToWorldMatrix->GetElement(1,3) + slice*normal[1],
-                               imageToWorldMatrix->GetElement(2,3) + slice*normal[2] };
-          slicePlane->SetOrigin(origin);
-          if (origin[2] < bounds[4] || origin[2] > bounds[5])
+          // Get closed surface representation
+          closedSurfaces[batchIndex] = vtkPolyData::SafeDownCast(
+            segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName()) );
+          if (!closedSurfaces[batchIndex])
           {
-            // No contours outside surface bounds
-            continue;
+            error = "Failed to get closed surface representation from segment " + segmentID;
+            vtkErrorMacro("ExportDicomRTStudy: " + error);
+            return error;
           }
 
-          // Cut closed surface at slice
-          cutter->SetCutFunction(slicePlane);
-
-          // Get instance UID of corresponding slice
-          int sliceNumber = slice-imageExtent[0];
-          sliceNumbers.push_back(sliceNumber);
-          std::string sliceInstanceUID = (imageSliceUIDs.size() > static_cast<size_t>(sliceNumber) ? imageSliceUIDs[sliceNumber] : "");
-          sliceUIDs.push_back(sliceInstanceUID);
-
-          // Save slice contour
-          stripper->Update();
-          vtkPolyData* sliceContour = vtkPolyData::New();
-          sliceContour->SetPoints(stripper->GetOutput()->GetPoints());
-          sliceContour->SetPolys(stripper->GetOutput()->GetLines());
-          sliceContours.push_back(sliceContour);
-        } // For each anatomical image slice
+          // Each segment gets its own copy of the transform, as transforms are not safe to share between threads
+          segmentToWorldTransforms[batchIndex] = vtkSmartPointer<vtkGeneralTransform>::New();
+          segmentToWorldTransforms[batchIndex]->DeepCopy(nodeToWorldTransform);
+        }
 
-        // Get segment properties
-        std::string segmentName = segment->GetName();
-        double* segmentColor = segment->GetColor();
+        std::vector<SegmentContours> segmentContours(numberOfBatchSegments);
+        vtkSMPTools::For(0, static_cast<vtkIdType>(numberOfBatchSegments), [&](vtkIdType begin, vtkIdType end)
+        {
+          for (vtkIdType batchIndex = begin; batchIndex < end; ++batchIndex)
+          {
+            // Initialize cutter pipeline for segment
+            vtkNew<vtkTransformPolyDataFilter> transformPolyData;
+            transformPolyData->SetTransform(segmentToWorldTransforms[batchIndex]);
+            transformPolyData->SetInputData(closedSurfaces[batchIndex]);
+            vtkNew<vtkPlane> slicePlane;
+            slicePlane->SetNormal(normal);
+            vtkNew<vtkCutter> cutter;
+            cutter->SetInputConnection(transformPolyData->GetOutputPort());
+            cutter->SetCutFunction(slicePlane);
+            cutter->SetGenerateCutScalars(0);
+            vtkNew<vtkStripper> stripper;
+            stripper->SetInputConnection(cutter->GetOutputPort());
+
+            // Get segment bounding box
+            double bounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+            transformPolyData->Update();
+            transformPolyData->GetOutput()->GetBounds(bounds);
+
+            // Create planar contours from closed surface based on each of the anatomical image slices
+            SegmentContours& contours = segmentContours[batchIndex];
+            for (int slice=imageExtent[4]; slice<imageExtent[5]; ++slice)
+            {
+              // Calculate slice origin
+              double origin[3] = { imageToWorldMatrix->GetElement(0,3) + slice*normal[0],
+                                   imageToWorldMatrix->GetElement(1,3) + slice*normal[1],
+                                   imageToWorldMatrix->GetElement(2,3) + slice*normal[2] };
+              if (origin[2] < bounds[4] || origin[2] > bounds[5])
+              {
+                // No contours outside surface bounds
+                continue;
+              }
 
-        // Add contours to writer
-        rtWriter->AddStructure(segmentName.c_str(), segmentColor, sliceNumbers, sliceUIDs, sliceContours);
+              // Cut closed surface at slice
+              slicePlane->SetOrigin(origin);
+
+              // Get instance UID of corresponding slice
+              int sliceNumber = slice-imageExtent[0];
+              contours.SliceNumbers.push_back(sliceNumber);
+              contours.SliceUIDs.push_back(imageSliceUIDs.size() > static_cast<size_t>(sliceNumber) ? imageSliceUIDs[sliceNumber] : "");
+
+              // Save slice contour
+              stripper->Update();
+              vtkSmartPointer<vtkPolyData> sliceContour = vtkSmartPointer<vtkPolyData>::New();
+              sliceContour->SetPoints(stripper->GetOutput()->GetPoints());
+              sliceContour->SetPolys(stripper->GetOutput()->GetLines());
+              contours.SliceContours.push_back(sliceContour);
+            } // For each anatomical image slice
+          }
+        });
 
-        // Clean up slice contours
-        for (std::vector<vtkPolyData*>::iterator contourIt=sliceContours.begin(); contourIt!=sliceContours.end(); ++contourIt)
+        for (size_t batchIndex = 0; batchIndex < numberOfBatchSegments; ++batchIndex)
         {
-          (*contourIt)->Delete();
+          // Get segment properties
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(segmentIDs[batchStart + batchIndex]);
+          std::string segmentName = segment->GetName();
+          double* segmentColor = segment->GetColor();
+
+          // Add contours to writer
+          SegmentContours& contours = segmentContours[batchIndex];
+          std::vector<vtkPolyData*> sliceContours(contours.SliceContours.begin(), contours.SliceContours.end());
+          rtWriter->AddStructure(segmentName.c_str(), segmentColor, contours.SliceNumbers, contours.SliceUIDs, sliceContours);
+
+          // Release slice contours
+          contours = SegmentContours();
         }
-      } // For each segment
+      } // For each batch of segments
     }
     else
     {
@@ -74,14 +74,43 @@ public:
   /// Insert currently loaded series in the proper place in subject hierarchy
   static void InsertSeriesInSubjectHierarchy(vtkSlicerDicomReaderBase* reader, vtkMRMLScene* scene);
 
+  /// Add the contours of segments that were loaded with deferred contours (\sa LazyStructureSetLoading)
+  /// to the segmentation, and create the representations that the other segments already have.
+  /// Modules that access existing representations of such segments should call this first.
+  /// \param segmentationNode Segmentation node loaded from an RT structure set
+  /// \param segmentID Segment to load contours for. If nullptr, then contours of all deferred segments are loaded
+  /// \return False if a conversion failed, true otherwise (also if there were no deferred contours)
+  bool LoadDeferredSegmentContours(vtkMRMLSegmentationNode* segmentationNode, const char* segmentID = nullptr);
+
+  /// Determine if a segment was loaded with deferred contours that have not been added yet
+  bool IsSegmentContoursDeferred(vtkMRMLSegmentationNode* segmentationNode, const char* segmentID);
+
 public:
   vtkSetMacro(BeamModelsInSeparateBranch, bool);
   vtkGetMacro(BeamModelsInSeparateBranch, bool);
   vtkBooleanMacro(BeamModelsInSeparateBranch, bool);
 
+  vtkSetMacro(LazyStructureSetLoading, bool);
+  vtkGetMacro(LazyStructureSetLoading, bool);
+  vtkBooleanMacro(LazyStructureSetLoading, bool);
+
+  vtkSetMacro(CompactDynamicBeamLoading, bool);
+  vtkGetMacro(CompactDynamicBeamLoading, bool);
+  vtkBooleanMacro(CompactDynamicBeamLoading, bool);
+
+  vtkSetMacro(ExportStructureBatchSize, int);
+  vtkGetMacro(ExportStructureBatchSize, int);
+
 protected:
   void SetMRMLSceneInternal(vtkMRMLScene* newScene) override;
   void OnMRMLSceneEndClose() override;
+  void OnMRMLSceneNodeRemoved(vtkMRMLNode* node) override;
+
+  /// Load all deferred contours before the scene is saved
+  void ProcessMRMLSceneEvents(vtkObject* caller, unsigned long event, void* callData) override;
+
+  /// Load deferred contours of segments that are shown, and of all segments if a new representation is requested
+  void ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData) override;
 
   /// Register MRML Node classes to Scene. Gets called automatically when the MRMLScene is attached to this logic class.
   void RegisterNodes() override;
@@ -101,6 +130,24 @@ private:
   /// Flag determining whether the generated beam models are arranged in a separate subject hierarchy
   /// branch, or each beam model is added under its corresponding isocenter fiducial
   bool BeamModelsInSeparateBranch;
+
+  /// Flag determining whether structure set ROIs are only registered as hidden segments with their metadata
+  /// (name, color, ROI number, bounds) when loading, and their contours are added to the segmentation and
+  /// converted only when the segment is first shown, a new representation is created for the segmentation,
+  /// the scene is saved, or \sa LoadDeferredSegmentContours is called.
+  /// Off by default.
+  bool LazyStructureSetLoading;
+
+  /// Flag determining whether dynamic beams (e.g. arcs) are loaded as a single beam node with a control point
+  /// table holding the parameters of all control points (\sa vtkMRMLRTBeamNode::SetCurrentControlPointIndex),
+  /// instead of a sequence of beam, transform and MLC table nodes per control point. Off by default.
+  bool CompactDynamicBeamLoading;
+
+  /// Number of segments that are converted concurrently when exporting a structure set
+  /// (\sa ExportDicomRTStudy). The converted structures of a batch are handed to the writer
+  /// and released before the next batch is converted, which bounds the memory used by the export.
+  /// If not positive, then all segments are converted in one batch. 16 by default.
+  int ExportStructureBatchSize;
 };
 
 #endif
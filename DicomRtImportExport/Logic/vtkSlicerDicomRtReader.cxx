@@ -33,10 +33,13 @@
 #include <vtkObjectFactory.h>
 #include <vtkPoints.h>
 #include <vtkPolyData.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartPointer.h>
 
 // STD includes
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <vector>
 #include <map>
 
@@ -44,6 +47,7 @@
 #include <dcmtk/config/osconfig.h>    /* make sure OS specific configuration is included first */
 
 #include <dcmtk/ofstd/ofconapp.h>
+#include <dcmtk/ofstd/ofstd.h>
 
 #include <dcmtk/dcmrt/drtdose.h>
 #include <dcmtk/dcmrt/drtimage.h>
@@ -58,6 +62,116 @@
 
 vtkStandardNewMacro(vtkSlicerDicomRtReader);
 
+namespace
+{
+  /// Parse backslash separated decimal string (DS) values and append them to a vector.
+  /// Values with at most 15 significant digits and a decimal exponent within +-22 (practically all coordinates)
+  /// are converted exactly using integer arithmetic, the others are converted by OFStandard::atof.
+  /// \return Number of parsed values
+  size_t ParseDecimalStringValues(const char* valuesString, std::vector<double>& values)
+  {
+    static const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    if (!valuesString || valuesString[0] == '\0')
+    {
+      return 0;
+    }
+
+    size_t numberOfValues = 0;
+    const char* valueStart = valuesString;
+    while (true)
+    {
+      const char* valueEnd = valueStart;
+      while (*valueEnd != '\0' && *valueEnd != '\\')
+      {
+        ++valueEnd;
+      }
+
+      // Trim padding
+      const char* begin = valueStart;
+      const char* end = valueEnd;
+      while (begin < end && *begin == ' ')
+      {
+        ++begin;
+      }
+      while (end > begin && *(end-1) == ' ')
+      {
+        --end;
+      }
+
+      // Fast path
+      const char* c = begin;
+      bool negative = false;
+      if (c < end && (*c == '+' || *c == '-'))
+      {
+        negative = (*c == '-');
+        ++c;
+      }
+      uint64_t mantissa = 0;
+      int significantDigits = 0;
+      int exponent = 0;
+      bool digitFound = false;
+      for (; c < end && *c >= '0' && *c <= '9'; ++c)
+      {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*c - '0');
+        significantDigits += (mantissa > 0 ? 1 : 0);
+        digitFound = true;
+      }
+      if (c < end && *c == '.')
+      {
+        for (++c; c < end && *c >= '0' && *c <= '9'; ++c)
+        {
+          mantissa = mantissa * 10 + static_cast<uint64_t>(*c - '0');
+          significantDigits += (mantissa > 0 ? 1 : 0);
+          --exponent;
+          digitFound = true;
+        }
+      }
+      if (digitFound && c < end && (*c == 'e' || *c == 'E'))
+      {
+        ++c;
+        bool negativeExponent = false;
+        if (c < end && (*c == '+' || *c == '-'))
+        {
+          negativeExponent = (*c == '-');
+          ++c;
+        }
+        int explicitExponent = 0;
+        bool exponentDigitFound = false;
+        for (; c < end && *c >= '0' && *c <= '9' && explicitExponent < 1000; ++c)
+        {
+          explicitExponent = explicitExponent * 10 + (*c - '0');
+          exponentDigitFound = true;
+        }
+        digitFound = exponentDigitFound;
+        exponent += (negativeExponent ? -explicitExponent : explicitExponent);
+      }
+
+      double value = 0.0;
+      if (digitFound && c == end && significantDigits <= 15 && exponent >= -22 && exponent <= 22)
+      {
+        value = static_cast<double>(mantissa);
+        value = (exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent]);
+        value = (negative ? -value : value);
+      }
+      else
+      {
+        value = OFStandard::atof(std::string(begin, end).c_str());
+      }
+      values.push_back(value);
+      ++numberOfValues;
+
+      if (*valueEnd == '\0')
+      {
+        break;
+      }
+      valueStart = valueEnd + 1;
+    }
+
+    return numberOfValues;
+  }
+}
+
 //----------------------------------------------------------------------------
 class vtkSlicerDicomRtReader::vtkInternal
 {
@@ -151,6 +265,53 @@ public:
   /// List of loaded contour ROIs from structure set
   std::vector<RoiEntry> RoiSequenceVector;
 
+  /// Contour data of a ROI collected from the ROI contour sequence.
+  /// Decoding it does not access the DCMTK objects, so multiple ROIs can be decoded concurrently.
+  class RoiContourData
+  {
+  public:
+    /// ROI entry the contours belong to
+    RoiEntry* Roi{nullptr};
+    /// Display color of the ROI as stored in the ROI contour sequence
+    std::array< double, 3 > DisplayColor;
+    /// Contour data (backslash separated LPS coordinates) of each contour
+    std::vector<OFString> ContourDataStrings;
+    /// Number of contour points of each contour
+    std::vector<Sint32> NumberOfContourPoints;
+    /// Whether the referenced slice instance is specified for each contour
+    std::vector<bool> HasReferencedSOPInstanceUID;
+    /// Referenced slice instance UID of each contour
+    std::vector<std::string> ReferencedSOPInstanceUIDs;
+
+    /// Number of values found in the contour data of each contour (output)
+    std::vector<size_t> NumberOfContourDataValues;
+    /// Whether the contour data of each contour is valid and the contour is added to the poly data (output)
+    std::vector<bool> ContourValid;
+    /// Decoded contours in RAS coordinate system (output)
+    vtkSmartPointer<vtkPolyData> PolyData;
+  };
+
+  /// Decodes contour data of a range of ROIs
+  class RoiContourDecodingFunctor
+  {
+  public:
+    RoiContourDecodingFunctor(std::vector<RoiContourData>& roiContourDataVector)
+      : RoiContourDataVector(roiContourDataVector)
+    {
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+      for (vtkIdType roiIndex = begin; roiIndex < end; ++roiIndex)
+      {
+        vtkInternal::DecodeRoiContourData(this->RoiContourDataVector[roiIndex]);
+      }
+    }
+
+  private:
+    std::vector<RoiContourData>& RoiContourDataVector;
+  };
+
   //TODO: Use referenced beams to load beams in correct order
   class ReferencedBeamEntry
   {
@@ -356,8 +517,14 @@ public:
   void LoadRTStructureSet(DcmDataset* dataset);
   /// Load contours from a structure sequence
   void LoadContoursFromRoiSequence(DRTStructureSetROISequence* roiSequence);
-  /// Load individual contour from RT Structure Set
-  vtkSlicerDicomRtReader::vtkInternal::RoiEntry* LoadContour(DRTROIContourSequence::Item &roiObject, DRTStructureSetIOD* rtStructureSet);
+  /// Collect contour data of an individual ROI from RT Structure Set.
+  /// The contour data is only collected if the ROI has contours, in which case the ROI is set in the contour data.
+  /// \return ROI entry of the contour, nullptr if not found
+  vtkSlicerDicomRtReader::vtkInternal::RoiEntry* LoadContour(DRTROIContourSequence::Item &roiObject, RoiContourData& roiContourData);
+  /// Decode contour data of a ROI into poly data. Thread-safe, does not access the DCMTK objects or the reader.
+  static void DecodeRoiContourData(RoiContourData& roiContourData);
+  /// Store decoded contour data and referenced slice instances in the ROI entry
+  void StoreRoiContourData(RoiContourData& roiContourData, DRTStructureSetIOD* rtStructureSet);
 
   /// Load RT Image
   void LoadRTImage(DcmDataset* dataset);
@@ -1928,8 +2095,7 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadRTStructureSet(DcmDataset* dataset
   vtkDebugWithObjectMacro(this->External, "LoadRTStructureSet: RT Structure Set object");
 
   // Read ROI name, description, and number into the ROI contour sequence vector (StructureSetROISequence)
-  DRTStructureSetROISequence* rtStructureSetROISequence = new DRTStructureSetROISequence(rtStructureSet->getStructureSetROISequence());
-  this->LoadContoursFromRoiSequence(rtStructureSetROISequence);
+  this->LoadContoursFromRoiSequence(&rtStructureSet->getStructureSetROISequence());
 
   // Get referenced anatomical image
   OFString referencedSeriesInstanceUID = this->GetReferencedSeriesInstanceUID(rtStructureSet);
@@ -1945,18 +2111,33 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadRTStructureSet(DcmDataset* dataset
   }
 
   // Read ROIs, iterate over ROI contour sequence
+  std::vector<RoiContourData> roiContourDataVector;
+  roiContourDataVector.reserve(rtROIContourSequence.getNumberOfItems());
   do 
   {
     DRTROIContourSequence::Item &currentRoi = rtROIContourSequence.getCurrentItem();
-    RoiEntry* currentRoiEntry = this->LoadContour(currentRoi, rtStructureSet);
+    RoiContourData currentRoiContourData;
+    RoiEntry* currentRoiEntry = this->LoadContour(currentRoi, currentRoiContourData);
     if (currentRoiEntry)
     {
       // Set referenced series UID
       currentRoiEntry->ReferencedSeriesUID = (std::string)referencedSeriesInstanceUID.c_str();
     }
+    if (currentRoiContourData.Roi)
+    {
+      roiContourDataVector.push_back(std::move(currentRoiContourData));
+    }
   }
   while (rtROIContourSequence.gotoNextItem().good());
 
+  // Decode contour data of the ROIs concurrently, then store them in ROI order
+  RoiContourDecodingFunctor decodingFunctor(roiContourDataVector);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(roiContourDataVector.size()), 1, decodingFunctor);
+  for (RoiContourData& roiContourData : roiContourDataVector)
+  {
+    this->StoreRoiContourData(roiContourData, rtStructureSet);
+  }
+
   // Get SOP instance UID
   OFString sopInstanceUid("");
   if (rtStructureSet->getSOPInstanceUID(sopInstanceUid).bad())
@@ -1982,6 +2163,7 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadContoursFromRoiSequence(DRTStructu
     vtkErrorWithObjectMacro(this->External, "LoadContoursFromRoiSequence: No structure sets were found");
     return;
   }
+  this->RoiSequenceVector.reserve(this->RoiSequenceVector.size() + rtStructureSetROISequence->getNumberOfItems());
   do
   {
     DRTStructureSetROISequence::Item &currentROISequence = rtStructureSetROISequence->getCurrentItem();
@@ -2016,17 +2198,13 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadContoursFromRoiSequence(DRTStructu
 
 //----------------------------------------------------------------------------
 vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkInternal::LoadContour(
-  DRTROIContourSequence::Item &roi, DRTStructureSetIOD* rtStructureSet)
+  DRTROIContourSequence::Item &roi, RoiContourData& roiContourData)
 {
   if (!roi.isValid())
   {
     return nullptr;
   }
 
-  // Used for connection from one planar contour ROI to the corresponding anatomical volume slice instance
-  std::map<int, std::string> contourToSliceInstanceUIDMap;
-  std::set<std::string> referencedSopInstanceUids;
-
   // Get ROI entry created for the referenced ROI
   Sint32 referencedRoiNumber = -1;
   roi.getReferencedROINumber(referencedRoiNumber);
@@ -2046,12 +2224,12 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
     return roiEntry;
   }
 
-  // Create containers for contour poly data
-  vtkSmartPointer<vtkPoints> currentRoiContourPoints = vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkCellArray> currentRoiContourCells = vtkSmartPointer<vtkCellArray>::New();
-  vtkIdType pointId = 0;
-
-  // Read contour data, iterate over contour sequence
+  // Collect contour data, iterate over contour sequence
+  size_t numberOfContours = rtContourSequence.getNumberOfItems();
+  roiContourData.ContourDataStrings.reserve(numberOfContours);
+  roiContourData.NumberOfContourPoints.reserve(numberOfContours);
+  roiContourData.HasReferencedSOPInstanceUID.reserve(numberOfContours);
+  roiContourData.ReferencedSOPInstanceUIDs.reserve(numberOfContours);
   do
   {
     // Get contour
@@ -2062,49 +2240,26 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
     }
 
     // Get number of contour points
-    OFString numberOfPointsString("");
-    contourItem.getNumberOfContourPoints(numberOfPointsString);
-    std::stringstream ss;
-    ss << numberOfPointsString;
-    int numberOfPoints;
-    ss >> numberOfPoints;
-
-    // Get contour point data
-    OFVector<vtkTypeFloat64> contourData_LPS;
-    contourItem.getContourData(contourData_LPS);
-    if (contourData_LPS.size() != size_t(numberOfPoints * 3))
-    {
-      vtkErrorWithObjectMacro(this->External, "LoadContour: Contour sequence object item is invalid: "
-        << " number of contour points is " << numberOfPoints << " therefore expected "
-        << numberOfPoints * 3 << " values in contour data but only found " << contourData_LPS.size());
-      continue;
-    }
-
-    unsigned int contourIndex = currentRoiContourCells->InsertNextCell(numberOfPoints+1);
-    for (int k=0; k<numberOfPoints; k++)
-    {
-      // Convert from DICOM LPS -> Slicer RAS
-      currentRoiContourPoints->InsertPoint(pointId, -contourData_LPS[3*k], -contourData_LPS[3*k+1], contourData_LPS[3*k+2]);
-      currentRoiContourCells->InsertCellPoint(pointId);
-      pointId++;
-    }
+    Sint32 numberOfPoints = 0;
+    contourItem.getNumberOfContourPoints(numberOfPoints);
 
-    // Close the contour
-    currentRoiContourCells->InsertCellPoint(pointId-numberOfPoints);
+    // Get contour point data as string. It is parsed when decoding the ROI
+    OFString contourDataString("");
+    contourItem.getContourData(contourDataString, -1);
 
-    // Add map to the referenced slice instance UID
+    // Get the referenced slice instance UID
     // This is not a mandatory field so no error logged if not found. The reason why
     // it is still read and stored is that it references the contours individually
+    bool hasReferencedSOPInstanceUID = false;
+    OFString referencedSOPInstanceUID("");
     DRTContourImageSequence &rtContourImageSequence = contourItem.getContourImageSequence();
     if (rtContourImageSequence.gotoFirstItem().good())
     {
       DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequence.getCurrentItem();
       if (rtContourImageSequenceItem.isValid())
       {
-        OFString referencedSOPInstanceUID("");
         rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID);
-        contourToSliceInstanceUIDMap[contourIndex] = referencedSOPInstanceUID.c_str();
-        referencedSopInstanceUids.insert(referencedSOPInstanceUID.c_str());
+        hasReferencedSOPInstanceUID = true;
 
         // Check if multiple SOP instance UIDs are referenced
         if (rtContourImageSequence.getNumberOfItems() > 1)
@@ -2117,9 +2272,141 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
         vtkErrorWithObjectMacro(this->External, "LoadContour: Contour image sequence object item is invalid");
       }
     }
+
+    roiContourData.ContourDataStrings.push_back(contourDataString);
+    roiContourData.NumberOfContourPoints.push_back(numberOfPoints);
+    roiContourData.HasReferencedSOPInstanceUID.push_back(hasReferencedSOPInstanceUID);
+    roiContourData.ReferencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID.c_str());
   }
   while (rtContourSequence.gotoNextItem().good());
 
+  // Get structure color
+  Sint32 roiDisplayColor = -1;
+  for (int j=0; j<3; j++)
+  {
+    roi.getROIDisplayColor(roiDisplayColor,j);
+    roiContourData.DisplayColor[j] = roiDisplayColor/255.0;
+  }
+
+  roiContourData.Roi = roiEntry;
+  return roiEntry;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomRtReader::vtkInternal::DecodeRoiContourData(RoiContourData& roiContourData)
+{
+  size_t numberOfContours = roiContourData.ContourDataStrings.size();
+  roiContourData.NumberOfContourDataValues.assign(numberOfContours, 0);
+  roiContourData.ContourValid.assign(numberOfContours, false);
+
+  // Parse all contours into one coordinate buffer, preallocated based on the number of contour points
+  vtkIdType expectedNumberOfPoints = 0;
+  for (Sint32 numberOfPoints : roiContourData.NumberOfContourPoints)
+  {
+    expectedNumberOfPoints += std::max<Sint32>(numberOfPoints, 0);
+  }
+  std::vector<double> contourData_LPS;
+  contourData_LPS.reserve(3 * expectedNumberOfPoints);
+  vtkIdType numberOfValidContours = 0;
+  for (size_t contourIndex=0; contourIndex<numberOfContours; ++contourIndex)
+  {
+    size_t contourDataStart = contourData_LPS.size();
+    size_t numberOfValues = ParseDecimalStringValues(roiContourData.ContourDataStrings[contourIndex].c_str(), contourData_LPS);
+    roiContourData.NumberOfContourDataValues[contourIndex] = numberOfValues;
+    Sint32 numberOfPoints = roiContourData.NumberOfContourPoints[contourIndex];
+    if (numberOfPoints <= 0 || numberOfValues != size_t(numberOfPoints) * 3)
+    {
+      contourData_LPS.resize(contourDataStart);
+      continue;
+    }
+    roiContourData.ContourValid[contourIndex] = true;
+    ++numberOfValidContours;
+  }
+
+  // Convert from DICOM LPS -> Slicer RAS
+  vtkIdType numberOfPoints = static_cast<vtkIdType>(contourData_LPS.size() / 3);
+  vtkSmartPointer<vtkPoints> roiContourPoints = vtkSmartPointer<vtkPoints>::New();
+  roiContourPoints->SetNumberOfPoints(numberOfPoints);
+  for (vtkIdType pointId=0; pointId<numberOfPoints; ++pointId)
+  {
+    roiContourPoints->SetPoint(pointId, -contourData_LPS[3*pointId], -contourData_LPS[3*pointId+1], contourData_LPS[3*pointId+2]);
+  }
+
+  // Create a closed polyline for each valid contour
+  vtkSmartPointer<vtkCellArray> roiContourCells = vtkSmartPointer<vtkCellArray>::New();
+  roiContourCells->Allocate(numberOfPoints + 2 * numberOfValidContours);
+  std::vector<vtkIdType> contourPointIds;
+  vtkIdType pointId = 0;
+  for (size_t contourIndex=0; contourIndex<numberOfContours; ++contourIndex)
+  {
+    if (!roiContourData.ContourValid[contourIndex])
+    {
+      continue;
+    }
+    vtkIdType numberOfContourPoints = roiContourData.NumberOfContourPoints[contourIndex];
+    contourPointIds.resize(numberOfContourPoints + 1);
+    for (vtkIdType k=0; k<numberOfContourPoints; ++k)
+    {
+      contourPointIds[k] = pointId + k;
+    }
+    // Close the contour
+    contourPointIds[numberOfContourPoints] = pointId;
+    roiContourCells->InsertNextCell(numberOfContourPoints + 1, contourPointIds.data());
+    pointId += numberOfContourPoints;
+  }
+
+  roiContourData.PolyData = vtkSmartPointer<vtkPolyData>::New();
+  roiContourData.PolyData->SetPoints(roiContourPoints);
+  if (numberOfPoints == 1)
+  {
+    // Point ROI
+    roiContourData.PolyData->SetVerts(roiContourCells);
+  }
+  else if (numberOfPoints > 1)
+  {
+    // Contour ROI
+    roiContourData.PolyData->SetLines(roiContourCells);
+  }
+
+  // Contour data strings are not needed any more
+  roiContourData.ContourDataStrings.clear();
+  roiContourData.ContourDataStrings.shrink_to_fit();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDicomRtReader::vtkInternal::StoreRoiContourData(RoiContourData& roiContourData, DRTStructureSetIOD* rtStructureSet)
+{
+  RoiEntry* roiEntry = roiContourData.Roi;
+  if (!roiEntry || !roiContourData.PolyData)
+  {
+    return;
+  }
+
+  // Used for connection from one planar contour ROI to the corresponding anatomical volume slice instance
+  std::map<int, std::string> contourToSliceInstanceUIDMap;
+  std::set<std::string> referencedSopInstanceUids;
+
+  // Map the cells of the valid contours to the referenced slice instance UIDs
+  int contourIndex = 0;
+  for (size_t contourItemIndex=0; contourItemIndex<roiContourData.ContourValid.size(); ++contourItemIndex)
+  {
+    if (!roiContourData.ContourValid[contourItemIndex])
+    {
+      Sint32 numberOfPoints = roiContourData.NumberOfContourPoints[contourItemIndex];
+      vtkErrorWithObjectMacro(this->External, "LoadContour: Contour sequence object item is invalid: "
+        << " number of contour points is " << numberOfPoints << " therefore expected "
+        << numberOfPoints * 3 << " values in contour data but only found " << roiContourData.NumberOfContourDataValues[contourItemIndex]);
+      continue;
+    }
+    if (roiContourData.HasReferencedSOPInstanceUID[contourItemIndex])
+    {
+      const std::string& referencedSOPInstanceUID = roiContourData.ReferencedSOPInstanceUIDs[contourItemIndex];
+      contourToSliceInstanceUIDMap[contourIndex] = referencedSOPInstanceUID;
+      referencedSopInstanceUids.insert(referencedSOPInstanceUID);
+    }
+    ++contourIndex;
+  }
+
   // Read slice reference UIDs from referenced frame of reference sequence if it was not included in the ROIContourSequence above
   if (contourToSliceInstanceUIDMap.empty())
   {
@@ -2152,27 +2439,8 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
   }
 
   // Save just loaded contour data into ROI entry
-  vtkSmartPointer<vtkPolyData> currentRoiPolyData = vtkSmartPointer<vtkPolyData>::New();
-  currentRoiPolyData->SetPoints(currentRoiContourPoints);
-  if (currentRoiContourPoints->GetNumberOfPoints() == 1)
-  {
-    // Point ROI
-    currentRoiPolyData->SetVerts(currentRoiContourCells);
-  }
-  else if (currentRoiContourPoints->GetNumberOfPoints() > 1)
-  {
-    // Contour ROI
-    currentRoiPolyData->SetLines(currentRoiContourCells);
-  }
-  roiEntry->SetPolyData(currentRoiPolyData);
-
-  // Get structure color
-  Sint32 roiDisplayColor = -1;
-  for (int j=0; j<3; j++)
-  {
-    roi.getROIDisplayColor(roiDisplayColor,j);
-    roiEntry->DisplayColor[j] = roiDisplayColor/255.0;
-  }
+  roiEntry->SetPolyData(roiContourData.PolyData);
+  roiEntry->DisplayColor = roiContourData.DisplayColor;
 
   // Set referenced SOP instance UIDs
   roiEntry->ContourIndexToSOPInstanceUIDMap = contourToSliceInstanceUIDMap;
@@ -2188,8 +2456,6 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
   // Strip last space
   serializedUidList = serializedUidList.substr(0, serializedUidList.size()-1);
   this->External->SetRTStructureSetReferencedSOPInstanceUIDs(serializedUidList.c_str());
-
-  return roiEntry;
 }
 
 //----------------------------------------------------------------------------
@@ -2806,6 +3072,29 @@ double vtkSlicerDicomRtReader::GetBeamControlPointBeamLimitingDeviceAngle( unsig
   return 0.0;
 }
 
+//----------------------------------------------------------------------------
+double vtkSlicerDicomRtReader::GetBeamControlPointCumulativeMetersetWeight( unsigned int beamNumber, 
+  unsigned int controlPointIndex)
+{
+  vtkInternal::BeamEntry* beam = this->Internal->FindBeamByNumber(beamNumber);
+  if (beam && (controlPointIndex < beam->ControlPointSequenceVector.size()))
+  {
+    vtkInternal::ControlPointEntry& controlPoint = beam->ControlPointSequenceVector.at(controlPointIndex);
+    return controlPoint.CumulativeMetersetWeight;
+  }
+  else if (!beam)
+  {
+    vtkErrorMacro("GetBeamControlPointCumulativeMetersetWeight: " \
+      "Unable to find beam of number" << beamNumber);
+  }
+  else
+  {
+    vtkErrorMacro("GetBeamControlPointCumulativeMetersetWeight: " \
+     "No control point sequence data for current beam: " << beam->Name);
+  }
+  return -1.0;
+}
+
 //----------------------------------------------------------------------------
 bool vtkSlicerDicomRtReader::GetBeamControlPointJawPositions( unsigned int beamNumber, 
   unsigned int controlPointIndex, double jawPositions[2][2])
@@ -2929,6 +3218,52 @@ bool vtkSlicerDicomRtReader::GetBeamControlPointScanSpotParameters( unsigned int
   return false;
 }
 
+//----------------------------------------------------------------------------
+unsigned int vtkSlicerDicomRtReader::GetBeamControlPointScanSpots( unsigned int beamNumber,
+  unsigned int controlPointIndex, const float*& positionMap,
+  const float*& metersetWeights, std::string& scanSpotTuneId)
+{
+  positionMap = nullptr;
+  metersetWeights = nullptr;
+  vtkInternal::BeamEntry* beam = this->Internal->FindBeamByNumber(beamNumber);
+  if (beam && (controlPointIndex < beam->ControlPointSequenceVector.size()))
+  {
+    vtkInternal::ControlPointEntry& controlPoint = beam->ControlPointSequenceVector.at(controlPointIndex);
+
+    const std::string& scanMode = beam->ScanMode;
+    if (scanMode != "MODULATED" && scanMode != "MODULATED_SPEC")
+    {
+      vtkWarningMacro("GetBeamControlPointScanSpots: ScanMode of the beam isn't MODULATED");
+      return 0;
+    }
+    const unsigned int& positions = controlPoint.NumberOfScanSpotPositions;
+    if (positions && (positions * 2 == controlPoint.ScanSpotPositionMap.size())
+      && (positions == controlPoint.ScanSpotMetersetWeights.size()))
+    {
+      positionMap = controlPoint.ScanSpotPositionMap.data();
+      metersetWeights = controlPoint.ScanSpotMetersetWeights.data();
+      scanSpotTuneId = controlPoint.ScanSpotTuneId;
+      return positions;
+    }
+    else
+    {
+      vtkWarningMacro("GetBeamControlPointScanSpots: " \
+       "Different number of scan spot positions in map or weights");
+    }
+  }
+  else if (!beam)
+  {
+    vtkErrorMacro("GetBeamControlPointScanSpots: " \
+      "Unable to find beam of number" << beamNumber);
+  }
+  else
+  {
+    vtkErrorMacro("GetBeamControlPointScanSpots: " \
+     "No control point sequence data for current beam: " << beam->Name);
+  }
+  return 0;
+}
+
 //----------------------------------------------------------------------------
 bool vtkSlicerDicomRtReader::GetBeamControlPointScanningSpotSize( unsigned int beamNumber, 
   unsigned int controlPointIndex, std::array< float, 2 >& ScanSpotSize)
@@ -125,6 +125,11 @@ public:
   double GetBeamControlPointBeamLimitingDeviceAngle( unsigned int beamNumber, 
     unsigned int controlPoint);
 
+  /// Get cumulative meterset weight for a given control point of a beam
+  /// \return Cumulative meterset weight, -1 if not specified
+  double GetBeamControlPointCumulativeMetersetWeight( unsigned int beamNumber, 
+    unsigned int controlPoint);
+
   /// Get jaw positions for a given control point of a beam
   /// \param jawPositions Array in which the jaw positions are copied
   /// \return true if jaw positions are valid, false otherwise 
@@ -140,6 +145,17 @@ public:
     unsigned int controlPointIndex, std::vector<float>& positionMap, 
     std::vector<float>& metersetWeights);
 
+  /// Get Scan spot position map, meterset weights and tune ID for a given
+  /// control point of a modulated ion beam without copying the spot data
+  /// \param positionMap Pointer to the interleaved (x,y) position map owned by the reader
+  /// \param metersetWeights Pointer to the meterset weights owned by the reader
+  /// \param scanSpotTuneId Scan spot tune ID of the control point
+  /// \return Number of scan spots, 0 if data is invalid. The pointers are valid
+  ///   until the reader is updated or deleted.
+  unsigned int GetBeamControlPointScanSpots( unsigned int beamNumber,
+    unsigned int controlPointIndex, const float*& positionMap,
+    const float*& metersetWeights, std::string& scanSpotTuneId);
+
   /// Get Scan spot size for a given control point of a modulated ion beam
   /// \param ScanSpotSize Array in which the raw scanning spot size is copied
   /// \return true if data is valid, false otherwise
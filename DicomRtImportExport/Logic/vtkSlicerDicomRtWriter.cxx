@@ -30,7 +30,7 @@
 #include <vtkObjectFactory.h>
 #include <vtkSmartPointer.h>
 #include <vtkPolyData.h>
-#include <vtkCell.h>
+#include <vtkCellArray.h>
 #include <vtkPoints.h>
 
 // ITK includes
@@ -130,9 +130,9 @@ void vtkSlicerDicomRtWriter::AddStructure(UCharImageType::Pointer itk_structure,
   
 //----------------------------------------------------------------------------
 void vtkSlicerDicomRtWriter::AddStructure(const char *name, double *color,
-                                          std::vector<int> sliceNumbers,
-                                          std::vector<std::string> sliceUIDs,
-                                          std::vector<vtkPolyData*> sliceContours )
+                                          const std::vector<int>& sliceNumbers,
+                                          const std::vector<std::string>& sliceUIDs,
+                                          const std::vector<vtkPolyData*>& sliceContours )
 {
   if (sliceNumbers.size() != sliceUIDs.size() || sliceNumbers.size() != sliceContours.size())
   {
@@ -158,19 +158,28 @@ void vtkSlicerDicomRtWriter::AddStructure(const char *name, double *color,
   for (size_t contourIndex=0; contourIndex<sliceContours.size(); ++contourIndex)
   {
     int sliceNumber = sliceNumbers[contourIndex];
-    std::string sliceUID = sliceUIDs[contourIndex];
+    const std::string& sliceUID = sliceUIDs[contourIndex];
     vtkPolyData* contourPolyData = sliceContours[contourIndex];
-    for (int cellIndex=0; cellIndex<contourPolyData->GetNumberOfCells(); ++cellIndex)
+    vtkPoints* points = contourPolyData->GetPoints();
+    vtkCellArray* polys = contourPolyData->GetPolys();
+    if (!points || !polys)
     {
-      vtkPoints* points = contourPolyData->GetCell(cellIndex)->GetPoints();
-      Rtss_contour* contour = roi->add_polyline(points->GetNumberOfPoints());
+      continue;
+    }
+
+    // Traverse the point IDs of the polygons directly instead of instantiating a cell for each
+    vtkIdType numberOfCellPoints = 0;
+    const vtkIdType* cellPointIds = nullptr;
+    for (polys->InitTraversal(); polys->GetNextCell(numberOfCellPoints, cellPointIds); )
+    {
+      Rtss_contour* contour = roi->add_polyline(numberOfCellPoints);
       contour->slice_no = sliceNumber;
       contour->ct_slice_uid = sliceUID;
 
-      for (int pointIndex=0; pointIndex<points->GetNumberOfPoints(); ++pointIndex)
+      for (vtkIdType pointIndex=0; pointIndex<numberOfCellPoints; ++pointIndex)
       {
         double point[3] = {0.0,0.0,0.0};
-        points->GetPoint(pointIndex, point);
+        points->GetPoint(cellPointIds[pointIndex], point);
         // RAS to LPS conversion
         contour->x[pointIndex] = point[0] * -1.0;
         contour->y[pointIndex] = point[1] * -1.0;
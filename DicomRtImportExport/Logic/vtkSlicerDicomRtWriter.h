@@ -57,9 +57,9 @@ public:
   /// The three argument vectors contain the slice numbers, UIDs and contours, and need to
   /// contain the same number of elements.
   void AddStructure(const char *name, double *color,
-                    std::vector<int> sliceNumbers,
-                    std::vector<std::string> sliceUIDs,
-                    std::vector<vtkPolyData*> sliceContours);
+                    const std::vector<int>& sliceNumbers,
+                    const std::vector<std::string>& sliceUIDs,
+                    const std::vector<vtkPolyData*>& sliceContours);
   /// Add
 
   /// TODO: Description, argument names and descriptions
@@ -0,0 +1,290 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DicomRtImportExport includes
+#include "vtkSegmentConversionCache.h"
+
+// SlicerRt includes
+#include "vtkSlicerRtCommon.h"
+
+// SegmentationCore includes
+#include <vtkOrientedImageData.h>
+#include <vtkSegment.h>
+#include <vtkSegmentationConverter.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  void CreateContourPolyData(vtkPolyData* polyData, double firstPointX)
+  {
+    vtkNew<vtkPoints> points;
+    points->InsertNextPoint(firstPointX, 0.0, 0.0);
+    points->InsertNextPoint(10.0, 0.0, 0.0);
+    points->InsertNextPoint(10.0, 10.0, 0.0);
+    points->InsertNextPoint(0.0, 10.0, 0.0);
+    vtkNew<vtkCellArray> lines;
+    vtkIdType pointIds[5] = { 0, 1, 2, 3, 0 };
+    lines->InsertNextCell(5, pointIds);
+    polyData->SetPoints(points);
+    polyData->SetLines(lines);
+  }
+
+  //-----------------------------------------------------------------------------
+  unsigned long GetNumberOfCacheEntries(const std::string& cacheDirectory)
+  {
+    vtksys::Directory directory;
+    if (!directory.Load(cacheDirectory))
+    {
+      return 0;
+    }
+    unsigned long numberOfEntries = 0;
+    for (unsigned long fileIndex = 0; fileIndex < directory.GetNumberOfFiles(); ++fileIndex)
+    {
+      std::string extension = vtksys::SystemTools::GetFilenameLastExtension(directory.GetFile(fileIndex));
+      if (extension == ".vtp" || extension == ".vti")
+      {
+        ++numberOfEntries;
+      }
+    }
+    return numberOfEntries;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSegmentConversionCacheTest1(int argc, char* argv[])
+{
+  // TemporaryDirectory
+  if (argc < 3 || std::string(argv[1]) != "-TemporaryDirectory")
+  {
+    std::cerr << "Invalid arguments!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string cacheDirectory(argv[2]);
+  std::cout << "Cache directory: " << cacheDirectory << std::endl;
+  vtksys::SystemTools::RemoveADirectory(cacheDirectory);
+
+  const std::string contourRepresentationName(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName());
+  const std::string conversionDescription("TestConversion");
+
+  vtkNew<vtkPolyData> contourPolyData;
+  CreateContourPolyData(contourPolyData, 0.0);
+  vtkNew<vtkSegment> segment;
+  segment->AddRepresentation(contourRepresentationName, contourPolyData);
+
+  // No caching without cache directory or without the tags of RT structure set segments
+  vtkSegmentConversionCache::SetCacheDirectory("");
+  segment->SetTag(vtkSlicerRtCommon::DICOMRTIMPORT_STRUCTURE_SET_SOP_INSTANCE_UID_SEGMENT_TAG_NAME, "1.2.3.4");
+  segment->SetTag(vtkSlicerRtCommon::DICOMRTIMPORT_ROI_NUMBER_SEGMENT_TAG_NAME, "1");
+  if (!vtkSegmentConversionCache::GetCacheKey(segment, contourRepresentationName, conversionDescription).empty())
+  {
+    std::cerr << __LINE__ << ": Cache key is not empty with disabled cache" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkSegmentConversionCache::SetCacheDirectory(cacheDirectory);
+  vtkNew<vtkSegment> untaggedSegment;
+  untaggedSegment->AddRepresentation(contourRepresentationName, contourPolyData);
+  if (!vtkSegmentConversionCache::GetCacheKey(untaggedSegment, contourRepresentationName, conversionDescription).empty())
+  {
+    std::cerr << __LINE__ << ": Cache key is not empty for segment not loaded from RT structure set" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Key is stable and changes with every input
+  std::string cacheKey = vtkSegmentConversionCache::GetCacheKey(segment, contourRepresentationName, conversionDescription);
+  if (cacheKey.empty() || cacheKey != vtkSegmentConversionCache::GetCacheKey(segment, contourRepresentationName, conversionDescription))
+  {
+    std::cerr << __LINE__ << ": Cache key is empty or not stable" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (cacheKey == vtkSegmentConversionCache::GetCacheKey(segment, contourRepresentationName, "OtherConversion"))
+  {
+    std::cerr << __LINE__ << ": Cache key does not change with conversion description" << std::endl;
+    return EXIT_FAILURE;
+  }
+  segment->SetTag(vtkSlicerRtCommon::DICOMRTIMPORT_ROI_NUMBER_SEGMENT_TAG_NAME, "2");
+  if (cacheKey == vtkSegmentConversionCache::GetCacheKey(segment, contourRepresentationName, conversionDescription))
+  {
+    std::cerr << __LINE__ << ": Cache key does not change with ROI number" << std::endl;
+    return EXIT_FAILURE;
+  }
+  segment->SetTag(vtkSlicerRtCommon::DICOMRTIMPORT_ROI_NUMBER_SEGMENT_TAG_NAME, "1");
+  vtkNew<vtkPolyData> movedContourPolyData;
+  CreateContourPolyData(movedContourPolyData, 0.5);
+  vtkNew<vtkSegment> movedSegment;
+  movedSegment->DeepCopy(segment);
+  movedSegment->AddRepresentation(contourRepresentationName, movedContourPolyData);
+  std::string movedCacheKey = vtkSegmentConversionCache::GetCacheKey(movedSegment, contourRepresentationName, conversionDescription);
+  if (movedCacheKey.empty() || cacheKey == movedCacheKey)
+  {
+    std::cerr << __LINE__ << ": Cache key does not change with contour points" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Poly data round trip
+  vtkNew<vtkPolyData> readPolyData;
+  if (vtkSegmentConversionCache::ReadPolyData(cacheKey, readPolyData))
+  {
+    std::cerr << __LINE__ << ": Poly data is read from empty cache" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!vtkSegmentConversionCache::WritePolyData(cacheKey, contourPolyData))
+  {
+    std::cerr << __LINE__ << ": Failed to write poly data to the cache" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if ( !vtkSegmentConversionCache::ReadPolyData(cacheKey, readPolyData)
+    || readPolyData->GetNumberOfPoints() != contourPolyData->GetNumberOfPoints()
+    || readPolyData->GetNumberOfLines() != contourPolyData->GetNumberOfLines() )
+  {
+    std::cerr << __LINE__ << ": Poly data read from the cache differs from the written one" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (vtkIdType pointIndex = 0; pointIndex < contourPolyData->GetNumberOfPoints(); ++pointIndex)
+  {
+    double writtenPoint[3] = { 0.0, 0.0, 0.0 };
+    double readPoint[3] = { 0.0, 0.0, 0.0 };
+    contourPolyData->GetPoint(pointIndex, writtenPoint);
+    readPolyData->GetPoint(pointIndex, readPoint);
+    if (vtkMath::Distance2BetweenPoints(writtenPoint, readPoint) > 1e-12)
+    {
+      std::cerr << __LINE__ << ": Point " << pointIndex << " read from the cache differs from the written one" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (vtkSegmentConversionCache::ReadPolyData(movedCacheKey, readPolyData))
+  {
+    std::cerr << __LINE__ << ": Poly data is read for a key that has not been written" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Oriented image data round trip, including the directions
+  vtkNew<vtkOrientedImageData> labelmap;
+  labelmap->SetExtent(0, 3, 0, 4, 0, 5);
+  labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  for (int k = 0; k <= 5; ++k)
+  {
+    for (int j = 0; j <= 4; ++j)
+    {
+      for (int i = 0; i <= 3; ++i)
+      {
+        *static_cast<unsigned char*>(labelmap->GetScalarPointer(i, j, k)) = static_cast<unsigned char>((i + j + k) % 2);
+      }
+    }
+  }
+  labelmap->SetSpacing(0.5, 1.0, 2.0);
+  labelmap->SetOrigin(-10.0, 20.0, 30.0);
+  double directions[3][3] = { { 0.0, 1.0, 0.0 }, { -1.0, 0.0, 0.0 }, { 0.0, 0.0, 1.0 } };
+  labelmap->SetDirections(directions);
+  if (!vtkSegmentConversionCache::WriteOrientedImageData(movedCacheKey, labelmap))
+  {
+    std::cerr << __LINE__ << ": Failed to write oriented image data to the cache" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkNew<vtkOrientedImageData> readLabelmap;
+  if (!vtkSegmentConversionCache::ReadOrientedImageData(movedCacheKey, readLabelmap))
+  {
+    std::cerr << __LINE__ << ": Failed to read oriented image data from the cache" << std::endl;
+    return EXIT_FAILURE;
+  }
+  int writtenExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  int readExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  labelmap->GetExtent(writtenExtent);
+  readLabelmap->GetExtent(readExtent);
+  double readDirections[3][3] = { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } };
+  readLabelmap->GetDirections(readDirections);
+  for (int i = 0; i < 6; ++i)
+  {
+    if (writtenExtent[i] != readExtent[i])
+    {
+      std::cerr << __LINE__ << ": Extent of the oriented image data read from the cache differs from the written one" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  for (int i = 0; i < 3; ++i)
+  {
+    if ( fabs(labelmap->GetSpacing()[i] - readLabelmap->GetSpacing()[i]) > 1e-9
+      || fabs(labelmap->GetOrigin()[i] - readLabelmap->GetOrigin()[i]) > 1e-9 )
+    {
+      std::cerr << __LINE__ << ": Geometry of the oriented image data read from the cache differs from the written one" << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (int j = 0; j < 3; ++j)
+    {
+      if (fabs(directions[i][j] - readDirections[i][j]) > 1e-9)
+      {
+        std::cerr << __LINE__ << ": Directions of the oriented image data read from the cache differ from the written ones" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  for (int k = 0; k <= 5; ++k)
+  {
+    for (int j = 0; j <= 4; ++j)
+    {
+      for (int i = 0; i <= 3; ++i)
+      {
+        if ( *static_cast<unsigned char*>(labelmap->GetScalarPointer(i, j, k))
+          != *static_cast<unsigned char*>(readLabelmap->GetScalarPointer(i, j, k)) )
+        {
+          std::cerr << __LINE__ << ": Voxel (" << i << ", " << j << ", " << k << ") read from the cache differs from the written one" << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  // Pruning keeps the cache within the maximum size
+  if (GetNumberOfCacheEntries(cacheDirectory) != 2)
+  {
+    std::cerr << __LINE__ << ": Unexpected number of cache entries: " << GetNumberOfCacheEntries(cacheDirectory) << std::endl;
+    return EXIT_FAILURE;
+  }
+  unsigned long long defaultMaximumCacheSize = vtkSegmentConversionCache::GetMaximumCacheSize();
+  vtkSegmentConversionCache::PruneCache();
+  if (GetNumberOfCacheEntries(cacheDirectory) != 2)
+  {
+    std::cerr << __LINE__ << ": Cache entries are removed below the maximum cache size" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkSegmentConversionCache::SetMaximumCacheSize(1);
+  vtkSegmentConversionCache::PruneCache();
+  vtkSegmentConversionCache::SetMaximumCacheSize(defaultMaximumCacheSize);
+  if (GetNumberOfCacheEntries(cacheDirectory) != 0)
+  {
+    std::cerr << __LINE__ << ": Cache entries are not removed above the maximum cache size" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (vtkSegmentConversionCache::ReadPolyData(cacheKey, readPolyData))
+  {
+    std::cerr << __LINE__ << ": Poly data is read from the cache after it has been pruned" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkSegmentConversionCache::SetCacheDirectory("");
+  vtksys::SystemTools::RemoveADirectory(cacheDirectory);
+
+  std::cout << "Segment conversion cache test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -38,6 +38,8 @@ class DicomRtImportTest(unittest.TestCase):
     self.TestSection_ImportStudy()
     self.TestSection_SelectLoadables()
     self.TestSection_LoadIntoSlicer()
+    self.TestSection_CompareLabelmapConversionPaths()
+    self.TestSection_LazyStructureSetLoading()
     self.TestSection_SaveScene()
     self.TestSection_ClearDatabase()
 
@@ -156,6 +158,134 @@ class DicomRtImportTest(unittest.TestCase):
     shNode = slicer.vtkMRMLSubjectHierarchyNode.GetSubjectHierarchyNode(slicer.mrmlScene)
     self.assertEqual( shNode.GetNumberOfItems(), 28 )
 
+  #------------------------------------------------------------------------------
+  def TestSection_CompareLabelmapConversionPaths(self):
+    # slicer.util.delayDisplay("Compare labelmap conversion paths",self.delayMs)
+    logging.info("Compare labelmap conversion paths")
+
+    # The direct planar contour to labelmap rule is cheaper than converting through the closed surface,
+    # so it is used by default. Make sure that the two paths give matching labelmaps.
+    planarContourName = slicer.vtkSegmentationConverter.GetSegmentationPlanarContourRepresentationName()
+    closedSurfaceName = slicer.vtkSegmentationConverter.GetSegmentationClosedSurfaceRepresentationName()
+    labelmapName = slicer.vtkSegmentationConverter.GetSegmentationBinaryLabelmapRepresentationName()
+    geometryParameterName = slicer.vtkSegmentationConverter.GetReferenceImageGeometryParameterName()
+
+    segmentationNode = slicer.util.getNode('vtkMRMLSegmentationNode*')
+    segmentation = segmentationNode.GetSegmentation()
+    numberOfComparedSegments = 0
+    for segmentIndex in range(segmentation.GetNumberOfSegments()):
+      contours = segmentation.GetNthSegment(segmentIndex).GetRepresentation(planarContourName)
+      if contours is None or contours.GetNumberOfLines() == 0:
+        continue
+
+      # Axis aligned reference geometry with 1mm spacing around the contours
+      bounds = contours.GetBounds()
+      referenceGeometry = slicer.vtkOrientedImageData()
+      referenceGeometry.SetOrigin(bounds[0] - 5.0, bounds[2] - 5.0, bounds[4] - 5.0)
+      referenceGeometry.SetSpacing(1.0, 1.0, 1.0)
+      referenceGeometry.SetExtent(0, int(bounds[1] - bounds[0]) + 10, 0, int(bounds[3] - bounds[2]) + 10, 0, int(bounds[5] - bounds[4]) + 10)
+      geometryString = slicer.vtkSegmentationConverter.SerializeImageGeometry(referenceGeometry)
+
+      directSegment = slicer.vtkSegment()
+      directSegment.AddRepresentation(planarContourName, contours)
+      directSegment.AddRepresentation(labelmapName, slicer.vtkOrientedImageData())
+      directRule = slicer.vtkPlanarContourToBinaryLabelmapConversionRule()
+      directRule.SetConversionParameter(geometryParameterName, geometryString)
+      self.assertTrue( directRule.Convert(directSegment) )
+
+      surfaceSegment = slicer.vtkSegment()
+      surfaceSegment.AddRepresentation(planarContourName, contours)
+      surfaceSegment.AddRepresentation(closedSurfaceName, vtk.vtkPolyData())
+      surfaceSegment.AddRepresentation(labelmapName, slicer.vtkOrientedImageData())
+      self.assertTrue( slicer.vtkPlanarContourToClosedSurfaceConversionRule().Convert(surfaceSegment) )
+      surfaceRule = slicer.vtkClosedSurfaceToBinaryLabelmapConversionRule()
+      surfaceRule.SetConversionParameter(geometryParameterName, geometryString)
+      self.assertTrue( surfaceRule.Convert(surfaceSegment) )
+
+      directVoxels = self.getLabelmapVoxels(directSegment.GetRepresentation(labelmapName), referenceGeometry)
+      surfaceVoxels = self.getLabelmapVoxels(surfaceSegment.GetRepresentation(labelmapName), referenceGeometry)
+      if surfaceVoxels.sum() < 1000:
+        # Small structures are dominated by the different handling of the end caps
+        continue
+      dice = 2.0 * (directVoxels & surfaceVoxels).sum() / (directVoxels.sum() + surfaceVoxels.sum())
+      logging.info('Labelmap conversion path Dice similarity for segment %d: %.3f' % (segmentIndex, dice))
+      self.assertGreater( dice, 0.9 )
+      numberOfComparedSegments += 1
+
+    self.assertGreater( numberOfComparedSegments, 0 )
+
+  #------------------------------------------------------------------------------
+  def TestSection_LazyStructureSetLoading(self):
+    # slicer.util.delayDisplay("Lazy structure set loading",self.delayMs)
+    logging.info("Lazy structure set loading")
+
+    planarContourName = slicer.vtkSegmentationConverter.GetSegmentationPlanarContourRepresentationName()
+    roiBoundsTagName = 'DicomRtImport.RoiBounds'
+
+    # Bounds are only stored for deferred contours
+    eagerSegmentation = slicer.util.getNode('vtkMRMLSegmentationNode*').GetSegmentation()
+    for segmentIndex in range(eagerSegmentation.GetNumberOfSegments()):
+      self.assertFalse( eagerSegmentation.GetNthSegment(segmentIndex).HasTag(roiBoundsTagName) )
+
+    # Load the structure set again with deferred contours
+    structureSetLoadable = None
+    for plugin in self.dicomWidget.browserWidget.loadablesByPlugin:
+      if plugin.loadType != 'RT':
+        continue
+      for loadable in self.dicomWidget.browserWidget.loadablesByPlugin[plugin]:
+        if slicer.dicomDatabase.fileValue(loadable.files[0], '0008,0060') == 'RTSTRUCT':
+          structureSetLoadable = loadable
+    self.assertIsNotNone( structureSetLoadable )
+    vtkLoadable = slicer.vtkSlicerDICOMLoadable()
+    structureSetLoadable.copyToVtkLoadable(vtkLoadable)
+    rtLogic = slicer.modules.dicomrtimportexport.logic()
+    rtLogic.SetLazyStructureSetLoading(True)
+    try:
+      self.assertTrue( rtLogic.LoadDicomRT(vtkLoadable) )
+    finally:
+      rtLogic.SetLazyStructureSetLoading(False)
+
+    segmentationNodes = slicer.mrmlScene.GetNodesByClass('vtkMRMLSegmentationNode')
+    self.assertEqual( segmentationNodes.GetNumberOfItems(), 2 )
+    segmentationNode = segmentationNodes.GetItemAsObject(1)
+    segmentation = segmentationNode.GetSegmentation()
+    self.assertEqual( segmentation.GetNumberOfSegments(), eagerSegmentation.GetNumberOfSegments() )
+    self.assertGreater( segmentation.GetNumberOfSegments(), 1 )
+    segmentIDs = [segmentation.GetNthSegmentID(segmentIndex) for segmentIndex in range(segmentation.GetNumberOfSegments())]
+    # Segments are in ROI order in both segmentations
+    expectedNumberOfPoints = [eagerSegmentation.GetNthSegment(segmentIndex).GetRepresentation(planarContourName).GetNumberOfPoints()
+      for segmentIndex in range(eagerSegmentation.GetNumberOfSegments())]
+    for segmentID in segmentIDs:
+      self.assertTrue( rtLogic.IsSegmentContoursDeferred(segmentationNode, segmentID) )
+      self.assertTrue( segmentation.GetSegment(segmentID).HasTag(roiBoundsTagName) )
+      self.assertEqual( segmentation.GetSegment(segmentID).GetRepresentation(planarContourName).GetNumberOfPoints(), 0 )
+
+    # Showing a segment only loads the contours of that segment
+    shownSegmentIndex = 0
+    shownSegmentID = segmentIDs[shownSegmentIndex]
+    segmentationNode.GetDisplayNode().SetSegmentVisibility(shownSegmentID, True)
+    for segmentIndex, segmentID in enumerate(segmentIDs):
+      self.assertEqual( rtLogic.IsSegmentContoursDeferred(segmentationNode, segmentID), segmentIndex != shownSegmentIndex )
+    self.assertEqual( segmentation.GetSegment(shownSegmentID).GetRepresentation(planarContourName).GetNumberOfPoints(),
+      expectedNumberOfPoints[shownSegmentIndex] )
+
+    # Requesting a new representation loads the contours of all segments
+    ribbonModelName = slicer.vtkPlanarContourToRibbonModelConversionRule().GetTargetRepresentationName()
+    self.assertTrue( segmentation.CreateRepresentation(ribbonModelName) )
+    for segmentIndex, segmentID in enumerate(segmentIDs):
+      self.assertFalse( rtLogic.IsSegmentContoursDeferred(segmentationNode, segmentID) )
+      self.assertEqual( segmentation.GetSegment(segmentID).GetRepresentation(planarContourName).GetNumberOfPoints(),
+        expectedNumberOfPoints[segmentIndex] )
+      self.assertIsNotNone( segmentation.GetSegment(segmentID).GetRepresentation(ribbonModelName) )
+
+  #------------------------------------------------------------------------------
+  def getLabelmapVoxels(self, labelmap, referenceGeometry):
+    # Resample into the full reference extent so that labelmaps can be compared voxel by voxel
+    resampledLabelmap = slicer.vtkOrientedImageData()
+    self.assertTrue( slicer.vtkOrientedImageDataResample.ResampleOrientedImageToReferenceOrientedImage(labelmap, referenceGeometry, resampledLabelmap) )
+    import vtk.util.numpy_support
+    return vtk.util.numpy_support.vtk_to_numpy(resampledLabelmap.GetPointData().GetScalars()) > 0
+
   #------------------------------------------------------------------------------
   def TestSection_SaveScene(self):
     # slicer.util.delayDisplay("Save scene",self.delayMs)
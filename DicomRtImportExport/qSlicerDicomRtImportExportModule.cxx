@@ -23,9 +23,11 @@
 #include "qSlicerDicomRtImportExportModule.h"
 #include "qSlicerDicomRtImportExportModuleWidget.h"
 #include "vtkSlicerDicomRtImportExportModuleLogic.h"
+#include "vtkSegmentConversionCache.h"
 
 // Qt includes
 #include <QDebug> 
+#include <QSettings>
 
 // Slicer includes
 #include <qSlicerCoreApplication.h>
@@ -120,6 +122,16 @@ void qSlicerDicomRtImportExportModule::setup()
   // Register Subject Hierarchy plugins
   qSlicerSubjectHierarchyPluginHandler::instance()->registerPlugin(new qSlicerSubjectHierarchyRtImagePlugin());
   qSlicerSubjectHierarchyPluginHandler::instance()->registerPlugin(new qSlicerSubjectHierarchyRtDoseVolumePlugin());
+
+  // Store converted representations of the structures next to the DICOM database, so that
+  // converting the same structure set again (e.g. when loaded in a later session) is fast.
+  // The cache is pruned when it is first written, so that startup does not wait for scanning the directory.
+  QSettings settings;
+  QString databaseDirectory = settings.value("DatabaseDirectory").toString();
+  if (!databaseDirectory.isEmpty())
+  {
+    vtkSegmentConversionCache::SetCacheDirectory(databaseDirectory.toStdString() + "/SlicerRtConversionCache");
+  }
 }
 
 //-----------------------------------------------------------------------------
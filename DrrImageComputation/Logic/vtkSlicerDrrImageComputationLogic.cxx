@@ -35,6 +35,7 @@
 #include <vtkMRMLMarkupsFiducialNode.h>
 #include <vtkMRMLMarkupsLineNode.h>
 #include <vtkMRMLTableNode.h>
+#include <vtkMRMLSequenceNode.h>
 
 // SlicerRT Beams MRML includes
 #include <vtkMRMLRTBeamNode.h>
@@ -67,9 +68,17 @@
 #include <vtkMath.h>
 #include <vtkPlane.h>
 #include <vtkTable.h>
+#include <vtkImageData.h>
+#include <vtkCollection.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
 
 // std includes
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <limits>
+#include <sstream>
 
 // SlicerRT includes
 #include <vtkSlicerRtCommon.h>
@@ -82,12 +91,385 @@ const char* vtkSlicerDrrImageComputationLogic::VUP_VECTOR_MARKUPS_NODE_NAME = "V
 
 const char* vtkSlicerDrrImageComputationLogic::RTIMAGE_TRANSFORM_NODE_NAME = "DrrImageComputationTransform";
 
+namespace
+{
+  /// Plastimatch conversion of Hounsfield units into linear attenuation coefficient (1/mm),
+  /// relative to the attenuation of water at the mean energy of a diagnostic x-ray beam
+  inline float AttenuationFromHounsfieldUnits(double hu)
+  {
+    const double minimumHU = -800.;
+    const double waterAttenuation = 0.022;
+    return (hu <= minimumHU) ? 0.f : static_cast<float>((hu / 1000.) * waterAttenuation + waterAttenuation);
+  }
+
+  /// Threshold CT voxels and convert them to attenuation coefficients in one pass.
+  /// Voxel ranges are independent, so they are processed concurrently.
+  template <class T>
+  class AttenuationFunctor
+  {
+  public:
+    AttenuationFunctor(const T* ctValues, float* attenuationValues, int thresholdBelow, bool huConversion)
+      : CtValues(ctValues)
+      , AttenuationValues(attenuationValues)
+      , ThresholdBelow(thresholdBelow)
+      , HUConversion(huConversion)
+    {
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+      for (vtkIdType index = begin; index < end; ++index)
+      {
+        double value = static_cast<double>(this->CtValues[index]);
+        // Same as the threshold filter of the slicer_plastimatch_drr CLI
+        if (this->ThresholdBelow > -1000 && value < this->ThresholdBelow)
+        {
+          value = -1000.;
+        }
+        this->AttenuationValues[index] = this->HUConversion ? AttenuationFromHounsfieldUnits(value) : static_cast<float>(value);
+      }
+    }
+
+  private:
+    const T* CtValues;
+    float* AttenuationValues;
+    int ThresholdBelow;
+    bool HUConversion;
+  };
+
+  template <class T>
+  void ConvertToAttenuation(const T* ctValues, float* attenuationValues, vtkIdType numberOfValues, int thresholdBelow, bool huConversion)
+  {
+    AttenuationFunctor<T> attenuationFunctor(ctValues, attenuationValues, thresholdBelow, huConversion);
+    vtkSMPTools::For(0, numberOfValues, attenuationFunctor);
+  }
+
+  /// Cast rays from the x-ray source through every pixel of the image window and
+  /// integrate the attenuation along them. Rays are traversed in the IJK coordinate
+  /// system of the attenuation image, one detector row per work item.
+  class DrrRayCastFunctor
+  {
+  public:
+    DrrRayCastFunctor(const float* attenuationValues, const int dimensions[3], bool exactAlgorithm, double stepSize)
+      : AttenuationValues(attenuationValues)
+      , ExactAlgorithm(exactAlgorithm)
+      , StepSize(stepSize)
+      , Columns(0)
+      , DrrValues(nullptr)
+      , AbortCount(nullptr)
+      , AbortCountAtStart(0)
+    {
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        this->Dimensions[axis] = dimensions[axis];
+        this->SourceIJK[axis] = this->SourceLPS[axis] = 0.;
+        this->FirstPixelIJK[axis] = this->FirstPixelLPS[axis] = 0.;
+        this->ColumnStepIJK[axis] = this->ColumnStepLPS[axis] = 0.;
+        this->RowStepIJK[axis] = this->RowStepLPS[axis] = 0.;
+      }
+    }
+
+    /// Imager geometry of the projection.
+    /// Pixel position is (firstPixel + column * columnStep + row * rowStep)
+    void SetGeometry(int columns, const double sourceLPS[3], const double firstPixelLPS[3],
+      const double columnStepLPS[3], const double rowStepLPS[3], vtkMatrix4x4* lpsToIjkMatrix)
+    {
+      this->Columns = columns;
+      double sourceLPS4[4] = { sourceLPS[0], sourceLPS[1], sourceLPS[2], 1. };
+      double firstPixelLPS4[4] = { firstPixelLPS[0], firstPixelLPS[1], firstPixelLPS[2], 1. };
+      double columnStepLPS4[4] = { columnStepLPS[0], columnStepLPS[1], columnStepLPS[2], 0. };
+      double rowStepLPS4[4] = { rowStepLPS[0], rowStepLPS[1], rowStepLPS[2], 0. };
+      double point[4] = {};
+      lpsToIjkMatrix->MultiplyPoint(sourceLPS4, point);
+      std::copy(point, point + 3, this->SourceIJK);
+      lpsToIjkMatrix->MultiplyPoint(firstPixelLPS4, point);
+      std::copy(point, point + 3, this->FirstPixelIJK);
+      lpsToIjkMatrix->MultiplyPoint(columnStepLPS4, point);
+      std::copy(point, point + 3, this->ColumnStepIJK);
+      lpsToIjkMatrix->MultiplyPoint(rowStepLPS4, point);
+      std::copy(point, point + 3, this->RowStepIJK);
+      std::copy(sourceLPS, sourceLPS + 3, this->SourceLPS);
+      std::copy(firstPixelLPS, firstPixelLPS + 3, this->FirstPixelLPS);
+      std::copy(columnStepLPS, columnStepLPS + 3, this->ColumnStepLPS);
+      std::copy(rowStepLPS, rowStepLPS + 3, this->RowStepLPS);
+    }
+
+    void SetOutput(float* drrValues)
+    {
+      this->DrrValues = drrValues;
+    }
+
+    /// Skip the remaining rows once the abort count differs from its value at the start
+    void SetAbortCount(const std::atomic<unsigned int>* abortCount, unsigned int abortCountAtStart)
+    {
+      this->AbortCount = abortCount;
+      this->AbortCountAtStart = abortCountAtStart;
+    }
+
+    bool IsAborted() const
+    {
+      return this->AbortCount && this->AbortCount->load() != this->AbortCountAtStart;
+    }
+
+    void operator()(vtkIdType beginRow, vtkIdType endRow)
+    {
+      for (vtkIdType row = beginRow; row < endRow; ++row)
+      {
+        this->CastRow(row);
+      }
+    }
+
+    /// Cast rays through all pixels of a detector row
+    void CastRow(vtkIdType row) const
+    {
+      if (this->IsAborted())
+      {
+        return;
+      }
+      float* drrRow = this->DrrValues + row * this->Columns;
+      for (int column = 0; column < this->Columns; ++column)
+      {
+        double pixelIJK[3], pixelLPS[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+          pixelIJK[axis] = this->FirstPixelIJK[axis] + column * this->ColumnStepIJK[axis] + row * this->RowStepIJK[axis];
+          pixelLPS[axis] = this->FirstPixelLPS[axis] + column * this->ColumnStepLPS[axis] + row * this->RowStepLPS[axis];
+        }
+        drrRow[column] = static_cast<float>(this->CastRay(pixelIJK, sqrt(vtkMath::Distance2BetweenPoints(this->SourceLPS, pixelLPS))));
+      }
+    }
+
+  private:
+    /// Integrate attenuation along the segment from the source to the pixel
+    /// \param pixelIJK Position of the detector pixel in IJK coordinates
+    /// \param rayLength Length of the segment in mm
+    double CastRay(const double pixelIJK[3], double rayLength) const
+    {
+      double direction[3] = {};
+      double tEnter = 0.;
+      double tExit = 1.;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        direction[axis] = pixelIJK[axis] - this->SourceIJK[axis];
+        // Voxel i covers [i - 0.5, i + 0.5)
+        double lower = -0.5;
+        double upper = this->Dimensions[axis] - 0.5;
+        if (fabs(direction[axis]) < 1e-12)
+        {
+          if (this->SourceIJK[axis] < lower || this->SourceIJK[axis] >= upper)
+          {
+            return 0.;
+          }
+          continue;
+        }
+        double t0 = (lower - this->SourceIJK[axis]) / direction[axis];
+        double t1 = (upper - this->SourceIJK[axis]) / direction[axis];
+        tEnter = std::max(tEnter, std::min(t0, t1));
+        tExit = std::min(tExit, std::max(t0, t1));
+      }
+      if (tEnter >= tExit || rayLength <= 0.)
+      {
+        return 0.;
+      }
+
+      const vtkIdType sliceSize = static_cast<vtkIdType>(this->Dimensions[0]) * this->Dimensions[1];
+      double sum = 0.;
+      if (!this->ExactAlgorithm)
+      {
+        // Uniform: sample nearest voxel at fixed steps
+        double stepT = this->StepSize / rayLength;
+        for (double t = tEnter + stepT / 2.; t < tExit; t += stepT)
+        {
+          int index[3];
+          bool inside = true;
+          for (int axis = 0; axis < 3 && inside; ++axis)
+          {
+            index[axis] = static_cast<int>(floor(this->SourceIJK[axis] + t * direction[axis] + 0.5));
+            inside = index[axis] >= 0 && index[axis] < this->Dimensions[axis];
+          }
+          if (inside)
+          {
+            sum += this->AttenuationValues[index[2] * sliceSize + static_cast<vtkIdType>(index[1]) * this->Dimensions[0] + index[0]];
+          }
+        }
+        return sum * this->StepSize;
+      }
+
+      // Exact: sum attenuation weighted by the intersection length of each traversed voxel
+      int index[3], step[3];
+      double tNext[3], tDelta[3];
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        double position = this->SourceIJK[axis] + tEnter * direction[axis];
+        if (direction[axis] > 0.)
+        {
+          index[axis] = static_cast<int>(floor(position + 0.5));
+        }
+        else
+        {
+          index[axis] = static_cast<int>(ceil(position + 0.5)) - 1;
+        }
+        index[axis] = std::max(0, std::min(this->Dimensions[axis] - 1, index[axis]));
+
+        if (fabs(direction[axis]) < 1e-12)
+        {
+          step[axis] = 0;
+          tNext[axis] = std::numeric_limits<double>::max();
+          tDelta[axis] = std::numeric_limits<double>::max();
+        }
+        else
+        {
+          step[axis] = (direction[axis] > 0.) ? 1 : -1;
+          double boundary = index[axis] + 0.5 * step[axis];
+          tNext[axis] = (boundary - this->SourceIJK[axis]) / direction[axis];
+          tDelta[axis] = 1. / fabs(direction[axis]);
+        }
+      }
+
+      double t = tEnter;
+      while (t < tExit)
+      {
+        int axis = (tNext[0] < tNext[1]) ? ((tNext[0] < tNext[2]) ? 0 : 2) : ((tNext[1] < tNext[2]) ? 1 : 2);
+        double tEnd = std::min(tNext[axis], tExit);
+        sum += (tEnd - t) * this->AttenuationValues[index[2] * sliceSize + static_cast<vtkIdType>(index[1]) * this->Dimensions[0] + index[0]];
+        t = tEnd;
+        index[axis] += step[axis];
+        if (index[axis] < 0 || index[axis] >= this->Dimensions[axis])
+        {
+          break;
+        }
+        tNext[axis] += tDelta[axis];
+      }
+      return sum * rayLength;
+    }
+
+    const float* AttenuationValues;
+    int Dimensions[3];
+    bool ExactAlgorithm;
+    double StepSize;
+    int Columns;
+    double SourceIJK[3];
+    double FirstPixelIJK[3];
+    double ColumnStepIJK[3];
+    double RowStepIJK[3];
+    double SourceLPS[3];
+    double FirstPixelLPS[3];
+    double ColumnStepLPS[3];
+    double RowStepLPS[3];
+    float* DrrValues;
+    const std::atomic<unsigned int>* AbortCount;
+    unsigned int AbortCountAtStart;
+  };
+
+  /// Project several views at once. Work items are the detector rows of all views,
+  /// so that a few views with many rows and many views with few rows are balanced alike.
+  class DrrBatchRayCastFunctor
+  {
+  public:
+    DrrBatchRayCastFunctor(const std::vector<DrrRayCastFunctor>& viewFunctors, int rows)
+      : ViewFunctors(viewFunctors)
+      , Rows(rows)
+    {
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+      for (vtkIdType index = begin; index < end; ++index)
+      {
+        this->ViewFunctors[index / this->Rows].CastRow(index % this->Rows);
+      }
+    }
+
+  private:
+    const std::vector<DrrRayCastFunctor>& ViewFunctors;
+    int Rows;
+  };
+
+  /// Intensity mapping, rescale and invert of a DRR image, same as in slicer_plastimatch_drr CLI.
+  /// Rescaling to the autoscale range supersedes plastimatch autoscaling.
+  void MapDrrIntensities(float* drrValues, vtkIdType numberOfPixels, bool exponentialMapping,
+    const float autoscaleRange[2], bool invertIntensity)
+  {
+    if (exponentialMapping)
+    {
+      for (vtkIdType i = 0; i < numberOfPixels; ++i)
+      {
+        drrValues[i] = static_cast<float>(exp(-1. * drrValues[i]));
+      }
+    }
+    std::pair<float*, float*> minMax = std::minmax_element( drrValues, drrValues + numberOfPixels);
+    double drrMinimum = *minMax.first;
+    double drrRange = *minMax.second - drrMinimum;
+    double scale = (drrRange > 0.) ? (autoscaleRange[1] - autoscaleRange[0]) / drrRange : 0.;
+    for (vtkIdType i = 0; i < numberOfPixels; ++i)
+    {
+      double value = autoscaleRange[0] + (drrValues[i] - drrMinimum) * scale;
+      drrValues[i] = static_cast<float>(invertIntensity ? (autoscaleRange[0] - value) : value);
+    }
+  }
+
+  /// Intensity mapping of every view of a DRR image stack
+  class DrrIntensityFunctor
+  {
+  public:
+    DrrIntensityFunctor(float* drrValues, vtkIdType numberOfPixels, bool exponentialMapping,
+      const float autoscaleRange[2], bool invertIntensity)
+      : DrrValues(drrValues)
+      , NumberOfPixels(numberOfPixels)
+      , ExponentialMapping(exponentialMapping)
+      , InvertIntensity(invertIntensity)
+    {
+      this->AutoscaleRange[0] = autoscaleRange[0];
+      this->AutoscaleRange[1] = autoscaleRange[1];
+    }
+
+    void operator()(vtkIdType beginView, vtkIdType endView)
+    {
+      for (vtkIdType view = beginView; view < endView; ++view)
+      {
+        MapDrrIntensities( this->DrrValues + view * this->NumberOfPixels, this->NumberOfPixels,
+          this->ExponentialMapping, this->AutoscaleRange, this->InvertIntensity);
+      }
+    }
+
+  private:
+    float* DrrValues;
+    vtkIdType NumberOfPixels;
+    bool ExponentialMapping;
+    float AutoscaleRange[2];
+    bool InvertIntensity;
+  };
+
+  /// Set geometry of a DRR volume node to the one of the DRR image loaded
+  /// by the slicer_plastimatch_drr CLI (LPS, imager spacing)
+  void SetDrrVolumeGeometry(vtkMRMLScalarVolumeNode* drrVolumeNode, const double imagerSpacing[2])
+  {
+    double directions[3][3] = { { -1., 0., 0. }, { 0., -1., 0. }, { 0., 0., 1. } };
+    drrVolumeNode->SetSpacing( imagerSpacing[0], imagerSpacing[1], 1.);
+    drrVolumeNode->SetOrigin( 0., 0., 0.);
+    drrVolumeNode->SetIJKToRASDirections(directions);
+  }
+
+  /// Copy one view of a DRR image stack into a separate image
+  void ExtractDrrView(vtkImageData* drrStackImageData, int view, vtkImageData* drrImageData)
+  {
+    int dimensions[3] = {};
+    drrStackImageData->GetDimensions(dimensions);
+    vtkIdType numberOfPixels = static_cast<vtkIdType>(dimensions[0]) * dimensions[1];
+    drrImageData->SetExtent( 0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, 0);
+    drrImageData->AllocateScalars( VTK_FLOAT, 1);
+    const float* viewValues = static_cast<const float*>(drrStackImageData->GetScalarPointer()) + view * numberOfPixels;
+    std::copy( viewValues, viewValues + numberOfPixels, static_cast<float*>(drrImageData->GetScalarPointer()));
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerDrrImageComputationLogic);
 
 //----------------------------------------------------------------------------
 vtkSlicerDrrImageComputationLogic::vtkSlicerDrrImageComputationLogic()
   : PlastimatchDRRComputationLogic(nullptr)
+  , DrrImageComputationAbortCount(0)
 {
 }
 
@@ -1097,17 +1479,7 @@ vtkMRMLScalarVolumeNode* vtkSlicerDrrImageComputationLogic::ComputePlastimatchDR
 
   if (drrVolumeNode->GetImageData() && drrVolumeNode->GetSpacing())
   {
-    // Set more user friendly DRR image name
-    std::string drrName = scene->GenerateUniqueName(std::string("DRR : ") + std::string(beamNode->GetName()));
-    drrVolumeNode->SetName(drrName.c_str());
-
-    // Create parameter node name, and observe calculated drr volume
-    std::string parameterSetNodeName;
-    parameterSetNodeName = vtkMRMLPlanarImageNode::PLANARIMAGE_PARAMETER_SET_BASE_NAME_PREFIX + drrName;
-    parameterNode->SetName(parameterSetNodeName.c_str());
-    parameterNode->SetAndObserveRtImageVolumeNode(drrVolumeNode);
-
-    if (this->SetupDisplayAndSubjectHierarchyNodes( parameterNode, drrVolumeNode))
+    if (this->SetupDrrVolumeNode( parameterNode, drrVolumeNode))
     {
       return drrVolumeNode.GetPointer();
     }
@@ -1115,6 +1487,650 @@ vtkMRMLScalarVolumeNode* vtkSlicerDrrImageComputationLogic::ComputePlastimatchDR
   return nullptr;
 }
 
+//------------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkSlicerDrrImageComputationLogic::ComputeDRR( vtkMRMLDrrImageComputationNode* parameterNode,
+  vtkMRMLScalarVolumeNode* ctVolumeNode)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene)
+  {
+    vtkErrorMacro("ComputeDRR: Invalid MRML scene");
+    return nullptr;
+  }
+
+  if (!parameterNode)
+  {
+    vtkErrorMacro("ComputeDRR: Invalid parameter node");
+    return nullptr;
+  }
+
+  vtkMRMLRTBeamNode* beamNode = parameterNode->GetBeamNode();
+  if (!beamNode)
+  {
+    vtkErrorMacro("ComputeDRR: Invalid RT Beam node");
+    return nullptr;
+  }
+
+  if (!ctVolumeNode)
+  {
+    vtkErrorMacro("ComputeDRR: Invalid input CT volume node");
+    return nullptr;
+  }
+
+  vtkNew<vtkImageData> attenuationImageData;
+  vtkNew<vtkMatrix4x4> attenuationIjkToLpsMatrix;
+  if (!this->ComputeAttenuationImageData( parameterNode, ctVolumeNode, attenuationImageData, attenuationIjkToLpsMatrix))
+  {
+    vtkErrorMacro("ComputeDRR: Failed to compute attenuation image");
+    return nullptr;
+  }
+
+  vtkNew<vtkImageData> drrImageData;
+  if (!this->ComputeDrrImageData( parameterNode, attenuationImageData, attenuationIjkToLpsMatrix, drrImageData))
+  {
+    vtkErrorMacro("ComputeDRR: Failed to compute DRR image");
+    return nullptr;
+  }
+
+  double imagerSpacing[2] = { 0.25, 0.25 };
+  parameterNode->GetImagerSpacing(imagerSpacing);
+
+  // Create node for the DRR image volume
+  vtkNew<vtkMRMLScalarVolumeNode> drrVolumeNode;
+  SetDrrVolumeImageData( drrVolumeNode, drrImageData, imagerSpacing);
+  scene->AddNode(drrVolumeNode);
+
+  if (this->SetupDrrVolumeNode( parameterNode, drrVolumeNode))
+  {
+    return drrVolumeNode.GetPointer();
+  }
+  return nullptr;
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSequenceNode* vtkSlicerDrrImageComputationLogic::ComputeBatchDRR( vtkMRMLDrrImageComputationNode* parameterNode,
+  vtkMRMLScalarVolumeNode* ctVolumeNode)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene)
+  {
+    vtkErrorMacro("ComputeBatchDRR: Invalid MRML scene");
+    return nullptr;
+  }
+
+  if (!parameterNode)
+  {
+    vtkErrorMacro("ComputeBatchDRR: Invalid parameter node");
+    return nullptr;
+  }
+
+  if (!ctVolumeNode)
+  {
+    vtkErrorMacro("ComputeBatchDRR: Invalid input CT volume node");
+    return nullptr;
+  }
+
+  int numberOfViews = parameterNode->GetNumberOfBatchViews();
+  if (!numberOfViews)
+  {
+    vtkErrorMacro("ComputeBatchDRR: No batch views are set in parameter node");
+    return nullptr;
+  }
+
+  vtkNew<vtkDoubleArray> gantryCouchAngles;
+  gantryCouchAngles->SetNumberOfComponents(2);
+  gantryCouchAngles->SetNumberOfTuples(numberOfViews);
+  for (int view = 0; view < numberOfViews; ++view)
+  {
+    double angles[2] = {};
+    parameterNode->GetBatchView( view, angles);
+    gantryCouchAngles->SetTypedTuple( view, angles);
+  }
+
+  // Attenuation image is computed once for all views
+  vtkNew<vtkImageData> attenuationImageData;
+  vtkNew<vtkMatrix4x4> attenuationIjkToLpsMatrix;
+  if (!this->ComputeAttenuationImageData( parameterNode, ctVolumeNode, attenuationImageData, attenuationIjkToLpsMatrix))
+  {
+    vtkErrorMacro("ComputeBatchDRR: Failed to compute attenuation image");
+    return nullptr;
+  }
+
+  vtkNew<vtkImageData> drrStackImageData;
+  if (!this->ComputeDrrImageDataBatch( parameterNode, attenuationImageData, attenuationIjkToLpsMatrix,
+    gantryCouchAngles, drrStackImageData))
+  {
+    vtkErrorMacro("ComputeBatchDRR: Failed to compute DRR images");
+    return nullptr;
+  }
+
+  double imagerSpacing[2] = { 0.25, 0.25 };
+  parameterNode->GetImagerSpacing(imagerSpacing);
+
+  std::string sequenceName = scene->GenerateUniqueName(std::string("DRR : ") + std::string(ctVolumeNode->GetName()));
+  vtkMRMLSequenceNode* sequenceNode = vtkMRMLSequenceNode::SafeDownCast(
+    scene->AddNewNodeByClass( "vtkMRMLSequenceNode", sequenceName));
+  sequenceNode->SetIndexName("view");
+  sequenceNode->SetIndexUnit("");
+  sequenceNode->SetIndexType(vtkMRMLSequenceNode::NumericIndex);
+
+  for (int view = 0; view < numberOfViews; ++view)
+  {
+    vtkNew<vtkImageData> drrImageData;
+    ExtractDrrView( drrStackImageData, view, drrImageData);
+
+    double angles[2] = {};
+    gantryCouchAngles->GetTypedTuple( view, angles);
+    std::ostringstream viewNameStream;
+    viewNameStream << "DRR : G" << angles[0] << " C" << angles[1];
+
+    vtkNew<vtkMRMLScalarVolumeNode> drrVolumeNode;
+    drrVolumeNode->SetName(viewNameStream.str().c_str());
+    drrVolumeNode->SetAndObserveImageData(drrImageData);
+    SetDrrVolumeGeometry( drrVolumeNode, imagerSpacing);
+    sequenceNode->SetDataNodeAtValue( drrVolumeNode, std::to_string(view));
+  }
+  return sequenceNode;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerDrrImageComputationLogic::ComputePlanDRRs( vtkMRMLDrrImageComputationNode* parameterNode,
+  vtkMRMLScalarVolumeNode* ctVolumeNode, vtkMRMLRTPlanNode* planNode, vtkCollection* drrVolumeNodes)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene)
+  {
+    vtkErrorMacro("ComputePlanDRRs: Invalid MRML scene");
+    return false;
+  }
+
+  if (!parameterNode)
+  {
+    vtkErrorMacro("ComputePlanDRRs: Invalid parameter node");
+    return false;
+  }
+
+  if (!ctVolumeNode)
+  {
+    vtkErrorMacro("ComputePlanDRRs: Invalid input CT volume node");
+    return false;
+  }
+
+  if (!planNode)
+  {
+    vtkErrorMacro("ComputePlanDRRs: Invalid RT plan node");
+    return false;
+  }
+
+  std::vector<vtkMRMLRTBeamNode*> beams;
+  planNode->GetBeams(beams);
+  if (beams.empty())
+  {
+    vtkErrorMacro("ComputePlanDRRs: Plan '" << planNode->GetName() << "' has no beams");
+    return false;
+  }
+
+  double isocenterLPS[3] = {};
+  if (!beams[0]->GetPlanIsocenterPosition(isocenterLPS))
+  {
+    vtkErrorMacro("ComputePlanDRRs: Failed to get plan isocenter position");
+    return false;
+  }
+  isocenterLPS[0] *= -1.; // RAS to LPS
+  isocenterLPS[1] *= -1.;
+
+  double imagerSpacing[2] = { 0.25, 0.25 };
+  parameterNode->GetImagerSpacing(imagerSpacing);
+
+  // Imager orientation of every beam is set up before projecting
+  std::vector<vtkSmartPointer<vtkMatrix4x4> > projectionMatrices;
+  std::vector<double> normalVectors, viewUpVectors;
+  for (vtkMRMLRTBeamNode* beamNode : beams)
+  {
+    double normal[3] = {}, viewUp[3] = {};
+    if (!this->GetNormalAndVupVectorsFromAngles( beamNode->GetGantryAngle(), beamNode->GetCouchAngle(), normal, viewUp))
+    {
+      vtkErrorMacro("ComputePlanDRRs: Failed to get imager orientation of beam '" << beamNode->GetName() << "'");
+      return false;
+    }
+    normalVectors.insert( normalVectors.end(), normal, normal + 3);
+    viewUpVectors.insert( viewUpVectors.end(), viewUp, viewUp + 3);
+
+    double sid = beamNode->GetSAD() + parameterNode->GetIsocenterImagerDistance();
+    vtkSmartPointer<vtkMatrix4x4> projectionMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    CalculatePlastimatchProjectionMatrix( normal, viewUp, isocenterLPS, beamNode->GetSAD(), sid, imagerSpacing, projectionMatrix);
+    projectionMatrices.push_back(projectionMatrix);
+  }
+
+  // Attenuation image is computed once for all beams
+  vtkNew<vtkImageData> attenuationImageData;
+  vtkNew<vtkMatrix4x4> attenuationIjkToLpsMatrix;
+  if (!this->ComputeAttenuationImageData( parameterNode, ctVolumeNode, attenuationImageData, attenuationIjkToLpsMatrix))
+  {
+    vtkErrorMacro("ComputePlanDRRs: Failed to compute attenuation image");
+    return false;
+  }
+
+  vtkNew<vtkImageData> drrStackImageData;
+  if (!this->ProjectAttenuationImageData( parameterNode, attenuationImageData, attenuationIjkToLpsMatrix,
+    projectionMatrices, drrStackImageData))
+  {
+    vtkErrorMacro("ComputePlanDRRs: Failed to compute DRR images");
+    return false;
+  }
+
+  // DRR images are set up as RT images of the beams using a temporary parameter node, which
+  // is in the scene only during the setup, as it references the beams
+  vtkNew<vtkMRMLDrrImageComputationNode> beamParameterNode;
+  beamParameterNode->CopyContent(parameterNode);
+  beamParameterNode->SetHideFromEditors(true);
+  beamParameterNode->SetSaveWithScene(false);
+  scene->AddNode(beamParameterNode);
+
+  bool success = true;
+  for (size_t view = 0; view < beams.size(); ++view)
+  {
+    beamParameterNode->SetNormalVector(&normalVectors[3 * view]);
+    beamParameterNode->SetViewUpVector(&viewUpVectors[3 * view]);
+    beamParameterNode->SetAndObserveBeamNode(beams[view]);
+
+    vtkNew<vtkImageData> drrImageData;
+    ExtractDrrView( drrStackImageData, static_cast<int>(view), drrImageData);
+
+    vtkNew<vtkMRMLScalarVolumeNode> drrVolumeNode;
+    drrVolumeNode->SetAndObserveImageData(drrImageData);
+    SetDrrVolumeGeometry( drrVolumeNode, imagerSpacing);
+    scene->AddNode(drrVolumeNode);
+
+    if (!this->SetupDrrVolumeNode( beamParameterNode, drrVolumeNode))
+    {
+      vtkErrorMacro("ComputePlanDRRs: Failed to set up DRR image of beam '" << beams[view]->GetName() << "'");
+      // Do not leave a partially set up DRR image in the scene
+      if (drrVolumeNode->GetDisplayNode())
+      {
+        scene->RemoveNode(drrVolumeNode->GetDisplayNode());
+      }
+      scene->RemoveNode(drrVolumeNode);
+      success = false;
+      continue;
+    }
+    if (drrVolumeNodes)
+    {
+      drrVolumeNodes->AddItem(drrVolumeNode);
+    }
+  }
+  scene->RemoveNode(beamParameterNode);
+  return success;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerDrrImageComputationLogic::ComputeAttenuationImageData( vtkMRMLDrrImageComputationNode* parameterNode,
+  vtkMRMLScalarVolumeNode* ctVolumeNode, vtkImageData* attenuationImageData, vtkMatrix4x4* attenuationIjkToLpsMatrix)
+{
+  if (!parameterNode)
+  {
+    vtkErrorMacro("ComputeAttenuationImageData: Invalid parameter node");
+    return false;
+  }
+
+  vtkImageData* ctImageData = ctVolumeNode ? ctVolumeNode->GetImageData() : nullptr;
+  if (!ctImageData || !ctImageData->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("ComputeAttenuationImageData: Invalid input CT volume");
+    return false;
+  }
+  if (ctImageData->GetNumberOfScalarComponents() != 1)
+  {
+    vtkErrorMacro("ComputeAttenuationImageData: CT volume must have a single scalar component");
+    return false;
+  }
+
+  if (!attenuationImageData || !attenuationIjkToLpsMatrix)
+  {
+    vtkErrorMacro("ComputeAttenuationImageData: Invalid output attenuation image or matrix");
+    return false;
+  }
+
+  // Attenuation image is indexed from zero, the CT extent offset goes into the IJK to LPS matrix
+  int extent[6] = {};
+  ctImageData->GetExtent(extent);
+  attenuationImageData->SetExtent( 0, extent[1] - extent[0], 0, extent[3] - extent[2], 0, extent[5] - extent[4]);
+  attenuationImageData->AllocateScalars( VTK_FLOAT, 1);
+
+  vtkNew<vtkMatrix4x4> ctIjkToRasMatrix;
+  ctVolumeNode->GetIJKToRASMatrix(ctIjkToRasMatrix);
+  vtkNew<vtkTransform> ijkToLpsTransform;
+  ijkToLpsTransform->Identity();
+  ijkToLpsTransform->PostMultiply();
+  ijkToLpsTransform->Translate( extent[0], extent[2], extent[4]);
+  ijkToLpsTransform->Concatenate(ctIjkToRasMatrix);
+  ijkToLpsTransform->Scale( -1., -1., 1.); // RAS to LPS
+  attenuationIjkToLpsMatrix->DeepCopy(ijkToLpsTransform->GetMatrix());
+
+  bool huConversion = (parameterNode->GetHUConversion() != vtkMRMLDrrImageComputationNode::None);
+  vtkIdType numberOfValues = ctImageData->GetNumberOfPoints();
+  float* attenuationValues = static_cast<float*>(attenuationImageData->GetScalarPointer());
+  switch (ctImageData->GetScalarType())
+  {
+    vtkTemplateMacro(ConvertToAttenuation(static_cast<const VTK_TT*>(ctImageData->GetScalarPointer()), attenuationValues,
+      numberOfValues, parameterNode->GetHUThresholdBelow(), huConversion));
+    default:
+      vtkErrorMacro("ComputeAttenuationImageData: Unsupported scalar type of CT volume");
+      return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerDrrImageComputationLogic::ComputeDrrImageData( vtkMRMLDrrImageComputationNode* parameterNode,
+  vtkImageData* attenuationImageData, vtkMatrix4x4* attenuationIjkToLpsMatrix, vtkImageData* drrImageData)
+{
+  if (!parameterNode)
+  {
+    vtkErrorMacro("ComputeDrrImageData: Invalid parameter node");
+    return false;
+  }
+
+  vtkNew<vtkMatrix4x4> projectionMatrix;
+  if (!this->GetPlastimatchProjectionMatrix( parameterNode, projectionMatrix))
+  {
+    vtkErrorMacro("ComputeDrrImageData: Unable to get projection matrix");
+    return false;
+  }
+
+  std::vector<vtkSmartPointer<vtkMatrix4x4> > projectionMatrices(1, projectionMatrix.GetPointer());
+  return this->ProjectAttenuationImageData( parameterNode, attenuationImageData, attenuationIjkToLpsMatrix,
+    projectionMatrices, drrImageData);
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerDrrImageComputationLogic::ComputeDrrImageData( vtkMRMLDrrImageComputationNode* parameterNode,
+  vtkImageData* attenuationImageData, vtkMatrix4x4* attenuationIjkToLpsMatrix, vtkMatrix4x4* projectionMatrix,
+  vtkImageData* drrImageData)
+{
+  if (!parameterNode)
+  {
+    vtkErrorMacro("ComputeDrrImageData: Invalid parameter node");
+    return false;
+  }
+
+  if (!projectionMatrix)
+  {
+    vtkErrorMacro("ComputeDrrImageData: Invalid projection matrix");
+    return false;
+  }
+
+  std::vector<vtkSmartPointer<vtkMatrix4x4> > projectionMatrices(1, projectionMatrix);
+  return this->ProjectAttenuationImageData( parameterNode, attenuationImageData, attenuationIjkToLpsMatrix,
+    projectionMatrices, drrImageData);
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerDrrImageComputationLogic::SetupDrrImageComputation( vtkMRMLDrrImageComputationNode* parameterNode,
+  int downsampling, vtkMRMLDrrImageComputationNode* computationParameterNode, vtkMatrix4x4* projectionMatrix)
+{
+  if (!parameterNode || !computationParameterNode || !projectionMatrix)
+  {
+    vtkErrorMacro("SetupDrrImageComputation: Invalid parameter node or projection matrix");
+    return false;
+  }
+
+  vtkMRMLRTBeamNode* beamNode = parameterNode->GetBeamNode();
+  if (!beamNode)
+  {
+    vtkErrorMacro("SetupDrrImageComputation: Invalid RT Beam node");
+    return false;
+  }
+
+  if (downsampling < 1)
+  {
+    vtkErrorMacro("SetupDrrImageComputation: Downsampling factor must be positive");
+    return false;
+  }
+
+  computationParameterNode->CopyContent(parameterNode);
+
+  int imagerResolution[2] = { 1024, 768 };
+  double imagerSpacing[2] = { 0.25, 0.25 };
+  int imageWindow[4] = { 0, 0, 1023, 767 }; // start column, start row, end column, end row
+  parameterNode->GetImagerResolution(imagerResolution);
+  parameterNode->GetImagerSpacing(imagerSpacing);
+  parameterNode->GetImageWindow(imageWindow);
+  for (int axis = 0; axis < 2; ++axis)
+  {
+    imagerResolution[axis] = std::max<int>( 1, imagerResolution[axis] / downsampling);
+    imagerSpacing[axis] *= downsampling;
+    imageWindow[axis] /= downsampling;
+    imageWindow[axis + 2] /= downsampling;
+  }
+  computationParameterNode->SetImagerResolution(imagerResolution);
+  computationParameterNode->SetImagerSpacing(imagerSpacing);
+  computationParameterNode->SetImageWindow(imageWindow);
+
+  double normal[3] = {}, viewUp[3] = {}, isocenterLPS[3] = {};
+  parameterNode->GetNormalVector(normal);
+  parameterNode->GetViewUpVector(viewUp);
+  parameterNode->GetIsocenterPositionLPS(isocenterLPS);
+  double sid = beamNode->GetSAD() + parameterNode->GetIsocenterImagerDistance();
+  CalculatePlastimatchProjectionMatrix( normal, viewUp, isocenterLPS, beamNode->GetSAD(), sid, imagerSpacing, projectionMatrix);
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerDrrImageComputationLogic::AbortDrrImageComputation()
+{
+  ++this->DrrImageComputationAbortCount;
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerDrrImageComputationLogic::SetDrrVolumeImageData( vtkMRMLScalarVolumeNode* drrVolumeNode,
+  vtkImageData* drrImageData, const double imagerSpacing[2])
+{
+  if (!drrVolumeNode)
+  {
+    return;
+  }
+  drrVolumeNode->SetAndObserveImageData(drrImageData);
+  SetDrrVolumeGeometry( drrVolumeNode, imagerSpacing);
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerDrrImageComputationLogic::ComputeDrrImageDataBatch( vtkMRMLDrrImageComputationNode* parameterNode,
+  vtkImageData* attenuationImageData, vtkMatrix4x4* attenuationIjkToLpsMatrix, vtkDoubleArray* gantryCouchAngles,
+  vtkImageData* drrStackImageData)
+{
+  if (!parameterNode)
+  {
+    vtkErrorMacro("ComputeDrrImageDataBatch: Invalid parameter node");
+    return false;
+  }
+
+  vtkMRMLRTBeamNode* beamNode = parameterNode->GetBeamNode();
+  if (!beamNode)
+  {
+    vtkErrorMacro("ComputeDrrImageDataBatch: Invalid RT Beam node");
+    return false;
+  }
+
+  if (!gantryCouchAngles || gantryCouchAngles->GetNumberOfComponents() != 2 || !gantryCouchAngles->GetNumberOfTuples())
+  {
+    vtkErrorMacro("ComputeDrrImageDataBatch: Invalid gantry and couch angles");
+    return false;
+  }
+
+  double isocenterLPS[3] = {};
+  parameterNode->GetIsocenterPositionLPS(isocenterLPS);
+  double imagerSpacing[2] = { 0.25, 0.25 };
+  parameterNode->GetImagerSpacing(imagerSpacing);
+  double sid = beamNode->GetSAD() + parameterNode->GetIsocenterImagerDistance();
+
+  // Imager orientations of all views are set up before projecting
+  std::vector<vtkSmartPointer<vtkMatrix4x4> > projectionMatrices;
+  for (vtkIdType view = 0; view < gantryCouchAngles->GetNumberOfTuples(); ++view)
+  {
+    double angles[2] = {};
+    gantryCouchAngles->GetTypedTuple( view, angles);
+    double normal[3] = {}, viewUp[3] = {};
+    if (!this->GetNormalAndVupVectorsFromAngles( angles[0], angles[1], normal, viewUp))
+    {
+      vtkErrorMacro("ComputeDrrImageDataBatch: Failed to get imager orientation of view " << view);
+      return false;
+    }
+    vtkSmartPointer<vtkMatrix4x4> projectionMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    CalculatePlastimatchProjectionMatrix( normal, viewUp, isocenterLPS, beamNode->GetSAD(), sid, imagerSpacing, projectionMatrix);
+    projectionMatrices.push_back(projectionMatrix);
+  }
+
+  return this->ProjectAttenuationImageData( parameterNode, attenuationImageData, attenuationIjkToLpsMatrix,
+    projectionMatrices, drrStackImageData);
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerDrrImageComputationLogic::ProjectAttenuationImageData( vtkMRMLDrrImageComputationNode* parameterNode,
+  vtkImageData* attenuationImageData, vtkMatrix4x4* attenuationIjkToLpsMatrix,
+  const std::vector<vtkSmartPointer<vtkMatrix4x4> >& projectionMatrices, vtkImageData* drrImageData)
+{
+  if (!attenuationImageData || attenuationImageData->GetScalarType() != VTK_FLOAT
+    || attenuationImageData->GetNumberOfScalarComponents() != 1 || !attenuationIjkToLpsMatrix)
+  {
+    vtkErrorMacro("ProjectAttenuationImageData: Invalid attenuation image");
+    return false;
+  }
+
+  if (!drrImageData || projectionMatrices.empty())
+  {
+    vtkErrorMacro("ProjectAttenuationImageData: Invalid output DRR image or projections");
+    return false;
+  }
+
+  float autoscaleRange[2] = { 0.f, 255.f };
+  parameterNode->GetAutoscaleRange(autoscaleRange);
+  if (autoscaleRange[0] >= autoscaleRange[1])
+  {
+    vtkErrorMacro("ProjectAttenuationImageData: Autoscale range is wrong");
+    return false;
+  }
+
+  // Image window and image center, same as in slicer_plastimatch_drr CLI
+  int imagerResolution[2] = { 1024, 768 };
+  parameterNode->GetImagerResolution(imagerResolution);
+  int imageWindow[4] = { 0, imagerResolution[0] - 1, 0, imagerResolution[1] - 1 }; // start column, end column, start row, end row
+  if (parameterNode->GetImageWindowFlag())
+  {
+    int window[4] = { 0, 0, 1023, 767 };
+    parameterNode->GetImageWindow(window);
+    imageWindow[0] = std::max<int>( 0, window[0]); // start column
+    imageWindow[1] = std::min<int>( imagerResolution[0] - 1, window[2]); // end column
+    imageWindow[2] = std::max<int>( 0, window[1]); // start row
+    imageWindow[3] = std::min<int>( imagerResolution[1] - 1, window[3]); // end row
+  }
+  double imageCenter[2] = {
+    imageWindow[0] + (imageWindow[1] - imageWindow[0]) / 2., // column
+    imageWindow[2] + (imageWindow[3] - imageWindow[2]) / 2. // row
+  };
+  int columns = imageWindow[1] - imageWindow[0] + 1;
+  int rows = imageWindow[3] - imageWindow[2] + 1;
+  if (columns <= 0 || rows <= 0)
+  {
+    vtkErrorMacro("ProjectAttenuationImageData: Image window is empty");
+    return false;
+  }
+
+  vtkNew<vtkMatrix4x4> lpsToIjkMatrix;
+  vtkMatrix4x4::Invert( attenuationIjkToLpsMatrix, lpsToIjkMatrix);
+
+  // Uniform algorithm samples the volume with the smallest voxel size
+  double stepSize = VTK_DOUBLE_MAX;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    double voxelSize = sqrt( attenuationIjkToLpsMatrix->GetElement( 0, axis) * attenuationIjkToLpsMatrix->GetElement( 0, axis)
+      + attenuationIjkToLpsMatrix->GetElement( 1, axis) * attenuationIjkToLpsMatrix->GetElement( 1, axis)
+      + attenuationIjkToLpsMatrix->GetElement( 2, axis) * attenuationIjkToLpsMatrix->GetElement( 2, axis));
+    stepSize = std::min( stepSize, voxelSize);
+  }
+
+  int numberOfViews = static_cast<int>(projectionMatrices.size());
+  vtkIdType numberOfPixels = static_cast<vtkIdType>(columns) * rows;
+  drrImageData->SetExtent( 0, columns - 1, 0, rows - 1, 0, numberOfViews - 1);
+  drrImageData->AllocateScalars( VTK_FLOAT, 1);
+  float* drrValues = static_cast<float*>(drrImageData->GetScalarPointer());
+
+  // Rows are skipped once the computation is aborted
+  unsigned int abortCountAtStart = this->DrrImageComputationAbortCount.load();
+
+  // Projection matrix maps LPS into imager coordinates (column, row) relative to the image center,
+  // its inverse maps imager coordinates (u, v, 1) onto the imager plane
+  bool exactAlgorithm = (parameterNode->GetAlgorithmReconstuction() == vtkMRMLDrrImageComputationNode::Exact);
+  std::vector<DrrRayCastFunctor> viewFunctors;
+  viewFunctors.reserve(numberOfViews);
+  for (int view = 0; view < numberOfViews; ++view)
+  {
+    vtkNew<vtkMatrix4x4> imagerToLpsMatrix;
+    vtkMatrix4x4::Invert( projectionMatrices[view], imagerToLpsMatrix);
+
+    double sourceImager[4] = { 0., 0., 0., 1. };
+    double firstPixelImager[4] = { imageWindow[0] - imageCenter[0], imageWindow[2] - imageCenter[1], 1., 1. };
+    double columnStepImager[4] = { 1., 0., 0., 0. };
+    double rowStepImager[4] = { 0., 1., 0., 0. };
+    double sourceLPS[4], firstPixelLPS[4], columnStepLPS[4], rowStepLPS[4];
+    imagerToLpsMatrix->MultiplyPoint( sourceImager, sourceLPS);
+    imagerToLpsMatrix->MultiplyPoint( firstPixelImager, firstPixelLPS);
+    imagerToLpsMatrix->MultiplyPoint( columnStepImager, columnStepLPS);
+    imagerToLpsMatrix->MultiplyPoint( rowStepImager, rowStepLPS);
+
+    DrrRayCastFunctor rayCastFunctor( static_cast<const float*>(attenuationImageData->GetScalarPointer()),
+      attenuationImageData->GetDimensions(), exactAlgorithm, stepSize);
+    rayCastFunctor.SetGeometry( columns, sourceLPS, firstPixelLPS, columnStepLPS, rowStepLPS, lpsToIjkMatrix);
+    rayCastFunctor.SetOutput(drrValues + view * numberOfPixels);
+    rayCastFunctor.SetAbortCount( &this->DrrImageComputationAbortCount, abortCountAtStart);
+    viewFunctors.push_back(rayCastFunctor);
+  }
+
+  if (numberOfViews == 1)
+  {
+    vtkSMPTools::For( 0, rows, viewFunctors[0]);
+  }
+  else
+  {
+    DrrBatchRayCastFunctor batchRayCastFunctor( viewFunctors, rows);
+    vtkSMPTools::For( 0, static_cast<vtkIdType>(numberOfViews) * rows, batchRayCastFunctor);
+  }
+
+  if (this->DrrImageComputationAbortCount.load() != abortCountAtStart)
+  {
+    vtkDebugMacro("ProjectAttenuationImageData: Computation has been aborted");
+    return false;
+  }
+
+  DrrIntensityFunctor intensityFunctor( drrValues, numberOfPixels, parameterNode->GetExponentialMappingFlag(),
+    autoscaleRange, parameterNode->GetInvertIntensityFlag());
+  vtkSMPTools::For( 0, numberOfViews, intensityFunctor);
+  drrImageData->Modified();
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerDrrImageComputationLogic::SetupDrrVolumeNode( vtkMRMLDrrImageComputationNode* parameterNode,
+  vtkMRMLScalarVolumeNode* drrVolumeNode)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  vtkMRMLRTBeamNode* beamNode = parameterNode->GetBeamNode();
+
+  // Set more user friendly DRR image name
+  std::string drrName = scene->GenerateUniqueName(std::string("DRR : ") + std::string(beamNode->GetName()));
+  drrVolumeNode->SetName(drrName.c_str());
+
+  // Create parameter node name, and observe calculated drr volume
+  std::string parameterSetNodeName;
+  parameterSetNodeName = vtkMRMLPlanarImageNode::PLANARIMAGE_PARAMETER_SET_BASE_NAME_PREFIX + drrName;
+  parameterNode->SetName(parameterSetNodeName.c_str());
+  parameterNode->SetAndObserveRtImageVolumeNode(drrVolumeNode);
+
+  return this->SetupDisplayAndSubjectHierarchyNodes( parameterNode, drrVolumeNode);
+}
+
 //------------------------------------------------------------------------------
 bool vtkSlicerDrrImageComputationLogic::SetupDisplayAndSubjectHierarchyNodes( vtkMRMLDrrImageComputationNode* parameterNode,
   vtkMRMLScalarVolumeNode* drrVolumeNode)
@@ -1566,18 +2582,48 @@ bool vtkSlicerDrrImageComputationLogic::GetPlastimatchExtrinsicMatrix(vtkMRMLDrr
     return false;
   }
 
-  mat->Identity();
-
   double nrm[3]; // Panel normal vector
   double vup[3]; // Panel view-up vector
   double tgt[3]; // Target point or isocenter position
-  double plt[3];  // Panel left (toward first column)
-  double pup[3];  // Panel up (toward top row)
-
   parameterNode->GetNormalVector(nrm);
   parameterNode->GetViewUpVector(vup);
   parameterNode->GetIsocenterPositionLPS(tgt);
 
+  CalculatePlastimatchExtrinsicMatrix( nrm, vup, tgt, beamNode->GetSAD(), mat);
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerDrrImageComputationLogic::GetPlastimatchProjectionMatrix(vtkMRMLDrrImageComputationNode* parameterNode, vtkMatrix4x4* mat)
+{
+  vtkNew<vtkMatrix4x4> intrinsic;
+  vtkNew<vtkMatrix4x4> extrinsic;
+  if (!this->GetPlastimatchIntrinsicMatrix(parameterNode, intrinsic))
+  {
+    vtkErrorMacro("GetPlastimatchProjectionMatrix: Unable to get intrinsic matrix");
+    return false;
+  }
+  if (!this->GetPlastimatchExtrinsicMatrix(parameterNode, extrinsic))
+  {
+    vtkErrorMacro("GetPlastimatchProjectionMatrix: Unable to get extrinsic matrix");
+    return false;
+  }
+  vtkMatrix4x4::Multiply4x4(intrinsic, extrinsic, mat);
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerDrrImageComputationLogic::CalculatePlastimatchExtrinsicMatrix(const double normal[3], const double viewUp[3],
+  const double isocenterLPS[3], double sad, vtkMatrix4x4* mat)
+{
+  double nrm[3] = { normal[0], normal[1], normal[2] }; // Panel normal vector
+  double vup[3] = { viewUp[0], viewUp[1], viewUp[2] }; // Panel view-up vector
+  const double* tgt = isocenterLPS; // Target point or isocenter position
+  double plt[3];  // Panel left (toward first column)
+  double pup[3];  // Panel up (toward top row)
+
   // plt = nrm x vup
   vtkMath::Cross( nrm, vup, plt);
   vtkMath::Normalize(plt);
@@ -1603,30 +2649,63 @@ bool vtkSlicerDrrImageComputationLogic::GetPlastimatchExtrinsicMatrix(vtkMRMLDrr
   // Build extrinsic matrix - translation part
   extrinsicMatrix[3] = vtkMath::Dot(plt, tgt);
   extrinsicMatrix[7] = vtkMath::Dot(pup, tgt);
-  extrinsicMatrix[11] = vtkMath::Dot(nrm, tgt) + beamNode->GetSAD();
+  extrinsicMatrix[11] = vtkMath::Dot(nrm, tgt) + sad;
   // Copy vector into matrix (fill rows, columns)
   mat->DeepCopy(extrinsicMatrix);
-
-  return true;
 }
 
 //------------------------------------------------------------------------------
-bool vtkSlicerDrrImageComputationLogic::GetPlastimatchProjectionMatrix(vtkMRMLDrrImageComputationNode* parameterNode, vtkMatrix4x4* mat)
+void vtkSlicerDrrImageComputationLogic::CalculatePlastimatchProjectionMatrix(const double normal[3], const double viewUp[3],
+  const double isocenterLPS[3], double sad, double sid, const double imagerSpacing[2], vtkMatrix4x4* mat)
 {
-  vtkNew<vtkMatrix4x4> intrinsic;
   vtkNew<vtkMatrix4x4> extrinsic;
-  if (!this->GetPlastimatchIntrinsicMatrix(parameterNode, intrinsic))
-  {
-    vtkErrorMacro("GetPlastimatchProjectionMatrix: Unable to get intrinsic matrix");
-    return false;
-  }
-  if (!this->GetPlastimatchExtrinsicMatrix(parameterNode, extrinsic))
+  CalculatePlastimatchExtrinsicMatrix( normal, viewUp, isocenterLPS, sad, extrinsic);
+
+  vtkNew<vtkTransform> scaleTransform;
+  scaleTransform->Identity();
+  scaleTransform->Scale(1. / imagerSpacing[0], 1. / imagerSpacing[1], 1. / sid);
+
+  vtkMatrix4x4::Multiply4x4( scaleTransform->GetMatrix(), extrinsic, mat);
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerDrrImageComputationLogic::GetNormalAndVupVectorsFromAngles(double gantryAngle, double couchAngle,
+  double normal[3], double viewUp[3])
+{
+  // Same transformation path as in UpdateImageTransformFromBeam, only the rotation is used.
+  // Angles are set in a separate IEC logic, so the transforms of the beams in the scene are not changed
+  vtkNew<vtkIECTransformLogic> iecLogic;
+  iecLogic->UpdateGantryToFixedReferenceTransform(gantryAngle);
+  iecLogic->UpdatePatientSupportRotationToFixedReferenceTransform(-1. * couchAngle);
+
+  using IEC = vtkIECTransformLogic::CoordinateSystemIdentifier;
+  vtkNew<vtkGeneralTransform> generalTransform;
+  vtkNew<vtkTransform> gantryToRasTransform;
+  if (!iecLogic->GetTransformBetween(IEC::Gantry, IEC::RAS, generalTransform, true)
+    || !vtkMRMLTransformNode::IsGeneralTransformLinear(generalTransform, gantryToRasTransform))
   {
-    vtkErrorMacro("GetPlastimatchProjectionMatrix: Unable to get extrinsic matrix");
+    vtkErrorMacro("GetNormalAndVupVectorsFromAngles: Unable to get linear gantry to RAS transform");
     return false;
   }
-  vtkMatrix4x4::Multiply4x4(intrinsic, extrinsic, mat);
 
+  // Same as in UpdateNormalAndVupVectors
+  vtkNew<vtkTransform> rasToLpsTransform;
+  rasToLpsTransform->Identity();
+  rasToLpsTransform->RotateZ(180.0);
+
+  vtkNew<vtkTransform> dicomBeamTransform;
+  dicomBeamTransform->Identity();
+  dicomBeamTransform->PreMultiply();
+  dicomBeamTransform->Concatenate(rasToLpsTransform);
+  dicomBeamTransform->Concatenate(gantryToRasTransform);
+
+  double n[4], vup[4];
+  const double normalVector[4] = { 0., 0., 1., 0. }; // beam positive Z-axis
+  const double viewUpVector[4] = { -1., 0., 0., 0. }; // beam negative X-axis
+  dicomBeamTransform->GetMatrix()->MultiplyPoint( normalVector, n);
+  dicomBeamTransform->GetMatrix()->MultiplyPoint( viewUpVector, vup);
+  std::copy( n, n + 3, normal);
+  std::copy( vup, vup + 3, viewUp);
   return true;
 }
 
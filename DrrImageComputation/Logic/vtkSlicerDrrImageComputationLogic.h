@@ -27,8 +27,13 @@
 // Slicer includes
 #include <vtkSlicerModuleLogic.h>
 
+// VTK includes
+#include <vtkSmartPointer.h>
+
 // STD includes
+#include <atomic>
 #include <cstdlib>
+#include <vector>
 
 // SlicerRT includes
 #include "vtkSlicerDrrImageComputationModuleLogicExport.h"
@@ -43,6 +48,8 @@ class vtkMRMLMarkupsPlaneNode;
 class vtkMRMLMarkupsFiducialNode;
 class vtkMRMLMarkupsLineNode;
 class vtkMRMLTableNode;
+class vtkMRMLSequenceNode;
+class vtkMRMLRTPlanNode;
 
 class vtkMRMLLinearTransformNode;
 
@@ -50,6 +57,9 @@ class vtkSlicerBeamsModuleLogic;
 class vtkSlicerPlanarImageModuleLogic;
 class vtkSlicerCLIModuleLogic;
 
+class vtkCollection;
+class vtkDoubleArray;
+class vtkImageData;
 class vtkMatrix4x4;
 
 /// \ingroup Slicer_QtModules_DrrImageComputation
@@ -87,6 +97,98 @@ public:
   /// \return valid computed DRR volume node or nullptr otherwise
   vtkMRMLScalarVolumeNode* ComputePlastimatchDRR(vtkMRMLDrrImageComputationNode* parameterNode, vtkMRMLScalarVolumeNode* ctInputVolume);
 
+  /// Compute DRR image in-process by ray casting through the CT volume in memory,
+  /// without running the slicer_plastimatch_drr CLI module and its temporary files.
+  /// Geometry and intensity mapping are the same as in \sa ComputePlastimatchDRR
+  /// \param parameterNode - parameters of DRR image computation
+  /// \param ctInputVolume - CT volume
+  /// \return valid computed DRR volume node or nullptr otherwise
+  vtkMRMLScalarVolumeNode* ComputeDRR(vtkMRMLDrrImageComputationNode* parameterNode, vtkMRMLScalarVolumeNode* ctInputVolume);
+
+  /// Convert CT volume into linear attenuation coefficients (HU threshold and HU conversion)
+  /// \param parameterNode - parameters of DRR image computation
+  /// \param ctInputVolume - CT volume
+  /// \param attenuationImageData - output attenuation image (float), indexed from zero
+  /// \param attenuationIjkToLpsMatrix - output IJK to LPS matrix of the attenuation image
+  /// \return true if attenuation image is computed, false otherwise
+  bool ComputeAttenuationImageData(vtkMRMLDrrImageComputationNode* parameterNode, vtkMRMLScalarVolumeNode* ctInputVolume,
+    vtkImageData* attenuationImageData, vtkMatrix4x4* attenuationIjkToLpsMatrix);
+
+  /// Compute DRR image data by casting rays through the attenuation image, multithreaded over detector rows.
+  /// Rays are set up from the plastimatch projection matrix \sa GetPlastimatchProjectionMatrix
+  /// \param parameterNode - parameters of DRR image computation
+  /// \param attenuationImageData - attenuation image \sa ComputeAttenuationImageData
+  /// \param attenuationIjkToLpsMatrix - IJK to LPS matrix of the attenuation image
+  /// \param drrImageData - output DRR image (float), columns and rows of the image window
+  /// \return true if DRR image is computed, false otherwise
+  bool ComputeDrrImageData(vtkMRMLDrrImageComputationNode* parameterNode, vtkImageData* attenuationImageData,
+    vtkMatrix4x4* attenuationIjkToLpsMatrix, vtkImageData* drrImageData);
+
+  /// Compute DRR image data with a given projection matrix. Only imager and intensity parameters
+  /// are taken from the parameter node, so a standalone copy made by \sa SetupDrrImageComputation
+  /// can be projected in a background thread while the parameters in the scene keep changing.
+  /// \param parameterNode - imager and intensity parameters of DRR image computation
+  /// \param attenuationImageData - attenuation image \sa ComputeAttenuationImageData
+  /// \param attenuationIjkToLpsMatrix - IJK to LPS matrix of the attenuation image
+  /// \param projectionMatrix - plastimatch projection matrix
+  /// \param drrImageData - output DRR image (float), columns and rows of the image window
+  /// \return true if DRR image is computed, false if it failed or was aborted \sa AbortDrrImageComputation
+  bool ComputeDrrImageData(vtkMRMLDrrImageComputationNode* parameterNode, vtkImageData* attenuationImageData,
+    vtkMatrix4x4* attenuationIjkToLpsMatrix, vtkMatrix4x4* projectionMatrix, vtkImageData* drrImageData);
+
+  /// Set up a standalone copy of DRR image computation parameters with its projection matrix.
+  /// Imager resolution and image window are reduced by the downsampling factor and imager spacing
+  /// is increased by it, so the imager keeps its physical size (e.g. for a quick preview).
+  /// \param parameterNode - parameters of DRR image computation
+  /// \param downsampling - imager downsampling factor, 1 keeps the requested resolution
+  /// \param computationParameterNode - output copy of the parameters, not added to the scene
+  /// \param projectionMatrix - output plastimatch projection matrix of the copy
+  /// \return true if the computation is set up, false otherwise
+  bool SetupDrrImageComputation(vtkMRMLDrrImageComputationNode* parameterNode, int downsampling,
+    vtkMRMLDrrImageComputationNode* computationParameterNode, vtkMatrix4x4* projectionMatrix);
+
+  /// Abort in-process DRR image computations that are in progress, e.g. when their parameters
+  /// have been superseded. Computations started afterwards are not affected.
+  void AbortDrrImageComputation();
+
+  /// Set DRR image data into a volume node with the geometry of the DRR image
+  /// loaded by the slicer_plastimatch_drr CLI (LPS, imager spacing)
+  /// \param drrVolumeNode - DRR volume
+  /// \param drrImageData - DRR image \sa ComputeDrrImageData
+  /// \param imagerSpacing - imager pixel spacing (columns, rows)
+  static void SetDrrVolumeImageData(vtkMRMLScalarVolumeNode* drrVolumeNode, vtkImageData* drrImageData,
+    const double imagerSpacing[2]);
+
+  /// Compute DRR image data of several views at once. All views share the attenuation image
+  /// and the imager of the parameter node, and are projected concurrently.
+  /// \param parameterNode - parameters of DRR image computation
+  /// \param attenuationImageData - attenuation image \sa ComputeAttenuationImageData
+  /// \param attenuationIjkToLpsMatrix - IJK to LPS matrix of the attenuation image
+  /// \param gantryCouchAngles - gantry and couch angles of the views in degrees (two components)
+  /// \param drrStackImageData - output stack of DRR images (float), one slice per view
+  /// \return true if DRR images are computed, false otherwise
+  bool ComputeDrrImageDataBatch(vtkMRMLDrrImageComputationNode* parameterNode, vtkImageData* attenuationImageData,
+    vtkMatrix4x4* attenuationIjkToLpsMatrix, vtkDoubleArray* gantryCouchAngles, vtkImageData* drrStackImageData);
+
+  /// Compute DRR images of the batch views of the parameter node in-process
+  /// \sa vtkMRMLDrrImageComputationNode::AddBatchView. The CT volume is converted into attenuation
+  /// once and all views are projected concurrently.
+  /// \param parameterNode - parameters of DRR image computation
+  /// \param ctInputVolume - CT volume
+  /// \return sequence of DRR volumes indexed by view, nullptr otherwise
+  vtkMRMLSequenceNode* ComputeBatchDRR(vtkMRMLDrrImageComputationNode* parameterNode, vtkMRMLScalarVolumeNode* ctInputVolume);
+
+  /// Compute DRR images of all beams of a plan in-process. The CT volume is converted into attenuation
+  /// once and all beams are projected concurrently. Every DRR image is set up the same way as by
+  /// \sa ComputeDRR, using a temporary copy of \a parameterNode that is removed from the scene afterwards
+  /// \param parameterNode - imager and intensity parameters of DRR image computation
+  /// \param ctInputVolume - CT volume
+  /// \param planNode - RT plan
+  /// \param drrVolumeNodes - output collection of computed DRR volume nodes, optional
+  /// \return true if all DRR images are computed, false otherwise
+  bool ComputePlanDRRs(vtkMRMLDrrImageComputationNode* parameterNode, vtkMRMLScalarVolumeNode* ctInputVolume,
+    vtkMRMLRTPlanNode* planNode, vtkCollection* drrVolumeNodes = nullptr);
+
   /// Update Beam node from 3D view camera position
   /// \param parameterNode - parameters of DRR image computation
   /// \return true if beam was updated, false otherwise
@@ -116,6 +218,34 @@ public:
   /// \return - true if matrix is valid, false otherwise
   bool GetPlastimatchProjectionMatrix(vtkMRMLDrrImageComputationNode* parameterNode, vtkMatrix4x4* mat);
 
+  /// Calculate plastimatch extrinsic matrix from imager orientation
+  /// \param normal - imager normal vector (LPS)
+  /// \param viewUp - imager view-up vector (LPS)
+  /// \param isocenterLPS - isocenter position
+  /// \param sad - source to axis distance
+  /// \param mat - linear transformation matrix
+  static void CalculatePlastimatchExtrinsicMatrix(const double normal[3], const double viewUp[3],
+    const double isocenterLPS[3], double sad, vtkMatrix4x4* mat);
+
+  /// Calculate plastimatch projection matrix from imager orientation
+  /// \param normal - imager normal vector (LPS)
+  /// \param viewUp - imager view-up vector (LPS)
+  /// \param isocenterLPS - isocenter position
+  /// \param sad - source to axis distance
+  /// \param sid - source to imager distance
+  /// \param imagerSpacing - imager pixel spacing (columns, rows)
+  /// \param mat - linear transformation matrix
+  static void CalculatePlastimatchProjectionMatrix(const double normal[3], const double viewUp[3],
+    const double isocenterLPS[3], double sad, double sid, const double imagerSpacing[2], vtkMatrix4x4* mat);
+
+  /// Get imager normal and view-up vectors (LPS) for gantry and couch angles
+  /// \param gantryAngle - gantry angle in degrees
+  /// \param couchAngle - couch angle in degrees
+  /// \param normal - imager normal vector
+  /// \param viewUp - imager view-up vector
+  /// \return - true if vectors are valid, false otherwise
+  bool GetNormalAndVupVectorsFromAngles(double gantryAngle, double couchAngle, double normal[3], double viewUp[3]);
+
   /// Get plastimatch projection matrix
   /// \param parameterNode - parameters of DRR image computation
   /// \param mat - linear transformation matrix
@@ -185,6 +315,19 @@ private:
   /// \param parameterNode - parameters of DRR image computation
   /// \param drrVolumeNode - RTImage DRR volume
   bool SetupGeometry( vtkMRMLDrrImageComputationNode* parameterNode, vtkMRMLScalarVolumeNode* drrVolumeNode);
+  /// Name calculated DRR image, observe it by the parameter node and setup its nodes
+  /// \param parameterNode - parameters of DRR image computation
+  /// \param drrVolumeNode - RTImage DRR volume
+  bool SetupDrrVolumeNode( vtkMRMLDrrImageComputationNode* parameterNode, vtkMRMLScalarVolumeNode* drrVolumeNode);
+  /// Project attenuation image with each projection matrix into one slice of the DRR image stack
+  /// \param parameterNode - imager and intensity parameters of DRR image computation
+  /// \param attenuationImageData - attenuation image
+  /// \param attenuationIjkToLpsMatrix - IJK to LPS matrix of the attenuation image
+  /// \param projectionMatrices - plastimatch projection matrix of each view
+  /// \param drrImageData - output DRR image stack
+  bool ProjectAttenuationImageData( vtkMRMLDrrImageComputationNode* parameterNode, vtkImageData* attenuationImageData,
+    vtkMatrix4x4* attenuationIjkToLpsMatrix, const std::vector<vtkSmartPointer<vtkMatrix4x4> >& projectionMatrices,
+    vtkImageData* drrImageData);
   /// IEC Transformation from Gantry -> RAS (without collimator)
   vtkMRMLLinearTransformNode* UpdateImageTransformFromBeam(vtkMRMLRTBeamNode* node);
 
@@ -194,6 +337,9 @@ private:
   vtkSlicerCLIModuleLogic* PlastimatchDRRComputationLogic;
   /// Beams logic instance
   vtkSlicerBeamsModuleLogic* BeamsLogic;
+  /// Number of abort requests of in-process DRR image computations.
+  /// Computations check it against the value at their start \sa AbortDrrImageComputation
+  std::atomic<unsigned int> DrrImageComputationAbortCount;
 };
 
 #endif
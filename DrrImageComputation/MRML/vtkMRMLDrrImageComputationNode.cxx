@@ -33,7 +33,9 @@
 #include "vtkMRMLDrrImageComputationNode.h"
 
 // STD include
+#include <cmath>
 #include <cstring>
+#include <sstream>
 
 //------------------------------------------------------------------------------
 namespace
@@ -125,6 +127,14 @@ void vtkMRMLDrrImageComputationNode::WriteXML(ostream& of, int nIndent)
   vtkMRMLWriteXMLIntMacro(Threading, Threading);
   // add new parameters here
   vtkMRMLWriteXMLEndMacro(); 
+
+  // Batch views as space separated (gantry, couch) angle pairs
+  of << " BatchViewAngles=\"";
+  for (size_t i = 0; i < this->BatchViewAngles.size(); ++i)
+  {
+    of << (i > 0 ? " " : "") << this->BatchViewAngles[i];
+  }
+  of << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -154,6 +164,22 @@ void vtkMRMLDrrImageComputationNode::ReadXMLAttributes(const char** atts)
   // add new parameters here
   vtkMRMLReadXMLEndMacro();
 
+  for (const char** attribute = atts; attribute && *attribute; attribute += 2)
+  {
+    if (strcmp(attribute[0], "BatchViewAngles") || !attribute[1])
+    {
+      continue;
+    }
+    this->BatchViewAngles.clear();
+    std::istringstream anglesStream(attribute[1]);
+    double gantryAngle = 0., couchAngle = 0.;
+    while (anglesStream >> gantryAngle >> couchAngle)
+    {
+      this->BatchViewAngles.push_back(gantryAngle);
+      this->BatchViewAngles.push_back(couchAngle);
+    }
+  }
+
   this->EndModify(disabledModify);
 
   // Note: ReportString is not read from XML, it is a strictly temporary value
@@ -195,6 +221,7 @@ void vtkMRMLDrrImageComputationNode::Copy(vtkMRMLNode *anode)
   vtkMRMLCopyIntMacro(Threading);
   // add new parameters here
   vtkMRMLCopyEndMacro(); 
+  this->BatchViewAngles = node->BatchViewAngles;
 
   this->EndModify(disabledModify);
 
@@ -233,6 +260,7 @@ void vtkMRMLDrrImageComputationNode::CopyContent(vtkMRMLNode *anode, bool deepCo
   vtkMRMLCopyIntMacro(Threading);
   // add new parameters here
   vtkMRMLCopyEndMacro();
+  this->BatchViewAngles = node->BatchViewAngles;
 }
 
 //----------------------------------------------------------------------------
@@ -260,6 +288,7 @@ void vtkMRMLDrrImageComputationNode::PrintSelf(ostream& os, vtkIndent indent)
   vtkMRMLPrintIntMacro(Threading);
   // add new parameters here
   vtkMRMLPrintEndMacro(); 
+  os << indent << "NumberOfBatchViews: " << this->GetNumberOfBatchViews() << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -436,3 +465,57 @@ void vtkMRMLDrrImageComputationNode::GetImageCenter(double imageCenter[2])
   image_center[1] = static_cast<int>(imageCenter[1]);
   this->SetImageCenter(image_center);
 }
+
+//----------------------------------------------------------------------------
+void vtkMRMLDrrImageComputationNode::AddBatchView(double gantryAngle, double couchAngle)
+{
+  this->BatchViewAngles.push_back(gantryAngle);
+  this->BatchViewAngles.push_back(couchAngle);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDrrImageComputationNode::AddBatchArc(double startGantryAngle, double gantryAngleStep, int numberOfViews, double couchAngle)
+{
+  if (numberOfViews <= 0)
+  {
+    return;
+  }
+  this->BatchViewAngles.reserve(this->BatchViewAngles.size() + 2 * numberOfViews);
+  for (int i = 0; i < numberOfViews; ++i)
+  {
+    double gantryAngle = fmod(startGantryAngle + i * gantryAngleStep, 360.);
+    this->BatchViewAngles.push_back((gantryAngle < 0.) ? gantryAngle + 360. : gantryAngle);
+    this->BatchViewAngles.push_back(couchAngle);
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDrrImageComputationNode::RemoveAllBatchViews()
+{
+  if (this->BatchViewAngles.empty())
+  {
+    return;
+  }
+  this->BatchViewAngles.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLDrrImageComputationNode::GetNumberOfBatchViews() const
+{
+  return static_cast<int>(this->BatchViewAngles.size() / 2);
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLDrrImageComputationNode::GetBatchView(int viewIndex, double angles[2]) const
+{
+  if (viewIndex < 0 || viewIndex >= this->GetNumberOfBatchViews())
+  {
+    return false;
+  }
+  angles[0] = this->BatchViewAngles[2 * viewIndex];
+  angles[1] = this->BatchViewAngles[2 * viewIndex + 1];
+  return true;
+}
@@ -30,6 +30,9 @@
 #include <vtkSlicerPlanarImageModuleLogic.h>
 #include <vtkMRMLPlanarImageNode.h>
 
+// STD includes
+#include <vector>
+
 class vtkMRMLLinearTransformNode;
 class vtkMRMLRTBeamNode;
 class vtkMRMLMarkupsClosedCurveNode;
@@ -147,6 +150,26 @@ public:
   vtkGetVector4Macro(ImageWindow, int);
   vtkSetVector4Macro(ImageWindow, int);
 
+  /// Add a view to batch DRR computation
+  /// \param gantryAngle - gantry angle of the view in degrees
+  /// \param couchAngle - couch angle of the view in degrees
+  void AddBatchView(double gantryAngle, double couchAngle);
+  /// Add views of a gantry arc to batch DRR computation
+  /// \param startGantryAngle - gantry angle of the first view in degrees
+  /// \param gantryAngleStep - gantry angle difference of consecutive views in degrees
+  /// \param numberOfViews - number of views along the arc
+  /// \param couchAngle - couch angle of the views in degrees
+  void AddBatchArc(double startGantryAngle, double gantryAngleStep, int numberOfViews, double couchAngle = 0.);
+  /// Remove all views of batch DRR computation
+  void RemoveAllBatchViews();
+  /// Get number of views of batch DRR computation
+  int GetNumberOfBatchViews() const;
+  /// Get angles of a view of batch DRR computation
+  /// \param viewIndex - index of the view
+  /// \param angles - gantry and couch angles of the view in degrees
+  /// \return true if view index is valid, false otherwise
+  bool GetBatchView(int viewIndex, double angles[2]) const;
+
 protected:
   vtkMRMLDrrImageComputationNode();
   ~vtkMRMLDrrImageComputationNode();
@@ -175,6 +198,7 @@ protected:
   bool InvertIntensityFlag;
   float AutoscaleRange[2];
   int HUThresholdBelow;
+  std::vector<double> BatchViewAngles; // gantry, couch angle pairs of batch DRR views
 };
 
 #endif
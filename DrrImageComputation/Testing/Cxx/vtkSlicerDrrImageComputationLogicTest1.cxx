@@ -0,0 +1,218 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DrrImageComputation includes
+#include "vtkSlicerDrrImageComputationLogic.h"
+#include "vtkMRMLDrrImageComputationNode.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLVolumeArchetypeStorageNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// ITK includes
+#include "itkFactoryRegistration.h"
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  bool LoadVolume(vtkMRMLScene* scene, const char* fileName, vtkMRMLScalarVolumeNode* volumeNode)
+  {
+    vtkNew<vtkMRMLVolumeArchetypeStorageNode> storageNode;
+    storageNode->SetFileName(fileName);
+    scene->AddNode(storageNode);
+    scene->AddNode(volumeNode);
+    volumeNode->SetAndObserveStorageNodeID(storageNode->GetID());
+    return storageNode->ReadData(volumeNode) && volumeNode->GetImageData();
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDrrImageComputationLogicTest1(int argc, char* argv[])
+{
+  // Arguments: -InputVolume <CT volume> -BaselineVolume <DRR computed by the CLI> -IntensityTolerance <value>
+  //   -MaximumDifferentPixelsPercent <value>
+  const char* inputVolumeFileName = nullptr;
+  const char* baselineVolumeFileName = nullptr;
+  double intensityTolerance = 1.0;
+  double maximumDifferentPixelsPercent = 1.0;
+  for (int argIndex = 1; argIndex + 1 < argc; argIndex += 2)
+  {
+    std::string argName(argv[argIndex]);
+    std::stringstream argValueStream(argv[argIndex + 1]);
+    if (argName == "-InputVolume")
+    {
+      inputVolumeFileName = argv[argIndex + 1];
+    }
+    else if (argName == "-BaselineVolume")
+    {
+      baselineVolumeFileName = argv[argIndex + 1];
+    }
+    else if (argName == "-IntensityTolerance")
+    {
+      argValueStream >> intensityTolerance;
+    }
+    else if (argName == "-MaximumDifferentPixelsPercent")
+    {
+      argValueStream >> maximumDifferentPixelsPercent;
+    }
+    else
+    {
+      std::cerr << "Invalid argument: " << argName << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (!inputVolumeFileName || !baselineVolumeFileName)
+  {
+    std::cerr << "Invalid arguments!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Make sure NRRD reading works
+  itk::itkFactoryRegistration();
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLScalarVolumeNode> ctVolumeNode;
+  if (!LoadVolume(scene, inputVolumeFileName, ctVolumeNode))
+  {
+    std::cerr << __LINE__ << ": Failed to load input volume " << inputVolumeFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkNew<vtkMRMLScalarVolumeNode> baselineVolumeNode;
+  if (!LoadVolume(scene, baselineVolumeFileName, baselineVolumeNode))
+  {
+    std::cerr << __LINE__ << ": Failed to load baseline volume " << baselineVolumeFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Default parameters of the slicer_plastimatch_drr CLI, which computed the baseline
+  const double sourceAxisDistance = 1000.;
+  const double sourceImagerDistance = 1400.;
+  double normal[3] = { 0., -1., 0. };
+  double viewUp[3] = { -1., 0., 0. };
+  double isocenterLPS[3] = { 0., 0., 0. };
+  int imagerResolution[2] = { 2000, 2000 };
+  double imagerSpacing[2] = { 0.25, 0.25 };
+  float autoscaleRange[2] = { 0.f, 255.f };
+
+  vtkNew<vtkMRMLDrrImageComputationNode> parameterNode;
+  parameterNode->SetNormalVector(normal);
+  parameterNode->SetViewUpVector(viewUp);
+  parameterNode->SetIsocenterImagerDistance(sourceImagerDistance - sourceAxisDistance);
+  parameterNode->SetImagerResolution(imagerResolution);
+  parameterNode->SetImagerSpacing(imagerSpacing);
+  parameterNode->SetImageWindowFlag(false);
+  parameterNode->SetAutoscaleFlag(false);
+  parameterNode->SetAutoscaleRange(autoscaleRange);
+  parameterNode->SetExponentialMappingFlag(true);
+  parameterNode->SetHUThresholdBelow(-1000);
+  parameterNode->SetHUConversion(vtkMRMLDrrImageComputationNode::Preprocess);
+  parameterNode->SetAlgorithmReconstuction(vtkMRMLDrrImageComputationNode::Exact);
+  parameterNode->SetThreading(vtkMRMLDrrImageComputationNode::CPU);
+  parameterNode->SetInvertIntensityFlag(true);
+
+  vtkNew<vtkSlicerDrrImageComputationLogic> logic;
+  vtkNew<vtkImageData> attenuationImageData;
+  vtkNew<vtkMatrix4x4> attenuationIjkToLpsMatrix;
+  if (!logic->ComputeAttenuationImageData(parameterNode, ctVolumeNode, attenuationImageData, attenuationIjkToLpsMatrix))
+  {
+    std::cerr << __LINE__ << ": Failed to compute attenuation image" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkMatrix4x4> projectionMatrix;
+  vtkSlicerDrrImageComputationLogic::CalculatePlastimatchProjectionMatrix( normal, viewUp, isocenterLPS,
+    sourceAxisDistance, sourceImagerDistance, imagerSpacing, projectionMatrix);
+  vtkNew<vtkImageData> drrImageData;
+  if (!logic->ComputeDrrImageData(parameterNode, attenuationImageData, attenuationIjkToLpsMatrix, projectionMatrix, drrImageData))
+  {
+    std::cerr << __LINE__ << ": Failed to compute DRR image" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkNew<vtkMRMLScalarVolumeNode> drrVolumeNode;
+  vtkSlicerDrrImageComputationLogic::SetDrrVolumeImageData(drrVolumeNode, drrImageData, imagerSpacing);
+
+  // Pixel grid, orientation and flip of the image must be the same as of the one loaded from the CLI output
+  int drrDimensions[3] = { 0, 0, 0 };
+  int baselineDimensions[3] = { 0, 0, 0 };
+  drrImageData->GetDimensions(drrDimensions);
+  baselineVolumeNode->GetImageData()->GetDimensions(baselineDimensions);
+  if ( drrDimensions[0] != baselineDimensions[0] || drrDimensions[1] != baselineDimensions[1]
+    || drrDimensions[2] != baselineDimensions[2] )
+  {
+    std::cerr << __LINE__ << ": DRR image dimensions (" << drrDimensions[0] << ", " << drrDimensions[1] << ", " << drrDimensions[2]
+      << ") differ from baseline (" << baselineDimensions[0] << ", " << baselineDimensions[1] << ", " << baselineDimensions[2] << ")" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkNew<vtkMatrix4x4> drrIjkToRasDirections;
+  vtkNew<vtkMatrix4x4> baselineIjkToRasDirections;
+  drrVolumeNode->GetIJKToRASDirectionMatrix(drrIjkToRasDirections);
+  baselineVolumeNode->GetIJKToRASDirectionMatrix(baselineIjkToRasDirections);
+  for (int i = 0; i < 3; ++i)
+  {
+    if (fabs(drrVolumeNode->GetSpacing()[i] - baselineVolumeNode->GetSpacing()[i]) > 1e-6)
+    {
+      std::cerr << __LINE__ << ": DRR image spacing differs from baseline along axis " << i << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (int j = 0; j < 3; ++j)
+    {
+      if (fabs(drrIjkToRasDirections->GetElement(i, j) - baselineIjkToRasDirections->GetElement(i, j)) > 1e-6)
+      {
+        std::cerr << __LINE__ << ": DRR image directions differ from baseline" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Ray casting differs from plastimatch only in rounding, allow a few pixels at sharp edges to differ more
+  vtkIdType numberOfDifferentPixels = 0;
+  double maximumDifference = 0.;
+  for (int j = 0; j < drrDimensions[1]; ++j)
+  {
+    for (int i = 0; i < drrDimensions[0]; ++i)
+    {
+      double difference = fabs( drrImageData->GetScalarComponentAsDouble( i, j, 0, 0)
+        - baselineVolumeNode->GetImageData()->GetScalarComponentAsDouble( i, j, 0, 0));
+      maximumDifference = std::max( maximumDifference, difference);
+      if (difference > intensityTolerance)
+      {
+        ++numberOfDifferentPixels;
+      }
+    }
+  }
+  double differentPixelsPercent = 100. * numberOfDifferentPixels / (static_cast<double>(drrDimensions[0]) * drrDimensions[1]);
+  std::cout << "Maximum intensity difference: " << maximumDifference << ", pixels differing more than "
+    << intensityTolerance << ": " << differentPixelsPercent << "%" << std::endl;
+  if (differentPixelsPercent > maximumDifferentPixelsPercent)
+  {
+    std::cerr << __LINE__ << ": DRR image differs from baseline in " << differentPixelsPercent << "% of the pixels" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
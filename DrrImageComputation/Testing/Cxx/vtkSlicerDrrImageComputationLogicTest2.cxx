@@ -0,0 +1,307 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DrrImageComputation includes
+#include "vtkSlicerDrrImageComputationLogic.h"
+#include "vtkMRMLDrrImageComputationNode.h"
+
+// Beams includes
+#include <vtkMRMLRTBeamNode.h>
+#include <vtkMRMLRTPlanNode.h>
+#include <vtkSlicerBeamsModuleLogic.h>
+
+// PlanarImage includes
+#include <vtkSlicerPlanarImageModuleLogic.h>
+
+// Slicer includes
+#include <vtkSlicerApplicationLogic.h>
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSequenceNode.h>
+#include <vtkMRMLVolumeArchetypeStorageNode.h>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// ITK includes
+#include "itkFactoryRegistration.h"
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  bool LoadVolume(vtkMRMLScene* scene, const char* fileName, vtkMRMLScalarVolumeNode* volumeNode)
+  {
+    vtkNew<vtkMRMLVolumeArchetypeStorageNode> storageNode;
+    storageNode->SetFileName(fileName);
+    scene->AddNode(storageNode);
+    scene->AddNode(volumeNode);
+    volumeNode->SetAndObserveStorageNodeID(storageNode->GetID());
+    return storageNode->ReadData(volumeNode) && volumeNode->GetImageData();
+  }
+
+  //-----------------------------------------------------------------------------
+  /// Check that a DRR volume has the same pixel grid, geometry and intensities as the expected one
+  bool AreDrrVolumesEqual(vtkMRMLScalarVolumeNode* drrVolumeNode, vtkMRMLScalarVolumeNode* expectedVolumeNode,
+    double intensityTolerance)
+  {
+    if (!drrVolumeNode || !drrVolumeNode->GetImageData() || !expectedVolumeNode || !expectedVolumeNode->GetImageData())
+    {
+      std::cerr << "Invalid DRR volume" << std::endl;
+      return false;
+    }
+
+    int dimensions[3] = { 0, 0, 0 };
+    int expectedDimensions[3] = { 0, 0, 0 };
+    drrVolumeNode->GetImageData()->GetDimensions(dimensions);
+    expectedVolumeNode->GetImageData()->GetDimensions(expectedDimensions);
+    if (!std::equal(dimensions, dimensions + 3, expectedDimensions))
+    {
+      std::cerr << "DRR image dimensions (" << dimensions[0] << ", " << dimensions[1] << ", " << dimensions[2]
+        << ") differ from expected (" << expectedDimensions[0] << ", " << expectedDimensions[1] << ", " << expectedDimensions[2] << ")" << std::endl;
+      return false;
+    }
+
+    vtkNew<vtkMatrix4x4> ijkToRasMatrix;
+    vtkNew<vtkMatrix4x4> expectedIjkToRasMatrix;
+    drrVolumeNode->GetIJKToRASMatrix(ijkToRasMatrix);
+    expectedVolumeNode->GetIJKToRASMatrix(expectedIjkToRasMatrix);
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        if (fabs(ijkToRasMatrix->GetElement(i, j) - expectedIjkToRasMatrix->GetElement(i, j)) > 1e-6)
+        {
+          std::cerr << "DRR image IJK to RAS matrix differs from expected at (" << i << ", " << j << ")" << std::endl;
+          return false;
+        }
+      }
+    }
+
+    for (int j = 0; j < dimensions[1]; ++j)
+    {
+      for (int i = 0; i < dimensions[0]; ++i)
+      {
+        double difference = fabs( drrVolumeNode->GetImageData()->GetScalarComponentAsDouble( i, j, 0, 0)
+          - expectedVolumeNode->GetImageData()->GetScalarComponentAsDouble( i, j, 0, 0));
+        if (difference > intensityTolerance)
+        {
+          std::cerr << "DRR image intensity differs from expected at pixel (" << i << ", " << j << ") by " << difference << std::endl;
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDrrImageComputationLogicTest2(int argc, char* argv[])
+{
+  // Arguments: -InputVolume <CT volume>
+  // DRR images computed for several views at once must be the same as the ones computed one by one
+  const char* inputVolumeFileName = nullptr;
+  for (int argIndex = 1; argIndex + 1 < argc; argIndex += 2)
+  {
+    std::string argName(argv[argIndex]);
+    if (argName == "-InputVolume")
+    {
+      inputVolumeFileName = argv[argIndex + 1];
+    }
+    else
+    {
+      std::cerr << "Invalid argument: " << argName << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (!inputVolumeFileName)
+  {
+    std::cerr << "Invalid arguments!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Make sure NRRD reading works
+  itk::itkFactoryRegistration();
+
+  vtkNew<vtkMRMLScene> scene;
+  if (!scene->IsNodeClassRegistered("vtkMRMLSequenceNode"))
+  {
+    scene->RegisterNodeClass(vtkSmartPointer<vtkMRMLSequenceNode>::New());
+  }
+
+  // Set up the logic classes that are accessed by the DRR logic for setting up RT images
+  vtkNew<vtkSlicerApplicationLogic> applicationLogic;
+  vtkNew<vtkSlicerBeamsModuleLogic> beamsLogic;
+  beamsLogic->SetMRMLScene(scene);
+  vtkNew<vtkSlicerPlanarImageModuleLogic> planarImageLogic;
+  planarImageLogic->SetMRMLScene(scene);
+  applicationLogic->SetModuleLogic("Beams", beamsLogic);
+  applicationLogic->SetModuleLogic("PlanarImage", planarImageLogic);
+  vtkNew<vtkSlicerDrrImageComputationLogic> logic;
+  logic->SetMRMLApplicationLogic(applicationLogic);
+  logic->SetMRMLScene(scene);
+
+  vtkNew<vtkMRMLScalarVolumeNode> ctVolumeNode;
+  if (!LoadVolume(scene, inputVolumeFileName, ctVolumeNode))
+  {
+    std::cerr << __LINE__ << ": Failed to load input volume " << inputVolumeFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Plan with two beams, isocenter at the origin
+  const double gantryAngles[2] = { 0., 90. };
+  vtkNew<vtkMRMLRTPlanNode> planNode;
+  scene->AddNode(planNode);
+  std::vector<vtkSmartPointer<vtkMRMLRTBeamNode> > beamNodes;
+  for (double gantryAngle : gantryAngles)
+  {
+    vtkSmartPointer<vtkMRMLRTBeamNode> beamNode = vtkSmartPointer<vtkMRMLRTBeamNode>::New();
+    beamNode->SetName(("Beam G" + std::to_string(static_cast<int>(gantryAngle))).c_str());
+    beamNode->SetGantryAngle(gantryAngle);
+    scene->AddNode(beamNode);
+    planNode->AddBeam(beamNode);
+    beamNodes.push_back(beamNode);
+  }
+
+  // Coarse imager to keep the test fast
+  int imagerResolution[2] = { 400, 400 };
+  double imagerSpacing[2] = { 1.0, 1.0 };
+  float autoscaleRange[2] = { 0.f, 255.f };
+
+  vtkNew<vtkMRMLDrrImageComputationNode> parameterNode;
+  scene->AddNode(parameterNode);
+  parameterNode->SetAndObserveBeamNode(beamNodes[0]);
+  parameterNode->SetIsocenterImagerDistance(400.);
+  parameterNode->SetImagerResolution(imagerResolution);
+  parameterNode->SetImagerSpacing(imagerSpacing);
+  parameterNode->SetImageWindowFlag(false);
+  parameterNode->SetAutoscaleFlag(false);
+  parameterNode->SetAutoscaleRange(autoscaleRange);
+  parameterNode->SetExponentialMappingFlag(true);
+  parameterNode->SetHUThresholdBelow(-1000);
+  parameterNode->SetHUConversion(vtkMRMLDrrImageComputationNode::Preprocess);
+  parameterNode->SetAlgorithmReconstuction(vtkMRMLDrrImageComputationNode::Exact);
+  parameterNode->SetThreading(vtkMRMLDrrImageComputationNode::CPU);
+  parameterNode->SetInvertIntensityFlag(true);
+
+  const double intensityTolerance = 1e-3;
+
+  // Batch views: one DRR image per view in the sequence, each the same as the image of a single view
+  for (double gantryAngle : gantryAngles)
+  {
+    parameterNode->AddBatchView(gantryAngle, 0.);
+  }
+  vtkMRMLSequenceNode* sequenceNode = logic->ComputeBatchDRR(parameterNode, ctVolumeNode);
+  if (!sequenceNode)
+  {
+    std::cerr << __LINE__ << ": Failed to compute batch DRR images" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (sequenceNode->GetNumberOfDataNodes() != 2)
+  {
+    std::cerr << __LINE__ << ": Number of batch DRR images is " << sequenceNode->GetNumberOfDataNodes() << " instead of 2" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkImageData> attenuationImageData;
+  vtkNew<vtkMatrix4x4> attenuationIjkToLpsMatrix;
+  if (!logic->ComputeAttenuationImageData(parameterNode, ctVolumeNode, attenuationImageData, attenuationIjkToLpsMatrix))
+  {
+    std::cerr << __LINE__ << ": Failed to compute attenuation image" << std::endl;
+    return EXIT_FAILURE;
+  }
+  double isocenterLPS[3] = { 0., 0., 0. };
+  parameterNode->GetIsocenterPositionLPS(isocenterLPS);
+  double sourceAxisDistance = beamNodes[0]->GetSAD();
+  double sourceImagerDistance = sourceAxisDistance + parameterNode->GetIsocenterImagerDistance();
+  for (int view = 0; view < 2; ++view)
+  {
+    double normal[3] = { 0., 0., 0. };
+    double viewUp[3] = { 0., 0., 0. };
+    if (!logic->GetNormalAndVupVectorsFromAngles(gantryAngles[view], 0., normal, viewUp))
+    {
+      std::cerr << __LINE__ << ": Failed to get imager orientation of view " << view << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkNew<vtkMatrix4x4> projectionMatrix;
+    vtkSlicerDrrImageComputationLogic::CalculatePlastimatchProjectionMatrix( normal, viewUp, isocenterLPS,
+      sourceAxisDistance, sourceImagerDistance, imagerSpacing, projectionMatrix);
+    vtkNew<vtkImageData> drrImageData;
+    if (!logic->ComputeDrrImageData(parameterNode, attenuationImageData, attenuationIjkToLpsMatrix, projectionMatrix, drrImageData))
+    {
+      std::cerr << __LINE__ << ": Failed to compute DRR image of view " << view << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkNew<vtkMRMLScalarVolumeNode> expectedVolumeNode;
+    vtkSlicerDrrImageComputationLogic::SetDrrVolumeImageData(expectedVolumeNode, drrImageData, imagerSpacing);
+
+    if (!AreDrrVolumesEqual(vtkMRMLScalarVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(view)), expectedVolumeNode, intensityTolerance))
+    {
+      std::cerr << __LINE__ << ": Batch DRR image of view " << view << " differs from the single view DRR image" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Plan beams: one RT image per beam, each the same as the one computed for the beam alone
+  vtkNew<vtkCollection> drrVolumeNodes;
+  if (!logic->ComputePlanDRRs(parameterNode, ctVolumeNode, planNode, drrVolumeNodes))
+  {
+    std::cerr << __LINE__ << ": Failed to compute plan DRR images" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (drrVolumeNodes->GetNumberOfItems() != 2)
+  {
+    std::cerr << __LINE__ << ": Number of plan DRR images is " << drrVolumeNodes->GetNumberOfItems() << " instead of 2" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int view = 0; view < 2; ++view)
+  {
+    vtkNew<vtkMRMLDrrImageComputationNode> beamParameterNode;
+    scene->AddNode(beamParameterNode);
+    beamParameterNode->CopyContent(parameterNode);
+    beamParameterNode->SetAndObserveBeamNode(beamNodes[view]);
+    double normal[3] = { 0., 0., 0. };
+    double viewUp[3] = { 0., 0., 0. };
+    logic->GetNormalAndVupVectorsFromAngles(gantryAngles[view], 0., normal, viewUp);
+    beamParameterNode->SetNormalVector(normal);
+    beamParameterNode->SetViewUpVector(viewUp);
+
+    vtkMRMLScalarVolumeNode* expectedVolumeNode = logic->ComputeDRR(beamParameterNode, ctVolumeNode);
+    if (!expectedVolumeNode)
+    {
+      std::cerr << __LINE__ << ": Failed to compute DRR image of beam " << view << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!AreDrrVolumesEqual(vtkMRMLScalarVolumeNode::SafeDownCast(drrVolumeNodes->GetItemAsObject(view)), expectedVolumeNode, intensityTolerance))
+    {
+      std::cerr << __LINE__ << ": Plan DRR image of beam " << view << " differs from the DRR image computed for the beam" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
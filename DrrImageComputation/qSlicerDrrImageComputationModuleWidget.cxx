@@ -17,8 +17,11 @@
 
 // Qt includes
 #include <QDebug>
+#include <QThread>
+#include <QTimer>
 
 // qSlicer includes
+#include "qSlicerCoreApplication.h"
 #include "qSlicerDrrImageComputationModuleWidget.h"
 #include "qSlicerSimpleMarkupsWidget.h"
 #include "ui_qSlicerDrrImageComputationModuleWidget.h"
@@ -30,6 +33,10 @@
 #include <vtkMRMLMarkupsFiducialNode.h>
 #include <vtkMRMLCameraNode.h>
 #include <vtkMRMLTableNode.h>
+#include <vtkMRMLSelectionNode.h>
+
+// Slicer includes
+#include <vtkSlicerApplicationLogic.h>
 
 // SlicerRT MRML Beams includes
 #include <vtkMRMLRTBeamNode.h>
@@ -45,6 +52,9 @@
 #include <vtkMatrix4x4.h>
 #include <vtkCamera.h>
 #include <vtkTable.h>
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
 
 namespace {
 
@@ -59,6 +69,10 @@ constexpr int PROJECTED_POINT_ROW_COLUMN = 7;
 constexpr int PROJECTED_POINT_STATUS_COLUMN = 8;
 constexpr int PROJECTED_POINT_COLUMNS = 9;
 
+constexpr int DRR_PREVIEW_DOWNSAMPLING = 4;
+constexpr int DRR_PREVIEW_REFINEMENT_DELAY_MS = 500;
+const char* DRR_PREVIEW_VOLUME_NODE_NAME = "DRR preview";
+
 };
 
 //-----------------------------------------------------------------------------
@@ -74,6 +88,37 @@ public:
   vtkSlicerDrrImageComputationLogic* logic() const;
   bool CheckPointWithinVolumeBounds(vtkMRMLScalarVolumeNode* volumeNode, const double pointRAS[3]) const;
   bool GetMarkupsWidgetRowList(std::list< int >& list);
+  /// Recompute attenuation image of the CT volume for DRR preview if the CT or HU conversion changed
+  bool UpdatePreviewAttenuationImage(vtkMRMLDrrImageComputationNode* parameterNode, vtkMRMLScalarVolumeNode* ctVolumeNode);
+  /// Show DRR image in the DRR preview volume, create the volume if needed
+  void SetPreviewImageData(vtkImageData* drrImageData, vtkMRMLDrrImageComputationNode* computationParameterNode);
+  /// Abort running refinement and wait until it finishes
+  void StopPreviewRefinement();
+  /// Stop refinement and release the attenuation image of the preview
+  void ClearPreviewAttenuationImage();
+
+public:
+  /// Attenuation image of the CT volume, shared by preview and refinement
+  vtkSmartPointer<vtkImageData> PreviewAttenuationImageData;
+  vtkSmartPointer<vtkMatrix4x4> PreviewAttenuationIjkToLpsMatrix;
+  vtkWeakPointer<vtkMRMLScalarVolumeNode> PreviewCtVolumeNode;
+  vtkMTimeType PreviewCtImageDataMTime;
+  int PreviewHUThresholdBelow;
+  int PreviewHUConversion;
+
+  vtkWeakPointer<vtkMRMLScalarVolumeNode> PreviewVolumeNode;
+  /// Single shot timer restarted by every geometry change, refinement starts on its timeout
+  QTimer* PreviewRefinementTimer;
+  /// Thread of the refinement in progress, nullptr if there is none
+  QThread* PreviewRefinementThread;
+  /// Incremented by every preview, a refinement is discarded if a newer preview has been made
+  unsigned int PreviewCount;
+  unsigned int RefinementPreviewCount;
+  /// Inputs and output of the refinement in progress
+  vtkSmartPointer<vtkMRMLDrrImageComputationNode> RefinementParameterNode;
+  vtkSmartPointer<vtkMatrix4x4> RefinementProjectionMatrix;
+  vtkSmartPointer<vtkImageData> RefinementImageData;
+  bool RefinementSucceeded;
 };
 
 //-----------------------------------------------------------------------------
@@ -82,7 +127,15 @@ public:
 //-----------------------------------------------------------------------------
 qSlicerDrrImageComputationModuleWidgetPrivate::qSlicerDrrImageComputationModuleWidgetPrivate(qSlicerDrrImageComputationModuleWidget &object)
   :
-  q_ptr(&object)
+  q_ptr(&object),
+  PreviewCtImageDataMTime(0),
+  PreviewHUThresholdBelow(0),
+  PreviewHUConversion(0),
+  PreviewRefinementTimer(nullptr),
+  PreviewRefinementThread(nullptr),
+  PreviewCount(0),
+  RefinementPreviewCount(0),
+  RefinementSucceeded(false)
 {
 }
 
@@ -141,6 +194,117 @@ bool qSlicerDrrImageComputationModuleWidgetPrivate::GetMarkupsWidgetRowList(std:
   return (list.size() > 0);
 }
 
+//------------------------------------------------------------------------------
+bool qSlicerDrrImageComputationModuleWidgetPrivate::UpdatePreviewAttenuationImage(vtkMRMLDrrImageComputationNode* parameterNode,
+  vtkMRMLScalarVolumeNode* ctVolumeNode)
+{
+  if (!parameterNode || !ctVolumeNode || !ctVolumeNode->GetImageData())
+  {
+    qCritical() << Q_FUNC_INFO << ": Invalid parameter node or CT volume node";
+    return false;
+  }
+
+  if (this->PreviewAttenuationImageData && this->PreviewCtVolumeNode == ctVolumeNode
+    && this->PreviewCtImageDataMTime == ctVolumeNode->GetImageData()->GetMTime()
+    && this->PreviewHUThresholdBelow == parameterNode->GetHUThresholdBelow()
+    && this->PreviewHUConversion == static_cast<int>(parameterNode->GetHUConversion()))
+  {
+    return true;
+  }
+
+  // Running refinement reads the attenuation image, so it is stopped before the image is replaced
+  this->StopPreviewRefinement();
+
+  vtkSmartPointer<vtkImageData> attenuationImageData = vtkSmartPointer<vtkImageData>::New();
+  vtkSmartPointer<vtkMatrix4x4> attenuationIjkToLpsMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (!this->logic()->ComputeAttenuationImageData( parameterNode, ctVolumeNode, attenuationImageData, attenuationIjkToLpsMatrix))
+  {
+    qCritical() << Q_FUNC_INFO << ": Failed to compute attenuation image";
+    this->PreviewAttenuationImageData = nullptr;
+    return false;
+  }
+
+  this->PreviewAttenuationImageData = attenuationImageData;
+  this->PreviewAttenuationIjkToLpsMatrix = attenuationIjkToLpsMatrix;
+  this->PreviewCtVolumeNode = ctVolumeNode;
+  this->PreviewCtImageDataMTime = ctVolumeNode->GetImageData()->GetMTime();
+  this->PreviewHUThresholdBelow = parameterNode->GetHUThresholdBelow();
+  this->PreviewHUConversion = static_cast<int>(parameterNode->GetHUConversion());
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void qSlicerDrrImageComputationModuleWidgetPrivate::SetPreviewImageData(vtkImageData* drrImageData,
+  vtkMRMLDrrImageComputationNode* computationParameterNode)
+{
+  Q_Q(qSlicerDrrImageComputationModuleWidget);
+  vtkMRMLScene* scene = q->mrmlScene();
+  if (!scene)
+  {
+    qCritical() << Q_FUNC_INFO << ": Invalid scene";
+    return;
+  }
+
+  bool newPreviewVolume = false;
+  if (!this->PreviewVolumeNode || this->PreviewVolumeNode->GetScene() != scene)
+  {
+    vtkMRMLScalarVolumeNode* volumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(
+      scene->AddNewNodeByClass( "vtkMRMLScalarVolumeNode", DRR_PREVIEW_VOLUME_NODE_NAME));
+    volumeNode->CreateDefaultDisplayNodes();
+    this->PreviewVolumeNode = volumeNode;
+    newPreviewVolume = true;
+  }
+
+  double imagerSpacing[2] = { 0.25, 0.25 };
+  computationParameterNode->GetImagerSpacing(imagerSpacing);
+  vtkSlicerDrrImageComputationLogic::SetDrrVolumeImageData( this->PreviewVolumeNode, drrImageData, imagerSpacing);
+
+  // Show new preview volume in the slice views
+  vtkMRMLSelectionNode* selectionNode = qSlicerCoreApplication::application()->applicationLogic()->GetSelectionNode();
+  if (newPreviewVolume && selectionNode)
+  {
+    selectionNode->SetReferenceActiveVolumeID(this->PreviewVolumeNode->GetID());
+    qSlicerCoreApplication::application()->applicationLogic()->PropagateVolumeSelection(0);
+  }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerDrrImageComputationModuleWidgetPrivate::StopPreviewRefinement()
+{
+  if (this->PreviewRefinementTimer)
+  {
+    this->PreviewRefinementTimer->stop();
+  }
+  if (!this->PreviewRefinementThread)
+  {
+    return;
+  }
+
+  if (this->logic())
+  {
+    this->logic()->AbortDrrImageComputation();
+  }
+  this->PreviewRefinementThread->wait();
+  delete this->PreviewRefinementThread;
+  this->PreviewRefinementThread = nullptr;
+
+  this->RefinementParameterNode = nullptr;
+  this->RefinementProjectionMatrix = nullptr;
+  this->RefinementImageData = nullptr;
+}
+
+//------------------------------------------------------------------------------
+void qSlicerDrrImageComputationModuleWidgetPrivate::ClearPreviewAttenuationImage()
+{
+  // Running refinement reads the attenuation image, so it is stopped before the image is released
+  this->StopPreviewRefinement();
+
+  this->PreviewAttenuationImageData = nullptr;
+  this->PreviewAttenuationIjkToLpsMatrix = nullptr;
+  this->PreviewCtVolumeNode = nullptr;
+  this->PreviewCtImageDataMTime = 0;
+}
+
 //-----------------------------------------------------------------------------
 // qSlicerDrrImageComputationModuleWidget methods
 
@@ -154,6 +318,8 @@ qSlicerDrrImageComputationModuleWidget::qSlicerDrrImageComputationModuleWidget(Q
 //-----------------------------------------------------------------------------
 qSlicerDrrImageComputationModuleWidget::~qSlicerDrrImageComputationModuleWidget()
 {
+  Q_D(qSlicerDrrImageComputationModuleWidget);
+  d->StopPreviewRefinement();
 }
 
 //-----------------------------------------------------------------------------
@@ -212,6 +378,7 @@ void qSlicerDrrImageComputationModuleWidget::setup()
 
   // Buttons
   connect( d->PushButton_ComputeDrr, SIGNAL(clicked()), this, SLOT(onComputeDrrClicked()));
+  connect( d->CheckBox_InteractivePreview, SIGNAL(toggled(bool)), this, SLOT(onInteractivePreviewToggled(bool)));
   connect( d->CheckBox_ShowDrrMarkups, SIGNAL(toggled(bool)), this, SLOT(onShowMarkupsToggled(bool)));
   connect( d->GroupBox_ImageWindowParameters, SIGNAL(toggled(bool)), this, SLOT(onUseImageWindowToggled(bool)));
   connect( d->PushButton_UpdateBeamFromCamera, SIGNAL(clicked()), this, SLOT(onUpdateBeamFromCameraClicked()));
@@ -220,6 +387,12 @@ void qSlicerDrrImageComputationModuleWidget::setup()
 
   // Handle scene change event if occurs
   qvtkConnect( d->logic(), vtkCommand::ModifiedEvent, this, SLOT(onLogicModified()));
+
+  // DRR preview refinement starts when the geometry has not changed for a while
+  d->PreviewRefinementTimer = new QTimer(this);
+  d->PreviewRefinementTimer->setSingleShot(true);
+  d->PreviewRefinementTimer->setInterval(DRR_PREVIEW_REFINEMENT_DELAY_MS);
+  connect( d->PreviewRefinementTimer, SIGNAL(timeout()), this, SLOT(onDrrPreviewRefinementTimeout()));
 }
 
 //-----------------------------------------------------------------------------
@@ -385,6 +558,8 @@ void qSlicerDrrImageComputationModuleWidget::onSceneImportedEvent()
 void qSlicerDrrImageComputationModuleWidget::onSceneClosedEvent()
 {
   Q_D(qSlicerDrrImageComputationModuleWidget);
+  // Do not keep the attenuation image of a CT volume of the closed scene
+  d->ClearPreviewAttenuationImage();
   this->updateWidgetFromMRML();
 }
 
@@ -426,6 +601,7 @@ void qSlicerDrrImageComputationModuleWidget::onRTBeamNodeChanged(vtkMRMLNode* no
 
   parameterNode->SetAndObserveBeamNode(beamNode); // Update imager and image markups, DRR arguments in logic
   parameterNode->Modified();
+  this->updateDrrPreview();
 }
 
 //-----------------------------------------------------------------------------
@@ -454,6 +630,8 @@ void qSlicerDrrImageComputationModuleWidget::onCtVolumeNodeChanged(vtkMRMLNode*
     qCritical() << Q_FUNC_INFO << ": Invalid reference CT volume node";
     return;
   }
+
+  this->updateDrrPreview();
 }
 
 //-----------------------------------------------------------------------------
@@ -553,6 +731,7 @@ void qSlicerDrrImageComputationModuleWidget::onIsocenterImagerDistanceValueChang
   }
 
   parameterNode->SetIsocenterImagerDistance(value); // Update imager and image markups, DRR arguments
+  this->updateDrrPreview();
 }
 
 //-----------------------------------------------------------------------------
@@ -568,6 +747,7 @@ void qSlicerDrrImageComputationModuleWidget::onImagerSpacingChanged(double* spac
 
   double s[2] = { spacing[0], spacing[1] }; // columns, rows
   parameterNode->SetImagerSpacing(s); // Update imager and image markups, DRR arguments
+  this->updateDrrPreview();
 }
 
 //-----------------------------------------------------------------------------
@@ -594,6 +774,7 @@ void qSlicerDrrImageComputationModuleWidget::onImagerResolutionChanged(double* r
   int imagerResolution[2] = { static_cast<int>(res[0]), static_cast<int>(res[1]) }; // x, y
 
   parameterNode->SetImagerResolution(imagerResolution); // Update imager and image markups, DRR arguments
+  this->updateDrrPreview();
 }
 
 //-----------------------------------------------------------------------------
@@ -612,6 +793,7 @@ void qSlicerDrrImageComputationModuleWidget::onUpdateBeamFromCameraClicked()
   if (d->logic()->UpdateBeamFromCamera(parameterNode))
   {
     d->logic()->UpdateMarkupsNodes(parameterNode); // Update imager and image markups, DRR arguments
+    this->updateDrrPreview();
   }
 }
 
@@ -633,6 +815,7 @@ void qSlicerDrrImageComputationModuleWidget::onImageWindowColumnsValuesChanged(d
   imageWindow[2] = end_column;
 
   parameterNode->SetImageWindow(imageWindow); // Update imager and image markups, DRR arguments
+  this->updateDrrPreview();
 }
 
 //-----------------------------------------------------------------------------
@@ -653,6 +836,7 @@ void qSlicerDrrImageComputationModuleWidget::onImageWindowRowsValuesChanged( dou
   imageWindow[3] = end_row;
 
   parameterNode->SetImageWindow(imageWindow); // Update imager and image markups, DRR arguments
+  this->updateDrrPreview();
 }
 
 //-----------------------------------------------------------------------------
@@ -693,6 +877,7 @@ void qSlicerDrrImageComputationModuleWidget::onUseImageWindowToggled(bool value)
   }
 
   parameterNode->SetImageWindowFlag(value); // Update imager and image markups, DRR arguments
+  this->updateDrrPreview();
 }
 
 //-----------------------------------------------------------------------------
@@ -722,7 +907,16 @@ void qSlicerDrrImageComputationModuleWidget::onComputeDrrClicked()
   
   QApplication::setOverrideCursor(Qt::WaitCursor);
 
-  vtkMRMLScalarVolumeNode* drrImageNode = d->logic()->ComputePlastimatchDRR( parameterNode, ctVolumeNode);
+  // CPU computation is done in-process, GPU computation requires plastimatch
+  vtkMRMLScalarVolumeNode* drrImageNode = nullptr;
+  if (parameterNode->GetThreading() == vtkMRMLDrrImageComputationNode::CPU)
+  {
+    drrImageNode = d->logic()->ComputeDRR( parameterNode, ctVolumeNode);
+  }
+  else
+  {
+    drrImageNode = d->logic()->ComputePlastimatchDRR( parameterNode, ctVolumeNode);
+  }
   if (drrImageNode)
   {
     // node is OK
@@ -732,6 +926,142 @@ void qSlicerDrrImageComputationModuleWidget::onComputeDrrClicked()
   QApplication::restoreOverrideCursor();
 }
 
+//-----------------------------------------------------------------------------
+void qSlicerDrrImageComputationModuleWidget::onInteractivePreviewToggled(bool toggled)
+{
+  Q_D(qSlicerDrrImageComputationModuleWidget);
+
+  if (toggled)
+  {
+    this->updateDrrPreview();
+  }
+  else
+  {
+    d->ClearPreviewAttenuationImage();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDrrImageComputationModuleWidget::updateDrrPreview()
+{
+  Q_D(qSlicerDrrImageComputationModuleWidget);
+  if (!d->CheckBox_InteractivePreview->isChecked() || !this->mrmlScene())
+  {
+    return;
+  }
+
+  vtkMRMLDrrImageComputationNode* parameterNode = vtkMRMLDrrImageComputationNode::SafeDownCast(d->MRMLNodeComboBox_ParameterSet->currentNode());
+  vtkMRMLScalarVolumeNode* ctVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(d->MRMLNodeComboBox_CtVolume->currentNode());
+  if (!parameterNode || !parameterNode->GetBeamNode() || !ctVolumeNode)
+  {
+    // Nothing to preview yet
+    return;
+  }
+
+  // Refinement in progress is superseded by the new geometry
+  d->logic()->AbortDrrImageComputation();
+  d->PreviewCount++;
+
+  if (!d->UpdatePreviewAttenuationImage( parameterNode, ctVolumeNode))
+  {
+    return;
+  }
+
+  // Preview is computed right away at reduced resolution with the uniform algorithm
+  vtkNew<vtkMRMLDrrImageComputationNode> previewParameterNode;
+  vtkNew<vtkMatrix4x4> previewProjectionMatrix;
+  if (!d->logic()->SetupDrrImageComputation( parameterNode, DRR_PREVIEW_DOWNSAMPLING, previewParameterNode, previewProjectionMatrix))
+  {
+    qCritical() << Q_FUNC_INFO << ": Failed to set up DRR preview";
+    return;
+  }
+  previewParameterNode->SetAlgorithmReconstuction(vtkMRMLDrrImageComputationNode::Uniform);
+
+  vtkNew<vtkImageData> previewImageData;
+  if (!d->logic()->ComputeDrrImageData( previewParameterNode, d->PreviewAttenuationImageData,
+    d->PreviewAttenuationIjkToLpsMatrix, previewProjectionMatrix, previewImageData))
+  {
+    qCritical() << Q_FUNC_INFO << ": Failed to compute DRR preview";
+    return;
+  }
+  d->SetPreviewImageData( previewImageData, previewParameterNode);
+
+  d->PreviewRefinementTimer->start();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDrrImageComputationModuleWidget::onDrrPreviewRefinementTimeout()
+{
+  Q_D(qSlicerDrrImageComputationModuleWidget);
+
+  if (d->PreviewRefinementThread)
+  {
+    // Superseded refinement has been aborted, try again once it has finished
+    d->PreviewRefinementTimer->start();
+    return;
+  }
+
+  vtkMRMLDrrImageComputationNode* parameterNode = vtkMRMLDrrImageComputationNode::SafeDownCast(d->MRMLNodeComboBox_ParameterSet->currentNode());
+  if (!parameterNode || !d->PreviewAttenuationImageData)
+  {
+    return;
+  }
+
+  // Refinement uses the requested resolution and the exact algorithm. It gets its own copy
+  // of the parameters, so it can run in the background while the geometry keeps changing.
+  d->RefinementParameterNode = vtkSmartPointer<vtkMRMLDrrImageComputationNode>::New();
+  d->RefinementProjectionMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  d->RefinementImageData = vtkSmartPointer<vtkImageData>::New();
+  if (!d->logic()->SetupDrrImageComputation( parameterNode, 1, d->RefinementParameterNode, d->RefinementProjectionMatrix))
+  {
+    qCritical() << Q_FUNC_INFO << ": Failed to set up DRR preview refinement";
+    return;
+  }
+  d->RefinementParameterNode->SetAlgorithmReconstuction(vtkMRMLDrrImageComputationNode::Exact);
+  d->RefinementPreviewCount = d->PreviewCount;
+  d->RefinementSucceeded = false;
+
+  vtkSlicerDrrImageComputationLogic* logic = d->logic();
+  vtkMRMLDrrImageComputationNode* refinementParameterNode = d->RefinementParameterNode;
+  vtkImageData* attenuationImageData = d->PreviewAttenuationImageData;
+  vtkMatrix4x4* attenuationIjkToLpsMatrix = d->PreviewAttenuationIjkToLpsMatrix;
+  vtkMatrix4x4* projectionMatrix = d->RefinementProjectionMatrix;
+  vtkImageData* refinementImageData = d->RefinementImageData;
+  bool* refinementSucceeded = &d->RefinementSucceeded;
+  d->PreviewRefinementThread = QThread::create([=]()
+  {
+    *refinementSucceeded = logic->ComputeDrrImageData( refinementParameterNode, attenuationImageData,
+      attenuationIjkToLpsMatrix, projectionMatrix, refinementImageData);
+  });
+  connect( d->PreviewRefinementThread, SIGNAL(finished()), this, SLOT(onDrrPreviewRefinementFinished()));
+  d->PreviewRefinementThread->start();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDrrImageComputationModuleWidget::onDrrPreviewRefinementFinished()
+{
+  Q_D(qSlicerDrrImageComputationModuleWidget);
+
+  // Refinement may have been stopped and deleted already
+  if (!d->PreviewRefinementThread || !d->PreviewRefinementThread->isFinished())
+  {
+    return;
+  }
+  d->PreviewRefinementThread->deleteLater();
+  d->PreviewRefinementThread = nullptr;
+
+  // Result is shown only if no newer preview has been made in the meantime
+  if (d->RefinementSucceeded && d->RefinementPreviewCount == d->PreviewCount
+    && d->CheckBox_InteractivePreview->isChecked())
+  {
+    d->SetPreviewImageData( d->RefinementImageData, d->RefinementParameterNode);
+  }
+
+  d->RefinementParameterNode = nullptr;
+  d->RefinementProjectionMatrix = nullptr;
+  d->RefinementImageData = nullptr;
+}
+
 //-----------------------------------------------------------------------------
 void qSlicerDrrImageComputationModuleWidget::onMarkupsControlPointSelectionChanged(int index)
 {
@@ -64,6 +64,13 @@ public slots:
   void onUseImageWindowToggled(bool);
   void onUpdateBeamFromCameraClicked();
   void onComputeDrrClicked();
+  void onInteractivePreviewToggled(bool);
+
+  /// Compute low resolution DRR preview immediately, and schedule its refinement
+  /// to the requested resolution once the geometry has not changed for a while
+  void updateDrrPreview();
+  void onDrrPreviewRefinementTimeout();
+  void onDrrPreviewRefinementFinished();
 
   void onMarkupsControlPointSelectionChanged(int index);
   void onMarkupsNodeChanged();
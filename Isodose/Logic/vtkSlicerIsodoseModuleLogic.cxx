@@ -41,6 +41,7 @@
 #include <vtkMRMLModelNode.h>
 #include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLSliceNode.h>
 #include <vtkMRMLTransformNode.h>
 #include <vtkMRMLScalarVolumeDisplayNode.h>
 
@@ -49,16 +50,23 @@
 
 // VTK includes
 #include <vtkColorTransferFunction.h>
+#include <vtkDataArray.h>
+#include <vtkFlyingEdges2D.h>
 #include <vtkGeneralTransform.h>
 #include <vtkImageChangeInformation.h>
 #include <vtkImageData.h>
 #include <vtkImageMarchingCubes.h>
 #include <vtkImageReslice.h>
 #include <vtkLookupTable.h>
+#include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
 #include <vtkPolyDataNormals.h>
+#include <vtkQuadricDecimation.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartPointer.h>
+#include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkTriangleFilter.h>
 #include <vtkWindowedSincPolyDataFilter.h>
@@ -69,6 +77,14 @@
 
 #include "vtksys/SystemTools.hxx"
 
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
 //----------------------------------------------------------------------------
 const char* DEFAULT_ISODOSE_COLOR_TABLE_FILE_NAME = "Isodose_ColorTable.ctbl";
 const char* DEFAULT_ISODOSE_COLOR_TABLE_NODE_NAME = "Isodose_ColorTable_Default";
@@ -79,14 +95,153 @@ const std::string vtkSlicerIsodoseModuleLogic::ISODOSE_COLOR_TABLE_NODE_NAME_POS
 
 std::string vtkSlicerIsodoseModuleLogic::IsodoseColorNodeCopyUniqueName = DEFAULT_ISODOSE_COLOR_TABLECOPY_NODE_NAME;
 
+const char* SLICE_ISODOSE_LINES_MODEL_NODE_NAME_INFIX = "_IsodoseLines_";
+const char* ISOLEVELS_ARRAY_NAME = "isolevels";
+/// Maximum number of cached slice planes per isodose parameter node
+const unsigned int MAXIMUM_NUMBER_OF_CACHED_SLICE_PLANES = 512;
+
+//----------------------------------------------------------------------------
+/// Decimates the isosurface of each isodose level to a triangle budget. Levels are independent,
+/// so they can be processed concurrently, each writing only its own output surface.
+class IsosurfaceDecimationFunctor
+{
+public:
+  IsosurfaceDecimationFunctor(const std::vector<vtkSmartPointer<vtkPolyData> >& levelSurfaces,
+    std::vector<vtkSmartPointer<vtkPolyData> >& decimatedLevelSurfaces, vtkIdType triangleBudget)
+    : LevelSurfaces(levelSurfaces)
+    , DecimatedLevelSurfaces(decimatedLevelSurfaces)
+    , TriangleBudget(triangleBudget)
+  {
+  }
+
+  void operator()(vtkIdType beginLevel, vtkIdType endLevel)
+  {
+    for (vtkIdType level = beginLevel; level < endLevel; ++level)
+    {
+      vtkPolyData* levelSurface = this->LevelSurfaces[level];
+      vtkIdType numberOfTriangles = levelSurface->GetNumberOfPolys();
+      if (numberOfTriangles <= this->TriangleBudget)
+      {
+        // Surface is already light enough
+        this->DecimatedLevelSurfaces[level] = levelSurface;
+        continue;
+      }
+
+      vtkNew<vtkQuadricDecimation> decimation;
+      decimation->SetInputData(levelSurface);
+      decimation->SetTargetReduction(1.0 - static_cast<double>(this->TriangleBudget) / static_cast<double>(numberOfTriangles));
+      decimation->VolumePreservationOn();
+
+      vtkNew<vtkPolyDataNormals> normals;
+      normals->SetInputConnection(decimation->GetOutputPort());
+      normals->ComputePointNormalsOn();
+      normals->SplittingOff();
+      normals->Update();
+
+      vtkSmartPointer<vtkPolyData> decimatedSurface = vtkSmartPointer<vtkPolyData>::New();
+      decimatedSurface->ShallowCopy(normals->GetOutput());
+      this->DecimatedLevelSurfaces[level] = decimatedSurface;
+    }
+  }
+
+private:
+  const std::vector<vtkSmartPointer<vtkPolyData> >& LevelSurfaces;
+  std::vector<vtkSmartPointer<vtkPolyData> >& DecimatedLevelSurfaces;
+  vtkIdType TriangleBudget;
+};
+
+//----------------------------------------------------------------------------
+class vtkSlicerIsodoseModuleLogic::vtkInternal
+{
+public:
+  /// Slice isodose lines computed for one isodose parameter node.
+  /// The cache is valid as long as the signature (modified times of dose, levels and parameters) does not change.
+  struct SliceIsodoseLinesCache
+  {
+    std::string Signature;
+    std::map<std::string, vtkSmartPointer<vtkPolyData> > LinesForPlane;
+    /// Plane keys in insertion order, used for evicting the oldest entries
+    std::deque<std::string> PlaneKeys;
+  };
+
+  /// Assemble a string from the modified times of all inputs the slice isodose lines depend on
+  static std::string GetSliceIsodoseLinesSignature(vtkMRMLIsodoseNode* parameterNode);
+
+  /// Assemble a string identifying a slice plane position and orientation
+  static std::string GetSlicePlaneKey(vtkMatrix4x4* sliceToRAS);
+
+  /// Store isodose lines for a slice plane in the cache. The oldest entry is evicted if the cache is full
+  static void AddSliceIsodoseLinesToCache(SliceIsodoseLinesCache& cache, const std::string& planeKey, vtkPolyData* isodoseLines);
+
+public:
+  /// Slice isodose lines cache for each isodose parameter node (by node ID)
+  std::map<std::string, SliceIsodoseLinesCache> SliceIsodoseLinesCaches;
+};
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIsodoseModuleLogic::vtkInternal::GetSliceIsodoseLinesSignature(vtkMRMLIsodoseNode* parameterNode)
+{
+  std::stringstream ss;
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  vtkMRMLColorTableNode* colorTableNode = parameterNode->GetColorTableNode();
+  ss << (doseVolumeNode ? doseVolumeNode->GetID() : "") << ";"
+    << (doseVolumeNode ? doseVolumeNode->GetMTime() : 0) << ";"
+    << (doseVolumeNode && doseVolumeNode->GetImageData() ? doseVolumeNode->GetImageData()->GetMTime() : 0) << ";"
+    << (doseVolumeNode && doseVolumeNode->GetParentTransformNode() ? doseVolumeNode->GetParentTransformNode()->GetMTime() : 0) << ";"
+    << (colorTableNode ? colorTableNode->GetMTime() : 0) << ";"
+    << parameterNode->GetDoseUnits() << ";"
+    << parameterNode->GetRelativeRepresentationFlag() << ";"
+    << std::setprecision(12) << parameterNode->GetReferenceDoseValue();
+  return ss.str();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIsodoseModuleLogic::vtkInternal::GetSlicePlaneKey(vtkMatrix4x4* sliceToRAS)
+{
+  // Slice offsets are rounded to one micron, so that the same slice position always maps to the same key
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  for (int row = 0; row < 3; ++row)
+  {
+    for (int column = 0; column < 4; ++column)
+    {
+      ss << sliceToRAS->GetElement(row, column) << ";";
+    }
+  }
+  return ss.str();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::vtkInternal::AddSliceIsodoseLinesToCache(
+  SliceIsodoseLinesCache& cache, const std::string& planeKey, vtkPolyData* isodoseLines)
+{
+  if (cache.PlaneKeys.size() >= MAXIMUM_NUMBER_OF_CACHED_SLICE_PLANES)
+  {
+    cache.LinesForPlane.erase(cache.PlaneKeys.front());
+    cache.PlaneKeys.pop_front();
+  }
+  cache.LinesForPlane[planeKey] = isodoseLines;
+  cache.PlaneKeys.push_back(planeKey);
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerIsodoseModuleLogic);
 
 //----------------------------------------------------------------------------
-vtkSlicerIsodoseModuleLogic::vtkSlicerIsodoseModuleLogic() = default;
+vtkSlicerIsodoseModuleLogic::vtkSlicerIsodoseModuleLogic()
+{
+  this->Internal = new vtkInternal();
+}
 
 //----------------------------------------------------------------------------
-vtkSlicerIsodoseModuleLogic::~vtkSlicerIsodoseModuleLogic() = default;
+vtkSlicerIsodoseModuleLogic::~vtkSlicerIsodoseModuleLogic()
+{
+  if (this->Internal)
+  {
+    delete this->Internal;
+    this->Internal = nullptr;
+  }
+}
 
 //----------------------------------------------------------------------------
 void vtkSlicerIsodoseModuleLogic::PrintSelf(ostream& os, vtkIndent indent)
@@ -160,6 +315,16 @@ void vtkSlicerIsodoseModuleLogic::UpdateFromMRMLScene()
     return;
   }
 
+  // Observe slice nodes for updating on-demand slice isodose lines
+  std::vector<vtkMRMLNode*> sliceNodes;
+  this->GetMRMLScene()->GetNodesByClass("vtkMRMLSliceNode", sliceNodes);
+  for (vtkMRMLNode* sliceNode : sliceNodes)
+  {
+    vtkNew<vtkIntArray> events;
+    events->InsertNextValue(vtkCommand::ModifiedEvent);
+    vtkObserveMRMLNodeEventsMacro(sliceNode, events);
+  }
+
   this->Modified();
 }
 
@@ -172,6 +337,8 @@ void vtkSlicerIsodoseModuleLogic::OnMRMLSceneEndClose()
     return;
   }
 
+  this->ClearSliceIsodoseLinesCache();
+
   this->Modified();
 }
 
@@ -184,6 +351,14 @@ void vtkSlicerIsodoseModuleLogic::OnMRMLSceneNodeAdded(vtkMRMLNode* node)
     return;
   }
 
+  if (node->IsA("vtkMRMLSliceNode"))
+  {
+    // Observe slice node for updating on-demand slice isodose lines
+    vtkNew<vtkIntArray> events;
+    events->InsertNextValue(vtkCommand::ModifiedEvent);
+    vtkObserveMRMLNodeEventsMacro(node, events);
+  }
+
   // if the scene is still updating, jump out
   if (this->GetMRMLScene()->IsBatchProcessing())
   {
@@ -211,12 +386,61 @@ void vtkSlicerIsodoseModuleLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
     return;
   }
 
+  if (node->IsA("vtkMRMLIsodoseNode") && node->GetID())
+  {
+    this->Internal->SliceIsodoseLinesCaches.erase(node->GetID());
+  }
+
+  if (node->IsA("vtkMRMLSliceNode") && node->GetID())
+  {
+    // On-demand isodose lines of the removed slice view are not displayed anywhere else
+    std::vector<vtkMRMLNode*> isodoseNodes;
+    this->GetMRMLScene()->GetNodesByClass("vtkMRMLIsodoseNode", isodoseNodes);
+    for (vtkMRMLNode* isodoseNode : isodoseNodes)
+    {
+      this->RemoveSliceIsodoseLines(vtkMRMLIsodoseNode::SafeDownCast(isodoseNode), node->GetID());
+    }
+  }
+
   if (node->IsA("vtkMRMLScalarVolumeNode") || node->IsA("vtkMRMLIsodoseNode"))
   {
     this->Modified();
   }
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData)
+{
+  Superclass::ProcessMRMLNodesEvents(caller, event, callData);
+
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene)
+  {
+    vtkErrorMacro("ProcessMRMLNodesEvents: Invalid MRML scene");
+    return;
+  }
+  if (scene->IsBatchProcessing())
+  {
+    return;
+  }
+
+  vtkMRMLSliceNode* sliceNode = vtkMRMLSliceNode::SafeDownCast(caller);
+  if (sliceNode && event == vtkCommand::ModifiedEvent)
+  {
+    // Update on-demand isodose lines of the changed slice view for all isodose parameter nodes that use it
+    std::vector<vtkMRMLNode*> isodoseNodes;
+    scene->GetNodesByClass("vtkMRMLIsodoseNode", isodoseNodes);
+    for (vtkMRMLNode* node : isodoseNodes)
+    {
+      vtkMRMLIsodoseNode* parameterNode = vtkMRMLIsodoseNode::SafeDownCast(node);
+      if (parameterNode && parameterNode->GetOnDemandSliceIsodoseLines() && parameterNode->GetShowIsodoseLines())
+      {
+        this->UpdateSliceIsodoseLines(parameterNode, sliceNode);
+      }
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 vtkMRMLColorTableNode* vtkSlicerIsodoseModuleLogic::GetDefaultIsodoseColorTable(vtkMRMLScene* scene)
 {
@@ -697,28 +921,21 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
     this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
   }
 
-  // reference value for relative representation
-  double referenceValue = parameterNode->GetReferenceDoseValue();
+  // Get isodose level values (converted to absolute values for relative representation)
+  std::vector<double> isoLevels;
+  this->GetIsodoseLevelValues(parameterNode, isoLevels);
 
   // Create isodose surfaces
   vtkNew<vtkAppendPolyData> append;
   vtkNew<vtkFloatArray> colors;
   colors->SetNumberOfComponents(1);
-  colors->SetName("isolevels");
+  colors->SetName(ISOLEVELS_ARRAY_NAME);
+  // Non-empty surfaces of the individual levels, kept for creating the level of detail surfaces
+  std::vector<vtkSmartPointer<vtkPolyData> > levelSurfaces;
+  std::vector<double> levelSurfaceIsoLevels;
 
-  for (int i = 0; i < colorTableNode->GetNumberOfColors(); i++)
+  for (double isoLevel : isoLevels)
   {
-    const char* strIsoLevel = colorTableNode->GetColorName(i);
-    double isoLevel = vtkVariant(strIsoLevel).ToDouble();
-    // change isoLevel value for relative representation
-    if (relativeFlag)
-    {
-      if (doseUnits != vtkMRMLIsodoseNode::Relative)
-      {
-        isoLevel = isoLevel * referenceValue / 100.;
-      }
-    }
-
     vtkNew<vtkImageMarchingCubes> marchingCubes;
     marchingCubes->SetInputData(reslicedDoseVolumeImage);
     marchingCubes->SetNumberOfContours(1);
@@ -765,6 +982,8 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
       }
 
       append->AddInputData(isoSurface);
+      levelSurfaces.push_back(isoSurface);
+      levelSurfaceIsoLevels.push_back(isoLevel);
     }
 
     // Report progress
@@ -806,9 +1025,10 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
 
       vtkMRMLModelDisplayNode* displayNode = isodoseModelNode->GetModelDisplayNode();
       displayNode->SetBackfaceCulling(0); // Disable backface culling to make the back side of the model visible as well
-      displayNode->Visibility2DOn();
+      // Slice views show the on-demand isodose lines instead of the surface intersections if enabled
+      displayNode->SetVisibility2D(!parameterNode->GetOnDemandSliceIsodoseLines());
       displayNode->VisibilityOn();
-      displayNode->SetActiveScalarName("isolevels");
+      displayNode->SetActiveScalarName(ISOLEVELS_ARRAY_NAME);
       displayNode->SetAutoScalarRange(true);
       displayNode->SetAndObserveColorNodeID(colorTableNode->GetID());
       displayNode->SetScalarVisibility(true);
@@ -820,6 +1040,16 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
     isoSurfaces->GetPointData()->SetScalars(colors);
     isodoseModelNode->SetAndObservePolyData(isoSurfaces);
 
+    // Create decimated isosurfaces to render while the 3D view is being interacted with
+    if (parameterNode->GetLevelOfDetailTriangleBudget() > 0)
+    {
+      this->UpdateIsosurfacesLevelOfDetail(parameterNode, levelSurfaces, levelSurfaceIsoLevels);
+    }
+    else
+    {
+      this->RemoveIsosurfacesLevelOfDetail(parameterNode);
+    }
+
     // Update dose color table based on isodose
     if (!parameterNode->GetRealTime())
     {
@@ -833,6 +1063,11 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
       vtkNew<vtkPolyData> emptyPolyData;
       isodoseModelNode->SetAndObservePolyData(emptyPolyData);
     }
+    if (parameterNode->GetIsosurfacesLevelOfDetailModelNode())
+    {
+      vtkNew<vtkPolyData> emptyPolyData;
+      parameterNode->GetIsosurfacesLevelOfDetailModelNode()->SetAndObservePolyData(emptyPolyData);
+    }
     if (!parameterNode->GetRealTime())
     {
       vtkErrorMacro("CreateIsodoseSurfaces: Failed to create isosurfaces for dose volume " << doseVolumeNode->GetName());
@@ -843,6 +1078,447 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
   return true;
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::UpdateIsosurfacesLevelOfDetail(vtkMRMLIsodoseNode* parameterNode,
+  const std::vector<vtkSmartPointer<vtkPolyData> >& levelSurfaces, const std::vector<double>& isoLevels)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene || !parameterNode)
+  {
+    vtkErrorMacro("UpdateIsosurfacesLevelOfDetail: Invalid scene or parameter set node");
+    return;
+  }
+  if (levelSurfaces.size() != isoLevels.size())
+  {
+    vtkErrorMacro("UpdateIsosurfacesLevelOfDetail: Number of surfaces and isodose levels differ");
+    return;
+  }
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  vtkMRMLColorTableNode* colorTableNode = parameterNode->GetColorTableNode();
+  vtkMRMLModelNode* isodoseModelNode = parameterNode->GetIsosurfacesModelNode();
+  if (!doseVolumeNode || !colorTableNode || !isodoseModelNode)
+  {
+    vtkErrorMacro("UpdateIsosurfacesLevelOfDetail: Invalid dose volume, color table or isosurfaces model");
+    return;
+  }
+
+  // Decimate levels in parallel
+  std::vector<vtkSmartPointer<vtkPolyData> > decimatedLevelSurfaces(levelSurfaces.size());
+  IsosurfaceDecimationFunctor decimationFunctor(levelSurfaces, decimatedLevelSurfaces, parameterNode->GetLevelOfDetailTriangleBudget());
+  vtkSMPTools::For(0, static_cast<vtkIdType>(levelSurfaces.size()), decimationFunctor);
+
+  vtkNew<vtkAppendPolyData> append;
+  vtkNew<vtkFloatArray> colors;
+  colors->SetNumberOfComponents(1);
+  colors->SetName(ISOLEVELS_ARRAY_NAME);
+  for (size_t level = 0; level < decimatedLevelSurfaces.size(); ++level)
+  {
+    vtkPolyData* decimatedSurface = decimatedLevelSurfaces[level];
+    for (vtkIdType i = 0; i < decimatedSurface->GetNumberOfPoints(); ++i)
+    {
+      colors->InsertNextTuple1(static_cast<float>(isoLevels[level]));
+    }
+    append->AddInputData(decimatedSurface);
+  }
+  vtkNew<vtkPolyData> levelOfDetailSurfaces;
+  if (!decimatedLevelSurfaces.empty())
+  {
+    append->Update();
+    levelOfDetailSurfaces->ShallowCopy(append->GetOutput());
+    levelOfDetailSurfaces->GetPointData()->SetScalars(colors);
+  }
+
+  vtkMRMLModelNode* levelOfDetailModelNode = parameterNode->GetIsosurfacesLevelOfDetailModelNode();
+  if (!levelOfDetailModelNode)
+  {
+    // Create level of detail model node. It is an internal rendering helper of the isosurfaces model, so it is hidden
+    std::string baseName = std::string(isodoseModelNode->GetName()) + "_LevelOfDetail";
+    std::string uniqueName = scene->GenerateUniqueName(baseName.c_str());
+    levelOfDetailModelNode = vtkMRMLModelNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLModelNode", uniqueName));
+    levelOfDetailModelNode->SetAttribute(vtkSlicerRtCommon::DICOMRTIMPORT_ISODOSE_MODEL_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1");
+    levelOfDetailModelNode->HideFromEditorsOn();
+    levelOfDetailModelNode->CreateDefaultDisplayNodes();
+
+    vtkMRMLModelDisplayNode* displayNode = levelOfDetailModelNode->GetModelDisplayNode();
+    displayNode->SetBackfaceCulling(0);
+    displayNode->SetVisibility2D(false);
+    displayNode->SetVisibility(false); // Only shown during interaction
+    displayNode->SetActiveScalarName(ISOLEVELS_ARRAY_NAME);
+    displayNode->SetScalarVisibility(true);
+
+    parameterNode->SetAndObserveIsosurfacesLevelOfDetailModelNode(levelOfDetailModelNode);
+  }
+
+  // Use the same scalar range as the full resolution surfaces, so that the colors match
+  vtkMRMLModelDisplayNode* displayNode = levelOfDetailModelNode->GetModelDisplayNode();
+  if (displayNode)
+  {
+    displayNode->SetAndObserveColorNodeID(colorTableNode->GetID());
+    if (!isoLevels.empty())
+    {
+      displayNode->SetScalarRangeFlag(vtkMRMLDisplayNode::UseManualScalarRange);
+      displayNode->SetScalarRange(*std::min_element(isoLevels.begin(), isoLevels.end()),
+        *std::max_element(isoLevels.begin(), isoLevels.end()));
+    }
+  }
+
+  levelOfDetailModelNode->SetAndObservePolyData(levelOfDetailSurfaces);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::SetIsosurfacesLevelOfDetailRendering(vtkMRMLIsodoseNode* parameterNode, bool lowDetail)
+{
+  if (!parameterNode)
+  {
+    vtkErrorMacro("SetIsosurfacesLevelOfDetailRendering: Invalid parameter set node");
+    return;
+  }
+
+  vtkMRMLModelNode* isodoseModelNode = parameterNode->GetIsosurfacesModelNode();
+  vtkMRMLModelNode* levelOfDetailModelNode = parameterNode->GetIsosurfacesLevelOfDetailModelNode();
+  if (!isodoseModelNode || !isodoseModelNode->GetDisplayNode()
+    || !levelOfDetailModelNode || !levelOfDetailModelNode->GetDisplayNode()
+    || parameterNode->GetLevelOfDetailTriangleBudget() <= 0)
+  {
+    // No level of detail isosurfaces
+    return;
+  }
+
+  // Only the 3D views are switched, slice views keep showing the full resolution intersections
+  bool showIsosurfaces = parameterNode->GetShowIsodoseSurfaces();
+  isodoseModelNode->GetDisplayNode()->SetVisibility3D(!lowDetail);
+  levelOfDetailModelNode->GetDisplayNode()->SetVisibility(showIsosurfaces && lowDetail);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::RemoveIsosurfacesLevelOfDetail(vtkMRMLIsodoseNode* parameterNode)
+{
+  if (!parameterNode)
+  {
+    vtkErrorMacro("RemoveIsosurfacesLevelOfDetail: Invalid parameter set node");
+    return;
+  }
+
+  // Make sure the full resolution isosurfaces are not left hidden by an interrupted interaction
+  vtkMRMLModelNode* isodoseModelNode = parameterNode->GetIsosurfacesModelNode();
+  if (isodoseModelNode && isodoseModelNode->GetDisplayNode())
+  {
+    isodoseModelNode->GetDisplayNode()->SetVisibility3D(true);
+  }
+
+  vtkMRMLModelNode* levelOfDetailModelNode = parameterNode->GetIsosurfacesLevelOfDetailModelNode();
+  if (!levelOfDetailModelNode)
+  {
+    return;
+  }
+  parameterNode->SetAndObserveIsosurfacesLevelOfDetailModelNode(nullptr);
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (scene && scene->IsNodePresent(levelOfDetailModelNode))
+  {
+    scene->RemoveNode(levelOfDetailModelNode);
+  }
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerIsodoseModuleLogic::GetIsodoseLevelValues(vtkMRMLIsodoseNode* parameterNode, std::vector<double>& isoLevels)
+{
+  isoLevels.clear();
+  if (!parameterNode)
+  {
+    vtkErrorMacro("GetIsodoseLevelValues: Invalid parameter set node");
+    return false;
+  }
+  vtkMRMLColorTableNode* colorTableNode = parameterNode->GetColorTableNode();
+  if (!colorTableNode)
+  {
+    vtkErrorMacro("GetIsodoseLevelValues: Failed to get isodose color table node");
+    return false;
+  }
+
+  // Relative isolevels are given in percent of the reference dose value for absolute (Gy) and unknown dose units
+  vtkMRMLIsodoseNode::DoseUnitsType doseUnits = parameterNode->GetDoseUnits();
+  bool convertRelativeIsoLevels = parameterNode->GetRelativeRepresentationFlag()
+    && (doseUnits == vtkMRMLIsodoseNode::Gy || doseUnits == vtkMRMLIsodoseNode::Unknown);
+  double referenceValue = parameterNode->GetReferenceDoseValue();
+
+  for (int i = 0; i < colorTableNode->GetNumberOfColors(); i++)
+  {
+    double isoLevel = vtkVariant(colorTableNode->GetColorName(i)).ToDouble();
+    if (convertRelativeIsoLevels)
+    {
+      isoLevel = isoLevel * referenceValue / 100.;
+    }
+    isoLevels.push_back(isoLevel);
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerIsodoseModuleLogic::ComputeIsodoseLinesOnSlicePlane(vtkMRMLIsodoseNode* parameterNode, vtkMatrix4x4* sliceToRAS, vtkPolyData* outputLines)
+{
+  if (!parameterNode || !sliceToRAS || !outputLines)
+  {
+    vtkErrorMacro("ComputeIsodoseLinesOnSlicePlane: Invalid input arguments");
+    return false;
+  }
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  if (!doseVolumeNode || !doseVolumeNode->GetImageData())
+  {
+    vtkErrorMacro("ComputeIsodoseLinesOnSlicePlane: Invalid dose volume");
+    return false;
+  }
+  vtkImageData* doseImageData = doseVolumeNode->GetImageData();
+
+  // Use cached isodose lines if the plane has already been contoured with the current dose and levels
+  vtkInternal::SliceIsodoseLinesCache& cache = this->Internal->SliceIsodoseLinesCaches[parameterNode->GetID() ? parameterNode->GetID() : ""];
+  std::string signature = vtkInternal::GetSliceIsodoseLinesSignature(parameterNode);
+  if (cache.Signature != signature)
+  {
+    cache.LinesForPlane.clear();
+    cache.PlaneKeys.clear();
+    cache.Signature = signature;
+  }
+  std::string planeKey = vtkInternal::GetSlicePlaneKey(sliceToRAS);
+  auto cachedLinesIt = cache.LinesForPlane.find(planeKey);
+  if (cachedLinesIt != cache.LinesForPlane.end())
+  {
+    outputLines->ShallowCopy(cachedLinesIt->second);
+    return true;
+  }
+
+  std::vector<double> isoLevels;
+  if (!this->GetIsodoseLevelValues(parameterNode, isoLevels))
+  {
+    vtkErrorMacro("ComputeIsodoseLinesOnSlicePlane: Failed to get isodose levels for dose volume " << doseVolumeNode->GetName());
+    return false;
+  }
+
+  // Assemble slice to dose IJK transform (dose image data is stored in IJK coordinates)
+  vtkNew<vtkMatrix4x4> doseIJKToWorldMatrix;
+  doseVolumeNode->GetIJKToRASMatrix(doseIJKToWorldMatrix);
+  vtkMRMLTransformNode* doseVolumeTransformNode = doseVolumeNode->GetParentTransformNode();
+  if (doseVolumeTransformNode)
+  {
+    vtkNew<vtkMatrix4x4> doseRASToWorldMatrix;
+    doseVolumeTransformNode->GetMatrixTransformToWorld(doseRASToWorldMatrix);
+    vtkMatrix4x4::Multiply4x4(doseRASToWorldMatrix, doseIJKToWorldMatrix, doseIJKToWorldMatrix);
+  }
+  vtkNew<vtkMatrix4x4> worldToDoseIJKMatrix;
+  vtkMatrix4x4::Invert(doseIJKToWorldMatrix, worldToDoseIJKMatrix);
+  vtkNew<vtkMatrix4x4> sliceToDoseIJKMatrix;
+  vtkMatrix4x4::Multiply4x4(worldToDoseIJKMatrix, sliceToRAS, sliceToDoseIJKMatrix);
+  vtkNew<vtkMatrix4x4> doseIJKToSliceMatrix;
+  vtkMatrix4x4::Invert(sliceToDoseIJKMatrix, doseIJKToSliceMatrix);
+
+  // Determine bounding box of the dose volume in slice coordinates, so that only the part of the plane covered by dose is resampled
+  int doseExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  doseImageData->GetExtent(doseExtent);
+  double sliceBounds[6] = { VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    double cornerIJK[4] = {
+      static_cast<double>(doseExtent[(corner & 1) ? 1 : 0]),
+      static_cast<double>(doseExtent[(corner & 2) ? 3 : 2]),
+      static_cast<double>(doseExtent[(corner & 4) ? 5 : 4]),
+      1.0 };
+    double cornerSlice[4] = { 0.0, 0.0, 0.0, 1.0 };
+    doseIJKToSliceMatrix->MultiplyPoint(cornerIJK, cornerSlice);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      sliceBounds[2*axis] = std::min(sliceBounds[2*axis], cornerSlice[axis]);
+      sliceBounds[2*axis+1] = std::max(sliceBounds[2*axis+1], cornerSlice[axis]);
+    }
+  }
+  if (isoLevels.empty() || sliceBounds[4] > 0.0 || sliceBounds[5] < 0.0)
+  {
+    // No levels or the slice plane does not intersect the dose volume
+    vtkNew<vtkPolyData> emptyLines;
+    vtkInternal::AddSliceIsodoseLinesToCache(cache, planeKey, emptyLines);
+    outputLines->ShallowCopy(emptyLines);
+    return true;
+  }
+
+  // Resample dose on the slice plane with the finest dose voxel spacing
+  double doseSpacing[3] = { 1.0, 1.0, 1.0 };
+  doseVolumeNode->GetSpacing(doseSpacing);
+  double sampleSpacing = std::min(doseSpacing[0], std::min(doseSpacing[1], doseSpacing[2]));
+  int outputExtent[6] = { 0, static_cast<int>(std::ceil((sliceBounds[1] - sliceBounds[0]) / sampleSpacing)),
+    0, static_cast<int>(std::ceil((sliceBounds[3] - sliceBounds[2]) / sampleSpacing)), 0, 0 };
+
+  vtkNew<vtkImageReslice> reslice;
+  reslice->SetInputData(doseImageData);
+  reslice->SetResliceAxes(sliceToDoseIJKMatrix);
+  reslice->SetOutputOrigin(sliceBounds[0], sliceBounds[2], 0.0);
+  reslice->SetOutputSpacing(sampleSpacing, sampleSpacing, 1.0);
+  reslice->SetOutputExtent(outputExtent);
+  reslice->SetInterpolationModeToLinear();
+
+  // Contour all isodose levels at once with marching squares
+  vtkNew<vtkFlyingEdges2D> marchingSquares;
+  marchingSquares->SetInputConnection(reslice->GetOutputPort());
+  marchingSquares->SetNumberOfContours(static_cast<int>(isoLevels.size()));
+  for (int i = 0; i < static_cast<int>(isoLevels.size()); ++i)
+  {
+    marchingSquares->SetValue(i, isoLevels[i]);
+  }
+  marchingSquares->ComputeScalarsOn();
+
+  // Transform lines from slice to RAS coordinates
+  vtkNew<vtkTransform> sliceToRASTransform;
+  sliceToRASTransform->SetMatrix(sliceToRAS);
+  vtkNew<vtkTransformPolyDataFilter> transformPolyData;
+  transformPolyData->SetInputConnection(marchingSquares->GetOutputPort());
+  transformPolyData->SetTransform(sliceToRASTransform);
+  transformPolyData->Update();
+
+  vtkSmartPointer<vtkPolyData> isodoseLines = vtkSmartPointer<vtkPolyData>::New();
+  isodoseLines->ShallowCopy(transformPolyData->GetOutput());
+  vtkDataArray* isoLevelScalars = isodoseLines->GetPointData()->GetScalars();
+  if (isoLevelScalars)
+  {
+    isoLevelScalars->SetName(ISOLEVELS_ARRAY_NAME);
+  }
+
+  vtkInternal::AddSliceIsodoseLinesToCache(cache, planeKey, isodoseLines);
+  outputLines->ShallowCopy(isodoseLines);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerIsodoseModuleLogic::UpdateSliceIsodoseLines(vtkMRMLIsodoseNode* parameterNode, vtkMRMLSliceNode* sliceNode)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene || !parameterNode || !sliceNode || !sliceNode->GetID())
+  {
+    vtkErrorMacro("UpdateSliceIsodoseLines: Invalid scene, parameter set node or slice node");
+    return false;
+  }
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  vtkMRMLColorTableNode* colorTableNode = parameterNode->GetColorTableNode();
+  if (!doseVolumeNode || !colorTableNode)
+  {
+    vtkErrorMacro("UpdateSliceIsodoseLines: Invalid dose volume or isodose color table");
+    return false;
+  }
+
+  vtkMRMLModelNode* linesModelNode = parameterNode->GetSliceIsodoseLinesModelNode(sliceNode->GetID());
+  if (!linesModelNode)
+  {
+    // Create isodose lines model displayed only in the given slice view
+    std::string baseName = std::string(doseVolumeNode->GetName()) + SLICE_ISODOSE_LINES_MODEL_NODE_NAME_INFIX
+      + std::string(sliceNode->GetName() ? sliceNode->GetName() : "");
+    std::string uniqueName = scene->GenerateUniqueName(baseName.c_str());
+    linesModelNode = vtkMRMLModelNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLModelNode", uniqueName));
+    linesModelNode->SetAttribute(vtkSlicerRtCommon::DICOMRTIMPORT_ISODOSE_MODEL_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1");
+    linesModelNode->HideFromEditorsOn();
+    // Lines are computed from the dose when the slice changes, so they are not saved
+    linesModelNode->SaveWithSceneOff();
+    linesModelNode->CreateDefaultDisplayNodes();
+
+    vtkMRMLModelDisplayNode* displayNode = linesModelNode->GetModelDisplayNode();
+    displayNode->AddViewNodeID(sliceNode->GetID());
+    displayNode->SetVisibility3D(false);
+    displayNode->SetVisibility2D(true);
+    // Lines lie in the slice plane, so they are projected instead of intersected
+    displayNode->SetSliceDisplayModeToProjection();
+    displayNode->SetActiveScalarName(ISOLEVELS_ARRAY_NAME);
+    displayNode->SetScalarVisibility(true);
+
+    vtkNew<vtkPolyData> linesPolyData;
+    linesModelNode->SetAndObservePolyData(linesPolyData);
+
+    parameterNode->SetAndObserveSliceIsodoseLinesModelNode(sliceNode->GetID(), linesModelNode);
+  }
+
+  // Use the range of all levels, so that colors do not depend on which levels are present in the slice
+  std::vector<double> isoLevels;
+  this->GetIsodoseLevelValues(parameterNode, isoLevels);
+  vtkMRMLModelDisplayNode* displayNode = linesModelNode->GetModelDisplayNode();
+  if (displayNode)
+  {
+    displayNode->SetAndObserveColorNodeID(colorTableNode->GetID());
+    if (!isoLevels.empty())
+    {
+      displayNode->SetScalarRangeFlag(vtkMRMLDisplayNode::UseManualScalarRange);
+      displayNode->SetScalarRange(*std::min_element(isoLevels.begin(), isoLevels.end()),
+        *std::max_element(isoLevels.begin(), isoLevels.end()));
+    }
+    displayNode->SetVisibility(parameterNode->GetShowIsodoseLines());
+  }
+
+  vtkPolyData* linesPolyData = linesModelNode->GetPolyData();
+  if (!this->ComputeIsodoseLinesOnSlicePlane(parameterNode, sliceNode->GetSliceToRAS(), linesPolyData))
+  {
+    vtkErrorMacro("UpdateSliceIsodoseLines: Failed to compute isodose lines in slice " << sliceNode->GetName());
+    return false;
+  }
+  linesPolyData->Modified();
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::UpdateSliceIsodoseLinesInAllViews(vtkMRMLIsodoseNode* parameterNode)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene || !parameterNode)
+  {
+    vtkErrorMacro("UpdateSliceIsodoseLinesInAllViews: Invalid scene or parameter set node");
+    return;
+  }
+
+  // Isodose surface intersections are hidden in slice views while on-demand isodose lines are shown
+  vtkMRMLModelNode* isodoseModelNode = parameterNode->GetIsosurfacesModelNode();
+  if (isodoseModelNode && isodoseModelNode->GetDisplayNode())
+  {
+    isodoseModelNode->GetDisplayNode()->SetVisibility2D(!parameterNode->GetOnDemandSliceIsodoseLines());
+  }
+
+  std::vector<vtkMRMLNode*> sliceNodes;
+  scene->GetNodesByClass("vtkMRMLSliceNode", sliceNodes);
+  for (vtkMRMLNode* node : sliceNodes)
+  {
+    vtkMRMLSliceNode* sliceNode = vtkMRMLSliceNode::SafeDownCast(node);
+    if (!sliceNode || !sliceNode->GetID())
+    {
+      continue;
+    }
+    if (parameterNode->GetOnDemandSliceIsodoseLines())
+    {
+      this->UpdateSliceIsodoseLines(parameterNode, sliceNode);
+    }
+    else
+    {
+      // Remove on-demand isodose lines if the mode has been turned off
+      this->RemoveSliceIsodoseLines(parameterNode, sliceNode->GetID());
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::RemoveSliceIsodoseLines(vtkMRMLIsodoseNode* parameterNode, const char* sliceNodeID)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene || !parameterNode || !sliceNodeID)
+  {
+    return;
+  }
+  vtkMRMLModelNode* linesModelNode = parameterNode->GetSliceIsodoseLinesModelNode(sliceNodeID);
+  if (!linesModelNode)
+  {
+    return;
+  }
+  parameterNode->SetAndObserveSliceIsodoseLinesModelNode(sliceNodeID, nullptr);
+  scene->RemoveNode(linesModelNode);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::ClearSliceIsodoseLinesCache()
+{
+  this->Internal->SliceIsodoseLinesCaches.clear();
+}
+
 //---------------------------------------------------------------------------
 void vtkSlicerIsodoseModuleLogic::UpdateDoseColorTableFromIsodose(vtkMRMLIsodoseNode* parameterNode)
 {
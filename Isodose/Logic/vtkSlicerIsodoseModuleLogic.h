@@ -33,11 +33,20 @@
 
 #include "vtkSlicerIsodoseModuleLogicExport.h"
 
+// VTK includes
+#include <vtkSmartPointer.h>
+class vtkMatrix4x4;
+class vtkPolyData;
+
+// STD includes
+#include <vector>
+
 // MRML includes
 class vtkMRMLColorTableNode;
 class vtkMRMLIsodoseNode;
 class vtkMRMLModelHierarchyNode;
 class vtkMRMLScalarVolumeNode;
+class vtkMRMLSliceNode;
 
 class vtkSlicerColorLogic;
 
@@ -71,6 +80,36 @@ public:
   /// Set default color legend parameters from isodose parameter set
   void SetColorLegendDefaults(vtkMRMLIsodoseNode* parameterNode);
 
+  /// Switch between full resolution and decimated (level of detail) isosurfaces in the 3D views.
+  /// Has no effect if level of detail isosurfaces have not been created (see triangle budget in parameter node).
+  /// \param lowDetail Show decimated isosurfaces (typically while the 3D view is being interacted with) if true,
+  ///   full resolution isosurfaces otherwise
+  void SetIsosurfacesLevelOfDetailRendering(vtkMRMLIsodoseNode* parameterNode, bool lowDetail);
+
+  /// Remove the decimated (level of detail) isosurfaces model from the scene and show the full resolution
+  /// isosurfaces in the 3D views again. Called when level of detail generation is disabled (zero triangle budget).
+  void RemoveIsosurfacesLevelOfDetail(vtkMRMLIsodoseNode* parameterNode);
+
+  /// Compute isodose lines of all isodose levels on a slice plane.
+  /// The dose volume is resampled on the plane (only within the dose extent) and contoured with marching squares.
+  /// Results are cached per plane position, and the cache is invalidated when the dose, the isodose levels or
+  /// the parameters change.
+  /// \param parameterNode isodose node parameters
+  /// \param sliceToRAS Slice to RAS matrix. The XY plane of the slice coordinate system is contoured
+  /// \param outputLines Output polydata containing the isodose lines in RAS with isolevel point scalars
+  /// \return true if success, false otherwise
+  bool ComputeIsodoseLinesOnSlicePlane(vtkMRMLIsodoseNode* parameterNode, vtkMatrix4x4* sliceToRAS, vtkPolyData* outputLines);
+
+  /// Create or update the isodose lines model of a slice view with the isodose lines on the displayed slice
+  /// \return true if success, false otherwise
+  bool UpdateSliceIsodoseLines(vtkMRMLIsodoseNode* parameterNode, vtkMRMLSliceNode* sliceNode);
+
+  /// Update the isodose lines models of all slice views in the scene
+  void UpdateSliceIsodoseLinesInAllViews(vtkMRMLIsodoseNode* parameterNode);
+
+  /// Remove all cached slice isodose lines
+  void ClearSliceIsodoseLinesCache();
+
 public:
   /// Creates default isodose color table. Gets and returns if already exists
   static vtkMRMLColorTableNode* GetDefaultIsodoseColorTable(vtkMRMLScene* scene);
@@ -90,6 +129,21 @@ protected:
   /// \return The loaded color table node if loading succeeded, nullptr otherwise
   vtkMRMLColorTableNode* LoadDefaultIsodoseColorTable();
 
+  /// Get isodose level values from the color table of the parameter node.
+  /// Relative isolevels are converted to absolute dose values using the reference dose value if needed.
+  /// \return true if success, false otherwise
+  bool GetIsodoseLevelValues(vtkMRMLIsodoseNode* parameterNode, std::vector<double>& isoLevels);
+
+  /// Create or update the decimated (level of detail) isosurfaces model from the full resolution surfaces.
+  /// Each level is decimated to the triangle budget of the parameter node, the levels are processed in parallel.
+  /// \param levelSurfaces Full resolution isosurface of each level in RAS
+  /// \param isoLevels Isodose level value of each surface
+  void UpdateIsosurfacesLevelOfDetail(vtkMRMLIsodoseNode* parameterNode,
+    const std::vector<vtkSmartPointer<vtkPolyData> >& levelSurfaces, const std::vector<double>& isoLevels);
+
+  /// Remove the on-demand isodose lines model of a slice view from the scene if it exists
+  void RemoveSliceIsodoseLines(vtkMRMLIsodoseNode* parameterNode, const char* sliceNodeID);
+
 protected:
   void SetMRMLSceneInternal(vtkMRMLScene* newScene) override;
 
@@ -100,6 +154,9 @@ protected:
   void OnMRMLSceneNodeRemoved(vtkMRMLNode* node) override;
   void OnMRMLSceneEndClose() override;
 
+  /// Handles slice node changes to update on-demand slice isodose lines
+  void ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData) override;
+
 protected:
   vtkSlicerIsodoseModuleLogic();
   ~vtkSlicerIsodoseModuleLogic() override;
@@ -109,6 +166,9 @@ private:
   void operator=(const vtkSlicerIsodoseModuleLogic&) = delete;
   /// Unique name of the copy of default isodose color table node
   static std::string IsodoseColorNodeCopyUniqueName;
+
+  class vtkInternal;
+  vtkInternal* Internal;
 };
 
 #endif
@@ -41,6 +41,8 @@
 //------------------------------------------------------------------------------
 static const char* DOSE_VOLUME_REFERENCE_ROLE = "doseVolumeRef";
 static const char* ISOSURFACES_MODEL_REFERENCE_ROLE = "isosurfacesModelRef";
+static const char* ISOSURFACES_LOD_MODEL_REFERENCE_ROLE = "isosurfacesLevelOfDetailModelRef";
+static const char* SLICE_ISODOSE_LINES_MODEL_REFERENCE_ROLE_PREFIX = "sliceIsodoseLinesModelRef_";
 const char* vtkMRMLIsodoseNode::COLOR_TABLE_REFERENCE_ROLE = "colorTableRef";
 
 //------------------------------------------------------------------------------
@@ -68,6 +70,8 @@ void vtkMRMLIsodoseNode::WriteXML(ostream& of, int nIndent)
   vtkMRMLWriteXMLEnumMacro(DoseUnits, DoseUnits);
   vtkMRMLWriteXMLFloatMacro(ReferenceDoseValue, ReferenceDoseValue);
   vtkMRMLWriteXMLBooleanMacro(RelativeRepresentationFlag, RelativeRepresentationFlag);
+  vtkMRMLWriteXMLBooleanMacro(OnDemandSliceIsodoseLines, OnDemandSliceIsodoseLines);
+  vtkMRMLWriteXMLIntMacro(LevelOfDetailTriangleBudget, LevelOfDetailTriangleBudget);
   vtkMRMLWriteXMLBooleanMacro(RealTime, RealTime);
 
   vtkMRMLWriteXMLEndMacro();
@@ -86,6 +90,8 @@ void vtkMRMLIsodoseNode::ReadXMLAttributes(const char** atts)
   vtkMRMLReadXMLEnumMacro(DoseUnits, DoseUnits);
   vtkMRMLReadXMLFloatMacro(ReferenceDoseValue, ReferenceDoseValue);
   vtkMRMLReadXMLBooleanMacro(RelativeRepresentationFlag, RelativeRepresentationFlag);
+  vtkMRMLReadXMLBooleanMacro(OnDemandSliceIsodoseLines, OnDemandSliceIsodoseLines);
+  vtkMRMLReadXMLIntMacro(LevelOfDetailTriangleBudget, LevelOfDetailTriangleBudget);
   vtkMRMLReadXMLBooleanMacro(RealTime, RealTime);
   vtkMRMLReadXMLEndMacro();
 
@@ -108,6 +114,8 @@ void vtkMRMLIsodoseNode::Copy(vtkMRMLNode *anode)
   vtkMRMLCopyEnumMacro(DoseUnits);
   vtkMRMLCopyFloatMacro(ReferenceDoseValue);
   vtkMRMLCopyBooleanMacro(RelativeRepresentationFlag);
+  vtkMRMLCopyBooleanMacro(OnDemandSliceIsodoseLines);
+  vtkMRMLCopyIntMacro(LevelOfDetailTriangleBudget);
   vtkMRMLCopyBooleanMacro(RealTime);
   vtkMRMLCopyEndMacro();
 
@@ -126,6 +134,8 @@ void vtkMRMLIsodoseNode::PrintSelf(ostream& os, vtkIndent indent)
   vtkMRMLPrintEnumMacro(DoseUnits);
   vtkMRMLPrintFloatMacro(ReferenceDoseValue);
   vtkMRMLPrintBooleanMacro(RelativeRepresentationFlag);
+  vtkMRMLPrintBooleanMacro(OnDemandSliceIsodoseLines);
+  vtkMRMLPrintIntMacro(LevelOfDetailTriangleBudget);
   vtkMRMLPrintBooleanMacro(RealTime);
   vtkMRMLPrintEndMacro();
 }
@@ -198,6 +208,54 @@ void vtkMRMLIsodoseNode::SetAndObserveIsosurfacesModelNode(vtkMRMLModelNode* nod
   this->SetNodeReferenceID(ISOSURFACES_MODEL_REFERENCE_ROLE, (node ? node->GetID() : nullptr));
 }
 
+//----------------------------------------------------------------------------
+vtkMRMLModelNode* vtkMRMLIsodoseNode::GetIsosurfacesLevelOfDetailModelNode()
+{
+  return vtkMRMLModelNode::SafeDownCast( this->GetNodeReference(ISOSURFACES_LOD_MODEL_REFERENCE_ROLE) );
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIsodoseNode::SetAndObserveIsosurfacesLevelOfDetailModelNode(vtkMRMLModelNode* node)
+{
+  if (node && this->Scene != node->GetScene())
+  {
+    vtkErrorMacro("Cannot set reference: the referenced and referencing node are not in the same scene");
+    return;
+  }
+
+  this->SetNodeReferenceID(ISOSURFACES_LOD_MODEL_REFERENCE_ROLE, (node ? node->GetID() : nullptr));
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLModelNode* vtkMRMLIsodoseNode::GetSliceIsodoseLinesModelNode(const char* sliceNodeID)
+{
+  if (!sliceNodeID)
+  {
+    return nullptr;
+  }
+
+  std::string referenceRole = std::string(SLICE_ISODOSE_LINES_MODEL_REFERENCE_ROLE_PREFIX) + sliceNodeID;
+  return vtkMRMLModelNode::SafeDownCast( this->GetNodeReference(referenceRole.c_str()) );
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIsodoseNode::SetAndObserveSliceIsodoseLinesModelNode(const char* sliceNodeID, vtkMRMLModelNode* node)
+{
+  if (!sliceNodeID)
+  {
+    vtkErrorMacro("SetAndObserveSliceIsodoseLinesModelNode: Invalid slice node ID");
+    return;
+  }
+  if (node && this->Scene != node->GetScene())
+  {
+    vtkErrorMacro("Cannot set reference: the referenced and referencing node are not in the same scene");
+    return;
+  }
+
+  std::string referenceRole = std::string(SLICE_ISODOSE_LINES_MODEL_REFERENCE_ROLE_PREFIX) + sliceNodeID;
+  this->SetNodeReferenceID(referenceRole.c_str(), (node ? node->GetID() : nullptr));
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLIsodoseNode::SetDoseUnits(int id)
 {
@@ -75,6 +75,17 @@ public:
   /// Set and observe isosurfaces model node
   void SetAndObserveIsosurfacesModelNode(vtkMRMLModelNode* node);
 
+  /// Get decimated (level of detail) isosurfaces model node, shown instead of the full resolution one during interaction
+  vtkMRMLModelNode* GetIsosurfacesLevelOfDetailModelNode();
+  /// Set and observe decimated (level of detail) isosurfaces model node
+  void SetAndObserveIsosurfacesLevelOfDetailModelNode(vtkMRMLModelNode* node);
+
+  /// Get isodose lines model node computed on demand for a slice view
+  /// \param sliceNodeID ID of the slice node the isodose lines are displayed in
+  vtkMRMLModelNode* GetSliceIsodoseLinesModelNode(const char* sliceNodeID);
+  /// Set and observe isodose lines model node computed on demand for a slice view
+  void SetAndObserveSliceIsodoseLinesModelNode(const char* sliceNodeID, vtkMRMLModelNode* node);
+
   /// Get/Set show isodose lines checkbox state
   vtkGetMacro(ShowIsodoseLines, bool);
   vtkSetMacro(ShowIsodoseLines, bool);
@@ -114,6 +125,19 @@ public:
   vtkBooleanMacro(RelativeRepresentationFlag, bool);
   //@}
 
+  //@{
+  /// Get/Set on-demand slice isodose lines flag
+  vtkGetMacro(OnDemandSliceIsodoseLines, bool);
+  vtkSetMacro(OnDemandSliceIsodoseLines, bool);
+  vtkBooleanMacro(OnDemandSliceIsodoseLines, bool);
+  //@}
+
+  //@{
+  /// Get/Set target number of triangles per isodose level in the level of detail isosurfaces
+  vtkGetMacro(LevelOfDetailTriangleBudget, int);
+  vtkSetMacro(LevelOfDetailTriangleBudget, int);
+  //@}
+
   //@{
   /// Get/Set real time flag
   vtkGetMacro(RealTime, bool);
@@ -150,6 +174,14 @@ protected:
   /// for absolute dose (Gy) and unknown units or not
   bool RelativeRepresentationFlag{false};
 
+  /// Flag indicating that isodose lines in the slice views are computed on demand for the displayed
+  /// slice only (marching squares on the resliced dose), instead of intersecting the isodose surfaces.
+  bool OnDemandSliceIsodoseLines{false};
+
+  /// Target number of triangles per isodose level in the decimated (level of detail) isosurfaces
+  /// that are rendered while the 3D view is being interacted with. Zero disables the level of detail isosurfaces.
+  int LevelOfDetailTriangleBudget{0};
+
   /// Flag supporting real time applications, when there is strictly one set of isodose surfaces.
   /// When this flag is enabled, the following functions are prevented: use of subject hierarchy to organize the isodose
   /// model nodes, reporting of progress, batch processing, and update of dose color table from the isodose one.
@@ -38,6 +38,7 @@
 #include <vtkDoubleArray.h>
 #include <vtkImageData.h>
 #include <vtkMassProperties.h>
+#include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataReader.h>
@@ -227,5 +228,36 @@ int vtkSlicerIsodoseModuleLogicTest1( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  // Compute isodose lines on an axial plane through the center of the dose volume
+  double doseBounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  doseScalarVolumeNode->GetRASBounds(doseBounds);
+  vtkNew<vtkMatrix4x4> sliceToRAS;
+  sliceToRAS->SetElement(0, 3, (doseBounds[0] + doseBounds[1]) / 2.0);
+  sliceToRAS->SetElement(1, 3, (doseBounds[2] + doseBounds[3]) / 2.0);
+  sliceToRAS->SetElement(2, 3, (doseBounds[4] + doseBounds[5]) / 2.0);
+  vtkNew<vtkPolyData> isodoseLines;
+  if (!isodoseLogic->ComputeIsodoseLinesOnSlicePlane(paramNode, sliceToRAS, isodoseLines)
+    || isodoseLines->GetNumberOfLines() == 0)
+  {
+    std::cerr << "Unable to compute isodose lines on slice plane" << std::endl;
+    return EXIT_FAILURE;
+  }
+  double lineBounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  isodoseLines->GetBounds(lineBounds);
+  if (fabs(lineBounds[4] - sliceToRAS->GetElement(2, 3)) > 0.01 || fabs(lineBounds[5] - sliceToRAS->GetElement(2, 3)) > 0.01)
+  {
+    std::cerr << "Isodose lines are not in the slice plane" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Same plane is served from the cache
+  vtkNew<vtkPolyData> cachedIsodoseLines;
+  isodoseLogic->ComputeIsodoseLinesOnSlicePlane(paramNode, sliceToRAS, cachedIsodoseLines);
+  if (cachedIsodoseLines->GetNumberOfLines() != isodoseLines->GetNumberOfLines())
+  {
+    std::cerr << "Cached isodose lines differ from computed ones" << std::endl;
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
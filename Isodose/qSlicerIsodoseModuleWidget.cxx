@@ -56,6 +56,10 @@
 #include <vtkMRMLScene.h>
 #include <vtkMRMLSubjectHierarchyNode.h>
 
+// VTK includes
+#include <vtkInteractorObserver.h>
+#include <vtkRenderWindowInteractor.h>
+
 //-----------------------------------------------------------------------------
 /// \ingroup SlicerRt_QtModules_Isodose
 class qSlicerIsodoseModuleWidgetPrivate: public Ui_qSlicerIsodoseModule
@@ -179,6 +183,9 @@ void qSlicerIsodoseModuleWidget::onEnter()
     qCritical() << Q_FUNC_INFO << ": Invalid logic";
     return;
   }
+
+  // Views may have been added since the last time the module was entered
+  this->observeThreeDViewInteraction();
   vtkMRMLIsodoseNode* paramNode = vtkMRMLIsodoseNode::SafeDownCast(d->MRMLNodeComboBox_ParameterSet->currentNode());
 
   // If we have a parameter node select it
@@ -229,6 +236,8 @@ void qSlicerIsodoseModuleWidget::updateWidgetFromMRML()
 
     d->checkBox_Isoline->setChecked(d->IsodoseNode->GetShowIsodoseLines());
     d->checkBox_Isosurface->setChecked(d->IsodoseNode->GetShowIsodoseSurfaces());
+    d->checkBox_OnDemandSliceIsodoseLines->setChecked(d->IsodoseNode->GetOnDemandSliceIsodoseLines());
+    d->spinBox_LevelOfDetailTriangleBudget->setValue(d->IsodoseNode->GetLevelOfDetailTriangleBudget());
     d->checkBox_ShowDoseVolumesOnly->setChecked(d->IsodoseNode->GetShowDoseVolumesOnly());
 
     if (d->IsodoseNode->GetIsosurfacesModelNode())
@@ -275,6 +284,8 @@ void qSlicerIsodoseModuleWidget::setup()
   connect( d->checkBox_ShowDoseVolumesOnly, SIGNAL( stateChanged(int) ), this, SLOT( showDoseVolumesOnlyCheckboxChanged(int) ) );
   connect( d->checkBox_Isoline, SIGNAL(toggled(bool)), this, SLOT( setIsolineVisibility(bool) ) );
   connect( d->checkBox_Isosurface, SIGNAL(toggled(bool)), this, SLOT( setIsosurfaceVisibility(bool) ) );
+  connect( d->checkBox_OnDemandSliceIsodoseLines, SIGNAL(toggled(bool)), this, SLOT( setOnDemandSliceIsodoseLines(bool) ) );
+  connect( d->spinBox_LevelOfDetailTriangleBudget, SIGNAL(valueChanged(int)), this, SLOT( setLevelOfDetailTriangleBudget(int) ) );
   connect( d->pushButton_Apply, SIGNAL(clicked()), this, SLOT(applyClicked()) );
   connect( d->groupBox_RelativeIsolevels, SIGNAL(toggled(bool)), this, SLOT(setRelativeIsolevelsFlag(bool)));
   connect( d->sliderWidget_ReferenceDose, SIGNAL(valueChanged(double)), this, SLOT(setReferenceDoseValue(double)));
@@ -651,13 +662,53 @@ void qSlicerIsodoseModuleWidget::setIsolineVisibility(bool visible)
   d->IsodoseNode->SetShowIsodoseLines(visible);
   d->IsodoseNode->DisableModifiedEventOff();
 
-  if (d->IsodoseNode->GetIsosurfacesModelNode())
+  if (d->IsodoseNode->GetOnDemandSliceIsodoseLines())
+  {
+    // Isodose lines are shown by the on-demand slice isodose lines models
+    d->logic()->UpdateSliceIsodoseLinesInAllViews(d->IsodoseNode);
+  }
+  else if (d->IsodoseNode->GetIsosurfacesModelNode())
   {
     vtkMRMLModelNode* modelNode = d->IsodoseNode->GetIsosurfacesModelNode();
     modelNode->GetDisplayNode()->SetVisibility2D(visible);
   }
 }
 
+//------------------------------------------------------------------------------
+void qSlicerIsodoseModuleWidget::setOnDemandSliceIsodoseLines(bool onDemand)
+{
+  Q_D(qSlicerIsodoseModuleWidget);
+
+  if (!this->mrmlScene())
+  {
+    qCritical() << Q_FUNC_INFO << ": Invalid scene";
+    return;
+  }
+
+  if (!d->IsodoseNode)
+  {
+    return;
+  }
+
+  d->IsodoseNode->DisableModifiedEventOn();
+  d->IsodoseNode->SetOnDemandSliceIsodoseLines(onDemand);
+  d->IsodoseNode->DisableModifiedEventOff();
+
+  if (!d->IsodoseNode->GetDoseVolumeNode())
+  {
+    return;
+  }
+
+  QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
+  d->logic()->UpdateSliceIsodoseLinesInAllViews(d->IsodoseNode);
+  if (!onDemand && d->IsodoseNode->GetIsosurfacesModelNode())
+  {
+    // Restore isodose surface intersections in slice views
+    d->IsodoseNode->GetIsosurfacesModelNode()->GetDisplayNode()->SetVisibility2D(d->IsodoseNode->GetShowIsodoseLines());
+  }
+  QApplication::restoreOverrideCursor();
+}
+
 //------------------------------------------------------------------------------
 void qSlicerIsodoseModuleWidget::setIsosurfaceVisibility(bool visible)
 {
@@ -691,6 +742,89 @@ void qSlicerIsodoseModuleWidget::setIsosurfaceVisibility(bool visible)
   }
 }
 
+//------------------------------------------------------------------------------
+void qSlicerIsodoseModuleWidget::setLevelOfDetailTriangleBudget(int budget)
+{
+  Q_D(qSlicerIsodoseModuleWidget);
+
+  if (!d->IsodoseNode)
+  {
+    return;
+  }
+
+  // Level of detail isosurfaces are created with the next isosurface computation
+  d->IsodoseNode->DisableModifiedEventOn();
+  d->IsodoseNode->SetLevelOfDetailTriangleBudget(budget);
+  d->IsodoseNode->DisableModifiedEventOff();
+
+  // Previously generated level of detail isosurfaces are removed right away when disabled
+  if (budget <= 0)
+  {
+    d->logic()->RemoveIsosurfacesLevelOfDetail(d->IsodoseNode);
+  }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerIsodoseModuleWidget::observeThreeDViewInteraction()
+{
+  qSlicerApplication* slicerApplication = qSlicerApplication::application();
+  if (!slicerApplication || !slicerApplication->layoutManager())
+  {
+    return;
+  }
+
+  qSlicerLayoutManager* layoutManager = slicerApplication->layoutManager();
+  for (int viewIndex = 0; viewIndex < layoutManager->threeDViewCount(); ++viewIndex)
+  {
+    qMRMLThreeDWidget* threeDWidget = layoutManager->threeDWidget(viewIndex);
+    if (!threeDWidget || !threeDWidget->threeDView())
+    {
+      continue;
+    }
+    // Depending on the interaction, either the interactor style or the interactor reports the start and end of
+    // interaction. Connections already made are not duplicated.
+    qMRMLThreeDView* threeDView = threeDWidget->threeDView();
+    qvtkConnect(threeDView->interactorStyle(), vtkCommand::StartInteractionEvent, this, SLOT(onThreeDViewStartInteraction()));
+    qvtkConnect(threeDView->interactorStyle(), vtkCommand::EndInteractionEvent, this, SLOT(onThreeDViewEndInteraction()));
+    qvtkConnect(threeDView->interactor(), vtkCommand::StartInteractionEvent, this, SLOT(onThreeDViewStartInteraction()));
+    qvtkConnect(threeDView->interactor(), vtkCommand::EndInteractionEvent, this, SLOT(onThreeDViewEndInteraction()));
+  }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerIsodoseModuleWidget::onThreeDViewStartInteraction()
+{
+  this->setIsosurfacesLevelOfDetailRendering(true);
+}
+
+//------------------------------------------------------------------------------
+void qSlicerIsodoseModuleWidget::onThreeDViewEndInteraction()
+{
+  this->setIsosurfacesLevelOfDetailRendering(false);
+}
+
+//------------------------------------------------------------------------------
+void qSlicerIsodoseModuleWidget::setIsosurfacesLevelOfDetailRendering(bool lowDetail)
+{
+  Q_D(qSlicerIsodoseModuleWidget);
+
+  if (!this->mrmlScene() || !d->logic())
+  {
+    return;
+  }
+
+  std::vector<vtkMRMLNode*> isodoseNodes;
+  this->mrmlScene()->GetNodesByClass("vtkMRMLIsodoseNode", isodoseNodes);
+  for (vtkMRMLNode* node : isodoseNodes)
+  {
+    vtkMRMLIsodoseNode* isodoseNode = vtkMRMLIsodoseNode::SafeDownCast(node);
+    if (isodoseNode && isodoseNode->GetLevelOfDetailTriangleBudget() > 0)
+    {
+      d->logic()->SetIsosurfacesLevelOfDetailRendering(isodoseNode, lowDetail);
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 void qSlicerIsodoseModuleWidget::applyClicked()
 {
@@ -733,6 +867,11 @@ void qSlicerIsodoseModuleWidget::applyClicked()
     this->updateColorLegendFromMRML();
   }
 
+  if (d->IsodoseNode->GetOnDemandSliceIsodoseLines())
+  {
+    d->logic()->UpdateSliceIsodoseLinesInAllViews(d->IsodoseNode);
+  }
+
   QApplication::restoreOverrideCursor();
 }
 
@@ -87,6 +87,9 @@ protected slots:
   /// Slot for changing isosurface visibility
   void setIsosurfaceVisibility(bool);
 
+  /// Slot for changing on-demand isodose lines computation in slice views
+  void setOnDemandSliceIsodoseLines(bool);
+
   /// Slot handling clicking the Apply button
   void applyClicked();
 
@@ -105,6 +108,15 @@ protected slots:
   /// Updates color legend widget
   void updateColorLegendFromMRML();
 
+  /// Slot setting the triangle budget of the level of detail isosurfaces
+  void setLevelOfDetailTriangleBudget(int budget);
+
+  /// Slot called when interaction starts in a 3D view. Switches to the level of detail isosurfaces
+  void onThreeDViewStartInteraction();
+
+  /// Slot called when interaction ends in a 3D view. Switches back to the full resolution isosurfaces
+  void onThreeDViewEndInteraction();
+
 protected:
   // Generates a new isodose level name
   QString generateNewIsodoseLevel() const;
@@ -112,6 +124,12 @@ protected:
   /// Updates button states
   void updateButtonsState();
 
+  /// Observe interaction in the 3D views for switching to level of detail isosurfaces
+  void observeThreeDViewInteraction();
+
+  /// Switch between full resolution and level of detail isosurfaces for all isodose parameter nodes
+  void setIsosurfacesLevelOfDetailRendering(bool lowDetail);
+
 protected:
   QScopedPointer<qSlicerIsodoseModuleWidgetPrivate> d_ptr;
   
@@ -80,6 +80,12 @@ vtkMRMLRoomsEyeViewNode::vtkMRMLRoomsEyeViewNode()
   , VerticalTableTopDisplacement(0.0)
   , LongitudinalTableTopDisplacement(0.0)
   , LateralTableTopDisplacement(0.0)
+  , ClearanceThreshold(30.0)
+  , GantryTableTopClearance(-1.0)
+  , GantryPatientSupportClearance(-1.0)
+  , CollimatorTableTopClearance(-1.0)
+  , GantryPatientClearance(-1.0)
+  , CollimatorPatientClearance(-1.0)
 {
   this->SetSingletonTag("IEC");
 }
@@ -106,6 +112,7 @@ void vtkMRMLRoomsEyeViewNode::WriteXML(ostream& of, int nIndent)
   vtkMRMLWriteXMLFloatMacro(VerticalTableTopDisplacement, VerticalTableTopDisplacement);
   vtkMRMLWriteXMLFloatMacro(LongitudinalTableTopDisplacement, LongitudinalTableTopDisplacement);
   vtkMRMLWriteXMLFloatMacro(LateralTableTopDisplacement, LateralTableTopDisplacement);
+  vtkMRMLWriteXMLFloatMacro(ClearanceThreshold, ClearanceThreshold);
   vtkMRMLWriteXMLStringMacro(PatientBodySegmentID, PatientBodySegmentID);
   vtkMRMLWriteXMLStringMacro(TreatmentMachineDescriptorFilePath, TreatmentMachineDescriptorFilePath);
   vtkMRMLWriteXMLEndMacro(); 
@@ -126,13 +133,14 @@ void vtkMRMLRoomsEyeViewNode::ReadXMLAttributes(const char** atts)
   vtkMRMLReadXMLFloatMacro(VerticalTableTopDisplacement, VerticalTableTopDisplacement);
   vtkMRMLReadXMLFloatMacro(LongitudinalTableTopDisplacement, LongitudinalTableTopDisplacement);
   vtkMRMLReadXMLFloatMacro(LateralTableTopDisplacement, LateralTableTopDisplacement);
+  vtkMRMLReadXMLFloatMacro(ClearanceThreshold, ClearanceThreshold);
   vtkMRMLReadXMLStringMacro(PatientBodySegmentID, PatientBodySegmentID);
   vtkMRMLReadXMLStringMacro(TreatmentMachineDescriptorFilePath, TreatmentMachineDescriptorFilePath);
   vtkMRMLReadXMLEndMacro(); 
 
   this->EndModify(disabledModify);
 
-  // Note: ReportString is not read from XML, it is a strictly temporary value
+  // Note: ReportString and the clearances are not read from XML, they are strictly temporary values
 }
 
 //----------------------------------------------------------------------------
@@ -153,6 +161,12 @@ void vtkMRMLRoomsEyeViewNode::Copy(vtkMRMLNode *anode)
   vtkMRMLCopyFloatMacro(VerticalTableTopDisplacement);
   vtkMRMLCopyFloatMacro(LongitudinalTableTopDisplacement);
   vtkMRMLCopyFloatMacro(LateralTableTopDisplacement);
+  vtkMRMLCopyFloatMacro(ClearanceThreshold);
+  vtkMRMLCopyFloatMacro(GantryTableTopClearance);
+  vtkMRMLCopyFloatMacro(GantryPatientSupportClearance);
+  vtkMRMLCopyFloatMacro(CollimatorTableTopClearance);
+  vtkMRMLCopyFloatMacro(GantryPatientClearance);
+  vtkMRMLCopyFloatMacro(CollimatorPatientClearance);
   vtkMRMLCopyStringMacro(PatientBodySegmentID);
   vtkMRMLCopyStringMacro(TreatmentMachineDescriptorFilePath);
   vtkMRMLCopyEndMacro(); 
@@ -174,6 +188,12 @@ void vtkMRMLRoomsEyeViewNode::PrintSelf(ostream& os, vtkIndent indent)
   vtkMRMLPrintFloatMacro(VerticalTableTopDisplacement);
   vtkMRMLPrintFloatMacro(LongitudinalTableTopDisplacement);
   vtkMRMLPrintFloatMacro(LateralTableTopDisplacement);
+  vtkMRMLPrintFloatMacro(ClearanceThreshold);
+  vtkMRMLPrintFloatMacro(GantryTableTopClearance);
+  vtkMRMLPrintFloatMacro(GantryPatientSupportClearance);
+  vtkMRMLPrintFloatMacro(CollimatorTableTopClearance);
+  vtkMRMLPrintFloatMacro(GantryPatientClearance);
+  vtkMRMLPrintFloatMacro(CollimatorPatientClearance);
   vtkMRMLPrintStringMacro(PatientBodySegmentID);
   vtkMRMLPrintStringMacro(TreatmentMachineDescriptorFilePath);
   vtkMRMLPrintEndMacro(); 
@@ -157,6 +157,25 @@ public:
   vtkGetMacro(LateralTableTopDisplacement, double);
   vtkSetMacro(LateralTableTopDisplacement, double);
 
+  /// Get safety margin (mm) required between the treatment machine parts and the patient
+  vtkGetMacro(ClearanceThreshold, double);
+  /// Set safety margin (mm). Clearance calculation of a part pair stops as soon as a distance below it is found.
+  vtkSetMacro(ClearanceThreshold, double);
+
+  /// Minimum distances (mm) between the part pairs calculated by the logic. They are negative if not calculated
+  /// (e.g. a part is not loaded), and may be any value below the clearance threshold if the margin is violated.
+  /// \sa vtkSlicerRoomsEyeViewModuleLogic::CalculateClearances
+  vtkGetMacro(GantryTableTopClearance, double);
+  vtkSetMacro(GantryTableTopClearance, double);
+  vtkGetMacro(GantryPatientSupportClearance, double);
+  vtkSetMacro(GantryPatientSupportClearance, double);
+  vtkGetMacro(CollimatorTableTopClearance, double);
+  vtkSetMacro(CollimatorTableTopClearance, double);
+  vtkGetMacro(GantryPatientClearance, double);
+  vtkSetMacro(GantryPatientClearance, double);
+  vtkGetMacro(CollimatorPatientClearance, double);
+  vtkSetMacro(CollimatorPatientClearance, double);
+
 protected:
   vtkMRMLRoomsEyeViewNode();
   ~vtkMRMLRoomsEyeViewNode();
@@ -180,6 +199,12 @@ protected:
   double VerticalTableTopDisplacement;
   double LongitudinalTableTopDisplacement;
   double LateralTableTopDisplacement;
+  double ClearanceThreshold;
+  double GantryTableTopClearance;
+  double GantryPatientSupportClearance;
+  double CollimatorTableTopClearance;
+  double GantryPatientClearance;
+  double CollimatorPatientClearance;
   double AdditionalModelVerticalDisplacement;
   double AdditionalModelLongitudinalDisplacement;
   double AdditionalModelLateralDisplacement;
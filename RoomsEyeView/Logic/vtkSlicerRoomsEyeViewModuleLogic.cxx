@@ -25,6 +25,7 @@
 // RoomsEyeView includes
 #include "vtkSlicerRoomsEyeViewModuleLogic.h"
 #include "vtkMRMLRoomsEyeViewNode.h"
+#include "vtkTriangleBoundingVolumeHierarchy.h"
 
 // SlicerRT includes
 #include "vtkMRMLRTBeamNode.h"
@@ -35,7 +36,9 @@
 #include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLModelNode.h>
 #include <vtkMRMLModelDisplayNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLSegmentationNode.h>
 #include "vtkMRMLSubjectHierarchyNode.h"
 #include <vtkMRMLViewNode.h>
 
@@ -44,15 +47,20 @@
 #include <vtkSlicerSegmentationsModuleLogic.h>
 
 // vtkSegmentationCore includes
+#include <vtkSegment.h>
+#include <vtkSegmentation.h>
 #include <vtkSegmentationConverter.h>
 
 // VTK includes
 #include <vtkAppendPolyData.h>
-#include "vtkCollisionDetectionFilter.h"
+#include <vtkDoubleArray.h>
 #include <vtkGeneralTransform.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
 #include <vtkMatrix4x4.h>
 #include <vtkObjectFactory.h>
 #include <vtkPolyDataReader.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartPointer.h>
 #include <vtkTransform.h>
 #include <vtkTransformFilter.h>
@@ -62,6 +70,12 @@
 // VTKSYS includes
 #include <vtksys/SystemTools.hxx>
 
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+
 // RapidJSON includes
 #include "rapidjson/document.h"     // rapidjson's DOM-style API
 #include "rapidjson/filereadstream.h"
@@ -69,10 +83,252 @@
 // Constants
 const char* vtkSlicerRoomsEyeViewModuleLogic::ORIENTATION_MARKER_MODEL_NODE_NAME = "RoomsEyeViewOrientationMarker";
 const char* vtkSlicerRoomsEyeViewModuleLogic::TREATMENT_MACHINE_DESCRIPTOR_FILE_PATH_ATTRIBUTE_NAME = "TreatmentMachineDescriptorFilePath";
-unsigned int vtkSlicerRoomsEyeViewModuleLogic::MAX_TRIANGLE_NUMBER_PRODUCT_FOR_COLLISIONS = 1e10;
 
 static rapidjson::Value JSON_EMPTY_VALUE;
 
+namespace
+{
+
+/// Pair of parts to check for collision, both in RAS through their own transform
+struct PartPairCollisionTest
+{
+  vtkTriangleBoundingVolumeHierarchy* Hierarchy1;
+  vtkMatrix4x4* PartToRasMatrix1;
+  vtkTriangleBoundingVolumeHierarchy* Hierarchy2;
+  vtkMatrix4x4* PartToRasMatrix2;
+  std::string CollisionMessage;
+};
+
+/// Narrow phase collision detection of part pairs, pairs are independent
+class PartPairCollisionFunctor
+{
+public:
+  PartPairCollisionFunctor(const std::vector<PartPairCollisionTest>& tests, std::vector<char>& collisions)
+    : Tests(tests)
+    , Collisions(collisions)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType index = begin; index < end; ++index)
+    {
+      const PartPairCollisionTest& test = this->Tests[index];
+      this->Collisions[index] = vtkTriangleBoundingVolumeHierarchy::Intersect(
+        test.Hierarchy1, test.PartToRasMatrix1, test.Hierarchy2, test.PartToRasMatrix2);
+    }
+  }
+
+private:
+  const std::vector<PartPairCollisionTest>& Tests;
+  std::vector<char>& Collisions;
+};
+
+/// Pair of parts to calculate the minimum distance for, both in RAS through their own transform
+struct PartPairClearanceQuery
+{
+  vtkTriangleBoundingVolumeHierarchy* Hierarchy1;
+  vtkMatrix4x4* PartToRasMatrix1;
+  vtkTriangleBoundingVolumeHierarchy* Hierarchy2;
+  vtkMatrix4x4* PartToRasMatrix2;
+  /// Output minimum distance, negative if any of the parts is missing
+  double Clearance;
+};
+
+/// Distance queries of part pairs, pairs are independent
+class PartPairClearanceFunctor
+{
+public:
+  PartPairClearanceFunctor(std::vector<PartPairClearanceQuery>& queries, double clearanceThreshold)
+    : Queries(queries)
+    , ClearanceThreshold(clearanceThreshold)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType index = begin; index < end; ++index)
+    {
+      PartPairClearanceQuery& query = this->Queries[index];
+      query.Clearance = -1.0;
+      if (!query.Hierarchy1 || !query.Hierarchy2
+        || query.Hierarchy1->GetNumberOfTriangles() == 0 || query.Hierarchy2->GetNumberOfTriangles() == 0)
+      {
+        continue;
+      }
+      query.Clearance = vtkTriangleBoundingVolumeHierarchy::Distance(
+        query.Hierarchy1, query.PartToRasMatrix1, query.Hierarchy2, query.PartToRasMatrix2, this->ClearanceThreshold);
+    }
+  }
+
+private:
+  std::vector<PartPairClearanceQuery>& Queries;
+  double ClearanceThreshold;
+};
+
+/// Broad phase of collision detection: determine whether the bounding boxes in RAS of two parts placed by row-major matrices overlap.
+/// Parts whose bounding boxes are disjoint cannot collide. Returns false if any of the hierarchies is missing or empty.
+bool PartBoundsOverlap(vtkTriangleBoundingVolumeHierarchy* hierarchy1, const double partToRasMatrix1[16],
+  vtkTriangleBoundingVolumeHierarchy* hierarchy2, const double partToRasMatrix2[16])
+{
+  double bounds1[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  double bounds2[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  if ( !hierarchy1 || !hierarchy2
+    || !hierarchy1->GetTransformedBounds(partToRasMatrix1, bounds1) || !hierarchy2->GetTransformedBounds(partToRasMatrix2, bounds2) )
+  {
+    return false;
+  }
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    if (bounds1[2 * axis] > bounds2[2 * axis + 1] || bounds2[2 * axis] > bounds1[2 * axis + 1])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Test collision of two parts placed in RAS by row-major matrices. Parts with disjoint bounding boxes in RAS are not tested further.
+bool PartsCollide(vtkTriangleBoundingVolumeHierarchy* hierarchy1, const double partToRasMatrix1[16],
+  vtkTriangleBoundingVolumeHierarchy* hierarchy2, const double partToRasMatrix2[16])
+{
+  return PartBoundsOverlap(hierarchy1, partToRasMatrix1, hierarchy2, partToRasMatrix2)
+    && vtkTriangleBoundingVolumeHierarchy::Intersect(hierarchy1, partToRasMatrix1, hierarchy2, partToRasMatrix2);
+}
+
+/// Pose independent inputs of the collision map calculation.
+/// Matrices are row-major, pose dependent ones are stored consecutively for each sampled value.
+struct CollisionMapInput
+{
+  vtkIdType NumberOfGantryAngles;
+  vtkIdType NumberOfPatientSupportAngles;
+
+  /// Hierarchies of the parts, nullptr if the part does not take part in collision detection
+  vtkTriangleBoundingVolumeHierarchy* CollimatorHierarchy;
+  vtkTriangleBoundingVolumeHierarchy* GantryHierarchy;
+  vtkTriangleBoundingVolumeHierarchy* PatientSupportHierarchy;
+  vtkTriangleBoundingVolumeHierarchy* TableTopHierarchy;
+  vtkTriangleBoundingVolumeHierarchy* PatientBodyHierarchy;
+
+  double FixedReferenceToRasMatrix[16];
+  double CollimatorToGantryMatrix[16];
+  double TableTopEccentricRotationToPatientSupportRotationMatrix[16];
+  /// Inverse of the current table top to RAS transform if the patient body moves with the table top
+  double RasToCurrentTableTopMatrix[16];
+  bool PatientBodyFollowsTableTop;
+
+  std::vector<double> GantryToFixedReferenceMatrices;
+  std::vector<double> PatientSupportRotationToFixedReferenceMatrices;
+  std::vector<double> PatientSupportToPatientSupportRotationMatrices;
+  std::vector<double> TableTopToTableTopEccentricRotationMatrices;
+};
+
+/// Collision detection for the samples of a collision map. Part poses are composed from the precomputed matrices.
+/// Samples are ordered as the voxels of the map, gantry angle changing fastest.
+class CollisionMapFunctor
+{
+public:
+  CollisionMapFunctor(const CollisionMapInput& input, unsigned char* collisionFlags)
+    : Input(input)
+    , CollisionFlags(collisionFlags)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    const CollisionMapInput& input = this->Input;
+    double gantryToRas[16] = { 0.0 };
+    double collimatorToRas[16] = { 0.0 };
+    double patientSupportRotationToRas[16] = { 0.0 };
+    double patientSupportToRas[16] = { 0.0 };
+    double tableTopToPatientSupportRotation[16] = { 0.0 };
+    double tableTopToRas[16] = { 0.0 };
+    double patientBodyToRas[16] = { 1.0, 0.0, 0.0, 0.0,  0.0, 1.0, 0.0, 0.0,  0.0, 0.0, 1.0, 0.0,  0.0, 0.0, 0.0, 1.0 };
+    for (vtkIdType sample = begin; sample < end; ++sample)
+    {
+      vtkIdType gantryIndex = sample % input.NumberOfGantryAngles;
+      vtkIdType patientSupportIndex = (sample / input.NumberOfGantryAngles) % input.NumberOfPatientSupportAngles;
+      vtkIdType tableTopIndex = sample / (input.NumberOfGantryAngles * input.NumberOfPatientSupportAngles);
+
+      vtkMatrix4x4::Multiply4x4(input.FixedReferenceToRasMatrix, &input.GantryToFixedReferenceMatrices[16 * gantryIndex], gantryToRas);
+      vtkMatrix4x4::Multiply4x4(gantryToRas, input.CollimatorToGantryMatrix, collimatorToRas);
+      vtkMatrix4x4::Multiply4x4(input.FixedReferenceToRasMatrix,
+        &input.PatientSupportRotationToFixedReferenceMatrices[16 * patientSupportIndex], patientSupportRotationToRas);
+      vtkMatrix4x4::Multiply4x4(patientSupportRotationToRas,
+        &input.PatientSupportToPatientSupportRotationMatrices[16 * tableTopIndex], patientSupportToRas);
+      vtkMatrix4x4::Multiply4x4(input.TableTopEccentricRotationToPatientSupportRotationMatrix,
+        &input.TableTopToTableTopEccentricRotationMatrices[16 * tableTopIndex], tableTopToPatientSupportRotation);
+      vtkMatrix4x4::Multiply4x4(patientSupportRotationToRas, tableTopToPatientSupportRotation, tableTopToRas);
+      if (input.PatientBodyFollowsTableTop)
+      {
+        vtkMatrix4x4::Multiply4x4(tableTopToRas, input.RasToCurrentTableTopMatrix, patientBodyToRas);
+      }
+
+      unsigned char flags = 0;
+      if (PartsCollide(input.GantryHierarchy, gantryToRas, input.TableTopHierarchy, tableTopToRas))
+      {
+        flags |= vtkSlicerRoomsEyeViewModuleLogic::GantryTableTopCollision;
+      }
+      if (PartsCollide(input.GantryHierarchy, gantryToRas, input.PatientSupportHierarchy, patientSupportToRas))
+      {
+        flags |= vtkSlicerRoomsEyeViewModuleLogic::GantryPatientSupportCollision;
+      }
+      if (PartsCollide(input.CollimatorHierarchy, collimatorToRas, input.TableTopHierarchy, tableTopToRas))
+      {
+        flags |= vtkSlicerRoomsEyeViewModuleLogic::CollimatorTableTopCollision;
+      }
+      if (PartsCollide(input.GantryHierarchy, gantryToRas, input.PatientBodyHierarchy, patientBodyToRas))
+      {
+        flags |= vtkSlicerRoomsEyeViewModuleLogic::GantryPatientCollision;
+      }
+      if (PartsCollide(input.CollimatorHierarchy, collimatorToRas, input.PatientBodyHierarchy, patientBodyToRas))
+      {
+        flags |= vtkSlicerRoomsEyeViewModuleLogic::CollimatorPatientCollision;
+      }
+      this->CollisionFlags[sample] = flags;
+    }
+  }
+
+private:
+  const CollisionMapInput& Input;
+  unsigned char* CollisionFlags;
+};
+
+/// Smallest gantry rotation step (degrees) of the continuous collision check along an arc. When the parts are so close
+/// that a safe step would be smaller than this, contact is reported instead of letting the steps vanish.
+const double MINIMUM_ARC_STEP_ANGLE = 0.1;
+
+/// Largest distance from the origin of a point in a box
+double GetMaximumDistanceFromOrigin(const double bounds[6])
+{
+  double maximumDistance2 = 0.0;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    double coordinate = std::max(std::fabs(bounds[2 * axis]), std::fabs(bounds[2 * axis + 1]));
+    maximumDistance2 += coordinate * coordinate;
+  }
+  return std::sqrt(maximumDistance2);
+}
+
+/// Largest number of poses in a collision map. The map has one byte per pose, but each pose is a full
+/// collision test, so grids beyond this are rejected as unreasonable.
+const double MAXIMUM_NUMBER_OF_COLLISION_MAP_SAMPLES = 20.0e6;
+
+/// Number of samples between start and stop (inclusive) with the given step.
+/// Returned as floating point so that tiny steps cannot overflow it.
+double GetNumberOfSamples(double start, double stop, double step)
+{
+  return std::floor((stop - start) / step + 1e-6) + 1.0;
+}
+
+/// Append the row-major elements of a matrix to a vector
+void AppendMatrixElements(vtkMatrix4x4* matrix, std::vector<double>& elements)
+{
+  elements.insert(elements.end(), matrix->GetData(), matrix->GetData() + 16);
+}
+
+} // namespace
+
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerRoomsEyeViewModuleLogic);
@@ -97,6 +353,36 @@ public:
   std::string GetTreatmentMachinePartModelName(vtkMRMLRoomsEyeViewNode* parameterNode, TreatmentMachinePartType partType);
   vtkMRMLModelNode* GetTreatmentMachinePartModelNode(vtkMRMLRoomsEyeViewNode* parameterNode, TreatmentMachinePartType partType);
   vtkMRMLModelNode* EnsureTreatmentMachinePartModelNode(vtkMRMLRoomsEyeViewNode* parameterNode, TreatmentMachinePartType partType, bool optional=false);
+
+  /// Get bounding volume hierarchy of a treatment machine part
+  /// \return nullptr if the part was not set up for collision detection
+  vtkTriangleBoundingVolumeHierarchy* GetPartHierarchy(TreatmentMachinePartType partType);
+  /// Get bounding volume hierarchy of a treatment machine part if its state is "Active"
+  /// \return nullptr if the part is not active or was not set up for collision detection
+  vtkTriangleBoundingVolumeHierarchy* GetActivePartHierarchy(TreatmentMachinePartType partType);
+  /// Get bounding volume hierarchy of the patient body in RAS. It is rebuilt only if the body segment or its transform changed.
+  /// \return nullptr if there is no patient body
+  vtkTriangleBoundingVolumeHierarchy* GetPatientBodyHierarchy(vtkMRMLRoomsEyeViewNode* parameterNode);
+
+  /// Get current transforms from the treatment machine parts to RAS
+  /// \return Error message, empty on success
+  std::string GetPartToRasTransforms(vtkTransform* gantryToRasTransform, vtkTransform* collimatorToRasTransform,
+    vtkTransform* patientSupportToRasTransform, vtkTransform* tableTopToRasTransform);
+
+  /// Get transform that scales the patient support vertically so that it reaches the table top at the given displacement
+  bool GetPatientSupportScalingTransform(vtkMRMLRoomsEyeViewNode* parameterNode, double verticalTableTopDisplacement,
+    vtkTransform* patientSupportScalingTransform);
+
+  /// Add a part pair to the collision tests if both parts exist and their bounding boxes in RAS overlap (broad phase)
+  static void AddCollisionTest(std::vector<PartPairCollisionTest>& tests,
+    vtkTriangleBoundingVolumeHierarchy* hierarchy1, vtkMatrix4x4* partToRasMatrix1,
+    vtkTriangleBoundingVolumeHierarchy* hierarchy2, vtkMatrix4x4* partToRasMatrix2, const std::string& collisionMessage);
+
+  /// Bounding volume hierarchies of the treatment machine parts in their own (model) coordinate systems
+  std::map<TreatmentMachinePartType, vtkSmartPointer<vtkTriangleBoundingVolumeHierarchy> > PartHierarchies;
+  /// Bounding volume hierarchy of the patient body and the signature of the body it was built from
+  vtkSmartPointer<vtkTriangleBoundingVolumeHierarchy> PatientBodyHierarchy;
+  std::string PatientBodyHierarchySignature;
 };
 
 //---------------------------------------------------------------------------
@@ -305,31 +591,180 @@ vtkMRMLModelNode* vtkSlicerRoomsEyeViewModuleLogic::vtkInternal::EnsureTreatment
   return partModelNode;
 }
 
+//---------------------------------------------------------------------------
+vtkTriangleBoundingVolumeHierarchy* vtkSlicerRoomsEyeViewModuleLogic::vtkInternal::GetPartHierarchy(TreatmentMachinePartType partType)
+{
+  std::map<TreatmentMachinePartType, vtkSmartPointer<vtkTriangleBoundingVolumeHierarchy> >::iterator hierarchyIt =
+    this->PartHierarchies.find(partType);
+  if (hierarchyIt == this->PartHierarchies.end())
+  {
+    return nullptr;
+  }
+  return hierarchyIt->second;
+}
+
+//---------------------------------------------------------------------------
+vtkTriangleBoundingVolumeHierarchy* vtkSlicerRoomsEyeViewModuleLogic::vtkInternal::GetActivePartHierarchy(TreatmentMachinePartType partType)
+{
+  std::string partState = this->External->GetStateForPartType(this->External->GetTreatmentMachinePartTypeAsString(partType));
+  if (partState != "Active")
+  {
+    return nullptr;
+  }
+  return this->GetPartHierarchy(partType);
+}
+
+//---------------------------------------------------------------------------
+vtkTriangleBoundingVolumeHierarchy* vtkSlicerRoomsEyeViewModuleLogic::vtkInternal::GetPatientBodyHierarchy(
+  vtkMRMLRoomsEyeViewNode* parameterNode)
+{
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetPatientBodySegmentationNode();
+  const char* segmentID = parameterNode->GetPatientBodySegmentID();
+  vtkSegment* segment = (segmentationNode && segmentID && segmentationNode->GetSegmentation()
+    ? segmentationNode->GetSegmentation()->GetSegment(segmentID) : nullptr);
+  if (!segment)
+  {
+    this->PatientBodyHierarchy = nullptr;
+    this->PatientBodyHierarchySignature.clear();
+    return nullptr;
+  }
+
+  // The body poly data is only converted and its hierarchy built again if the segment or its transform changed
+  std::stringstream signatureStream;
+  signatureStream << segmentationNode << ";" << segmentID << ";" << segmentationNode->GetSegmentation()->GetMTime()
+    << ";" << segment->GetMTime();
+  vtkDataObject* closedSurface = segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName());
+  if (closedSurface)
+  {
+    signatureStream << ";" << closedSurface->GetMTime();
+  }
+  if (segmentationNode->GetParentTransformNode())
+  {
+    vtkNew<vtkMatrix4x4> segmentationToRasMatrix;
+    segmentationNode->GetParentTransformNode()->GetMatrixTransformToWorld(segmentationToRasMatrix);
+    for (int element = 0; element < 16; ++element)
+    {
+      signatureStream << ";" << segmentationToRasMatrix->GetElement(element / 4, element % 4);
+    }
+  }
+  std::string signature = signatureStream.str();
+  if (this->PatientBodyHierarchy && signature == this->PatientBodyHierarchySignature)
+  {
+    return this->PatientBodyHierarchy;
+  }
+
+  vtkNew<vtkPolyData> patientBodyPolyData;
+  if (!this->External->GetPatientBodyPolyData(parameterNode, patientBodyPolyData))
+  {
+    this->PatientBodyHierarchy = nullptr;
+    this->PatientBodyHierarchySignature.clear();
+    return nullptr;
+  }
+  this->PatientBodyHierarchy = vtkSmartPointer<vtkTriangleBoundingVolumeHierarchy>::New();
+  this->PatientBodyHierarchy->Build(patientBodyPolyData);
+  this->PatientBodyHierarchySignature = signature;
+  return this->PatientBodyHierarchy;
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerRoomsEyeViewModuleLogic::vtkInternal::GetPartToRasTransforms(vtkTransform* gantryToRasTransform,
+  vtkTransform* collimatorToRasTransform, vtkTransform* patientSupportToRasTransform, vtkTransform* tableTopToRasTransform)
+{
+  vtkMRMLLinearTransformNode* gantryToFixedReferenceTransformNode =
+    this->External->GetTransformNodeBetween(vtkIECTransformLogic::Gantry, vtkIECTransformLogic::FixedReference);
+  vtkMRMLLinearTransformNode* patientSupportToPatientSupportRotationTransformNode =
+    this->External->GetTransformNodeBetween(vtkIECTransformLogic::PatientSupport, vtkIECTransformLogic::PatientSupportRotation);
+  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode =
+    this->External->GetTransformNodeBetween(vtkIECTransformLogic::Collimator, vtkIECTransformLogic::Gantry);
+  vtkMRMLLinearTransformNode* tableTopToTableTopEccentricRotationTransformNode =
+    this->External->GetTransformNodeBetween(vtkIECTransformLogic::TableTop, vtkIECTransformLogic::TableTopEccentricRotation);
+
+  if ( !gantryToFixedReferenceTransformNode || !patientSupportToPatientSupportRotationTransformNode
+    || !collimatorToGantryTransformNode || !tableTopToTableTopEccentricRotationTransformNode )
+  {
+    return "Failed to access IEC transforms";
+  }
+
+  // Get transforms to world, make sure they are linear
+  vtkNew<vtkGeneralTransform> gantryToRasGeneralTransform;
+  gantryToFixedReferenceTransformNode->GetTransformToWorld(gantryToRasGeneralTransform);
+
+  vtkNew<vtkGeneralTransform> patientSupportToRasGeneralTransform;
+  patientSupportToPatientSupportRotationTransformNode->GetTransformToWorld(patientSupportToRasGeneralTransform);
+
+  vtkNew<vtkGeneralTransform> collimatorToRasGeneralTransform;
+  collimatorToGantryTransformNode->GetTransformToWorld(collimatorToRasGeneralTransform);
+
+  vtkNew<vtkGeneralTransform> tableTopToRasGeneralTransform;
+  tableTopToTableTopEccentricRotationTransformNode->GetTransformToWorld(tableTopToRasGeneralTransform);
+
+  if ( !vtkMRMLTransformNode::IsGeneralTransformLinear(gantryToRasGeneralTransform, gantryToRasTransform)
+    || !vtkMRMLTransformNode::IsGeneralTransformLinear(patientSupportToRasGeneralTransform, patientSupportToRasTransform)
+    || !vtkMRMLTransformNode::IsGeneralTransformLinear(collimatorToRasGeneralTransform, collimatorToRasTransform)
+    || !vtkMRMLTransformNode::IsGeneralTransformLinear(tableTopToRasGeneralTransform, tableTopToRasTransform) )
+  {
+    return "Non-linear transform detected";
+  }
+
+
+  return "";
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerRoomsEyeViewModuleLogic::vtkInternal::GetPatientSupportScalingTransform(
+  vtkMRMLRoomsEyeViewNode* parameterNode, double verticalTableTopDisplacement, vtkTransform* patientSupportScalingTransform)
+{
+  vtkMRMLModelNode* patientSupportModel = this->GetTreatmentMachinePartModelNode(parameterNode, PatientSupport);
+  if (!patientSupportModel || !patientSupportModel->GetPolyData())
+  {
+    return false;
+  }
+
+  // Get bounds of the patient support model
+  double patientSupportModelBounds[6] = { 0, 0, 0, 0, 0, 0 };
+  patientSupportModel->GetPolyData()->GetBounds(patientSupportModelBounds);
+
+  // Translation to origin for in-place vertical scaling
+  patientSupportScalingTransform->Identity();
+  patientSupportScalingTransform->PostMultiply();
+  double patientSupportTranslationToOrigin[3] = { 0, 0, (-1.0) * patientSupportModelBounds[4]};
+  patientSupportScalingTransform->Translate(patientSupportTranslationToOrigin);
+
+  // Apply patient support vertical scale
+  double newPatientSupportHeight = patientSupportModelBounds[5] + verticalTableTopDisplacement - patientSupportModelBounds[4];
+  double originalPatientSupportHeight = patientSupportModelBounds[5] - patientSupportModelBounds[4];
+  patientSupportScalingTransform->Scale(1.0, 1.0, newPatientSupportHeight / originalPatientSupportHeight);
+
+  // Translate back so that the patient support base is at the same height
+  double patientSupportTranslationFromOrigin[3] = { 0, 0, patientSupportModelBounds[4]};
+  patientSupportScalingTransform->Translate(patientSupportTranslationFromOrigin);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerRoomsEyeViewModuleLogic::vtkInternal::AddCollisionTest(std::vector<PartPairCollisionTest>& tests,
+  vtkTriangleBoundingVolumeHierarchy* hierarchy1, vtkMatrix4x4* partToRasMatrix1,
+  vtkTriangleBoundingVolumeHierarchy* hierarchy2, vtkMatrix4x4* partToRasMatrix2, const std::string& collisionMessage)
+{
+  if (!partToRasMatrix1 || !partToRasMatrix2
+    || !PartBoundsOverlap(hierarchy1, partToRasMatrix1->GetData(), hierarchy2, partToRasMatrix2->GetData()))
+  {
+    // Bounding boxes in RAS are disjoint, the parts cannot collide
+    return;
+  }
+  PartPairCollisionTest test = { hierarchy1, partToRasMatrix1, hierarchy2, partToRasMatrix2, collisionMessage };
+  tests.push_back(test);
+}
+
 //---------------------------------------------------------------------------
 // vtkSlicerRoomsEyeViewModuleLogic methods
 
 //----------------------------------------------------------------------------
 vtkSlicerRoomsEyeViewModuleLogic::vtkSlicerRoomsEyeViewModuleLogic()
-  : GantryPatientCollisionDetection(nullptr)
-  , GantryTableTopCollisionDetection(nullptr)
-  , GantryPatientSupportCollisionDetection(nullptr)
-  , CollimatorPatientCollisionDetection(nullptr)
-  , CollimatorTableTopCollisionDetection(nullptr)
 {
   this->Internal = new vtkInternal(this); 
 
   this->IECLogic = vtkIECTransformLogic::New();
-
-  this->GantryPatientCollisionDetection = vtkCollisionDetectionFilter::New();
-  this->GantryPatientCollisionDetection->SetCollisionModeToFirstContact();
-  this->GantryTableTopCollisionDetection = vtkCollisionDetectionFilter::New();
-  this->GantryTableTopCollisionDetection->SetCollisionModeToFirstContact();
-  this->GantryPatientSupportCollisionDetection = vtkCollisionDetectionFilter::New();
-  this->GantryPatientSupportCollisionDetection->SetCollisionModeToFirstContact();
-  this->CollimatorPatientCollisionDetection = vtkCollisionDetectionFilter::New();
-  this->CollimatorPatientCollisionDetection->SetCollisionModeToFirstContact();
-  this->CollimatorTableTopCollisionDetection = vtkCollisionDetectionFilter::New();
-  this->CollimatorTableTopCollisionDetection->SetCollisionModeToFirstContact();
 }
 
 //----------------------------------------------------------------------------
@@ -341,30 +776,10 @@ vtkSlicerRoomsEyeViewModuleLogic::~vtkSlicerRoomsEyeViewModuleLogic()
     this->IECLogic = nullptr;
   }
 
-  if (this->GantryPatientCollisionDetection)
-  {
-    this->GantryPatientCollisionDetection->Delete();
-    this->GantryPatientCollisionDetection = nullptr;
-  }
-  if (this->GantryTableTopCollisionDetection)
-  {
-    this->GantryTableTopCollisionDetection->Delete();
-    this->GantryTableTopCollisionDetection = nullptr;
-  }
-  if (this->GantryPatientSupportCollisionDetection)
-  {
-    this->GantryPatientSupportCollisionDetection->Delete();
-    this->GantryPatientSupportCollisionDetection = nullptr;
-  }
-  if (this->CollimatorPatientCollisionDetection)
-  {
-    this->CollimatorPatientCollisionDetection->Delete();
-    this->CollimatorPatientCollisionDetection = nullptr;
-  }
-  if (this->CollimatorTableTopCollisionDetection)
+  if (this->Internal)
   {
-    this->CollimatorTableTopCollisionDetection->Delete();
-    this->CollimatorTableTopCollisionDetection = nullptr;
+    delete this->Internal;
+    this->Internal = nullptr;
   }
 }
 
@@ -697,7 +1112,7 @@ vtkSlicerRoomsEyeViewModuleLogic::LoadTreatmentMachine(vtkMRMLRoomsEyeViewNode*
 
 //----------------------------------------------------------------------------
 std::vector<vtkSlicerRoomsEyeViewModuleLogic::TreatmentMachinePartType>
-vtkSlicerRoomsEyeViewModuleLogic::SetupTreatmentMachineModels(vtkMRMLRoomsEyeViewNode* parameterNode, bool forceEnableCollisionDetection/*=false*/)
+vtkSlicerRoomsEyeViewModuleLogic::SetupTreatmentMachineModels(vtkMRMLRoomsEyeViewNode* parameterNode)
 {
   vtkMRMLScene* scene = this->GetMRMLScene();
   if (!scene)
@@ -707,7 +1122,7 @@ vtkSlicerRoomsEyeViewModuleLogic::SetupTreatmentMachineModels(vtkMRMLRoomsEyeVie
   }
 
   std::vector<TreatmentMachinePartType> loadedParts;
-  std::map<TreatmentMachinePartType, unsigned int> loadedPartsNumTriangles;
+  this->Internal->PartHierarchies.clear();
   for (int partIdx=0; partIdx<LastPartType; ++partIdx)
   {
     std::string partType = this->GetTreatmentMachinePartTypeAsString((TreatmentMachinePartType)partIdx);
@@ -723,7 +1138,6 @@ vtkSlicerRoomsEyeViewModuleLogic::SetupTreatmentMachineModels(vtkMRMLRoomsEyeVie
     }
 
     loadedParts.push_back((TreatmentMachinePartType)partIdx);
-    loadedPartsNumTriangles[(TreatmentMachinePartType)partIdx] = partModel->GetPolyData()->GetNumberOfCells();
 
     // Set color
     vtkVector3d partColor(this->GetColorForPartType(partType));
@@ -749,40 +1163,39 @@ vtkSlicerRoomsEyeViewModuleLogic::SetupTreatmentMachineModels(vtkMRMLRoomsEyeVie
       vtkErrorMacro("SetupTreatmentMachineModels: Failed to set file to RAS matrix for treatment machine part " << partType);
     }
 
-    // Setup transforms and collision detection
+    // Build bounding volume hierarchy once for the parts taking part in collision detection.
+    // The parts are rigid, so moving them only changes the transform used in the queries.
+    if (partIdx == Collimator || partIdx == Gantry || partIdx == PatientSupport || partIdx == TableTop)
+    {
+      vtkSmartPointer<vtkTriangleBoundingVolumeHierarchy> partHierarchy = vtkSmartPointer<vtkTriangleBoundingVolumeHierarchy>::New();
+      partHierarchy->Build(partModel->GetPolyData());
+      this->Internal->PartHierarchies[(TreatmentMachinePartType)partIdx] = partHierarchy;
+    }
+
+    // Setup transforms
     if (partIdx == Collimator)
     {
       vtkMRMLLinearTransformNode* collimatorToGantryTransformNode =
         this->GetTransformNodeBetween(vtkIECTransformLogic::Collimator, vtkIECTransformLogic::Gantry);
       partModel->SetAndObserveTransformNodeID(collimatorToGantryTransformNode->GetID());
-      this->CollimatorTableTopCollisionDetection->SetInputData(0, partModel->GetPolyData());
-      // Patient model is set when calculating collisions, as it can be changed dynamically
-      this->CollimatorPatientCollisionDetection->SetInputData(0, partModel->GetPolyData());
     }
     else if (partIdx == Gantry)
     {
       vtkMRMLLinearTransformNode* gantryToFixedReferenceTransformNode =
         this->GetTransformNodeBetween(vtkIECTransformLogic::Gantry, vtkIECTransformLogic::FixedReference);
       partModel->SetAndObserveTransformNodeID(gantryToFixedReferenceTransformNode->GetID());
-      this->GantryTableTopCollisionDetection->SetInputData(0, partModel->GetPolyData());
-      this->GantryPatientSupportCollisionDetection->SetInputData(0, partModel->GetPolyData());
-      // Patient model is set when calculating collisions, as it can be changed dynamically
-      this->GantryPatientCollisionDetection->SetInputData(0, partModel->GetPolyData());
     }
     else if (partIdx == PatientSupport)
     {
       vtkMRMLLinearTransformNode* patientSupportToPatientSupportRotationTransformNode =
         this->GetTransformNodeBetween(vtkIECTransformLogic::PatientSupport, vtkIECTransformLogic::PatientSupportRotation);
       partModel->SetAndObserveTransformNodeID(patientSupportToPatientSupportRotationTransformNode->GetID());
-      this->GantryPatientSupportCollisionDetection->SetInputData(1, partModel->GetPolyData());
     }
     else if (partIdx == TableTop)
     {
       vtkMRMLLinearTransformNode* tableTopToTableTopEccentricRotationTransformNode =
         this->GetTransformNodeBetween(vtkIECTransformLogic::TableTop, vtkIECTransformLogic::TableTopEccentricRotation);
       partModel->SetAndObserveTransformNodeID(tableTopToTableTopEccentricRotationTransformNode->GetID());
-      this->GantryTableTopCollisionDetection->SetInputData(1, partModel->GetPolyData());
-      this->CollimatorTableTopCollisionDetection->SetInputData(1, partModel->GetPolyData());
     }
     else if (partIdx == Body)
     {
@@ -811,35 +1224,6 @@ vtkSlicerRoomsEyeViewModuleLogic::SetupTreatmentMachineModels(vtkMRMLRoomsEyeVie
     //TODO: ApplicatorHolder, ElectronApplicator?
   }
 
-  // Disable collision detection if product of number of triangles of the two models is above threshold
-  if (loadedPartsNumTriangles[Gantry] * loadedPartsNumTriangles[TableTop] > MAX_TRIANGLE_NUMBER_PRODUCT_FOR_COLLISIONS && !forceEnableCollisionDetection)
-  {
-    vtkWarningMacro("Too many combined triangles (product = " << loadedPartsNumTriangles[Gantry] * loadedPartsNumTriangles[TableTop]
-      << ") detected between gantry and table top. Collision detection may take a very long time.");
-    this->GantryTableTopCollisionDetection->SetInputData(0, nullptr);
-    this->GantryTableTopCollisionDetection->SetInputData(1, nullptr);
-  }
-  if (loadedPartsNumTriangles[Gantry] * loadedPartsNumTriangles[PatientSupport] > MAX_TRIANGLE_NUMBER_PRODUCT_FOR_COLLISIONS && !forceEnableCollisionDetection)
-  {
-    vtkWarningMacro("Too many combined triangles (product = " << loadedPartsNumTriangles[Gantry] * loadedPartsNumTriangles[PatientSupport]
-      << ") detected between gantry and patient support. Collision detection may take a very long time.");
-    this->GantryPatientSupportCollisionDetection->SetInputData(0, nullptr);
-    this->GantryPatientSupportCollisionDetection->SetInputData(1, nullptr);
-  }
-  if (loadedPartsNumTriangles[Collimator] * loadedPartsNumTriangles[TableTop] > MAX_TRIANGLE_NUMBER_PRODUCT_FOR_COLLISIONS && !forceEnableCollisionDetection)
-  {
-    vtkWarningMacro("Too many combined triangles (product = " << loadedPartsNumTriangles[Collimator] * loadedPartsNumTriangles[TableTop]
-      << ") detected between collimator and table top. Collision detection may take a very long time.");
-    this->CollimatorTableTopCollisionDetection->SetInputData(0, nullptr);
-    this->CollimatorTableTopCollisionDetection->SetInputData(1, nullptr);
-  }
-
-  // Set identity transform for patient (parent transform is taken into account when getting poly data from segmentation)
-  vtkNew<vtkTransform> identityTransform;
-  identityTransform->Identity();
-  this->GantryPatientCollisionDetection->SetTransform(1, vtkLinearTransform::SafeDownCast(identityTransform));
-  this->CollimatorPatientCollisionDetection->SetTransform(1, vtkLinearTransform::SafeDownCast(identityTransform));
-
   return loadedParts;
 }
 
@@ -1250,38 +1634,14 @@ void vtkSlicerRoomsEyeViewModuleLogic::UpdatePatientSupportToPatientSupportRotat
     return;
   }
 
-  std::string machineType = this->Internal->GetTreatmentMachineFileNameWithoutExtension(parameterNode);
-
-  vtkMRMLModelNode* patientSupportModel = this->Internal->GetTreatmentMachinePartModelNode(parameterNode, PatientSupport);
-  vtkMRMLModelNode* tableTopModel = this->Internal->GetTreatmentMachinePartModelNode(parameterNode, TableTop);
-  if (!patientSupportModel || !patientSupportModel->GetPolyData() || !tableTopModel || !tableTopModel->GetPolyData())
+  vtkNew<vtkTransform> patientSupportScalingTransform;
+  if (!this->Internal->GetPatientSupportScalingTransform(
+    parameterNode, parameterNode->GetVerticalTableTopDisplacement(), patientSupportScalingTransform))
   {
     vtkErrorMacro("UpdatePatientSupportToPatientSupportRotationTransform: Failed to access treatment machine part models");
     return;
   }
 
-  // Get bounds of parts involved in computation
-  double patientSupportModelBounds[6] = { 0, 0, 0, 0, 0, 0 };
-  patientSupportModel->GetPolyData()->GetBounds(patientSupportModelBounds);
-  double tableTopModelBounds[6] = { 0, 0, 0, 0, 0, 0 };
-  tableTopModel->GetPolyData()->GetBounds(tableTopModelBounds);
-
-  // Translation to origin for in-place vertical scaling
-  vtkNew<vtkTransform> patientSupportScalingTransform;
-  patientSupportScalingTransform->PostMultiply();
-  double patientSupportTranslationToOrigin[3] = { 0, 0, (-1.0) * patientSupportModelBounds[4]};
-  patientSupportScalingTransform->Translate(patientSupportTranslationToOrigin);
-
-  // Apply patient support vertical scale
-  double tableTopDisplacement = parameterNode->GetVerticalTableTopDisplacement();
-  double newPatientSupportHeight = /*tableTopModelBounds[4] + */patientSupportModelBounds[5] + tableTopDisplacement - patientSupportModelBounds[4];
-  double originalPatientSupportHeight = patientSupportModelBounds[5] - patientSupportModelBounds[4];
-  patientSupportScalingTransform->Scale(1.0, 1.0, newPatientSupportHeight / originalPatientSupportHeight);
-
-  // Translate back so that the patient support base is at the same height
-  double patientSupportTranslationFromOrigin[3] = { 0, 0, patientSupportModelBounds[4]};
-  patientSupportScalingTransform->Translate(patientSupportTranslationFromOrigin);
-
   vtkMRMLLinearTransformNode* patientSupportToPatientSupportRotationTransformNode =
     this->GetTransformNodeBetween(vtkIECTransformLogic::PatientSupport, vtkIECTransformLogic::PatientSupportRotation);
   patientSupportToPatientSupportRotationTransformNode->SetAndObserveTransformToParent(patientSupportScalingTransform);
@@ -1334,47 +1694,15 @@ std::string vtkSlicerRoomsEyeViewModuleLogic::CheckForCollisions(vtkMRMLRoomsEye
 
   std::string statusString = "";
 
-  // Get transforms used in the collision detection filters
-  vtkMRMLLinearTransformNode* gantryToFixedReferenceTransformNode =
-    this->GetTransformNodeBetween(vtkIECTransformLogic::Gantry, vtkIECTransformLogic::FixedReference);
-  vtkMRMLLinearTransformNode* patientSupportToPatientSupportRotationTransformNode =
-    this->GetTransformNodeBetween(vtkIECTransformLogic::PatientSupport, vtkIECTransformLogic::PatientSupportRotation);
-  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode =
-    this->GetTransformNodeBetween(vtkIECTransformLogic::Collimator, vtkIECTransformLogic::Gantry);
-  vtkMRMLLinearTransformNode* tableTopToTableTopEccentricRotationTransformNode =
-    this->GetTransformNodeBetween(vtkIECTransformLogic::TableTop, vtkIECTransformLogic::TableTopEccentricRotation);
-
-  if ( !gantryToFixedReferenceTransformNode || !patientSupportToPatientSupportRotationTransformNode
-    || !collimatorToGantryTransformNode || !tableTopToTableTopEccentricRotationTransformNode )
-  {
-    statusString = "Failed to access IEC transforms";
-    vtkErrorMacro("CheckForCollisions: " + statusString);
-    return statusString;
-  }
-
-  // Get transforms to world, make sure they are linear
-  vtkNew<vtkGeneralTransform> gantryToRasGeneralTransform;
-  gantryToFixedReferenceTransformNode->GetTransformToWorld(gantryToRasGeneralTransform);
+  // Get transforms used in the collision detection
   vtkNew<vtkTransform> gantryToRasTransform;
-
-  vtkNew<vtkGeneralTransform> patientSupportToRasGeneralTransform;
-  patientSupportToPatientSupportRotationTransformNode->GetTransformToWorld(patientSupportToRasGeneralTransform);
+  vtkNew<vtkTransform> collimatorToRasTransform;
   vtkNew<vtkTransform> patientSupportToRasTransform;
-
-  vtkNew<vtkGeneralTransform> collimatorToRasGeneralTransform;
-  collimatorToGantryTransformNode->GetTransformToWorld(collimatorToRasGeneralTransform);
-  vtkNew<vtkTransform> collimatorToRasTransform ;
-
-  vtkNew<vtkGeneralTransform> tableTopToRasGeneralTransform;
-  tableTopToTableTopEccentricRotationTransformNode->GetTransformToWorld(tableTopToRasGeneralTransform);
   vtkNew<vtkTransform> tableTopToRasTransform;
-
-  if ( !vtkMRMLTransformNode::IsGeneralTransformLinear(gantryToRasGeneralTransform, gantryToRasTransform)
-    || !vtkMRMLTransformNode::IsGeneralTransformLinear(patientSupportToRasGeneralTransform, patientSupportToRasTransform)
-    || !vtkMRMLTransformNode::IsGeneralTransformLinear(collimatorToRasGeneralTransform, collimatorToRasTransform)
-    || !vtkMRMLTransformNode::IsGeneralTransformLinear(tableTopToRasGeneralTransform, tableTopToRasTransform) )
+  statusString = this->Internal->GetPartToRasTransforms(
+    gantryToRasTransform, collimatorToRasTransform, patientSupportToRasTransform, tableTopToRasTransform);
+  if (!statusString.empty())
   {
-    statusString = "Non-linear transform detected";
     vtkErrorMacro("CheckForCollisions: " + statusString);
     return statusString;
   }
@@ -1385,69 +1713,403 @@ std::string vtkSlicerRoomsEyeViewModuleLogic::CheckForCollisions(vtkMRMLRoomsEye
   std::string patientSupportState = this->GetStateForPartType(this->GetTreatmentMachinePartTypeAsString(PatientSupport));
   std::string tableTopState = this->GetStateForPartType(this->GetTreatmentMachinePartTypeAsString(TableTop));
 
-  // If number of contacts between pieces of treatment room is greater than 0, the collision between which pieces
+  // Collect part pairs whose bounding boxes overlap in RAS (broad phase).
+  // Patient body poly data is already in RAS (parent transform is taken into account when getting it from segmentation).
+  vtkTriangleBoundingVolumeHierarchy* collimatorHierarchy = this->Internal->GetPartHierarchy(Collimator);
+  vtkTriangleBoundingVolumeHierarchy* gantryHierarchy = this->Internal->GetPartHierarchy(Gantry);
+  vtkTriangleBoundingVolumeHierarchy* patientSupportHierarchy = this->Internal->GetPartHierarchy(PatientSupport);
+  vtkTriangleBoundingVolumeHierarchy* tableTopHierarchy = this->Internal->GetPartHierarchy(TableTop);
+  vtkTriangleBoundingVolumeHierarchy* patientBodyHierarchy = this->Internal->GetPatientBodyHierarchy(parameterNode);
+  std::vector<PartPairCollisionTest> collisionTests;
+  if (gantryState == "Active" && tableTopState == "Active")
+  {
+    vtkInternal::AddCollisionTest(collisionTests, gantryHierarchy, gantryToRasTransform->GetMatrix(),
+      tableTopHierarchy, tableTopToRasTransform->GetMatrix(), "Collision between gantry and table top\n");
+  }
+  if (gantryState == "Active" && patientSupportState == "Active")
+  {
+    vtkInternal::AddCollisionTest(collisionTests, gantryHierarchy, gantryToRasTransform->GetMatrix(),
+      patientSupportHierarchy, patientSupportToRasTransform->GetMatrix(), "Collision between gantry and patient support\n");
+  }
+  if (collimatorState == "Active" && tableTopState == "Active")
+  {
+    vtkInternal::AddCollisionTest(collisionTests, collimatorHierarchy, collimatorToRasTransform->GetMatrix(),
+      tableTopHierarchy, tableTopToRasTransform->GetMatrix(), "Collision between collimator and table top\n");
+  }
+  if (gantryState == "Active")
+  {
+    vtkInternal::AddCollisionTest(collisionTests, gantryHierarchy, gantryToRasTransform->GetMatrix(),
+      patientBodyHierarchy, nullptr, "Collision between gantry and patient\n");
+  }
+  if (collimatorState == "Active")
+  {
+    vtkInternal::AddCollisionTest(collisionTests, collimatorHierarchy, collimatorToRasTransform->GetMatrix(),
+      patientBodyHierarchy, nullptr, "Collision between collimator and patient\n");
+  }
+
+  // Test the remaining pairs concurrently (narrow phase)
+  std::vector<char> collisions(collisionTests.size(), 0);
+  PartPairCollisionFunctor collisionFunctor(collisionTests, collisions);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(collisionTests.size()), collisionFunctor);
+
+  // If there is contact between pieces of treatment room, the collision between which pieces
   // will be set to the output string and returned by the function.
-  if (gantryState == "Active" && tableTopState == "Active" && this->GantryTableTopCollisionDetection->GetInputData(0))
+  for (size_t index = 0; index < collisionTests.size(); ++index)
   {
-    this->GantryTableTopCollisionDetection->SetTransform(0, vtkLinearTransform::SafeDownCast(gantryToRasTransform));
-    this->GantryTableTopCollisionDetection->SetTransform(1, vtkLinearTransform::SafeDownCast(tableTopToRasTransform));
-    this->GantryTableTopCollisionDetection->Update();
-    if (this->GantryTableTopCollisionDetection->GetNumberOfContacts() > 0)
+    if (collisions[index])
     {
-      statusString = statusString + "Collision between gantry and table top\n";
+      statusString = statusString + collisionTests[index].CollisionMessage;
     }
   }
 
-  if (gantryState == "Active" && patientSupportState == "Active" && this->GantryTableTopCollisionDetection->GetInputData(0))
+  return statusString;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSlicerRoomsEyeViewModuleLogic::CalculateClearances(vtkMRMLRoomsEyeViewNode* parameterNode)
+{
+  if (!parameterNode)
   {
-    this->GantryPatientSupportCollisionDetection->SetTransform(0, vtkLinearTransform::SafeDownCast(gantryToRasTransform));
-    this->GantryPatientSupportCollisionDetection->SetTransform(1, vtkLinearTransform::SafeDownCast(patientSupportToRasTransform));
-    this->GantryPatientSupportCollisionDetection->Update();
-    if (this->GantryPatientSupportCollisionDetection->GetNumberOfContacts() > 0)
-    {
-      statusString = statusString + "Collision between gantry and patient support\n";
-    }
+    vtkErrorMacro("CalculateClearances: Invalid parameter set node");
+    return false;
   }
 
-  if (collimatorState == "Active" && tableTopState == "Active" && this->CollimatorTableTopCollisionDetection->GetInputData(0))
+  vtkNew<vtkTransform> gantryToRasTransform;
+  vtkNew<vtkTransform> collimatorToRasTransform;
+  vtkNew<vtkTransform> patientSupportToRasTransform;
+  vtkNew<vtkTransform> tableTopToRasTransform;
+  std::string errorMessage = this->Internal->GetPartToRasTransforms(
+    gantryToRasTransform, collimatorToRasTransform, patientSupportToRasTransform, tableTopToRasTransform);
+  if (!errorMessage.empty())
   {
-    this->CollimatorTableTopCollisionDetection->SetTransform(0, vtkLinearTransform::SafeDownCast(collimatorToRasTransform));
-    this->CollimatorTableTopCollisionDetection->SetTransform(1, vtkLinearTransform::SafeDownCast(tableTopToRasTransform));
-    this->CollimatorTableTopCollisionDetection->Update();
-    if (this->CollimatorTableTopCollisionDetection->GetNumberOfContacts() > 0)
-    {
-      statusString = statusString + "Collision between collimator and table top\n";
-    }
+    vtkErrorMacro("CalculateClearances: " + errorMessage);
+    return false;
   }
 
-  // Get patient body poly data
-  vtkNew<vtkPolyData> patientBodyPolyData;
-  if (this->GetPatientBodyPolyData(parameterNode, patientBodyPolyData))
+  // Only active parts are considered, same as in CheckForCollisions
+  vtkTriangleBoundingVolumeHierarchy* collimatorHierarchy = this->Internal->GetActivePartHierarchy(Collimator);
+  vtkTriangleBoundingVolumeHierarchy* gantryHierarchy = this->Internal->GetActivePartHierarchy(Gantry);
+  vtkTriangleBoundingVolumeHierarchy* patientSupportHierarchy = this->Internal->GetActivePartHierarchy(PatientSupport);
+  vtkTriangleBoundingVolumeHierarchy* tableTopHierarchy = this->Internal->GetActivePartHierarchy(TableTop);
+  // Patient body poly data is already in RAS
+  vtkTriangleBoundingVolumeHierarchy* patientBodyHierarchy = this->Internal->GetPatientBodyHierarchy(parameterNode);
+
+  std::vector<PartPairClearanceQuery> queries;
+  PartPairClearanceQuery gantryTableTopQuery = { gantryHierarchy, gantryToRasTransform->GetMatrix(),
+    tableTopHierarchy, tableTopToRasTransform->GetMatrix(), -1.0 };
+  queries.push_back(gantryTableTopQuery);
+  PartPairClearanceQuery gantryPatientSupportQuery = { gantryHierarchy, gantryToRasTransform->GetMatrix(),
+    patientSupportHierarchy, patientSupportToRasTransform->GetMatrix(), -1.0 };
+  queries.push_back(gantryPatientSupportQuery);
+  PartPairClearanceQuery collimatorTableTopQuery = { collimatorHierarchy, collimatorToRasTransform->GetMatrix(),
+    tableTopHierarchy, tableTopToRasTransform->GetMatrix(), -1.0 };
+  queries.push_back(collimatorTableTopQuery);
+  PartPairClearanceQuery gantryPatientQuery = { gantryHierarchy, gantryToRasTransform->GetMatrix(),
+    patientBodyHierarchy, nullptr, -1.0 };
+  queries.push_back(gantryPatientQuery);
+  PartPairClearanceQuery collimatorPatientQuery = { collimatorHierarchy, collimatorToRasTransform->GetMatrix(),
+    patientBodyHierarchy, nullptr, -1.0 };
+  queries.push_back(collimatorPatientQuery);
+
+  PartPairClearanceFunctor clearanceFunctor(queries, parameterNode->GetClearanceThreshold());
+  vtkSMPTools::For(0, static_cast<vtkIdType>(queries.size()), clearanceFunctor);
+
+  int disabledModify = parameterNode->StartModify();
+  parameterNode->SetGantryTableTopClearance(queries[0].Clearance);
+  parameterNode->SetGantryPatientSupportClearance(queries[1].Clearance);
+  parameterNode->SetCollimatorTableTopClearance(queries[2].Clearance);
+  parameterNode->SetGantryPatientClearance(queries[3].Clearance);
+  parameterNode->SetCollimatorPatientClearance(queries[4].Clearance);
+  parameterNode->EndModify(disabledModify);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSlicerRoomsEyeViewModuleLogic::CheckForCollisionsAlongArc(vtkMRMLRoomsEyeViewNode* parameterNode,
+  double startGantryAngle, double stopGantryAngle, bool& contact, double& firstContactGantryAngle, double contactDistance/*=1.0*/)
+{
+  contact = false;
+  if (!parameterNode)
+  {
+    vtkErrorMacro("CheckForCollisionsAlongArc: Invalid parameter set node");
+    return false;
+  }
+  if (contactDistance <= 0.0)
+  {
+    vtkErrorMacro("CheckForCollisionsAlongArc: Contact distance must be positive");
+    return false;
+  }
+
+  // Poses of the parts that do not move along the arc
+  vtkNew<vtkTransform> gantryToRasTransform;
+  vtkNew<vtkTransform> collimatorToRasTransform;
+  vtkNew<vtkTransform> patientSupportToRasTransform;
+  vtkNew<vtkTransform> tableTopToRasTransform;
+  std::string errorMessage = this->Internal->GetPartToRasTransforms(
+    gantryToRasTransform, collimatorToRasTransform, patientSupportToRasTransform, tableTopToRasTransform);
+  if (!errorMessage.empty())
+  {
+    vtkErrorMacro("CheckForCollisionsAlongArc: " + errorMessage);
+    return false;
+  }
+  vtkMRMLLinearTransformNode* fixedReferenceToRasTransformNode =
+    this->GetTransformNodeBetween(vtkIECTransformLogic::FixedReference, vtkIECTransformLogic::RAS);
+  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode =
+    this->GetTransformNodeBetween(vtkIECTransformLogic::Collimator, vtkIECTransformLogic::Gantry);
+  if (!fixedReferenceToRasTransformNode || !collimatorToGantryTransformNode)
   {
-    if (gantryState == "Active")
+    vtkErrorMacro("CheckForCollisionsAlongArc: Failed to access IEC transforms");
+    return false;
+  }
+  vtkNew<vtkMatrix4x4> fixedReferenceToRasMatrix;
+  fixedReferenceToRasTransformNode->GetMatrixTransformToWorld(fixedReferenceToRasMatrix);
+  vtkNew<vtkMatrix4x4> collimatorToGantryMatrix;
+  collimatorToGantryTransformNode->GetMatrixTransformToParent(collimatorToGantryMatrix);
+
+  // Only active parts are considered, same as in CheckForCollisions
+  vtkTriangleBoundingVolumeHierarchy* collimatorHierarchy = this->Internal->GetActivePartHierarchy(Collimator);
+  vtkTriangleBoundingVolumeHierarchy* gantryHierarchy = this->Internal->GetActivePartHierarchy(Gantry);
+  vtkTriangleBoundingVolumeHierarchy* patientSupportHierarchy = this->Internal->GetActivePartHierarchy(PatientSupport);
+  vtkTriangleBoundingVolumeHierarchy* tableTopHierarchy = this->Internal->GetActivePartHierarchy(TableTop);
+  vtkTriangleBoundingVolumeHierarchy* patientBodyHierarchy = this->Internal->GetPatientBodyHierarchy(parameterNode);
+
+  // The gantry rotates around an axis through the isocenter (origin of the gantry coordinate system), so rotating
+  // by an angle moves any point of the gantry and the collimator by at most the angle times this radius
+  double maximumRadius = 0.0;
+  double bounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  if (gantryHierarchy && gantryHierarchy->GetBounds(bounds))
+  {
+    maximumRadius = std::max(maximumRadius, GetMaximumDistanceFromOrigin(bounds));
+  }
+  if (collimatorHierarchy && collimatorHierarchy->GetTransformedBounds(collimatorToGantryMatrix, bounds))
+  {
+    maximumRadius = std::max(maximumRadius, GetMaximumDistanceFromOrigin(bounds));
+  }
+  if (maximumRadius <= 0.0)
+  {
+    // No rotating part to check
+    return true;
+  }
+
+  // Rotating part matrices are updated in place, the queries refer to them
+  vtkNew<vtkMatrix4x4> gantryToRasMatrix;
+  vtkNew<vtkMatrix4x4> collimatorToRasMatrix;
+  std::vector<PartPairClearanceQuery> queries;
+  PartPairClearanceQuery gantryTableTopQuery = { gantryHierarchy, gantryToRasMatrix, tableTopHierarchy, tableTopToRasTransform->GetMatrix(), -1.0 };
+  queries.push_back(gantryTableTopQuery);
+  PartPairClearanceQuery gantryPatientSupportQuery = { gantryHierarchy, gantryToRasMatrix, patientSupportHierarchy, patientSupportToRasTransform->GetMatrix(), -1.0 };
+  queries.push_back(gantryPatientSupportQuery);
+  PartPairClearanceQuery collimatorTableTopQuery = { collimatorHierarchy, collimatorToRasMatrix, tableTopHierarchy, tableTopToRasTransform->GetMatrix(), -1.0 };
+  queries.push_back(collimatorTableTopQuery);
+  PartPairClearanceQuery gantryPatientQuery = { gantryHierarchy, gantryToRasMatrix, patientBodyHierarchy, nullptr, -1.0 };
+  queries.push_back(gantryPatientQuery);
+  PartPairClearanceQuery collimatorPatientQuery = { collimatorHierarchy, collimatorToRasMatrix, patientBodyHierarchy, nullptr, -1.0 };
+  queries.push_back(collimatorPatientQuery);
+  PartPairClearanceFunctor clearanceFunctor(queries, contactDistance);
+
+  // Gantry rotation is computed by a separate IEC logic, so the transforms shown in the scene are not changed
+  vtkNew<vtkIECTransformLogic> arcIECLogic;
+  double direction = (stopGantryAngle >= startGantryAngle ? 1.0 : -1.0);
+  double gantryAngle = startGantryAngle;
+  while (true)
+  {
+    arcIECLogic->UpdateGantryToFixedReferenceTransform(gantryAngle);
+    vtkMatrix4x4::Multiply4x4(fixedReferenceToRasMatrix, arcIECLogic->GetElementaryTransformBetween(
+      vtkIECTransformLogic::Gantry, vtkIECTransformLogic::FixedReference)->GetMatrix(), gantryToRasMatrix);
+    vtkMatrix4x4::Multiply4x4(gantryToRasMatrix, collimatorToGantryMatrix, collimatorToRasMatrix);
+
+    vtkSMPTools::For(0, static_cast<vtkIdType>(queries.size()), clearanceFunctor);
+    double minimumDistance = VTK_DOUBLE_MAX;
+    for (const PartPairClearanceQuery& query : queries)
     {
-      this->GantryPatientCollisionDetection->SetInputData(1, patientBodyPolyData);
-      this->GantryPatientCollisionDetection->SetTransform(0, vtkLinearTransform::SafeDownCast(gantryToRasTransform));
-      this->GantryPatientCollisionDetection->Update();
-      if (this->GantryPatientCollisionDetection->GetNumberOfContacts() > 0)
+      if (query.Clearance >= 0.0)
       {
-        statusString = statusString + "Collision between gantry and patient\n";
+        minimumDistance = std::min(minimumDistance, query.Clearance);
       }
     }
+    if (minimumDistance == VTK_DOUBLE_MAX)
+    {
+      // There is nothing the rotating parts could collide with
+      return true;
+    }
+    if (minimumDistance < contactDistance)
+    {
+      contact = true;
+      firstContactGantryAngle = gantryAngle;
+      return true;
+    }
+    if (gantryAngle == stopGantryAngle)
+    {
+      return true;
+    }
 
-    if (collimatorState == "Active")
+    // Advance by the largest angle that cannot bring the parts closer than the contact distance. A longer step could
+    // skip over a contact, so if the safe step is too small then contact is reported at the current angle.
+    double stepAngle = vtkMath::DegreesFromRadians((minimumDistance - contactDistance) / maximumRadius);
+    if (direction * (stopGantryAngle - gantryAngle) <= stepAngle)
     {
-      this->CollimatorPatientCollisionDetection->SetInputData(1, patientBodyPolyData);
-      this->CollimatorPatientCollisionDetection->SetTransform(0, vtkLinearTransform::SafeDownCast(collimatorToRasTransform));
-      this->CollimatorPatientCollisionDetection->Update();
-      if (this->CollimatorPatientCollisionDetection->GetNumberOfContacts() > 0)
-      {
-        statusString = statusString + "Collision between collimator and patient\n";
-      }
+      gantryAngle = stopGantryAngle;
+    }
+    else if (stepAngle < MINIMUM_ARC_STEP_ANGLE)
+    {
+      contact = true;
+      firstContactGantryAngle = gantryAngle;
+      return true;
+    }
+    else
+    {
+      gantryAngle += direction * stepAngle;
     }
   }
+}
 
-  return statusString;
+//-----------------------------------------------------------------------------
+bool vtkSlicerRoomsEyeViewModuleLogic::CalculateCollisionMap(vtkMRMLRoomsEyeViewNode* parameterNode,
+  double gantryAngleStart, double gantryAngleStop, double gantryAngleStep,
+  double patientSupportAngleStart, double patientSupportAngleStop, double patientSupportAngleStep,
+  vtkMRMLScalarVolumeNode* collisionMapVolumeNode, vtkDoubleArray* tableTopDisplacements/*=nullptr*/)
+{
+  if (!parameterNode)
+  {
+    vtkErrorMacro("CalculateCollisionMap: Invalid parameter set node");
+    return false;
+  }
+  if (!collisionMapVolumeNode)
+  {
+    vtkErrorMacro("CalculateCollisionMap: Invalid output collision map volume node");
+    return false;
+  }
+  if ( gantryAngleStep <= 0.0 || gantryAngleStop < gantryAngleStart
+    || patientSupportAngleStep <= 0.0 || patientSupportAngleStop < patientSupportAngleStart )
+  {
+    vtkErrorMacro("CalculateCollisionMap: Invalid angle ranges, stop must not be less than start and step must be positive");
+    return false;
+  }
+  if (tableTopDisplacements && (tableTopDisplacements->GetNumberOfComponents() != 3 || tableTopDisplacements->GetNumberOfTuples() == 0))
+  {
+    vtkErrorMacro("CalculateCollisionMap: Table top displacements must be a non-empty array of lateral, longitudinal and vertical displacements");
+    return false;
+  }
+
+  // Get transforms that do not change between samples
+  vtkMRMLLinearTransformNode* fixedReferenceToRasTransformNode =
+    this->GetTransformNodeBetween(vtkIECTransformLogic::FixedReference, vtkIECTransformLogic::RAS);
+  vtkMRMLLinearTransformNode* collimatorToGantryTransformNode =
+    this->GetTransformNodeBetween(vtkIECTransformLogic::Collimator, vtkIECTransformLogic::Gantry);
+  vtkMRMLLinearTransformNode* tableTopEccentricRotationToPatientSupportRotationTransformNode =
+    this->GetTransformNodeBetween(vtkIECTransformLogic::TableTopEccentricRotation, vtkIECTransformLogic::PatientSupportRotation);
+  vtkMRMLLinearTransformNode* tableTopToTableTopEccentricRotationTransformNode =
+    this->GetTransformNodeBetween(vtkIECTransformLogic::TableTop, vtkIECTransformLogic::TableTopEccentricRotation);
+  if ( !fixedReferenceToRasTransformNode || !collimatorToGantryTransformNode
+    || !tableTopEccentricRotationToPatientSupportRotationTransformNode || !tableTopToTableTopEccentricRotationTransformNode )
+  {
+    vtkErrorMacro("CalculateCollisionMap: Failed to access IEC transforms");
+    return false;
+  }
+
+  // Reject grids that would not fit in an image or would take unreasonably long to compute
+  double numberOfGantryAngles = GetNumberOfSamples(gantryAngleStart, gantryAngleStop, gantryAngleStep);
+  double numberOfPatientSupportAngles = GetNumberOfSamples(patientSupportAngleStart, patientSupportAngleStop, patientSupportAngleStep);
+  vtkIdType numberOfTableTopPositions = (tableTopDisplacements ? tableTopDisplacements->GetNumberOfTuples() : 1);
+  if ( numberOfGantryAngles * numberOfPatientSupportAngles * numberOfTableTopPositions > MAXIMUM_NUMBER_OF_COLLISION_MAP_SAMPLES
+    || numberOfGantryAngles > VTK_INT_MAX || numberOfPatientSupportAngles > VTK_INT_MAX || numberOfTableTopPositions > VTK_INT_MAX )
+  {
+    vtkErrorMacro("CalculateCollisionMap: Collision map of " << numberOfGantryAngles << " x " << numberOfPatientSupportAngles
+      << " x " << numberOfTableTopPositions << " samples exceeds the maximum of " << MAXIMUM_NUMBER_OF_COLLISION_MAP_SAMPLES << " samples");
+    return false;
+  }
+
+  CollisionMapInput input;
+  input.NumberOfGantryAngles = static_cast<vtkIdType>(numberOfGantryAngles);
+  input.NumberOfPatientSupportAngles = static_cast<vtkIdType>(numberOfPatientSupportAngles);
+
+  vtkNew<vtkMatrix4x4> matrix;
+  fixedReferenceToRasTransformNode->GetMatrixTransformToWorld(matrix);
+  std::copy(matrix->GetData(), matrix->GetData() + 16, input.FixedReferenceToRasMatrix);
+  collimatorToGantryTransformNode->GetMatrixTransformToParent(matrix);
+  std::copy(matrix->GetData(), matrix->GetData() + 16, input.CollimatorToGantryMatrix);
+  tableTopEccentricRotationToPatientSupportRotationTransformNode->GetMatrixTransformToParent(matrix);
+  std::copy(matrix->GetData(), matrix->GetData() + 16, input.TableTopEccentricRotationToPatientSupportRotationMatrix);
+
+  // Rotation matrices are computed by a separate IEC logic, so the transforms shown in the scene are not changed
+  vtkNew<vtkIECTransformLogic> samplingIECLogic;
+  for (vtkIdType gantryIndex = 0; gantryIndex < input.NumberOfGantryAngles; ++gantryIndex)
+  {
+    samplingIECLogic->UpdateGantryToFixedReferenceTransform(gantryAngleStart + gantryIndex * gantryAngleStep);
+    AppendMatrixElements(samplingIECLogic->GetElementaryTransformBetween(
+      vtkIECTransformLogic::Gantry, vtkIECTransformLogic::FixedReference)->GetMatrix(), input.GantryToFixedReferenceMatrices);
+  }
+  for (vtkIdType patientSupportIndex = 0; patientSupportIndex < input.NumberOfPatientSupportAngles; ++patientSupportIndex)
+  {
+    samplingIECLogic->UpdatePatientSupportRotationToFixedReferenceTransform(
+      patientSupportAngleStart + patientSupportIndex * patientSupportAngleStep);
+    AppendMatrixElements(samplingIECLogic->GetElementaryTransformBetween(
+      vtkIECTransformLogic::PatientSupportRotation, vtkIECTransformLogic::FixedReference)->GetMatrix(),
+      input.PatientSupportRotationToFixedReferenceMatrices);
+  }
+
+  // Table top translation and the matching patient support scaling for each table top position
+  vtkNew<vtkTransform> patientSupportScalingTransform;
+  for (vtkIdType tableTopIndex = 0; tableTopIndex < numberOfTableTopPositions; ++tableTopIndex)
+  {
+    double displacement[3] = { parameterNode->GetLateralTableTopDisplacement(),
+      parameterNode->GetLongitudinalTableTopDisplacement(), parameterNode->GetVerticalTableTopDisplacement() };
+    if (tableTopDisplacements)
+    {
+      tableTopDisplacements->GetTuple(tableTopIndex, displacement);
+    }
+    if (!this->Internal->GetPatientSupportScalingTransform(parameterNode, displacement[2], patientSupportScalingTransform))
+    {
+      vtkErrorMacro("CalculateCollisionMap: Failed to access treatment machine part models");
+      return false;
+    }
+    AppendMatrixElements(patientSupportScalingTransform->GetMatrix(), input.PatientSupportToPatientSupportRotationMatrices);
+
+    vtkNew<vtkMatrix4x4> tableTopTranslationMatrix;
+    tableTopTranslationMatrix->SetElement(0, 3, displacement[0]);
+    tableTopTranslationMatrix->SetElement(1, 3, displacement[1]);
+    tableTopTranslationMatrix->SetElement(2, 3, displacement[2]);
+    AppendMatrixElements(tableTopTranslationMatrix, input.TableTopToTableTopEccentricRotationMatrices);
+  }
+
+  // Only active parts are tested, same as in CheckForCollisions
+  input.CollimatorHierarchy = this->Internal->GetActivePartHierarchy(Collimator);
+  input.GantryHierarchy = this->Internal->GetActivePartHierarchy(Gantry);
+  input.PatientSupportHierarchy = this->Internal->GetActivePartHierarchy(PatientSupport);
+  input.TableTopHierarchy = this->Internal->GetActivePartHierarchy(TableTop);
+
+  // The patient body hierarchy is in RAS at the current table top pose. If the body segmentation is
+  // under the table top in the transform hierarchy, then it is moved along with the table top.
+  input.PatientBodyHierarchy = this->Internal->GetPatientBodyHierarchy(parameterNode);
+  input.PatientBodyFollowsTableTop = false;
+  vtkMRMLSegmentationNode* patientBodySegmentationNode = parameterNode->GetPatientBodySegmentationNode();
+  for (vtkMRMLTransformNode* transformNode = (patientBodySegmentationNode ? patientBodySegmentationNode->GetParentTransformNode() : nullptr);
+    transformNode; transformNode = transformNode->GetParentTransformNode())
+  {
+    if (transformNode == tableTopToTableTopEccentricRotationTransformNode)
+    {
+      input.PatientBodyFollowsTableTop = true;
+      break;
+    }
+  }
+  tableTopToTableTopEccentricRotationTransformNode->GetMatrixTransformToWorld(matrix);
+  matrix->Invert();
+  std::copy(matrix->GetData(), matrix->GetData() + 16, input.RasToCurrentTableTopMatrix);
+
+  // Test all samples concurrently
+  vtkNew<vtkImageData> collisionMapImageData;
+  collisionMapImageData->SetDimensions(static_cast<int>(input.NumberOfGantryAngles),
+    static_cast<int>(input.NumberOfPatientSupportAngles), static_cast<int>(numberOfTableTopPositions));
+  collisionMapImageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  unsigned char* collisionFlags = static_cast<unsigned char*>(collisionMapImageData->GetScalarPointer());
+  CollisionMapFunctor collisionMapFunctor(input, collisionFlags);
+  vtkSMPTools::For(0, input.NumberOfGantryAngles * input.NumberOfPatientSupportAngles * numberOfTableTopPositions, collisionMapFunctor);
+
+  // Voxel coordinates are the gantry and patient support angles and the table top position index
+  collisionMapVolumeNode->SetOrigin(gantryAngleStart, patientSupportAngleStart, 0.0);
+  collisionMapVolumeNode->SetSpacing(gantryAngleStep, patientSupportAngleStep, 1.0);
+  collisionMapVolumeNode->SetAndObserveImageData(collisionMapImageData);
+  return true;
 }
 
 //---------------------------------------------------------------------------
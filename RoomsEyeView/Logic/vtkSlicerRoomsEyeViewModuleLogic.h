@@ -39,13 +39,14 @@
 // IEC Logic include
 #include <vtkIECTransformLogic.h>
 
-class vtkCollisionDetectionFilter;
+class vtkDoubleArray;
 class vtkMatrix4x4;
 class vtkPolyData;
 class vtkVector3d;
 
 class vtkMRMLRoomsEyeViewNode;
 class vtkMRMLModelNode;
+class vtkMRMLScalarVolumeNode;
 
 /// \ingroup SlicerRt_QtModules_RoomsEyeView
 class VTK_SLICER_ROOMSEYEVIEW_LOGIC_EXPORT vtkSlicerRoomsEyeViewModuleLogic : public vtkSlicerModuleLogic
@@ -68,9 +69,19 @@ public:
     LastPartType
     }; 
 
+  /// Bits of the collision map voxel values, one for each tested part pair
+  /// \sa CalculateCollisionMap()
+  enum CollisionMapFlag
+    {
+    GantryTableTopCollision = 1,
+    GantryPatientSupportCollision = 2,
+    CollimatorTableTopCollision = 4,
+    GantryPatientCollision = 8,
+    CollimatorPatientCollision = 16
+    };
+
   static const char* ORIENTATION_MARKER_MODEL_NODE_NAME;
   static const char* TREATMENT_MACHINE_DESCRIPTOR_FILE_PATH_ATTRIBUTE_NAME;
-  static unsigned int MAX_TRIANGLE_NUMBER_PRODUCT_FOR_COLLISIONS;
 
 public:
   static vtkSlicerRoomsEyeViewModuleLogic *New();
@@ -83,11 +94,9 @@ public:
   /// \return List of parts that were successfully set up.
   std::vector<TreatmentMachinePartType> LoadTreatmentMachine(vtkMRMLRoomsEyeViewNode* parameterNode);
   /// Set up the IEC transforms and model properties on the treatment machine models.
-  /// \param forceEnableCollisionDetection Enable collision detection between parts even if calculation is potentially
-  ///        lengthy absed on the number of triangles of the parts.
+  /// Bounding volume hierarchies used for collision detection are built for the parts here, once per loaded machine.
   /// \return List of parts that were successfully set up.
-  std::vector<TreatmentMachinePartType> SetupTreatmentMachineModels(
-    vtkMRMLRoomsEyeViewNode* parameterNode, bool forceEnableCollisionDetection=false);
+  std::vector<TreatmentMachinePartType> SetupTreatmentMachineModels(vtkMRMLRoomsEyeViewNode* parameterNode);
   /// Create or get transforms taking part in the IEC logic and additional devices, and build the transform hierarchy
   void BuildRoomsEyeViewTransformHierarchy();
 
@@ -119,10 +128,50 @@ public:
   /// Update orientation marker based on the current transforms
   vtkMRMLModelNode* UpdateTreatmentOrientationMarker(vtkMRMLRoomsEyeViewNode* parameterNode);
 
-  /// Check for collisions between pieces of linac model using vtkCollisionDetectionFilter
+  /// Check for collisions between pieces of linac model and the patient body.
+  /// Part pairs whose transformed bounding boxes do not overlap are skipped, the remaining pairs are tested
+  /// concurrently using the bounding volume hierarchies of the parts.
   /// \return string indicating whether collision occurred
   std::string CheckForCollisions(vtkMRMLRoomsEyeViewNode* parameterNode);
 
+  /// Calculate minimum distances between the part pairs checked for collisions, and store them in the parameter node.
+  /// The part pairs are processed concurrently. Each distance query skips box pairs that cannot be closer than the
+  /// closest triangles found so far, and stops as soon as a distance below the clearance threshold of the parameter node is found.
+  /// \return Success flag
+  bool CalculateClearances(vtkMRMLRoomsEyeViewNode* parameterNode);
+
+  /// Continuous collision check of the gantry and the collimator rotating along an arc, with the patient support,
+  /// table top and collimator in their current pose. Uses conservative advancement: at each gantry angle the minimum
+  /// distance to the other parts and the patient is computed, and the gantry is rotated by the largest angle
+  /// that cannot bring any point of the rotating parts closer than the contact distance. If that angle is less than
+  /// 0.1 degrees then contact is reported. Thus no contact is missed, and the reported first contact angle is never past
+  /// the actual one, but parts that come within the distance the rotating parts move in 0.1 degrees may be reported as well.
+  /// \param startGantryAngle Gantry angle at the start of the arc (degrees)
+  /// \param stopGantryAngle Gantry angle at the end of the arc (degrees). It is less than the start angle for arcs of
+  ///   decreasing angle, and may be out of the [0,360] range for arcs crossing 0 degrees.
+  /// \param contact Output flag, true if the gantry or the collimator comes in contact with another part or the patient along the arc
+  /// \param firstContactGantryAngle Output gantry angle of the first contact along the arc. Only set if there is contact.
+  ///   It is at or before the angle where the parts first come closer than the contact distance.
+  /// \param contactDistance Parts closer than this (mm) are considered to be in contact
+  /// \return Success flag
+  bool CheckForCollisionsAlongArc(vtkMRMLRoomsEyeViewNode* parameterNode, double startGantryAngle, double stopGantryAngle,
+    bool& contact, double& firstContactGantryAngle, double contactDistance=1.0);
+
+  /// Calculate collision map over a grid of gantry and patient support rotation angles, and optionally table top positions.
+  /// Part poses are computed from the IEC transforms directly without updating the transform nodes, and the grid samples
+  /// are tested concurrently. The collimator angle is the current one in the parameter node.
+  /// If the patient body segmentation is under the table top in the transform hierarchy, then it moves with the table top.
+  /// \param tableTopDisplacements Lateral, longitudinal and vertical table top displacements (3 components), one map slice
+  ///   for each tuple. If nullptr, the current displacements in the parameter node are used and the map has one slice.
+  /// \param collisionMapVolumeNode Output volume. Its axes are gantry angle, patient support angle and table top position
+  ///   index, so the IJK to RAS transform maps voxel indices to angles. Voxel values are combinations of CollisionMapFlag
+  ///   bits, zero means that the pose is free of collisions.
+  /// \return Success flag. Fails without computing anything if the grid has more than 20 million samples.
+  bool CalculateCollisionMap(vtkMRMLRoomsEyeViewNode* parameterNode,
+    double gantryAngleStart, double gantryAngleStop, double gantryAngleStep,
+    double patientSupportAngleStart, double patientSupportAngleStop, double patientSupportAngleStep,
+    vtkMRMLScalarVolumeNode* collisionMapVolumeNode, vtkDoubleArray* tableTopDisplacements=nullptr);
+
 // Get treatment machine properties from descriptor file
 public:
   /// Get part name for part type in the currently loaded treatment machine description
@@ -149,12 +198,6 @@ public:
   /// Possibility to set Beams logic externally. This allows automated tests to run, when we do not have the whole application
   vtkSetObjectMacro(BeamsLogic, vtkSlicerBeamsModuleLogic);
 
-  vtkGetObjectMacro(GantryPatientCollisionDetection, vtkCollisionDetectionFilter);
-  vtkGetObjectMacro(GantryTableTopCollisionDetection, vtkCollisionDetectionFilter);
-  vtkGetObjectMacro(GantryPatientSupportCollisionDetection, vtkCollisionDetectionFilter);
-  vtkGetObjectMacro(CollimatorPatientCollisionDetection, vtkCollisionDetectionFilter);
-  vtkGetObjectMacro(CollimatorTableTopCollisionDetection, vtkCollisionDetectionFilter);
-
 public:
   /// Get transform node between two coordinate systems is exists
   /// \param fromFrame - start transformation from frame
@@ -175,13 +218,6 @@ protected:
   vtkIECTransformLogic* IECLogic;
   vtkSlicerBeamsModuleLogic* BeamsLogic{nullptr};
 
-  vtkCollisionDetectionFilter* GantryPatientCollisionDetection;
-  vtkCollisionDetectionFilter* GantryTableTopCollisionDetection;
-  vtkCollisionDetectionFilter* GantryPatientSupportCollisionDetection;
-
-  vtkCollisionDetectionFilter* CollimatorPatientCollisionDetection;
-  vtkCollisionDetectionFilter* CollimatorTableTopCollisionDetection;
-
 protected:
   vtkSlicerRoomsEyeViewModuleLogic();
   ~vtkSlicerRoomsEyeViewModuleLogic() override;
@@ -0,0 +1,776 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// RoomsEyeView includes
+#include "vtkTriangleBoundingVolumeHierarchy.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+#include <vtkTriangleFilter.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+/// Leaves are not split further if they contain at most this many triangles
+const vtkIdType MAX_TRIANGLES_PER_LEAF = 4;
+
+/// Node of the hierarchy. Leaf nodes have triangles, inner nodes have two consecutive children.
+struct BoxNode
+{
+  double Bounds[6];
+  vtkIdType FirstChild;
+  vtkIdType FirstTriangle;
+  vtkIdType NumberOfTriangles;
+};
+
+/// Apply the affine part of a row-major 4x4 matrix to a point
+inline void TransformPoint(const double matrix[16], const double point[3], double transformedPoint[3])
+{
+  for (int row = 0; row < 3; ++row)
+  {
+    transformedPoint[row] = matrix[4 * row] * point[0] + matrix[4 * row + 1] * point[1]
+      + matrix[4 * row + 2] * point[2] + matrix[4 * row + 3];
+  }
+}
+
+/// Axis aligned bounds of a box transformed by a row-major 4x4 matrix (Arvo's method).
+/// The result contains the transformed box for any affine matrix.
+inline void TransformBounds(const double matrix[16], const double bounds[6], double transformedBounds[6])
+{
+  double center[3] = { 0.5 * (bounds[0] + bounds[1]), 0.5 * (bounds[2] + bounds[3]), 0.5 * (bounds[4] + bounds[5]) };
+  double halfSize[3] = { 0.5 * (bounds[1] - bounds[0]), 0.5 * (bounds[3] - bounds[2]), 0.5 * (bounds[5] - bounds[4]) };
+  double transformedCenter[3] = { 0.0, 0.0, 0.0 };
+  TransformPoint(matrix, center, transformedCenter);
+  for (int row = 0; row < 3; ++row)
+  {
+    double transformedHalfSize = std::fabs(matrix[4 * row]) * halfSize[0]
+      + std::fabs(matrix[4 * row + 1]) * halfSize[1] + std::fabs(matrix[4 * row + 2]) * halfSize[2];
+    transformedBounds[2 * row] = transformedCenter[row] - transformedHalfSize;
+    transformedBounds[2 * row + 1] = transformedCenter[row] + transformedHalfSize;
+  }
+}
+
+inline bool BoundsOverlap(const double bounds1[6], const double bounds2[6])
+{
+  return bounds1[0] <= bounds2[1] && bounds2[0] <= bounds1[1]
+    && bounds1[2] <= bounds2[3] && bounds2[2] <= bounds1[3]
+    && bounds1[4] <= bounds2[5] && bounds2[4] <= bounds1[5];
+}
+
+/// Two boxes given in different coordinate systems can only overlap if each overlaps the bounds of the other
+/// transformed into its own coordinate system.
+/// \param matrix21 Transform from the coordinate system of the second box to that of the first
+/// \param matrix12 Inverse of matrix21
+inline bool BoxesOverlap(const double bounds1[6], const double bounds2[6], const double matrix21[16], const double matrix12[16])
+{
+  double transformedBounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  TransformBounds(matrix21, bounds2, transformedBounds);
+  if (!BoundsOverlap(bounds1, transformedBounds))
+  {
+    return false;
+  }
+  TransformBounds(matrix12, bounds1, transformedBounds);
+  return BoundsOverlap(bounds2, transformedBounds);
+}
+
+inline double BoundsVolume(const double bounds[6])
+{
+  return (bounds[1] - bounds[0]) * (bounds[3] - bounds[2]) * (bounds[5] - bounds[4]);
+}
+
+/// Determine whether segment pq crosses triangle (v0,v1,v2) (Moller-Trumbore)
+inline bool SegmentIntersectsTriangle(const double p[3], const double q[3], const double v0[3], const double v1[3], const double v2[3])
+{
+  double direction[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] };
+  double edge1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+  double edge2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+  double pvec[3] = { direction[1] * edge2[2] - direction[2] * edge2[1],
+    direction[2] * edge2[0] - direction[0] * edge2[2], direction[0] * edge2[1] - direction[1] * edge2[0] };
+  double determinant = edge1[0] * pvec[0] + edge1[1] * pvec[1] + edge1[2] * pvec[2];
+  if (std::fabs(determinant) < 1e-12)
+  {
+    // Segment is parallel to the triangle plane
+    return false;
+  }
+  double inverseDeterminant = 1.0 / determinant;
+  double tvec[3] = { p[0] - v0[0], p[1] - v0[1], p[2] - v0[2] };
+  double u = (tvec[0] * pvec[0] + tvec[1] * pvec[1] + tvec[2] * pvec[2]) * inverseDeterminant;
+  if (u < 0.0 || u > 1.0)
+  {
+    return false;
+  }
+  double qvec[3] = { tvec[1] * edge1[2] - tvec[2] * edge1[1],
+    tvec[2] * edge1[0] - tvec[0] * edge1[2], tvec[0] * edge1[1] - tvec[1] * edge1[0] };
+  double v = (direction[0] * qvec[0] + direction[1] * qvec[1] + direction[2] * qvec[2]) * inverseDeterminant;
+  if (v < 0.0 || u + v > 1.0)
+  {
+    return false;
+  }
+  double t = (edge2[0] * qvec[0] + edge2[1] * qvec[1] + edge2[2] * qvec[2]) * inverseDeterminant;
+  return t >= 0.0 && t <= 1.0;
+}
+
+/// Two triangles (9 coordinates each) intersect if an edge of one crosses the other.
+/// Coplanar triangles that only touch are not reported as contact.
+inline bool TrianglesIntersect(const double* triangle1, const double* triangle2)
+{
+  for (int edge = 0; edge < 3; ++edge)
+  {
+    const double* start = triangle1 + 3 * edge;
+    const double* end = triangle1 + 3 * ((edge + 1) % 3);
+    if (SegmentIntersectsTriangle(start, end, triangle2, triangle2 + 3, triangle2 + 6))
+    {
+      return true;
+    }
+  }
+  for (int edge = 0; edge < 3; ++edge)
+  {
+    const double* start = triangle2 + 3 * edge;
+    const double* end = triangle2 + 3 * ((edge + 1) % 3);
+    if (SegmentIntersectsTriangle(start, end, triangle1, triangle1 + 3, triangle1 + 6))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Squared distance between two axis aligned boxes, zero if they overlap
+inline double BoundsDistance2(const double bounds1[6], const double bounds2[6])
+{
+  double distance2 = 0.0;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    double gap = std::max(bounds1[2 * axis] - bounds2[2 * axis + 1], bounds2[2 * axis] - bounds1[2 * axis + 1]);
+    if (gap > 0.0)
+    {
+      distance2 += gap * gap;
+    }
+  }
+  return distance2;
+}
+
+inline double Dot(const double a[3], const double b[3])
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline double Distance2(const double a[3], const double b[3])
+{
+  double difference[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+  return Dot(difference, difference);
+}
+
+inline double Clamp01(double value)
+{
+  return std::min(1.0, std::max(0.0, value));
+}
+
+/// Squared distance between segments p1q1 and p2q2 (Ericson: Real-Time Collision Detection, 5.1.9)
+inline double SegmentSegmentDistance2(const double p1[3], const double q1[3], const double p2[3], const double q2[3])
+{
+  double d1[3] = { q1[0] - p1[0], q1[1] - p1[1], q1[2] - p1[2] };
+  double d2[3] = { q2[0] - p2[0], q2[1] - p2[1], q2[2] - p2[2] };
+  double r[3] = { p1[0] - p2[0], p1[1] - p2[1], p1[2] - p2[2] };
+  double a = Dot(d1, d1);
+  double e = Dot(d2, d2);
+  double f = Dot(d2, r);
+  double s = 0.0;
+  double t = 0.0;
+  if (a <= 1e-12 && e <= 1e-12)
+  {
+    return Dot(r, r);
+  }
+  if (a <= 1e-12)
+  {
+    t = Clamp01(f / e);
+  }
+  else
+  {
+    double c = Dot(d1, r);
+    if (e <= 1e-12)
+    {
+      s = Clamp01(-c / a);
+    }
+    else
+    {
+      double b = Dot(d1, d2);
+      double denominator = a * e - b * b;
+      s = (denominator > 1e-12 ? Clamp01((b * f - c * e) / denominator) : 0.0);
+      t = (b * s + f) / e;
+      if (t < 0.0)
+      {
+        t = 0.0;
+        s = Clamp01(-c / a);
+      }
+      else if (t > 1.0)
+      {
+        t = 1.0;
+        s = Clamp01((b - c) / a);
+      }
+    }
+  }
+  double closest1[3] = { p1[0] + d1[0] * s, p1[1] + d1[1] * s, p1[2] + d1[2] * s };
+  double closest2[3] = { p2[0] + d2[0] * t, p2[1] + d2[1] * t, p2[2] + d2[2] * t };
+  return Distance2(closest1, closest2);
+}
+
+/// Squared distance between point p and triangle (a,b,c) (Ericson: Real-Time Collision Detection, 5.1.5)
+inline double PointTriangleDistance2(const double p[3], const double a[3], const double b[3], const double c[3])
+{
+  double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+  double ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+  double ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+  double d1 = Dot(ab, ap);
+  double d2 = Dot(ac, ap);
+  if (d1 <= 0.0 && d2 <= 0.0)
+  {
+    return Distance2(p, a);
+  }
+  double bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+  double d3 = Dot(ab, bp);
+  double d4 = Dot(ac, bp);
+  if (d3 >= 0.0 && d4 <= d3)
+  {
+    return Distance2(p, b);
+  }
+  double closest[3] = { 0.0, 0.0, 0.0 };
+  double vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+  {
+    double v = d1 / (d1 - d3);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      closest[axis] = a[axis] + v * ab[axis];
+    }
+    return Distance2(p, closest);
+  }
+  double cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+  double d5 = Dot(ab, cp);
+  double d6 = Dot(ac, cp);
+  if (d6 >= 0.0 && d5 <= d6)
+  {
+    return Distance2(p, c);
+  }
+  double vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+  {
+    double w = d2 / (d2 - d6);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      closest[axis] = a[axis] + w * ac[axis];
+    }
+    return Distance2(p, closest);
+  }
+  double va = d3 * d6 - d5 * d4;
+  if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+  {
+    double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      closest[axis] = b[axis] + w * (c[axis] - b[axis]);
+    }
+    return Distance2(p, closest);
+  }
+  double denominator = va + vb + vc;
+  if (std::fabs(denominator) < 1e-24)
+  {
+    // Degenerate triangle, its edges are checked separately
+    return std::numeric_limits<double>::max();
+  }
+  double v = vb / denominator;
+  double w = vc / denominator;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    closest[axis] = a[axis] + ab[axis] * v + ac[axis] * w;
+  }
+  return Distance2(p, closest);
+}
+
+/// Squared distance between two triangles (9 coordinates each), zero if they intersect.
+/// For disjoint triangles the closest points are on two edges or on a vertex and the other triangle.
+inline double TriangleDistance2(const double* triangle1, const double* triangle2)
+{
+  if (TrianglesIntersect(triangle1, triangle2))
+  {
+    return 0.0;
+  }
+  double distance2 = std::numeric_limits<double>::max();
+  for (int edge1 = 0; edge1 < 3; ++edge1)
+  {
+    for (int edge2 = 0; edge2 < 3; ++edge2)
+    {
+      distance2 = std::min(distance2, SegmentSegmentDistance2(triangle1 + 3 * edge1, triangle1 + 3 * ((edge1 + 1) % 3),
+        triangle2 + 3 * edge2, triangle2 + 3 * ((edge2 + 1) % 3)));
+    }
+  }
+  for (int vertex = 0; vertex < 3; ++vertex)
+  {
+    distance2 = std::min(distance2, PointTriangleDistance2(triangle1 + 3 * vertex, triangle2, triangle2 + 3, triangle2 + 6));
+    distance2 = std::min(distance2, PointTriangleDistance2(triangle2 + 3 * vertex, triangle1, triangle1 + 3, triangle1 + 6));
+  }
+  return distance2;
+}
+
+/// Get row-major elements of a matrix, identity if nullptr
+void GetMatrixElements(vtkMatrix4x4* matrix, double elements[16])
+{
+  if (matrix)
+  {
+    std::copy(matrix->GetData(), matrix->GetData() + 16, elements);
+  }
+  else
+  {
+    vtkMatrix4x4::Identity(elements);
+  }
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+class vtkTriangleBoundingVolumeHierarchy::vtkInternal
+{
+public:
+  /// Build the tree from the triangle coordinates. Triangles are reordered so that each leaf has a contiguous range.
+  void BuildTree();
+
+  /// Relative transforms between the coordinate systems of two hierarchies
+  /// \param matrix21 Output transform from the second hierarchy to the first
+  /// \param matrix12 Output transform from the first hierarchy to the second
+  static void GetRelativeTransforms(const double matrix1[16], const double matrix2[16], double matrix21[16], double matrix12[16]);
+
+public:
+  std::vector<BoxNode> Nodes;
+  /// Triangle vertex coordinates, 9 values for each triangle
+  std::vector<double> Triangles;
+};
+
+//----------------------------------------------------------------------------
+void vtkTriangleBoundingVolumeHierarchy::vtkInternal::BuildTree()
+{
+  this->Nodes.clear();
+  vtkIdType numberOfTriangles = static_cast<vtkIdType>(this->Triangles.size() / 9);
+  if (numberOfTriangles == 0)
+  {
+    return;
+  }
+
+  std::vector<double> centroids(3 * numberOfTriangles);
+  for (vtkIdType triangle = 0; triangle < numberOfTriangles; ++triangle)
+  {
+    const double* vertices = &this->Triangles[9 * triangle];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      centroids[3 * triangle + axis] = (vertices[axis] + vertices[3 + axis] + vertices[6 + axis]) / 3.0;
+    }
+  }
+  std::vector<vtkIdType> order(numberOfTriangles);
+  for (vtkIdType triangle = 0; triangle < numberOfTriangles; ++triangle)
+  {
+    order[triangle] = triangle;
+  }
+
+  BoxNode root = { { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }, -1, 0, numberOfTriangles };
+  this->Nodes.push_back(root);
+
+  // Split nodes at the median triangle centroid along the longest axis of the centroids
+  std::vector<vtkIdType> nodesToProcess(1, 0);
+  while (!nodesToProcess.empty())
+  {
+    vtkIdType nodeIndex = nodesToProcess.back();
+    nodesToProcess.pop_back();
+    vtkIdType first = this->Nodes[nodeIndex].FirstTriangle;
+    vtkIdType count = this->Nodes[nodeIndex].NumberOfTriangles;
+
+    double* bounds = this->Nodes[nodeIndex].Bounds;
+    double centroidBounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      bounds[2 * axis] = centroidBounds[2 * axis] = std::numeric_limits<double>::max();
+      bounds[2 * axis + 1] = centroidBounds[2 * axis + 1] = std::numeric_limits<double>::lowest();
+    }
+    for (vtkIdType index = first; index < first + count; ++index)
+    {
+      const double* vertices = &this->Triangles[9 * order[index]];
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        for (int vertex = 0; vertex < 3; ++vertex)
+        {
+          bounds[2 * axis] = std::min(bounds[2 * axis], vertices[3 * vertex + axis]);
+          bounds[2 * axis + 1] = std::max(bounds[2 * axis + 1], vertices[3 * vertex + axis]);
+        }
+        centroidBounds[2 * axis] = std::min(centroidBounds[2 * axis], centroids[3 * order[index] + axis]);
+        centroidBounds[2 * axis + 1] = std::max(centroidBounds[2 * axis + 1], centroids[3 * order[index] + axis]);
+      }
+    }
+    if (count <= MAX_TRIANGLES_PER_LEAF)
+    {
+      continue;
+    }
+
+    int splitAxis = 0;
+    for (int axis = 1; axis < 3; ++axis)
+    {
+      if (centroidBounds[2 * axis + 1] - centroidBounds[2 * axis] > centroidBounds[2 * splitAxis + 1] - centroidBounds[2 * splitAxis])
+      {
+        splitAxis = axis;
+      }
+    }
+    vtkIdType half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+      [&centroids, splitAxis](vtkIdType a, vtkIdType b) { return centroids[3 * a + splitAxis] < centroids[3 * b + splitAxis]; });
+
+    vtkIdType firstChild = static_cast<vtkIdType>(this->Nodes.size());
+    BoxNode leftChild = { { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }, -1, first, half };
+    BoxNode rightChild = { { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }, -1, first + half, count - half };
+    this->Nodes.push_back(leftChild);
+    this->Nodes.push_back(rightChild);
+    this->Nodes[nodeIndex].FirstChild = firstChild;
+    this->Nodes[nodeIndex].NumberOfTriangles = 0;
+    nodesToProcess.push_back(firstChild);
+    nodesToProcess.push_back(firstChild + 1);
+  }
+
+  // Store triangles in leaf order
+  std::vector<double> orderedTriangles(this->Triangles.size());
+  for (vtkIdType index = 0; index < numberOfTriangles; ++index)
+  {
+    std::copy(this->Triangles.begin() + 9 * order[index], this->Triangles.begin() + 9 * (order[index] + 1),
+      orderedTriangles.begin() + 9 * index);
+  }
+  this->Triangles.swap(orderedTriangles);
+}
+
+//----------------------------------------------------------------------------
+void vtkTriangleBoundingVolumeHierarchy::vtkInternal::GetRelativeTransforms(
+  const double matrix1[16], const double matrix2[16], double matrix21[16], double matrix12[16])
+{
+  double inverse1[16] = { 0.0 };
+  vtkMatrix4x4::Invert(matrix1, inverse1);
+  vtkMatrix4x4::Multiply4x4(inverse1, matrix2, matrix21);
+  vtkMatrix4x4::Invert(matrix21, matrix12);
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTriangleBoundingVolumeHierarchy);
+
+//----------------------------------------------------------------------------
+vtkTriangleBoundingVolumeHierarchy::vtkTriangleBoundingVolumeHierarchy()
+{
+  this->Internal = new vtkInternal();
+}
+
+//----------------------------------------------------------------------------
+vtkTriangleBoundingVolumeHierarchy::~vtkTriangleBoundingVolumeHierarchy()
+{
+  delete this->Internal;
+  this->Internal = nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkTriangleBoundingVolumeHierarchy::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfTriangles: " << this->GetNumberOfTriangles() << "\n";
+  os << indent << "NumberOfNodes: " << this->Internal->Nodes.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkTriangleBoundingVolumeHierarchy::Initialize()
+{
+  this->Internal->Nodes.clear();
+  this->Internal->Triangles.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTriangleBoundingVolumeHierarchy::Build(vtkPolyData* polyData)
+{
+  this->Internal->Nodes.clear();
+  this->Internal->Triangles.clear();
+  if (!polyData)
+  {
+    vtkErrorMacro("Build: Invalid poly data");
+    this->Modified();
+    return;
+  }
+
+  vtkNew<vtkTriangleFilter> triangleFilter;
+  triangleFilter->SetInputData(polyData);
+  triangleFilter->PassVertsOff();
+  triangleFilter->PassLinesOff();
+  triangleFilter->Update();
+  vtkPolyData* triangles = triangleFilter->GetOutput();
+
+  this->Internal->Triangles.reserve(9 * triangles->GetNumberOfPolys());
+  vtkCellArray* polys = triangles->GetPolys();
+  vtkNew<vtkIdList> pointIds;
+  double point[3] = { 0.0, 0.0, 0.0 };
+  polys->InitTraversal();
+  while (polys->GetNextCell(pointIds))
+  {
+    if (pointIds->GetNumberOfIds() != 3)
+    {
+      continue;
+    }
+    for (vtkIdType vertex = 0; vertex < 3; ++vertex)
+    {
+      triangles->GetPoint(pointIds->GetId(vertex), point);
+      this->Internal->Triangles.insert(this->Internal->Triangles.end(), point, point + 3);
+    }
+  }
+
+  this->Internal->BuildTree();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkTriangleBoundingVolumeHierarchy::GetNumberOfTriangles()
+{
+  return static_cast<vtkIdType>(this->Internal->Triangles.size() / 9);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTriangleBoundingVolumeHierarchy::GetBounds(double bounds[6])
+{
+  if (this->Internal->Nodes.empty())
+  {
+    return false;
+  }
+  std::copy(this->Internal->Nodes[0].Bounds, this->Internal->Nodes[0].Bounds + 6, bounds);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTriangleBoundingVolumeHierarchy::GetTransformedBounds(vtkMatrix4x4* matrix, double bounds[6])
+{
+  double elements[16] = { 0.0 };
+  GetMatrixElements(matrix, elements);
+  return this->GetTransformedBounds(elements, bounds);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTriangleBoundingVolumeHierarchy::GetTransformedBounds(const double matrixElements[16], double bounds[6])
+{
+  if (this->Internal->Nodes.empty())
+  {
+    return false;
+  }
+  TransformBounds(matrixElements, this->Internal->Nodes[0].Bounds, bounds);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTriangleBoundingVolumeHierarchy::Intersect(vtkTriangleBoundingVolumeHierarchy* hierarchy1, vtkMatrix4x4* matrix1,
+  vtkTriangleBoundingVolumeHierarchy* hierarchy2, vtkMatrix4x4* matrix2)
+{
+  double elements1[16] = { 0.0 };
+  double elements2[16] = { 0.0 };
+  GetMatrixElements(matrix1, elements1);
+  GetMatrixElements(matrix2, elements2);
+  return vtkTriangleBoundingVolumeHierarchy::Intersect(hierarchy1, elements1, hierarchy2, elements2);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTriangleBoundingVolumeHierarchy::Intersect(vtkTriangleBoundingVolumeHierarchy* hierarchy1, const double matrixElements1[16],
+  vtkTriangleBoundingVolumeHierarchy* hierarchy2, const double matrixElements2[16])
+{
+  if (!hierarchy1 || !hierarchy2 || hierarchy1->Internal->Nodes.empty() || hierarchy2->Internal->Nodes.empty())
+  {
+    return false;
+  }
+  const std::vector<BoxNode>& nodes1 = hierarchy1->Internal->Nodes;
+  const std::vector<BoxNode>& nodes2 = hierarchy2->Internal->Nodes;
+  const std::vector<double>& triangles1 = hierarchy1->Internal->Triangles;
+  const std::vector<double>& triangles2 = hierarchy2->Internal->Triangles;
+
+  // All tests are performed in the coordinate system of the first hierarchy
+  double matrix21[16] = { 0.0 };
+  double matrix12[16] = { 0.0 };
+  vtkInternal::GetRelativeTransforms(matrixElements1, matrixElements2, matrix21, matrix12);
+
+  std::vector< std::pair<vtkIdType, vtkIdType> > nodePairs(1, std::make_pair(0, 0));
+  double transformedTriangle[9] = { 0.0 };
+  while (!nodePairs.empty())
+  {
+    std::pair<vtkIdType, vtkIdType> nodePair = nodePairs.back();
+    nodePairs.pop_back();
+    const BoxNode& node1 = nodes1[nodePair.first];
+    const BoxNode& node2 = nodes2[nodePair.second];
+    if (!BoxesOverlap(node1.Bounds, node2.Bounds, matrix21, matrix12))
+    {
+      continue;
+    }
+
+    bool leaf1 = node1.NumberOfTriangles > 0;
+    bool leaf2 = node2.NumberOfTriangles > 0;
+    if (leaf1 && leaf2)
+    {
+      for (vtkIdType triangle2 = node2.FirstTriangle; triangle2 < node2.FirstTriangle + node2.NumberOfTriangles; ++triangle2)
+      {
+        for (int vertex = 0; vertex < 3; ++vertex)
+        {
+          TransformPoint(matrix21, &triangles2[9 * triangle2 + 3 * vertex], transformedTriangle + 3 * vertex);
+        }
+        for (vtkIdType triangle1 = node1.FirstTriangle; triangle1 < node1.FirstTriangle + node1.NumberOfTriangles; ++triangle1)
+        {
+          if (TrianglesIntersect(&triangles1[9 * triangle1], transformedTriangle))
+          {
+            return true;
+          }
+        }
+      }
+    }
+    else if (leaf1 || (!leaf2 && BoundsVolume(node2.Bounds) > BoundsVolume(node1.Bounds)))
+    {
+      // Descend into the second node
+      nodePairs.push_back(std::make_pair(nodePair.first, node2.FirstChild));
+      nodePairs.push_back(std::make_pair(nodePair.first, node2.FirstChild + 1));
+    }
+    else
+    {
+      // Descend into the first node
+      nodePairs.push_back(std::make_pair(node1.FirstChild, nodePair.second));
+      nodePairs.push_back(std::make_pair(node1.FirstChild + 1, nodePair.second));
+    }
+  }
+
+  return false;
+}
+
+//----------------------------------------------------------------------------
+double vtkTriangleBoundingVolumeHierarchy::Distance(vtkTriangleBoundingVolumeHierarchy* hierarchy1, vtkMatrix4x4* matrix1,
+  vtkTriangleBoundingVolumeHierarchy* hierarchy2, vtkMatrix4x4* matrix2, double distanceThreshold/*=0.0*/)
+{
+  double elements1[16] = { 0.0 };
+  double elements2[16] = { 0.0 };
+  GetMatrixElements(matrix1, elements1);
+  GetMatrixElements(matrix2, elements2);
+  return vtkTriangleBoundingVolumeHierarchy::Distance(hierarchy1, elements1, hierarchy2, elements2, distanceThreshold);
+}
+
+//----------------------------------------------------------------------------
+double vtkTriangleBoundingVolumeHierarchy::Distance(vtkTriangleBoundingVolumeHierarchy* hierarchy1, const double matrixElements1[16],
+  vtkTriangleBoundingVolumeHierarchy* hierarchy2, const double matrixElements2[16], double distanceThreshold/*=0.0*/)
+{
+  if (!hierarchy1 || !hierarchy2 || hierarchy1->Internal->Nodes.empty() || hierarchy2->Internal->Nodes.empty())
+  {
+    return VTK_DOUBLE_MAX;
+  }
+  const std::vector<BoxNode>& nodes1 = hierarchy1->Internal->Nodes;
+  const std::vector<BoxNode>& nodes2 = hierarchy2->Internal->Nodes;
+  const std::vector<double>& triangles1 = hierarchy1->Internal->Triangles;
+  const std::vector<double>& triangles2 = hierarchy2->Internal->Triangles;
+
+  // Distances are measured in the common coordinate system, as the transforms may contain scaling.
+  // Distance of the transformed bounds of two nodes is a lower bound for the distance of their triangles.
+  double bounds1[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  double bounds2[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  TransformBounds(matrixElements1, nodes1[0].Bounds, bounds1);
+  TransformBounds(matrixElements2, nodes2[0].Bounds, bounds2);
+
+  double threshold2 = distanceThreshold * distanceThreshold;
+  double minimumDistance2 = std::numeric_limits<double>::max();
+  struct NodePair
+  {
+    vtkIdType Node1;
+    vtkIdType Node2;
+    double LowerBound2;
+  };
+  std::vector<NodePair> nodePairs;
+  NodePair rootPair = { 0, 0, BoundsDistance2(bounds1, bounds2) };
+  nodePairs.push_back(rootPair);
+  double transformedTriangle1[9] = { 0.0 };
+  double transformedTriangle2[9] = { 0.0 };
+  while (!nodePairs.empty())
+  {
+    NodePair nodePair = nodePairs.back();
+    nodePairs.pop_back();
+    if (nodePair.LowerBound2 >= minimumDistance2)
+    {
+      continue;
+    }
+    const BoxNode& node1 = nodes1[nodePair.Node1];
+    const BoxNode& node2 = nodes2[nodePair.Node2];
+
+    bool leaf1 = node1.NumberOfTriangles > 0;
+    bool leaf2 = node2.NumberOfTriangles > 0;
+    if (leaf1 && leaf2)
+    {
+      for (vtkIdType triangle1 = node1.FirstTriangle; triangle1 < node1.FirstTriangle + node1.NumberOfTriangles; ++triangle1)
+      {
+        for (int vertex = 0; vertex < 3; ++vertex)
+        {
+          TransformPoint(matrixElements1, &triangles1[9 * triangle1 + 3 * vertex], transformedTriangle1 + 3 * vertex);
+        }
+        for (vtkIdType triangle2 = node2.FirstTriangle; triangle2 < node2.FirstTriangle + node2.NumberOfTriangles; ++triangle2)
+        {
+          for (int vertex = 0; vertex < 3; ++vertex)
+          {
+            TransformPoint(matrixElements2, &triangles2[9 * triangle2 + 3 * vertex], transformedTriangle2 + 3 * vertex);
+          }
+          minimumDistance2 = std::min(minimumDistance2, TriangleDistance2(transformedTriangle1, transformedTriangle2));
+          if (minimumDistance2 <= 0.0 || minimumDistance2 < threshold2)
+          {
+            return std::sqrt(minimumDistance2);
+          }
+        }
+      }
+      continue;
+    }
+
+    // Descend into one of the nodes, visit the closer child first
+    NodePair childPairs[2] = { nodePair, nodePair };
+    if (leaf1 || (!leaf2 && BoundsVolume(node2.Bounds) > BoundsVolume(node1.Bounds)))
+    {
+      TransformBounds(matrixElements1, node1.Bounds, bounds1);
+      for (int child = 0; child < 2; ++child)
+      {
+        childPairs[child].Node2 = node2.FirstChild + child;
+        TransformBounds(matrixElements2, nodes2[node2.FirstChild + child].Bounds, bounds2);
+        childPairs[child].LowerBound2 = BoundsDistance2(bounds1, bounds2);
+      }
+    }
+    else
+    {
+      TransformBounds(matrixElements2, node2.Bounds, bounds2);
+      for (int child = 0; child < 2; ++child)
+      {
+        childPairs[child].Node1 = node1.FirstChild + child;
+        TransformBounds(matrixElements1, nodes1[node1.FirstChild + child].Bounds, bounds1);
+        childPairs[child].LowerBound2 = BoundsDistance2(bounds1, bounds2);
+      }
+    }
+    int closerChild = (childPairs[0].LowerBound2 <= childPairs[1].LowerBound2 ? 0 : 1);
+    nodePairs.push_back(childPairs[1 - closerChild]);
+    nodePairs.push_back(childPairs[closerChild]);
+  }
+
+  return std::sqrt(minimumDistance2);
+}
@@ -0,0 +1,99 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTriangleBoundingVolumeHierarchy_h
+#define __vtkTriangleBoundingVolumeHierarchy_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerRoomsEyeViewModuleLogicExport.h"
+
+class vtkMatrix4x4;
+class vtkPolyData;
+
+/// \ingroup SlicerRt_QtModules_RoomsEyeView
+/// \brief Bounding volume hierarchy of the triangles of a rigid part, used for collision detection.
+///
+/// The hierarchy is a binary tree of axis aligned boxes in the coordinate system of the poly data it
+/// is built from. It is built once and then queried against other hierarchies with arbitrary linear
+/// transforms, so moving a part only changes the transform passed to the queries.
+/// Queries do not modify the hierarchies, so they can be run concurrently.
+class VTK_SLICER_ROOMSEYEVIEW_LOGIC_EXPORT vtkTriangleBoundingVolumeHierarchy : public vtkObject
+{
+public:
+  static vtkTriangleBoundingVolumeHierarchy* New();
+  vtkTypeMacro(vtkTriangleBoundingVolumeHierarchy, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Build hierarchy from the polygons of the poly data. Polygons are triangulated, other cells are ignored.
+  /// The triangles are copied, the poly data is not referenced afterwards.
+  void Build(vtkPolyData* polyData);
+
+  /// Remove all triangles
+  void Initialize();
+
+  /// Get number of triangles in the hierarchy
+  vtkIdType GetNumberOfTriangles();
+
+  /// Get bounds of the triangles in the coordinate system of the poly data the hierarchy was built from
+  /// \return False if the hierarchy is empty
+  bool GetBounds(double bounds[6]);
+
+  /// Get bounds of the root box transformed by the given matrix. The result contains all transformed triangles.
+  /// \return False if the hierarchy is empty
+  bool GetTransformedBounds(vtkMatrix4x4* matrix, double bounds[6]);
+  /// Get bounds of the root box transformed by the given row-major matrix elements
+  bool GetTransformedBounds(const double matrixElements[16], double bounds[6]);
+
+  /// Determine whether the triangles of two hierarchies intersect.
+  /// Only box pairs that overlap are descended into, and the query stops at the first contact.
+  /// \param matrix1 Transform from the coordinate system of the first hierarchy to a common coordinate system (nullptr means identity)
+  /// \param matrix2 Transform from the coordinate system of the second hierarchy to the common coordinate system (nullptr means identity)
+  /// \return True if a pair of triangles intersect
+  static bool Intersect(vtkTriangleBoundingVolumeHierarchy* hierarchy1, vtkMatrix4x4* matrix1,
+    vtkTriangleBoundingVolumeHierarchy* hierarchy2, vtkMatrix4x4* matrix2);
+  /// Determine whether the triangles of two hierarchies intersect, with transforms given as row-major matrix elements.
+  /// This allows concurrent queries for many poses without creating matrix objects.
+  static bool Intersect(vtkTriangleBoundingVolumeHierarchy* hierarchy1, const double matrixElements1[16],
+    vtkTriangleBoundingVolumeHierarchy* hierarchy2, const double matrixElements2[16]);
+
+  /// Compute the minimum distance between the triangles of two hierarchies in the common coordinate system.
+  /// Box pairs that cannot contain a closer triangle pair than the closest one found so far are skipped.
+  /// \param matrix1 Transform from the coordinate system of the first hierarchy to a common coordinate system (nullptr means identity)
+  /// \param matrix2 Transform from the coordinate system of the second hierarchy to the common coordinate system (nullptr means identity)
+  /// \param distanceThreshold The query stops as soon as a triangle pair closer than this is found. In that case the returned
+  ///   distance is below the threshold but it is not necessarily the minimum. Zero means that the exact minimum is computed.
+  /// \return Minimum distance, zero if the triangles intersect, VTK_DOUBLE_MAX if any of the hierarchies is empty
+  static double Distance(vtkTriangleBoundingVolumeHierarchy* hierarchy1, vtkMatrix4x4* matrix1,
+    vtkTriangleBoundingVolumeHierarchy* hierarchy2, vtkMatrix4x4* matrix2, double distanceThreshold=0.0);
+  /// Compute the minimum distance between the triangles of two hierarchies, with transforms given as row-major matrix elements
+  static double Distance(vtkTriangleBoundingVolumeHierarchy* hierarchy1, const double matrixElements1[16],
+    vtkTriangleBoundingVolumeHierarchy* hierarchy2, const double matrixElements2[16], double distanceThreshold=0.0);
+
+protected:
+  vtkTriangleBoundingVolumeHierarchy();
+  ~vtkTriangleBoundingVolumeHierarchy() override;
+
+private:
+  vtkTriangleBoundingVolumeHierarchy(const vtkTriangleBoundingVolumeHierarchy&) = delete;
+  void operator=(const vtkTriangleBoundingVolumeHierarchy&) = delete;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+};
+
+#endif
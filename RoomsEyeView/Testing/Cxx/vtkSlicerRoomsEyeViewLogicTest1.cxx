@@ -30,14 +30,32 @@
 // IEC Logic include
 #include <vtkIECTransformLogic.h>
 
+// Collision detection includes
+#include "vtkTriangleBoundingVolumeHierarchy.h"
+
 // MRML includes
 #include <vtkMRMLScene.h>
 #include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
 
 // VTK includes
 #include <vtkNew.h>
 #include <vtkTransform.h>
 #include <vtkMatrix4x4.h>
+#include <vtkCellArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkTestingOutputWindow.h>
+
+// VTKSYS includes
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <cmath>
+#include <fstream>
 
 
 //----------------------------------------------------------------------------
@@ -56,9 +74,39 @@ bool IsTransformMatrixEqualTo(vtkMRMLScene* mrmlScene, vtkMRMLLinearTransformNod
 bool AreEqualWithTolerance(double a, double b);
 bool IsEqual(vtkMatrix4x4* lhs, vtkMatrix4x4* rhs);
 
+/// Create closed surface of an axis aligned box from two triangles per face
+void CreateBoxPolyData(const double bounds[6], vtkPolyData* boxPolyData);
+/// Build bounding volume hierarchy of an axis aligned box
+void CreateBoxHierarchy(const double bounds[6], vtkTriangleBoundingVolumeHierarchy* hierarchy);
+/// Test intersection of triangle bounding volume hierarchies with known contact
+int TestTriangleBoundingVolumeHierarchyIntersect();
+/// Test minimum distance of triangle bounding volume hierarchies with known distance
+int TestTriangleBoundingVolumeHierarchyDistance();
+
+/// Load a treatment machine whose parts are boxes. The descriptor file is written to the temporary directory,
+/// and the part models are added to the scene before loading, so no model files are needed.
+/// \param tableTopState State of the table top in the descriptor file, the other parts are always active
+bool LoadBoxTreatmentMachine(vtkSlicerRoomsEyeViewModuleLogic* revLogic, vtkMRMLRoomsEyeViewNode* parameterNode,
+  const std::string& temporaryDirectory, const std::string& tableTopState="Active");
+/// Test collision map of the box treatment machine on a small grid with known collisions
+int TestCalculateCollisionMap(const std::string& temporaryDirectory);
+/// Test continuous collision check of the box treatment machine along arcs with known first contact
+int TestCheckForCollisionsAlongArc(const std::string& temporaryDirectory);
+/// Test clearances between the parts of the box treatment machine with known distances
+int TestCalculateClearances(const std::string& temporaryDirectory);
+
 //----------------------------------------------------------------------------
-int vtkSlicerRoomsEyeViewLogicTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+int vtkSlicerRoomsEyeViewLogicTest1(int argc, char* argv[])
 {
+  // TemporaryDirectory
+  if (argc < 3 || std::string(argv[1]) != "-TemporaryDirectory")
+  {
+    std::cerr << "Invalid arguments!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string temporaryDirectory(argv[2]);
+  vtksys::SystemTools::MakeDirectory(temporaryDirectory);
+
   // Create scene
   vtkNew<vtkMRMLScene> mrmlScene;
 
@@ -604,6 +652,27 @@ int vtkSlicerRoomsEyeViewLogicTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)
   //std::cout << "ZZZ after collimator angle 90:" << std::endl;
   //PrintLinearTransformNodeMatrices(mrmlScene, false, true);
 
+  if (TestTriangleBoundingVolumeHierarchyIntersect() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (TestTriangleBoundingVolumeHierarchyDistance() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (TestCalculateCollisionMap(temporaryDirectory) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (TestCheckForCollisionsAlongArc(temporaryDirectory) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (TestCalculateClearances(temporaryDirectory) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
   std::cout << "REV logic test passed" << std::endl;
   return EXIT_SUCCESS;
 }
@@ -766,3 +835,663 @@ bool IsEqual(vtkMatrix4x4* lhs, vtkMatrix4x4* rhs)
           AreEqualWithTolerance(lhs->GetElement(3,2), rhs->GetElement(3,2)) &&
           AreEqualWithTolerance(lhs->GetElement(3,3), rhs->GetElement(3,3));
 }
+
+//----------------------------------------------------------------------------
+void CreateBoxPolyData(const double bounds[6], vtkPolyData* boxPolyData)
+{
+  // Corner index bits select the minimum or maximum bound along x, y and z
+  vtkNew<vtkPoints> points;
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    points->InsertNextPoint(bounds[corner & 1], bounds[2 + ((corner >> 1) & 1)], bounds[4 + ((corner >> 2) & 1)]);
+  }
+  const vtkIdType faces[6][4] = { {0,2,6,4}, {1,3,7,5}, {0,1,5,4}, {2,3,7,6}, {0,1,3,2}, {4,5,7,6} };
+  vtkNew<vtkCellArray> triangles;
+  for (int face = 0; face < 6; ++face)
+  {
+    const vtkIdType triangle1[3] = { faces[face][0], faces[face][1], faces[face][2] };
+    const vtkIdType triangle2[3] = { faces[face][0], faces[face][2], faces[face][3] };
+    triangles->InsertNextCell(3, triangle1);
+    triangles->InsertNextCell(3, triangle2);
+  }
+  boxPolyData->SetPoints(points);
+  boxPolyData->SetPolys(triangles);
+}
+
+//----------------------------------------------------------------------------
+void CreateBoxHierarchy(const double bounds[6], vtkTriangleBoundingVolumeHierarchy* hierarchy)
+{
+  vtkNew<vtkPolyData> boxPolyData;
+  CreateBoxPolyData(bounds, boxPolyData);
+  hierarchy->Build(boxPolyData);
+}
+
+//----------------------------------------------------------------------------
+int TestTriangleBoundingVolumeHierarchyIntersect()
+{
+  const double boxBounds[6] = { 0.0, 10.0, 0.0, 10.0, 0.0, 10.0 };
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> boxHierarchy;
+  CreateBoxHierarchy(boxBounds, boxHierarchy);
+  if (boxHierarchy->GetNumberOfTriangles() != 12)
+  {
+    std::cerr << __LINE__ << ": Box hierarchy has " << boxHierarchy->GetNumberOfTriangles() << " triangles instead of 12" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkMatrix4x4> identityMatrix;
+
+  // Bar that fits within a side face of the box
+  const double barBounds[6] = { 0.0, 10.0, 2.0, 8.0, 2.0, 8.0 };
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> barHierarchy;
+  CreateBoxHierarchy(barBounds, barHierarchy);
+
+  // Touching: the end face of the bar lies on the side face of the box, so the edges of the bar touch the box
+  vtkNew<vtkTransform> barTransform;
+  barTransform->Translate(10.0, 0.0, 0.0);
+  if (!vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, nullptr, barHierarchy, barTransform->GetMatrix()))
+  {
+    std::cerr << __LINE__ << ": Touching parts are not reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Separated by epsilon
+  barTransform->Identity();
+  barTransform->Translate(10.0 + 1e-6, 0.0, 0.0);
+  if (vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, nullptr, barHierarchy, barTransform->GetMatrix()))
+  {
+    std::cerr << __LINE__ << ": Parts separated by 1e-6 mm are reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Penetrating
+  barTransform->Identity();
+  barTransform->Translate(9.0, 0.0, 0.0);
+  if (!vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, nullptr, barHierarchy, barTransform->GetMatrix()))
+  {
+    std::cerr << __LINE__ << ": Penetrating parts are not reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Only surfaces are tested, so a part entirely inside the other one does not intersect it
+  const double innerBoxBounds[6] = { 2.0, 8.0, 2.0, 8.0, 2.0, 8.0 };
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> innerBoxHierarchy;
+  CreateBoxHierarchy(innerBoxBounds, innerBoxHierarchy);
+  if (vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, identityMatrix, innerBoxHierarchy, identityMatrix))
+  {
+    std::cerr << __LINE__ << ": Surfaces of nested parts are reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Rotated: cube rotated by 45 degrees next to the vertical edge of the box at (10, 10).
+  // The face of the cube is 5 mm from its center, the edge of the box is sqrt(2) * offset from it,
+  // while the axis aligned bounds of the two parts overlap for both offsets.
+  const double cubeBounds[6] = { -5.0, 5.0, -5.0, 5.0, -5.0, 5.0 };
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> cubeHierarchy;
+  CreateBoxHierarchy(cubeBounds, cubeHierarchy);
+  vtkNew<vtkTransform> cubeTransform;
+  cubeTransform->Translate(13.0, 13.0, 5.0);
+  cubeTransform->RotateZ(45.0);
+  if (!vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, nullptr, cubeHierarchy, cubeTransform->GetMatrix()))
+  {
+    std::cerr << __LINE__ << ": Rotated part 0.76 mm inside the box is not reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+  cubeTransform->Identity();
+  cubeTransform->Translate(14.5, 14.5, 5.0);
+  cubeTransform->RotateZ(45.0);
+  if (vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, nullptr, cubeHierarchy, cubeTransform->GetMatrix()))
+  {
+    std::cerr << __LINE__ << ": Rotated part 1.36 mm from the box is reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Scaled: unit cube scaled to the size of the box, and the box scaled by the first transform
+  const double unitCubeBounds[6] = { 0.0, 1.0, 0.0, 1.0, 0.0, 1.0 };
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> unitCubeHierarchy;
+  CreateBoxHierarchy(unitCubeBounds, unitCubeHierarchy);
+  vtkNew<vtkTransform> unitCubeTransform;
+  unitCubeTransform->Translate(9.5, 0.0, 0.0);
+  unitCubeTransform->Scale(10.0, 10.0, 10.0);
+  if (!vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, nullptr, unitCubeHierarchy, unitCubeTransform->GetMatrix()))
+  {
+    std::cerr << __LINE__ << ": Scaled part overlapping the box is not reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+  unitCubeTransform->Identity();
+  unitCubeTransform->Translate(15.0, 0.0, 0.0);
+  unitCubeTransform->Scale(10.0, 10.0, 10.0);
+  if (vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, nullptr, unitCubeHierarchy, unitCubeTransform->GetMatrix()))
+  {
+    std::cerr << __LINE__ << ": Scaled part 5 mm from the box is reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkNew<vtkTransform> boxTransform;
+  boxTransform->Scale(2.0, 1.0, 1.0);
+  if (!vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, boxTransform->GetMatrix(), unitCubeHierarchy, unitCubeTransform->GetMatrix()))
+  {
+    std::cerr << __LINE__ << ": Scaled parts overlapping each other are not reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Degenerate triangles: a needle of collinear points crossing the box, and a triangle with a repeated point
+  vtkNew<vtkPoints> degeneratePoints;
+  degeneratePoints->InsertNextPoint(3.0, 6.0, -5.0);
+  degeneratePoints->InsertNextPoint(3.0, 6.0, 5.0);
+  degeneratePoints->InsertNextPoint(3.0, 6.0, 15.0);
+  degeneratePoints->InsertNextPoint(30.0, 0.0, 0.0);
+  degeneratePoints->InsertNextPoint(40.0, 0.0, 0.0);
+  const vtkIdType needleTriangle[3] = { 0, 1, 2 };
+  const vtkIdType repeatedPointTriangle[3] = { 3, 3, 4 };
+  vtkNew<vtkCellArray> needleTriangles;
+  needleTriangles->InsertNextCell(3, needleTriangle);
+  vtkNew<vtkPolyData> needlePolyData;
+  needlePolyData->SetPoints(degeneratePoints);
+  needlePolyData->SetPolys(needleTriangles);
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> needleHierarchy;
+  needleHierarchy->Build(needlePolyData);
+  if (!vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, identityMatrix, needleHierarchy, identityMatrix)
+    || !vtkTriangleBoundingVolumeHierarchy::Intersect(needleHierarchy, identityMatrix, boxHierarchy, identityMatrix))
+  {
+    std::cerr << __LINE__ << ": Degenerate triangle crossing the box is not reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkNew<vtkCellArray> repeatedPointTriangles;
+  repeatedPointTriangles->InsertNextCell(3, repeatedPointTriangle);
+  vtkNew<vtkPolyData> repeatedPointPolyData;
+  repeatedPointPolyData->SetPoints(degeneratePoints);
+  repeatedPointPolyData->SetPolys(repeatedPointTriangles);
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> repeatedPointHierarchy;
+  repeatedPointHierarchy->Build(repeatedPointPolyData);
+  if ( vtkTriangleBoundingVolumeHierarchy::Intersect(boxHierarchy, identityMatrix, repeatedPointHierarchy, identityMatrix)
+    || vtkTriangleBoundingVolumeHierarchy::Intersect(needleHierarchy, identityMatrix, repeatedPointHierarchy, identityMatrix) )
+  {
+    std::cerr << __LINE__ << ": Degenerate triangle away from the other part is reported as intersecting" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int TestTriangleBoundingVolumeHierarchyDistance()
+{
+  const double boxBounds[6] = { 0.0, 10.0, 0.0, 10.0, 0.0, 10.0 };
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> boxHierarchy;
+  CreateBoxHierarchy(boxBounds, boxHierarchy);
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> otherBoxHierarchy;
+  CreateBoxHierarchy(boxBounds, otherBoxHierarchy);
+  vtkNew<vtkMatrix4x4> identityMatrix;
+
+  // Boxes a known distance apart, face to face and edge to edge
+  vtkNew<vtkTransform> otherBoxTransform;
+  otherBoxTransform->Translate(15.0, 0.0, 0.0);
+  double distance = vtkTriangleBoundingVolumeHierarchy::Distance(boxHierarchy, nullptr, otherBoxHierarchy, otherBoxTransform->GetMatrix());
+  if (std::fabs(distance - 5.0) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Distance of boxes 5 mm apart is " << distance << std::endl;
+    return EXIT_FAILURE;
+  }
+  otherBoxTransform->Identity();
+  otherBoxTransform->Translate(13.0, 14.0, 0.0);
+  distance = vtkTriangleBoundingVolumeHierarchy::Distance(boxHierarchy, nullptr, otherBoxHierarchy, otherBoxTransform->GetMatrix());
+  if (std::fabs(distance - 5.0) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Distance of box edges 5 mm apart is " << distance << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Touching and overlapping boxes
+  otherBoxTransform->Identity();
+  otherBoxTransform->Translate(10.0, 0.0, 0.0);
+  distance = vtkTriangleBoundingVolumeHierarchy::Distance(boxHierarchy, nullptr, otherBoxHierarchy, otherBoxTransform->GetMatrix());
+  if (std::fabs(distance) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Distance of touching boxes is " << distance << std::endl;
+    return EXIT_FAILURE;
+  }
+  otherBoxTransform->Identity();
+  otherBoxTransform->Translate(5.0, 5.0, 0.0);
+  distance = vtkTriangleBoundingVolumeHierarchy::Distance(boxHierarchy, nullptr, otherBoxHierarchy, otherBoxTransform->GetMatrix());
+  if (std::fabs(distance) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Distance of overlapping boxes is " << distance << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Early stop: above the minimum distance the query may stop at any triangle pair closer than the threshold,
+  // below the minimum distance no triangle pair is close enough, so the exact minimum is returned
+  otherBoxTransform->Identity();
+  otherBoxTransform->Translate(15.0, 0.0, 0.0);
+  distance = vtkTriangleBoundingVolumeHierarchy::Distance(boxHierarchy, nullptr, otherBoxHierarchy, otherBoxTransform->GetMatrix(), 20.0);
+  if (distance < 5.0 - 1e-6 || distance >= 20.0)
+  {
+    std::cerr << __LINE__ << ": Distance of boxes 5 mm apart with 20 mm threshold is " << distance << std::endl;
+    return EXIT_FAILURE;
+  }
+  distance = vtkTriangleBoundingVolumeHierarchy::Distance(boxHierarchy, nullptr, otherBoxHierarchy, otherBoxTransform->GetMatrix(), 4.0);
+  if (std::fabs(distance - 5.0) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Distance of boxes 5 mm apart with 4 mm threshold is " << distance << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Degenerate triangles: a needle of collinear points above the box, and a triangle with a repeated point beside it
+  vtkNew<vtkPoints> degeneratePoints;
+  degeneratePoints->InsertNextPoint(3.0, 6.0, 15.0);
+  degeneratePoints->InsertNextPoint(3.0, 6.0, 20.0);
+  degeneratePoints->InsertNextPoint(3.0, 6.0, 25.0);
+  degeneratePoints->InsertNextPoint(18.0, 5.0, 5.0);
+  degeneratePoints->InsertNextPoint(30.0, 5.0, 5.0);
+  const vtkIdType needleTriangle[3] = { 0, 1, 2 };
+  const vtkIdType repeatedPointTriangle[3] = { 3, 3, 4 };
+  vtkNew<vtkCellArray> needleTriangles;
+  needleTriangles->InsertNextCell(3, needleTriangle);
+  vtkNew<vtkPolyData> needlePolyData;
+  needlePolyData->SetPoints(degeneratePoints);
+  needlePolyData->SetPolys(needleTriangles);
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> needleHierarchy;
+  needleHierarchy->Build(needlePolyData);
+  double needleDistance1 = vtkTriangleBoundingVolumeHierarchy::Distance(boxHierarchy, identityMatrix, needleHierarchy, identityMatrix);
+  double needleDistance2 = vtkTriangleBoundingVolumeHierarchy::Distance(needleHierarchy, identityMatrix, boxHierarchy, identityMatrix);
+  if (std::fabs(needleDistance1 - 5.0) > 1e-6 || std::fabs(needleDistance2 - 5.0) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Distance of degenerate triangle 5 mm above the box is " << needleDistance1 << " and " << needleDistance2 << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkNew<vtkCellArray> repeatedPointTriangles;
+  repeatedPointTriangles->InsertNextCell(3, repeatedPointTriangle);
+  vtkNew<vtkPolyData> repeatedPointPolyData;
+  repeatedPointPolyData->SetPoints(degeneratePoints);
+  repeatedPointPolyData->SetPolys(repeatedPointTriangles);
+  vtkNew<vtkTriangleBoundingVolumeHierarchy> repeatedPointHierarchy;
+  repeatedPointHierarchy->Build(repeatedPointPolyData);
+  distance = vtkTriangleBoundingVolumeHierarchy::Distance(boxHierarchy, identityMatrix, repeatedPointHierarchy, identityMatrix);
+  if (std::fabs(distance - 8.0) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Distance of degenerate triangle 8 mm beside the box is " << distance << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool LoadBoxTreatmentMachine(vtkSlicerRoomsEyeViewModuleLogic* revLogic, vtkMRMLRoomsEyeViewNode* parameterNode,
+  const std::string& temporaryDirectory, const std::string& tableTopState/*="Active"*/)
+{
+  // Part bounds in the coordinate system of the part (the file to RAS transforms are identity).
+  // The gantry is a slab above the isocenter that is long enough along the gantry rotation axis to reach the table top
+  // at 90 degrees patient support angle. The table top is a slab below the isocenter, lateral to the gantry at 0 degrees
+  // patient support angle. The collimator and the patient support never come in contact with anything.
+  const vtkSlicerRoomsEyeViewModuleLogic::TreatmentMachinePartType partTypes[4] = {
+    vtkSlicerRoomsEyeViewModuleLogic::Collimator, vtkSlicerRoomsEyeViewModuleLogic::Gantry,
+    vtkSlicerRoomsEyeViewModuleLogic::PatientSupport, vtkSlicerRoomsEyeViewModuleLogic::TableTop };
+  const double partBounds[4][6] = {
+    { -5.0, 5.0, -5.0, 5.0, 60.0, 80.0 },
+    { -10.0, 10.0, -50.0, 50.0, 100.0, 120.0 },
+    { -5.0, 5.0, -5.0, 5.0, -400.0, -300.0 },
+    { 15.0, 80.0, -5.0, 5.0, -115.0, -105.0 } };
+
+  const std::string machineType("BoxTreatmentMachine");
+  std::string descriptorFilePath = temporaryDirectory + "/" + machineType + ".json";
+  std::ofstream descriptorFile(descriptorFilePath.c_str());
+  descriptorFile << "{" << std::endl << "  \"TreatmentMachineName\": \"Box treatment machine\"," << std::endl << "  \"Part\": [" << std::endl;
+  for (int partIndex = 0; partIndex < 4; ++partIndex)
+  {
+    std::string partType(revLogic->GetTreatmentMachinePartTypeAsString(partTypes[partIndex]));
+    descriptorFile << "    {" << std::endl
+      << "      \"Type\": \"" << partType << "\"," << std::endl
+      << "      \"Name\": \"" << partType << "\"," << std::endl
+      << "      \"FilePath\": \"" << partType << ".stl\"," << std::endl
+      << "      \"FileToRASTransformMatrix\": [ [1, 0, 0, 0], [0, 1, 0, 0], [0, 0, 1, 0], [0, 0, 0, 1] ]," << std::endl
+      << "      \"Color\": [200, 200, 200]," << std::endl
+      << "      \"State\": \"" << (partTypes[partIndex] == vtkSlicerRoomsEyeViewModuleLogic::TableTop ? tableTopState : "Active") << "\"" << std::endl
+      << "    }" << (partIndex < 3 ? "," : "") << std::endl;
+
+    vtkNew<vtkPolyData> partPolyData;
+    CreateBoxPolyData(partBounds[partIndex], partPolyData);
+    vtkNew<vtkMRMLModelNode> partModelNode;
+    partModelNode->SetName((machineType + "_" + partType).c_str());
+    partModelNode->SetAndObservePolyData(partPolyData);
+    revLogic->GetMRMLScene()->AddNode(partModelNode);
+  }
+  descriptorFile << "  ]" << std::endl << "}" << std::endl;
+  descriptorFile.close();
+
+  parameterNode->SetTreatmentMachineDescriptorFilePath(descriptorFilePath.c_str());
+  std::vector<vtkSlicerRoomsEyeViewModuleLogic::TreatmentMachinePartType> loadedParts = revLogic->LoadTreatmentMachine(parameterNode);
+  if (loadedParts.size() != 4)
+  {
+    std::cerr << __LINE__ << ": Loaded " << loadedParts.size() << " parts of the box treatment machine instead of 4" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int TestCalculateCollisionMap(const std::string& temporaryDirectory)
+{
+  vtkNew<vtkMRMLScene> mrmlScene;
+  vtkNew<vtkSlicerRoomsEyeViewModuleLogic> revLogic;
+  vtkNew<vtkSlicerBeamsModuleLogic> beamsLogic;
+  beamsLogic->SetMRMLScene(mrmlScene);
+  beamsLogic->SetIECLogic(revLogic->GetIECLogic());
+  revLogic->SetMRMLScene(mrmlScene);
+  revLogic->SetBeamsLogic(beamsLogic);
+  revLogic->BuildRoomsEyeViewTransformHierarchy();
+
+  vtkNew<vtkMRMLRoomsEyeViewNode> parameterNode;
+  mrmlScene->AddNode(parameterNode);
+  if (!LoadBoxTreatmentMachine(revLogic, parameterNode, temporaryDirectory))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Gantry angles 0, 90, 180 and patient support angles 0, 90. The gantry only reaches the table top at 180 degrees gantry
+  // angle, and only touches it at 90 degrees patient support angle, when the table top is rotated under the gantry.
+  vtkNew<vtkMRMLScalarVolumeNode> collisionMapVolumeNode;
+  mrmlScene->AddNode(collisionMapVolumeNode);
+  if (!revLogic->CalculateCollisionMap(parameterNode, 0.0, 180.0, 90.0, 0.0, 90.0, 90.0, collisionMapVolumeNode))
+  {
+    std::cerr << __LINE__ << ": Failed to calculate collision map" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkImageData* collisionMapImageData = collisionMapVolumeNode->GetImageData();
+  int dimensions[3] = { 0, 0, 0 };
+  if (collisionMapImageData)
+  {
+    collisionMapImageData->GetDimensions(dimensions);
+  }
+  if (dimensions[0] != 3 || dimensions[1] != 2 || dimensions[2] != 1)
+  {
+    std::cerr << __LINE__ << ": Collision map dimensions " << dimensions[0] << " x " << dimensions[1] << " x " << dimensions[2]
+      << " do not match expected 3 x 2 x 1" << std::endl;
+    return EXIT_FAILURE;
+  }
+  double* spacing = collisionMapVolumeNode->GetSpacing();
+  if (!AreEqualWithTolerance(spacing[0], 90.0) || !AreEqualWithTolerance(spacing[1], 90.0))
+  {
+    std::cerr << __LINE__ << ": Collision map spacing " << spacing[0] << ", " << spacing[1] << " does not match the angle steps" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int patientSupportIndex = 0; patientSupportIndex < 2; ++patientSupportIndex)
+  {
+    for (int gantryIndex = 0; gantryIndex < 3; ++gantryIndex)
+    {
+      int expectedFlags = (gantryIndex == 2 && patientSupportIndex == 1 ? vtkSlicerRoomsEyeViewModuleLogic::GantryTableTopCollision : 0);
+      int flags = static_cast<int>(collisionMapImageData->GetScalarComponentAsDouble(gantryIndex, patientSupportIndex, 0, 0));
+      if (flags != expectedFlags)
+      {
+        std::cerr << __LINE__ << ": Collision map value " << flags << " at gantry angle " << gantryIndex * 90 << " and patient support angle "
+          << patientSupportIndex * 90 << " does not match expected value " << expectedFlags << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Grids with too many samples are rejected
+  vtkNew<vtkMRMLScalarVolumeNode> oversizeCollisionMapVolumeNode;
+  mrmlScene->AddNode(oversizeCollisionMapVolumeNode);
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  bool oversizeResult = revLogic->CalculateCollisionMap(parameterNode, 0.0, 360.0, 1.0e-4, 0.0, 90.0, 1.0e-4, oversizeCollisionMapVolumeNode);
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+  if (oversizeResult || oversizeCollisionMapVolumeNode->GetImageData())
+  {
+    std::cerr << __LINE__ << ": Collision map with too many samples is not rejected" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int TestCheckForCollisionsAlongArc(const std::string& temporaryDirectory)
+{
+  vtkNew<vtkMRMLScene> mrmlScene;
+  vtkNew<vtkSlicerRoomsEyeViewModuleLogic> revLogic;
+  vtkNew<vtkSlicerBeamsModuleLogic> beamsLogic;
+  beamsLogic->SetMRMLScene(mrmlScene);
+  beamsLogic->SetIECLogic(revLogic->GetIECLogic());
+  revLogic->SetMRMLScene(mrmlScene);
+  revLogic->SetBeamsLogic(beamsLogic);
+  revLogic->BuildRoomsEyeViewTransformHierarchy();
+
+  vtkNew<vtkMRMLRoomsEyeViewNode> parameterNode;
+  mrmlScene->AddNode(parameterNode);
+  if (!LoadBoxTreatmentMachine(revLogic, parameterNode, temporaryDirectory))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Rotate the table top under the gantry. In the plane perpendicular to the gantry rotation axis the gantry is then
+  // a 20 x 20 mm square 100 mm from the isocenter, and the table top is a 10 x 10 mm square 105 mm from the isocenter
+  // on the opposite side. They are 1 mm apart at 171.27 degrees gantry angle, and symmetrically at 188.73 degrees.
+  parameterNode->SetPatientSupportRotationAngle(90.0);
+  revLogic->UpdatePatientSupportRotationToFixedReferenceTransform(parameterNode);
+  const double contactDistance = 1.0;
+  const double expectedFirstContactGantryAngle = 171.27;
+  // Contact is reported conservatively, somewhat before the parts actually come closer than the contact distance
+  const double angleTolerance = 0.15;
+
+  // Increasing gantry angle
+  bool contact = false;
+  double firstContactGantryAngle = 0.0;
+  if (!revLogic->CheckForCollisionsAlongArc(parameterNode, 90.0, 270.0, contact, firstContactGantryAngle, contactDistance))
+  {
+    std::cerr << __LINE__ << ": Failed to check for collisions along arc" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!contact || firstContactGantryAngle > expectedFirstContactGantryAngle
+    || firstContactGantryAngle < expectedFirstContactGantryAngle - angleTolerance)
+  {
+    std::cerr << __LINE__ << ": First contact along increasing arc is " << (contact ? "" : "not found ") << "at " << firstContactGantryAngle
+      << " degrees instead of " << expectedFirstContactGantryAngle << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Decreasing gantry angle
+  contact = false;
+  if (!revLogic->CheckForCollisionsAlongArc(parameterNode, 270.0, 90.0, contact, firstContactGantryAngle, contactDistance))
+  {
+    std::cerr << __LINE__ << ": Failed to check for collisions along arc" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!contact || firstContactGantryAngle < 360.0 - expectedFirstContactGantryAngle
+    || firstContactGantryAngle > 360.0 - expectedFirstContactGantryAngle + angleTolerance)
+  {
+    std::cerr << __LINE__ << ": First contact along decreasing arc is " << (contact ? "" : "not found ") << "at " << firstContactGantryAngle
+      << " degrees instead of " << 360.0 - expectedFirstContactGantryAngle << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Decreasing gantry angle crossing 0 degrees
+  contact = false;
+  if (!revLogic->CheckForCollisionsAlongArc(parameterNode, 90.0, -200.0, contact, firstContactGantryAngle, contactDistance))
+  {
+    std::cerr << __LINE__ << ": Failed to check for collisions along arc" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!contact || firstContactGantryAngle < -expectedFirstContactGantryAngle
+    || firstContactGantryAngle > -expectedFirstContactGantryAngle + angleTolerance)
+  {
+    std::cerr << __LINE__ << ": First contact along arc crossing 0 degrees is " << (contact ? "" : "not found ") << "at " << firstContactGantryAngle
+      << " degrees instead of " << -expectedFirstContactGantryAngle << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Arc crossing 0 degrees over the isocenter, away from the table top
+  contact = false;
+  if (!revLogic->CheckForCollisionsAlongArc(parameterNode, 270.0, 450.0, contact, firstContactGantryAngle, contactDistance))
+  {
+    std::cerr << __LINE__ << ": Failed to check for collisions along arc" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (contact)
+  {
+    std::cerr << __LINE__ << ": Contact found at " << firstContactGantryAngle << " degrees along arc that is clear" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Arc that only grazes the patient support. With a passive table top the gantry can only come close to the patient
+  // support, which is closest when a gantry corner points straight down, at 180 -+ atan(10/120) degrees gantry angle.
+  // With a contact distance just above that minimum the parts are in contact along less than the minimum step angle,
+  // which must not be skipped.
+  vtkNew<vtkMRMLScene> grazeScene;
+  vtkNew<vtkSlicerRoomsEyeViewModuleLogic> grazeRevLogic;
+  vtkNew<vtkSlicerBeamsModuleLogic> grazeBeamsLogic;
+  grazeBeamsLogic->SetMRMLScene(grazeScene);
+  grazeBeamsLogic->SetIECLogic(grazeRevLogic->GetIECLogic());
+  grazeRevLogic->SetMRMLScene(grazeScene);
+  grazeRevLogic->SetBeamsLogic(grazeBeamsLogic);
+  grazeRevLogic->BuildRoomsEyeViewTransformHierarchy();
+
+  vtkNew<vtkMRMLRoomsEyeViewNode> grazeParameterNode;
+  grazeScene->AddNode(grazeParameterNode);
+  if (!LoadBoxTreatmentMachine(grazeRevLogic, grazeParameterNode, temporaryDirectory, "Passive"))
+  {
+    return EXIT_FAILURE;
+  }
+  const double gantryCornerRadius = std::sqrt(10.0 * 10.0 + 120.0 * 120.0);
+  const double grazeContactDistance = 300.0 - gantryCornerRadius + 1.0e-5;
+  // Gantry angle where the gantry corner first comes closer than the contact distance
+  const double grazeContactGantryAngle = 180.0 - vtkMath::DegreesFromRadians(std::atan(10.0 / 120.0)
+    + std::acos((300.0 - grazeContactDistance) / gantryCornerRadius));
+  contact = false;
+  if (!grazeRevLogic->CheckForCollisionsAlongArc(grazeParameterNode, 90.0, 270.0, contact, firstContactGantryAngle, grazeContactDistance))
+  {
+    std::cerr << __LINE__ << ": Failed to check for collisions along arc" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!contact || firstContactGantryAngle < 90.0 || firstContactGantryAngle > grazeContactGantryAngle)
+  {
+    std::cerr << __LINE__ << ": First contact along grazing arc is " << (contact ? "" : "not found ") << "at " << firstContactGantryAngle
+      << " degrees instead of before " << grazeContactGantryAngle << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int TestCalculateClearances(const std::string& temporaryDirectory)
+{
+  vtkNew<vtkMRMLScene> mrmlScene;
+  vtkNew<vtkSlicerRoomsEyeViewModuleLogic> revLogic;
+  vtkNew<vtkSlicerBeamsModuleLogic> beamsLogic;
+  beamsLogic->SetMRMLScene(mrmlScene);
+  beamsLogic->SetIECLogic(revLogic->GetIECLogic());
+  revLogic->SetMRMLScene(mrmlScene);
+  revLogic->SetBeamsLogic(beamsLogic);
+  revLogic->BuildRoomsEyeViewTransformHierarchy();
+
+  vtkNew<vtkMRMLRoomsEyeViewNode> parameterNode;
+  mrmlScene->AddNode(parameterNode);
+  if (!LoadBoxTreatmentMachine(revLogic, parameterNode, temporaryDirectory))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // At zero gantry and patient support angles the part boxes are not transformed relative to each other. The gantry is
+  // 5 mm lateral to and 205 mm above the table top, and 400 mm above the patient support. The collimator is 10 mm lateral
+  // to and 165 mm above the table top. All of these are beyond the default clearance threshold, so they are exact.
+  const double expectedGantryTableTopClearance = std::sqrt(5.0 * 5.0 + 205.0 * 205.0);
+  const double expectedGantryPatientSupportClearance = 400.0;
+  const double expectedCollimatorTableTopClearance = std::sqrt(10.0 * 10.0 + 165.0 * 165.0);
+  if (!revLogic->CalculateClearances(parameterNode))
+  {
+    std::cerr << __LINE__ << ": Failed to calculate clearances" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (std::fabs(parameterNode->GetGantryTableTopClearance() - expectedGantryTableTopClearance) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Gantry to table top clearance " << parameterNode->GetGantryTableTopClearance()
+      << " does not match expected value " << expectedGantryTableTopClearance << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (std::fabs(parameterNode->GetGantryPatientSupportClearance() - expectedGantryPatientSupportClearance) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Gantry to patient support clearance " << parameterNode->GetGantryPatientSupportClearance()
+      << " does not match expected value " << expectedGantryPatientSupportClearance << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (std::fabs(parameterNode->GetCollimatorTableTopClearance() - expectedCollimatorTableTopClearance) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Collimator to table top clearance " << parameterNode->GetCollimatorTableTopClearance()
+      << " does not match expected value " << expectedCollimatorTableTopClearance << std::endl;
+    return EXIT_FAILURE;
+  }
+  // There is no patient body segment
+  if (parameterNode->GetGantryPatientClearance() != -1.0 || parameterNode->GetCollimatorPatientClearance() != -1.0)
+  {
+    std::cerr << __LINE__ << ": Clearances to missing patient body are " << parameterNode->GetGantryPatientClearance() << " and "
+      << parameterNode->GetCollimatorPatientClearance() << " instead of -1" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // With a clearance threshold beyond the table top clearances the queries of these pairs may stop before the minimum
+  // is found, but the reported clearance is below the threshold. The patient support is still beyond the threshold.
+  const double clearanceThreshold = 250.0;
+  parameterNode->SetClearanceThreshold(clearanceThreshold);
+  if (!revLogic->CalculateClearances(parameterNode))
+  {
+    std::cerr << __LINE__ << ": Failed to calculate clearances" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (parameterNode->GetGantryTableTopClearance() >= clearanceThreshold
+    || parameterNode->GetGantryTableTopClearance() < expectedGantryTableTopClearance - 1e-6)
+  {
+    std::cerr << __LINE__ << ": Gantry to table top clearance " << parameterNode->GetGantryTableTopClearance()
+      << " is not between the minimum distance " << expectedGantryTableTopClearance << " and the threshold " << clearanceThreshold << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (parameterNode->GetCollimatorTableTopClearance() >= clearanceThreshold
+    || parameterNode->GetCollimatorTableTopClearance() < expectedCollimatorTableTopClearance - 1e-6)
+  {
+    std::cerr << __LINE__ << ": Collimator to table top clearance " << parameterNode->GetCollimatorTableTopClearance()
+      << " is not between the minimum distance " << expectedCollimatorTableTopClearance << " and the threshold " << clearanceThreshold << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (std::fabs(parameterNode->GetGantryPatientSupportClearance() - expectedGantryPatientSupportClearance) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Gantry to patient support clearance " << parameterNode->GetGantryPatientSupportClearance()
+      << " does not match expected value " << expectedGantryPatientSupportClearance << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Pairs with a part that is not active are not checked
+  vtkNew<vtkMRMLScene> passiveTableTopScene;
+  vtkNew<vtkSlicerRoomsEyeViewModuleLogic> passiveTableTopRevLogic;
+  vtkNew<vtkSlicerBeamsModuleLogic> passiveTableTopBeamsLogic;
+  passiveTableTopBeamsLogic->SetMRMLScene(passiveTableTopScene);
+  passiveTableTopBeamsLogic->SetIECLogic(passiveTableTopRevLogic->GetIECLogic());
+  passiveTableTopRevLogic->SetMRMLScene(passiveTableTopScene);
+  passiveTableTopRevLogic->SetBeamsLogic(passiveTableTopBeamsLogic);
+  passiveTableTopRevLogic->BuildRoomsEyeViewTransformHierarchy();
+
+  vtkNew<vtkMRMLRoomsEyeViewNode> passiveTableTopParameterNode;
+  passiveTableTopScene->AddNode(passiveTableTopParameterNode);
+  if (!LoadBoxTreatmentMachine(passiveTableTopRevLogic, passiveTableTopParameterNode, temporaryDirectory, "Passive"))
+  {
+    return EXIT_FAILURE;
+  }
+  if (!passiveTableTopRevLogic->CalculateClearances(passiveTableTopParameterNode))
+  {
+    std::cerr << __LINE__ << ": Failed to calculate clearances" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (passiveTableTopParameterNode->GetGantryTableTopClearance() != -1.0
+    || passiveTableTopParameterNode->GetCollimatorTableTopClearance() != -1.0)
+  {
+    std::cerr << __LINE__ << ": Clearances to passive table top are " << passiveTableTopParameterNode->GetGantryTableTopClearance()
+      << " and " << passiveTableTopParameterNode->GetCollimatorTableTopClearance() << " instead of -1" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (std::fabs(passiveTableTopParameterNode->GetGantryPatientSupportClearance() - expectedGantryPatientSupportClearance) > 1e-6)
+  {
+    std::cerr << __LINE__ << ": Gantry to patient support clearance " << passiveTableTopParameterNode->GetGantryPatientSupportClearance()
+      << " does not match expected value " << expectedGantryPatientSupportClearance << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
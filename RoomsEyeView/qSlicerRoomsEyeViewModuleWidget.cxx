@@ -62,6 +62,8 @@
 #include <QDebug>
 #include <QDir>
 #include <QFileDialog>
+#include <QPair>
+#include <QStringList>
 
 // CTK includes
 #include <ctkMessageBox.h>
@@ -69,7 +71,6 @@
 
 // VTK includes
 #include <vtkCamera.h>
-#include "vtkCollisionDetectionFilter.h"
 #include <vtkPolyData.h>
 #include <vtkMatrix4x4.h>
 #include <vtkTransform.h>
@@ -348,6 +349,7 @@ void qSlicerRoomsEyeViewModuleWidget::updateWidgetFromMRML()
     d->LongitudinalTableTopDisplacementSlider->setValue(paramNode->GetLongitudinalTableTopDisplacement());
     d->LateralTableTopDisplacementSlider->setValue(paramNode->GetLateralTableTopDisplacement());
     d->ImagingPanelMovementSlider->setValue(paramNode->GetImagingPanelMovement());
+    d->ClearanceThresholdSpinBox->setValue(paramNode->GetClearanceThreshold());
   }
 }
 
@@ -388,6 +390,7 @@ void qSlicerRoomsEyeViewModuleWidget::setup()
   connect(d->MRMLNodeComboBox_Beam, SIGNAL(currentNodeChanged(vtkMRMLNode*)), this, SLOT(onBeamNodeChanged(vtkMRMLNode*)));
   connect(d->SegmentSelectorWidget_PatientBody, SIGNAL(currentNodeChanged(vtkMRMLNode*)), this, SLOT(onPatientBodySegmentationNodeChanged(vtkMRMLNode*)));
   connect(d->SegmentSelectorWidget_PatientBody, SIGNAL(currentSegmentChanged(QString)), this, SLOT(onPatientBodySegmentChanged(QString)));
+  connect(d->ClearanceThresholdSpinBox, SIGNAL(valueChanged(double)), this, SLOT(onClearanceThresholdValueChanged(double)));
 
   // 3D camera control
   connect(d->FixedCameraCheckBox, SIGNAL(toggled(bool)), this, SLOT(setFixedReferenceCameraEnabled(bool)));
@@ -633,43 +636,6 @@ void qSlicerRoomsEyeViewModuleWidget::loadTreatmentMachineFromFile(QString descr
   std::vector<vtkSlicerRoomsEyeViewModuleLogic::TreatmentMachinePartType> loadedParts =
     d->logic()->LoadTreatmentMachine(paramNode);
 
-  // Warn the user if collision detection is disabled for certain part pairs
-  QString disabledCollisionDetectionMessage(
-    tr("Collision detection for the following part pairs may take very long due to high triangle numbers:\n\n"));
-  bool collisionDetectionDisabled = false;
-  if (d->logic()->GetGantryTableTopCollisionDetection()->GetInputData(0) == nullptr)
-  {
-    disabledCollisionDetectionMessage.append("Gantry-TableTop\n");
-    collisionDetectionDisabled = true;
-  }
-  if (d->logic()->GetGantryPatientSupportCollisionDetection()->GetInputData(0) == nullptr)
-  {
-    disabledCollisionDetectionMessage.append("Gantry-PatientSupport\n");
-    collisionDetectionDisabled = true;
-  }
-  if (d->logic()->GetCollimatorTableTopCollisionDetection()->GetInputData(0) == nullptr)
-  {
-    disabledCollisionDetectionMessage.append("Collimator-TableTop\n");
-    collisionDetectionDisabled = true;
-  }
-  disabledCollisionDetectionMessage.append(tr("\nWhat would you like to do?"));
-  if (collisionDetectionDisabled)
-  {
-    ctkMessageBox* existingMachineMsgBox = new ctkMessageBox(this);
-    existingMachineMsgBox->setWindowTitle(tr("Collision detection might take too long"));
-    existingMachineMsgBox->setText(disabledCollisionDetectionMessage);
-    existingMachineMsgBox->addButton(tr("Disable on these part pairs"), QMessageBox::AcceptRole);
-    existingMachineMsgBox->addButton(tr("Calculate anyway"), QMessageBox::RejectRole);
-    existingMachineMsgBox->setIcon(QMessageBox::Warning);
-    existingMachineMsgBox->exec();
-    int resultCode = existingMachineMsgBox->buttonRole(existingMachineMsgBox->clickedButton());
-    if (resultCode == QMessageBox::RejectRole)
-    {
-      // Set up treatment machine models again but make sure collision detection is not disabled between any parts
-      d->logic()->SetupTreatmentMachineModels(paramNode, true);
-    }
-  }
-
   // Set treatment machine dependent properties  //TODO: Use degrees of freedom from JSON
   if (!treatmentMachineType.compare("VarianTrueBeamSTx"))
   {
@@ -928,6 +894,25 @@ void qSlicerRoomsEyeViewModuleWidget::onLateralTableTopDisplacementSliderValueCh
   d->getLayoutManager()->resumeRender();
 }
 
+//-----------------------------------------------------------------------------
+void qSlicerRoomsEyeViewModuleWidget::onClearanceThresholdValueChanged(double value)
+{
+  Q_D(qSlicerRoomsEyeViewModuleWidget);
+
+  vtkMRMLRoomsEyeViewNode* paramNode = vtkMRMLRoomsEyeViewNode::SafeDownCast(d->MRMLNodeComboBox_ParameterSet->currentNode());
+  if (!paramNode || !d->ModuleWindowInitialized)
+  {
+    return;
+  }
+
+  paramNode->DisableModifiedEventOn();
+  paramNode->SetClearanceThreshold(value);
+  paramNode->DisableModifiedEventOff();
+
+  // Clearance warnings depend on the threshold
+  this->checkForCollisions();
+}
+
 //-----------------------------------------------------------------------------
 void qSlicerRoomsEyeViewModuleWidget::onBeamsEyeViewButtonClicked()
 {
@@ -1022,15 +1007,36 @@ void qSlicerRoomsEyeViewModuleWidget::checkForCollisions()
   }
   else
   {
-    QString noCollisionsMessage(tr("No collisions detected"));
-    if (d->logic()->GetGantryTableTopCollisionDetection()->GetInputData(0) == nullptr
-     || d->logic()->GetGantryPatientSupportCollisionDetection()->GetInputData(0) == nullptr
-     || d->logic()->GetCollimatorTableTopCollisionDetection()->GetInputData(0) == nullptr)
+    // Warn about part pairs that are closer to each other than the safety margin
+    QStringList clearanceWarnings;
+    if (paramNode->GetCollisionDetectionEnabled() && d->logic()->CalculateClearances(paramNode))
+    {
+      double clearanceThreshold = paramNode->GetClearanceThreshold();
+      QList< QPair<QString, double> > clearances;
+      clearances << qMakePair(tr("gantry and table top"), paramNode->GetGantryTableTopClearance())
+        << qMakePair(tr("gantry and patient support"), paramNode->GetGantryPatientSupportClearance())
+        << qMakePair(tr("collimator and table top"), paramNode->GetCollimatorTableTopClearance())
+        << qMakePair(tr("gantry and patient"), paramNode->GetGantryPatientClearance())
+        << qMakePair(tr("collimator and patient"), paramNode->GetCollimatorPatientClearance());
+      for (const QPair<QString, double>& clearance : clearances)
+      {
+        if (clearance.second >= 0.0 && clearance.second < clearanceThreshold)
+        {
+          clearanceWarnings << tr("Clearance between %1 is less than %2 mm").arg(clearance.first).arg(clearanceThreshold);
+        }
+      }
+    }
+
+    if (clearanceWarnings.isEmpty())
+    {
+      d->CollisionDetectionStatusLabel->setText(tr("No collisions detected"));
+      d->CollisionDetectionStatusLabel->setStyleSheet("color: green");
+    }
+    else
     {
-      noCollisionsMessage.append(tr(" (excluding certain parts)"));
+      d->CollisionDetectionStatusLabel->setText(tr("No collisions detected") + "\n" + clearanceWarnings.join("\n"));
+      d->CollisionDetectionStatusLabel->setStyleSheet("color: orange");
     }
-    d->CollisionDetectionStatusLabel->setText(noCollisionsMessage);
-    d->CollisionDetectionStatusLabel->setStyleSheet("color: green");
   }
 }
 
@@ -80,6 +80,8 @@ protected slots:
   void onLongitudinalTableTopDisplacementSliderValueChanged(double);
   void onLateralTableTopDisplacementSliderValueChanged(double);
 
+  void onClearanceThresholdValueChanged(double);
+
   void onBeamsEyeViewButtonClicked();
 
   void onBeamNodeChanged(vtkMRMLNode*);
@@ -102,6 +102,8 @@ public:
   static const std::string DICOMRTIMPORT_BEAM_NUMBER_ATTRIBUTE_NAME;
   static const std::string DICOMRTIMPORT_ROI_REFERENCED_SERIES_UID_ATTRIBUTE_NAME;
   static const std::string DICOMRTIMPORT_ROI_NUMBER_SEGMENT_TAG_NAME;
+  static const std::string DICOMRTIMPORT_ROI_BOUNDS_SEGMENT_TAG_NAME;
+  static const std::string DICOMRTIMPORT_STRUCTURE_SET_SOP_INSTANCE_UID_SEGMENT_TAG_NAME;
   static const std::string DICOMRTIMPORT_RTIMAGE_IDENTIFIER_ATTRIBUTE_NAME;
   static const std::string DICOMRTIMPORT_RTIMAGE_SID_ATTRIBUTE_NAME;
   static const std::string DICOMRTIMPORT_RTIMAGE_POSITION_ATTRIBUTE_NAME;